@@ -70,6 +70,7 @@ using namespace rowgroup;
 
 #include "installdir.h"
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/version.hpp>
@@ -426,6 +427,7 @@ void CalpontSystemCatalog::TableAliasName::unserialize(messageqcpp::ByteStream&
 
 /*static*/
 boost::mutex CalpontSystemCatalog::map_mutex;
+CalpontSystemCatalog::SnapshotPtr CalpontSystemCatalog::fSnapshot;
 /*static*/
 CalpontSystemCatalog::CatalogMap CalpontSystemCatalog::fCatalogMap;
 /*static*/
@@ -550,7 +552,18 @@ CalpontSystemCatalog::OID CalpontSystemCatalog::lookupOID(const TableColName& ta
     //Check whether cache needs to be flushed
     if ( aTableColName.schema.compare(CALPONT_SCHEMA) != 0)
     {
-        checkSysCatVer();
+        SnapshotPtr snap = currentSnapshot();
+
+        if (snap)
+        {
+            OIDmap::const_iterator iter = snap->oids.find(aTableColName);
+
+            if (iter != snap->oids.end() &&
+                    (fIdentity != EC || snap->colRIDs.find(aTableColName) != snap->colRIDs.end()))
+                return iter->second;
+
+            checkSysCatVer(snap->scn);
+        }
     }
 
     boost::mutex::scoped_lock lk2(fOIDmapLock);
@@ -1089,7 +1102,17 @@ const CalpontSystemCatalog::ColType CalpontSystemCatalog::colType(const OID& Oid
     //Check whether cache needs to be flushed
     if ( Oid >= 3000)
     {
-        checkSysCatVer();
+        SnapshotPtr snap = currentSnapshot();
+
+        if (snap)
+        {
+            Colinfomap::const_iterator iter = snap->colTypes.find(Oid);
+
+            if (iter != snap->colTypes.end())
+                return iter->second;
+
+            checkSysCatVer(snap->scn);
+        }
     }
 
     // check colinfomap first for system table column or cached column type
@@ -1409,7 +1432,17 @@ const CalpontSystemCatalog::TableColName CalpontSystemCatalog::colName(const OID
     //Check whether cache needs to be flushed
     if ( oid >= 3000)
     {
-        checkSysCatVer();
+        SnapshotPtr snap = currentSnapshot();
+
+        if (snap)
+        {
+            std::map<OID, TableColName>::const_iterator iter = snap->colNames.find(oid);
+
+            if (iter != snap->colNames.end())
+                return iter->second;
+
+            checkSysCatVer(snap->scn);
+        }
     }
 
     // check oidmap for system table columns and cached columns
@@ -1957,6 +1990,64 @@ boost::shared_ptr<CalpontSystemCatalog> CalpontSystemCatalog::makeCalpontSystemC
     return it->second;
 }
 
+/* static */
+CalpontSystemCatalog::SnapshotPtr CalpontSystemCatalog::snapshot(SCN scn)
+{
+    SnapshotPtr snap = boost::atomic_load(&fSnapshot);
+
+    if (snap && snap->scn == scn)
+        return snap;
+
+    return SnapshotPtr();
+}
+
+/* static */
+void CalpontSystemCatalog::refreshSnapshot()
+{
+    SessionManager sm;
+    SCN scn = sm.sysCatVerID().currentScn;
+    SnapshotPtr cur = boost::atomic_load(&fSnapshot);
+
+    if (scn < 0 || (cur && cur->scn == scn))
+        return;
+
+    // Built by a catalog of its own, so it doesn't flush any session's caches.
+    // The version moves both when a DDL starts and when it ends, so one built
+    // while a DDL was running is never current again and the next call redoes it.
+    boost::scoped_ptr<CalpontSystemCatalog> builder(new CalpontSystemCatalog());
+    boost::shared_ptr<Snapshot> snap(new Snapshot());
+    vector<pair<OID, TableName> > tables = builder->getTables();
+
+    for (uint32_t i = 0; i < tables.size(); i++)
+        snap->schemas.insert(tables[i].second.schema);
+
+    for (set<string>::const_iterator it = snap->schemas.begin(); it != snap->schemas.end(); ++it)
+        builder->getSchemaInfo(*it);
+
+    {
+        boost::mutex::scoped_lock lk(builder->fOIDmapLock);
+        snap->oids = builder->fOIDmap;
+        snap->colRIDs = builder->fColRIDmap;
+    }
+
+    {
+        boost::mutex::scoped_lock lk(builder->fColinfomapLock);
+        snap->colTypes = builder->fColinfomap;
+    }
+
+    {
+        boost::mutex::scoped_lock lk(builder->fTableInfoMapLock);
+        snap->tables = builder->fTablemap;
+        snap->tableRIDs = builder->fTableRIDmap;
+    }
+
+    for (OIDmap::const_iterator it = snap->oids.begin(); it != snap->oids.end(); ++it)
+        snap->colNames[it->second] = it->first;
+
+    snap->scn = scn;
+    boost::atomic_store(&fSnapshot, SnapshotPtr(snap));
+}
+
 /* static */
 void CalpontSystemCatalog::removeCalpontSystemCatalog(uint32_t sessionID)
 {
@@ -3538,7 +3629,22 @@ const CalpontSystemCatalog::ROPair CalpontSystemCatalog::tableRID(const TableNam
 
     lk1.unlock();
 
-    checkSysCatVer();
+    SnapshotPtr snap = currentSnapshot();
+
+    if (snap)
+    {
+        iter = snap->tables.find(aTableName);
+        TableRIDmap::const_iterator rid_iter = snap->tableRIDs.find(aTableName);
+
+        if (iter != snap->tables.end() && rid_iter != snap->tableRIDs.end())
+        {
+            rp.objnum = (*iter).second;
+            rp.rid = (*rid_iter).second;
+            return rp;
+        }
+
+        checkSysCatVer(snap->scn);
+    }
 
     lk1.lock();
     iter = fTablemap.find(aTableName);
@@ -5312,7 +5418,14 @@ void CalpontSystemCatalog::getSchemaInfo(const string& in_schema, int lower_case
         DEBUG << "Enter getSchemaInfo: " << schema << endl;
 
     //Check whether cache needs to be flushed
-    checkSysCatVer();
+    SnapshotPtr snap = currentSnapshot();
+
+    // the snapshot answers for this schema's columns
+    if (snap && snap->schemas.count(schema) > 0)
+        return;
+
+    if (snap)
+        checkSysCatVer(snap->scn);
 
     boost::mutex::scoped_lock lk(fSchemaCacheLock);
     set<string>::iterator setIt = fSchemaCache.find(schema);
@@ -6069,9 +6182,12 @@ void CalpontSystemCatalog::buildSysDctmap()
     fDctTokenMap[DICTOID_SYSCOLUMN_MAXVALUE] = OID_SYSCOLUMN_MAXVALUE;
 }
 
-void CalpontSystemCatalog::checkSysCatVer()
+/* Flushes the caches if the catalog version isn't the one they were built
+   from.  newScn is the version if the caller just fetched it, else < 0. */
+void CalpontSystemCatalog::checkSysCatVer(SCN newScn)
 {
-    SCN newScn = fSessionManager->sysCatVerID().currentScn;
+    if (newScn < 0)
+        newScn = fSessionManager->sysCatVerID().currentScn;
 
     if (newScn < 0)
     {
@@ -6087,6 +6203,24 @@ void CalpontSystemCatalog::checkSysCatVer()
     }
 }
 
+/* Returns the shared snapshot if it's current, without touching this catalog's
+   locks.  Otherwise flushes this catalog's caches if they're out of date, the
+   caller falls back to them; so must one that doesn't find what it wants in
+   the snapshot. */
+CalpontSystemCatalog::SnapshotPtr CalpontSystemCatalog::currentSnapshot()
+{
+    SCN scn = fSessionManager->sysCatVerID().currentScn;
+    SnapshotPtr snap;
+
+    if (scn >= 0)
+        snap = snapshot(scn);
+
+    if (!snap)
+        checkSysCatVer(scn);
+
+    return snap;
+}
+
 CalpontSystemCatalog::ColType::ColType() : 
     constraintType(NO_CONSTRAINT), 
     defaultValue(""), 
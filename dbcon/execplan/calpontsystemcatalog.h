@@ -745,6 +745,12 @@ public:
      *  @param sessionID
      */
     static void removeCalpontSystemCatalog(uint32_t sessionID = 0);
+
+    /** rebuilds the catalog snapshot shared by all the sessions of this
+     *  process, if there's none yet or DDL changed the catalog since.
+     *  Until it's called each session's catalog caches on its own.
+     */
+    static void refreshSnapshot();
     /** sessionid access and mutator methods
      *
      */
@@ -827,7 +833,7 @@ private:
     void buildSysTablemap();
     void buildSysDctmap();
 
-    void checkSysCatVer();
+    void checkSysCatVer(SCN newScn = -1);
 
     static boost::mutex map_mutex;
     static CatalogMap fCatalogMap;
@@ -882,6 +888,31 @@ private:
     boost::mutex  fSyscatSCNLock;
     SCN fSyscatSCN;
 
+    /** An immutable copy of the table & column caches, built in bulk and
+     *  shared by every session.  Readers look columns up in it without taking
+     *  the locks above, and a new session's first queries don't have to query
+     *  the system catalog.  It's replaced as a whole when DDL bumps the
+     *  catalog version.
+     */
+    struct Snapshot
+    {
+        SCN scn;
+        OIDmap oids;
+        ColRIDmap colRIDs;
+        std::map<OID, TableColName> colNames;
+        Colinfomap colTypes;
+        Tablemap tables;
+        TableRIDmap tableRIDs;
+        std::set<std::string> schemas;
+    };
+    typedef boost::shared_ptr<const Snapshot> SnapshotPtr;
+
+    /** returns the snapshot if it was built from catalog version scn */
+    static SnapshotPtr snapshot(SCN scn);
+    SnapshotPtr currentSnapshot();
+
+    static SnapshotPtr fSnapshot;   // only accessed with atomic_load()/atomic_store()
+
     static uint32_t fModuleID;
 };
 
@@ -404,6 +404,9 @@ bool ConstantColumn::operator!=(const TreeNode* t) const
 
 void ConstantColumn::constructRegex()
 {
+    fLikeMatcher.reset(new utils::LikeMatcher());
+    fLikeMatcher->compileLike(fResult.strVal.data(), fResult.strVal.length());
+
     //fRegex = new regex_t();
     fRegex.reset(new CNX_Regex());
 #ifdef POSIX_REGEX
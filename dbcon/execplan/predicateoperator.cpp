@@ -399,6 +399,15 @@ bool PredicateOperator::getBoolVal(rowgroup::Row& row, bool& isNull, ReturnedCol
 //        c[v.length()] = 0;
 //        std::string vv(c);
 
+        SP_LikeMatcher matcher = rop->likeMatcher();
+
+        if (matcher && matcher->literal())
+        {
+            // stop at the null padding, as regexec() does
+            bool ret = matcher->match(v.c_str(), strlen(v.c_str()));
+            return (((fOp == OP_LIKE) ? ret : !ret) && !isNull);
+        }
+
         if (regex)
         {
 #ifdef POSIX_REGEX
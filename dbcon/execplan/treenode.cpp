@@ -51,6 +51,7 @@ TreeNode::TreeNode(const TreeNode& rhs):
     fResultType(rhs.resultType()),
     fOperationType(rhs.operationType()),
     fRegex (rhs.regex()),
+    fLikeMatcher (rhs.likeMatcher()),
     fDerivedTable (rhs.derivedTable()),
     fRefCount(rhs.refCount()),
     fDerivedRefCol(rhs.derivedRefCol())
@@ -36,6 +36,7 @@
 #include "exceptclasses.h"
 #include "dataconvert.h"
 #include "columnwidth.h"
+#include "likematcher.h"
 #include "mcs_decimal.h"
 
 namespace messageqcpp
@@ -72,6 +73,8 @@ typedef IDB_Regex CNX_Regex;
 typedef boost::shared_ptr<IDB_Regex> SP_IDB_Regex;
 typedef SP_IDB_Regex SP_CNX_Regex;
 
+typedef boost::shared_ptr<utils::LikeMatcher> SP_LikeMatcher;
+
 /** Trim trailing 0 from val. All insignificant zeroes to the right of the
  *  decimal point are removed. Also, the decimal point is not included on
  *  whole numbers. It works like %g flag with printf, but always print
@@ -353,6 +356,16 @@ public:
         return fRegex;
     }
 
+    // literal LIKE matcher, set alongside the regex. used instead of it when literal()
+    virtual void likeMatcher(SP_LikeMatcher matcher)
+    {
+        fLikeMatcher = matcher;
+    }
+    virtual SP_LikeMatcher likeMatcher() const
+    {
+        return fLikeMatcher;
+    }
+
     uint32_t charsetNumber() const
     {
         return fResultType.charsetNumber;
@@ -368,6 +381,7 @@ protected:
     execplan::CalpontSystemCatalog::ColType fResultType; // mapped from mysql data type
     execplan::CalpontSystemCatalog::ColType fOperationType; // operator type, could be different from the result type
     SP_IDB_Regex fRegex;
+    SP_LikeMatcher fLikeMatcher;
 
     // double's range is +/-1.7E308 with at least 15 digits of precision
     char tmp[312]; // for conversion use
@@ -73,7 +73,11 @@ BatchPrimitiveProcessorJL::BatchPrimitiveProcessorJL(const ResourceManager* rm)
     status(0),
     sendRowGroups(false),
     valueColumn(0),
+    topNCount(0),
     sendTupleJoinRowGroupData(false),
+    shuffle(false),
+    shufflePartCount(0),
+    shufflePart(0),
     bop(BOP_AND),
     forHJ(false),
     threadCount(1),
@@ -747,8 +751,9 @@ void BatchPrimitiveProcessorJL::deserializeAggregateResult(ByteStream* in,
 
 void BatchPrimitiveProcessorJL::getRowGroupData(ByteStream& in, vector<RGData>* out,
         bool* validCPData, uint64_t* lbid, int128_t* min, int128_t* max,
-        uint32_t* cachedIO, uint32_t* physIO, uint32_t* touchedBlocks, bool* countThis,
-        uint32_t threadID, bool* hasWideColumn, const execplan::CalpontSystemCatalog::ColType& colType) const
+        uint32_t* cachedIO, uint32_t* physIO, uint32_t* touchedBlocks, uint32_t* pmAggFlushes,
+        bool* countThis, uint32_t threadID, bool* hasWideColumn,
+        const execplan::CalpontSystemCatalog::ColType& colType, bool* fromShuffle) const
 {
     uint64_t tmp64;
     int128_t tmp128;
@@ -769,6 +774,7 @@ void BatchPrimitiveProcessorJL::getRowGroupData(ByteStream& in, vector<RGData>*
         *cachedIO = 0;
         *physIO = 0;
         *touchedBlocks = 0;
+        *pmAggFlushes = 0;
         return;
     }
 
@@ -878,17 +884,54 @@ void BatchPrimitiveProcessorJL::getRowGroupData(ByteStream& in, vector<RGData>*
         in >> *cachedIO;
         in >> *physIO;
         in >> *touchedBlocks;
+
+        // # of times the PM flushed its bounded partial aggregation early
+        if (aggregatorPM)
+            in >> *pmAggFlushes;
+        else
+            *pmAggFlushes = 0;
     }
     else
     {
         *cachedIO = 0;
         *physIO = 0;
         *touchedBlocks = 0;
+        *pmAggFlushes = 0;
+    }
+
+    if (fromShuffle)
+        *fromShuffle = false;
+
+    // the trailer was already looked at by shuffleDelta()
+    if (shuffle)
+    {
+        if (*countThis)
+        {
+            uint32_t shuffleCount;
+            in >> shuffleCount;
+        }
+        else
+        {
+            in >> tmp8;
+
+            if (fromShuffle)
+                *fromShuffle = (tmp8 != SHUFFLE_MSG_NONE);
+        }
     }
 
     idbassert(in.length() == 0);
 }
 
+int32_t BatchPrimitiveProcessorJL::shuffleDelta(const ByteStream& in, bool counted)
+{
+    const uint8_t* end = in.buf() + in.length();
+
+    if (counted)
+        return *((const uint32_t*) (end - sizeof(uint32_t)));
+
+    return (end[-1] == SHUFFLE_MSG_LAST ? -1 : 0);
+}
+
 //boost::shared_array<uint8_t>
 RGData
 BatchPrimitiveProcessorJL::getErrorRowGroupData(uint16_t error) const
@@ -990,7 +1033,7 @@ string BatchPrimitiveProcessorJL::toString() const
  * (projection count)x serialized Commands
  */
 
-void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
+void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs, uint32_t pm) const
 {
     ISMPacketHeader ism;
     uint32_t i;
@@ -1033,6 +1076,9 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
     if (wideColumnsWidths)
         flags |= HAS_WIDE_COLUMNS;
 
+    if (shuffle)
+        flags |= SHUFFLE_JOIN;
+
     bs << flags;
 
     if (wideColumnsWidths)
@@ -1087,7 +1133,10 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
 
             for (i = 0; i < PMJoinerCount; i++)
             {
-                bs << (uint32_t) tJoiners[i]->size();
+                if (shuffle)
+                    bs << (uint32_t) shuffleRows[pm].size();
+                else
+                    bs << (uint32_t) tJoiners[i]->size();
                 bs << tJoiners[i]->getJoinType();
 
                 //bs << (uint64_t) tJoiners[i]->smallNullValue();
@@ -1129,6 +1178,13 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
                 bs << joinedRG;    // TODO: I think we can omit joinedRG if (!(fe2 || aggregatorPM))
 // 				cout << "joined RG: " << joinedRG.toString() << endl;
             }
+
+            if (shuffle)
+            {
+                bs << pm;
+                bs << shufflePartCount;
+                serializeVector<string>(bs, shufflePeers);
+            }
         }
     }
 
@@ -1158,6 +1214,24 @@ void BatchPrimitiveProcessorJL::createBPP(ByteStream& bs) const
         {
             bs << (uint8_t) 0;
         }
+
+        if (topNCount > 0)
+        {
+            bs << (uint8_t) 1;
+            bs << topNCount;
+            bs << (uint32_t) topNSpecs.size();
+
+            for (i = 0; i < topNSpecs.size(); i++)
+            {
+                bs << (int32_t) topNSpecs[i].fIndex;
+                bs << (int32_t) topNSpecs[i].fAsc;
+                bs << (int32_t) topNSpecs[i].fNf;
+            }
+        }
+        else
+        {
+            bs << (uint8_t) 0;
+        }
     }
 
     // decide which rowgroup is received by PrimProc
@@ -1372,24 +1446,211 @@ bool BatchPrimitiveProcessorJL::pickNextJoinerNum()
     pos = posByJoinerNum[joinerNum];
     return true;
 }
-    
+
+// same thing for the partitions of a shuffle join.  Set shufflePart & pos.
+bool BatchPrimitiveProcessorJL::pickNextShufflePart()
+{
+    uint i;
+
+    for (i = 0; i < shufflePartCount; i++)
+    {
+        shufflePart = (shufflePart + 1) % shufflePartCount;
+
+        if (shufflePos[shufflePart] != shuffleRows[shufflePart].size())
+            break;
+    }
+
+    if (i == shufflePartCount)
+        return false;
+
+    joinerNum = 0;
+    pos = shufflePos[shufflePart];
+    return true;
+}
+
+// The key of a small side row as the PM hash table stores it
+uint64_t BatchPrimitiveProcessorJL::typedSmallKey(Row& r, joiner::TupleJoiner& tj)
+{
+    uint32_t smallKeyCol = tj.getSmallKeyColumns()[0];
+    uint32_t largeKeyCol = tj.getLargeKeyColumns()[0];
+    bool bSignedUnsigned = r.isUnsigned(smallKeyCol) != tj.getLargeRG().isUnsigned(largeKeyCol);
+    uint64_t smallkey;
+
+    if ( r.getColType(smallKeyCol)== CalpontSystemCatalog::LONGDOUBLE)
+    {
+        // Small side is a long double. Since CS can't store larger than DOUBLE,
+        // we need to convert to whatever type large side is -- double or int64
+        long double smallkeyld = r.getLongDoubleField(smallKeyCol);
+        switch (tj.getLargeRG().getColType(largeKeyCol))
+        {
+            case CalpontSystemCatalog::DOUBLE:
+            case CalpontSystemCatalog::UDOUBLE:
+            case CalpontSystemCatalog::FLOAT:
+            case CalpontSystemCatalog::UFLOAT:
+            {
+                if (smallkeyld > MAX_DOUBLE || smallkeyld < MIN_DOUBLE)
+                {
+                    smallkey = joblist::UBIGINTEMPTYROW;
+                }
+                else
+                {
+                    double d = (double)smallkeyld;
+                    smallkey = *(int64_t*)&d;
+                }
+                break;
+            }
+            default:
+            {   
+                if (r.isUnsigned(smallKeyCol) && smallkeyld > MAX_UBIGINT)
+                {
+                    smallkey = joblist::UBIGINTEMPTYROW;
+                }
+                else if (smallkeyld > MAX_BIGINT || smallkeyld < MIN_BIGINT)
+                {
+                    smallkey = joblist::UBIGINTEMPTYROW;
+                }
+                else
+                {
+                    smallkey = (int64_t)smallkeyld;
+                }
+                break;
+            }
+        }
+    }
+    else if (r.isUnsigned(smallKeyCol))
+        smallkey = r.getUintField(smallKeyCol);
+    else
+        smallkey = r.getIntField(smallKeyCol);
+
+    // If this is a compare signed vs unsigned and the sign bit is on for this value, then all compares
+    // against the large side should fall. UBIGINTEMPTYROW is not a valid value, so nothing will match.
+    if (bSignedUnsigned && (smallkey & 0x8000000000000000ULL))
+        smallkey = joblist::UBIGINTEMPTYROW;
+
+    return smallkey;
+}
+
+// Makes the typeless key of a small side row.  Returns true if the key is null,
+// those aren't sent to the PM.
+bool BatchPrimitiveProcessorJL::typelessSmallKey(Row& r, joiner::TupleJoiner& tj,
+        utils::FixedAllocator* fa, joiner::TypelessData* key)
+{
+    uint32_t j, smallKeyCol, largeKeyCol;
+    uint64_t smallkey;
+    bool isNull = false;
+    bool bSignedUnsigned = tj.isSignedUnsignedJoin();
+
+    for (j = 0; j < tj.getSmallKeyColumns().size(); j++)
+    {
+        isNull |= r.isNullValue(tj.getSmallKeyColumns()[j]);
+
+        if (UNLIKELY(bSignedUnsigned))
+        {
+            // BUG 5628 If this is a signed/unsigned join column and the sign bit is set on either side,
+            // then it should not compare. Send null to PM to prevent compare
+            smallKeyCol = tj.getSmallKeyColumns()[j];
+            largeKeyCol = tj.getLargeKeyColumns()[j];
+
+            if (r.isUnsigned(smallKeyCol) != tj.getLargeRG().isUnsigned(largeKeyCol))
+            {
+                if (r.isUnsigned(smallKeyCol))
+                    smallkey = r.getUintField(smallKeyCol);
+                else
+                    smallkey = r.getIntField(smallKeyCol);
+
+                if (smallkey & 0x8000000000000000ULL)
+                {
+                    isNull = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!isNull)
+    {
+        *key = makeTypelessKey(r, tj.getSmallKeyColumns(),
+                               tj.getKeyLength(), fa,
+                               tj.getLargeRG(), tj.getLargeKeyColumns());
+        if (key->len == 0)
+        {
+            isNull = true;
+        }
+    }
+
+    return isNull;
+}
+
+void BatchPrimitiveProcessorJL::partitionSmallSide(joiner::TupleJoiner& tj, uint32_t partCount,
+        vector<vector<uint32_t> >* parts)
+{
+    vector<Row::Pointer>* tSmallSide = tj.getSmallSide();
+    Row r;
+    uint32_t i, part;
+
+    parts->clear();
+    parts->resize(partCount);
+    tj.getSmallRG().initRow(&r);
+
+    /* A row goes to the PM that will see the large side rows with the same key,
+       the PMs pick it the same way in BatchPrimitiveProcessor::shuffleRows() */
+    if (tj.isTypelessJoin())
+    {
+        utils::FixedAllocator fa(tj.getKeyLength(), true);
+        joiner::TypelessData tlData;
+
+        for (i = 0; i < tSmallSide->size(); i++)
+        {
+            r.setPointer((*tSmallSide)[i]);
+
+            if (typelessSmallKey(r, tj, &fa, &tlData))
+                part = 0;
+            else
+                part = shufflePartition(tlData.hash(tj.getLargeRG(), tj.getLargeKeyColumns()),
+                                        partCount);
+
+            (*parts)[part].push_back(i);
+        }
+    }
+    else
+    {
+        for (i = 0; i < tSmallSide->size(); i++)
+        {
+            r.setPointer((*tSmallSide)[i]);
+            (*parts)[shufflePartition(typedSmallKey(r, tj), partCount)].push_back(i);
+        }
+    }
+}
+
+void BatchPrimitiveProcessorJL::setShuffle(const vector<string>& peers)
+{
+    idbassert(PMJoinerCount == 1 && peers.size() == tJoiners[0]->getPmPartitions().size());
+    shuffle = true;
+    shufflePartCount = peers.size();
+    shufflePart = shufflePartCount - 1;
+    shufflePeers = peers;
+    shuffleRows = tJoiners[0]->getPmPartitions();
+    shufflePos.assign(shufflePartCount, 0);
+}
+
 /* This algorithm relies on the joiners being sorted by size atm */
 /* XXXPAT: Going to interleave across joiners to take advantage of the new locking env in PrimProc */
-bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
+bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs, int32_t* pm)
 {
     uint32_t size = 0, toSend, i, j;
     ISMPacketHeader ism;
     Row r;
     vector<Row::Pointer>* tSmallSide;
     joiner::TypelessData tlData;
-    uint32_t smallKeyCol;
-    uint32_t largeKeyCol;
-    uint64_t smallkey;
     bool isNull;
-    bool bSignedUnsigned;
+    // on a shuffle join the rows of a msg are the small side rows shuffleRows[shufflePart][pos...]
+    const uint32_t* rowNums = NULL;
     
-    bool moreMsgs = pickNextJoinerNum();
+    bool moreMsgs = (shuffle ? pickNextShufflePart() : pickNextJoinerNum());
     
+    if (pm)
+        *pm = (shuffle && moreMsgs ? (int32_t) shufflePart : -1);
+
     if (!moreMsgs)
     {
         /* last message */
@@ -1406,6 +1667,12 @@ bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
     tSmallSide = tJoiners[joinerNum]->getSmallSide();
     size = tSmallSide->size();
 
+    if (shuffle)
+    {
+        size = shuffleRows[shufflePart].size();
+        rowNums = &shuffleRows[shufflePart][0];
+    }
+
 #if 0
     if (joinerNum == PMJoinerCount - 1 && pos == size)
     {
@@ -1446,58 +1713,23 @@ bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
     bs << pos;
     bs << joinerNum;
 
+    /* The value stored with a key is the row's index in the small side data the
+       PM returns results for.  That's the PM's own copy if it gets the row data,
+       otherwise it's the UM's small side. */
     if (tJoiners[joinerNum]->isTypelessJoin())
     {
         utils::FixedAllocator fa(tlKeyLens[joinerNum], true);
 
         for (i = pos; i < pos + toSend; i++)
         {
-            r.setPointer((*tSmallSide)[i]);
-            isNull = false;
-            bSignedUnsigned = tJoiners[joinerNum]->isSignedUnsignedJoin();
-
-            for (j = 0; j < smallSideKeys[joinerNum].size(); j++)
-            {
-                isNull |= r.isNullValue(smallSideKeys[joinerNum][j]);
+            r.setPointer((*tSmallSide)[rowNums ? rowNums[i] : i]);
+            isNull = typelessSmallKey(r, *tJoiners[joinerNum], &fa, &tlData);
 
-                if (UNLIKELY(bSignedUnsigned))
-                {
-                    // BUG 5628 If this is a signed/unsigned join column and the sign bit is set on either side,
-                    // then it should not compare. Send null to PM to prevent compare
-                    smallKeyCol = smallSideKeys[joinerNum][j];
-                    largeKeyCol = tJoiners[joinerNum]->getLargeKeyColumns()[j];
-
-                    if (r.isUnsigned(smallKeyCol) != largeSideRG.isUnsigned(largeKeyCol))
-                    {
-                        if (r.isUnsigned(smallKeyCol))
-                            smallkey = r.getUintField(smallKeyCol);
-                        else
-                            smallkey = r.getIntField(smallKeyCol);
-
-                        if (smallkey & 0x8000000000000000ULL)
-                        {
-                            isNull = true;
-                            break;
-                        }
-                    }
-                }
-            }
-
-            if (!isNull)
-            {
-                tlData = makeTypelessKey(r, smallSideKeys[joinerNum],
-                                         tlKeyLens[joinerNum], &fa,
-                                         largeSideRG, tJoiners[joinerNum]->getLargeKeyColumns());
-                if (tlData.len == 0)
-                {
-                    isNull = true;
-                }
-            }
             bs << (uint8_t) isNull;
             if (!isNull)
             {
                 tlData.serialize(bs);
-                bs << i;
+                bs << ((rowNums && !sendTupleJoinRowGroupData) ? rowNums[i] : i);
             }
         }
     }
@@ -1513,67 +1745,11 @@ bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
         bs.needAtLeast(toSend * sizeof(JoinerElements));
         arr = (JoinerElements*) bs.getInputPtr();
 
-        smallKeyCol = smallSideKeys[joinerNum][0];
-        bSignedUnsigned = r.isUnsigned(smallKeyCol) != largeSideRG.isUnsigned(tJoiners[joinerNum]->getLargeKeyColumns()[0]);
-        j = 0;
-
         for (i = pos, j = 0; i < pos + toSend; ++i, ++j)
         {
-            r.setPointer((*tSmallSide)[i]);
-
-            if ( r.getColType(smallKeyCol)== CalpontSystemCatalog::LONGDOUBLE)
-            {
-                // Small side is a long double. Since CS can't store larger than DOUBLE,
-                // we need to convert to whatever type large side is -- double or int64
-                long double smallkeyld = r.getLongDoubleField(smallKeyCol);
-                switch (largeSideRG.getColType(tJoiners[joinerNum]->getLargeKeyColumns()[0]))
-                {
-                    case CalpontSystemCatalog::DOUBLE:
-                    case CalpontSystemCatalog::UDOUBLE:
-                    case CalpontSystemCatalog::FLOAT:
-                    case CalpontSystemCatalog::UFLOAT:
-                    {
-                        if (smallkeyld > MAX_DOUBLE || smallkeyld < MIN_DOUBLE)
-                        {
-                            smallkey = joblist::UBIGINTEMPTYROW;
-                        }
-                        else
-                        {
-                            double d = (double)smallkeyld;
-                            smallkey = *(int64_t*)&d;
-                        }
-                        break;
-                    }
-                    default:
-                    {   
-                        if (r.isUnsigned(smallKeyCol) && smallkeyld > MAX_UBIGINT)
-                        {
-                            smallkey = joblist::UBIGINTEMPTYROW;
-                        }
-                        else if (smallkeyld > MAX_BIGINT || smallkeyld < MIN_BIGINT)
-                        {
-                            smallkey = joblist::UBIGINTEMPTYROW;
-                        }
-                        else
-                        {
-                            smallkey = (int64_t)smallkeyld;
-                        }
-                        break;
-                    }
-                }
-            }
-            else if (r.isUnsigned(smallKeyCol))
-                smallkey = r.getUintField(smallKeyCol);
-            else
-                smallkey = r.getIntField(smallKeyCol);
-
-            // If this is a compare signed vs unsigned and the sign bit is on for this value, then all compares
-            // against the large side should fall. UBIGINTEMPTYROW is not a valid value, so nothing will match.
-            if (bSignedUnsigned && (smallkey & 0x8000000000000000ULL))
-                smallkey = joblist::UBIGINTEMPTYROW;
-
-            arr[j].key = (int64_t)smallkey;
-            arr[j].value = i;
+            r.setPointer((*tSmallSide)[rowNums ? rowNums[i] : i]);
+            arr[j].key = (int64_t) typedSmallKey(r, *tJoiners[joinerNum]);
+            arr[j].value = ((rowNums && !sendTupleJoinRowGroupData) ? rowNums[i] : i);
 // 			cout << "sending " << arr[j].key << ", " << arr[j].value << endl;
         }
 
@@ -1592,7 +1768,7 @@ bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
 
         for (i = pos; i < pos + toSend; i++, tmpRow.nextRow())
         {
-            r.setPointer((*tSmallSide)[i]);
+            r.setPointer((*tSmallSide)[rowNums ? rowNums[i] : i]);
             copyRow(r, &tmpRow);
         }
 
@@ -1612,7 +1788,12 @@ bool BatchPrimitiveProcessorJL::nextTupleJoinerMsg(ByteStream& bs)
     }
 
     pos += toSend;
-    posByJoinerNum[joinerNum] = pos;
+
+    if (shuffle)
+        shufflePos[shufflePart] = pos;
+    else
+        posByJoinerNum[joinerNum] = pos;
+
     return true;
 }
 
@@ -1645,6 +1826,12 @@ void BatchPrimitiveProcessorJL::addAggregateStep(const rowgroup::SP_ROWAGG_PM_t&
         sendTupleJoinRowGroupData = true;
 }
 
+void BatchPrimitiveProcessorJL::setTopN(const vector<ordering::IdbSortSpec>& specs, uint64_t count)
+{
+    topNSpecs = specs;
+    topNCount = count;
+}
+
 /* OR hacks */
 void BatchPrimitiveProcessorJL::setBOP(uint32_t op)
 {
@@ -44,6 +44,7 @@
 #include "brm.h"
 #include "command-jl.h"
 #include "resourcemanager.h"
+#include "../../utils/windowfunction/idborderby.h"
 //#include "tableband.h"
 
 namespace joblist
@@ -126,7 +127,8 @@ public:
     void addProjectStep(const pColStep&, const pDictionaryStep&);
     void addProjectStep(const PassThruStep&, const pDictionaryStep&);
 
-    void createBPP(messageqcpp::ByteStream&) const;
+    /* On a shuffle join each PM gets its own create msg, pm picks its partition */
+    void createBPP(messageqcpp::ByteStream&, uint32_t pm = 0) const;
     void destroyBPP(messageqcpp::ByteStream&) const;
 
     /* Call this one last */
@@ -170,11 +172,15 @@ public:
                                      std::vector<rowgroup::RGData>* out) const;
     void getRowGroupData(messageqcpp::ByteStream& in, std::vector<rowgroup::RGData>* out,
                          bool* validCPData, uint64_t* lbid, int128_t* min, int128_t* max,
-                         uint32_t* cachedIO,	uint32_t* physIO, uint32_t* touchedBlocks, bool* countThis,
-                         uint32_t threadID, bool* hasBinaryColumn, const execplan::CalpontSystemCatalog::ColType& colType) const;
+                         uint32_t* cachedIO,	uint32_t* physIO, uint32_t* touchedBlocks, uint32_t* pmAggFlushes,
+                         bool* countThis, uint32_t threadID, bool* hasBinaryColumn,
+                         const execplan::CalpontSystemCatalog::ColType& colType,
+                         bool* fromShuffle = NULL) const;
     void deserializeAggregateResult(messageqcpp::ByteStream* in,
                                     std::vector<rowgroup::RGData>* out) const;
     bool countThisMsg(messageqcpp::ByteStream& in) const;
+    /* The change in the # of shuffled row groups still being joined, see SHUFFLE_MSG_NONE */
+    static int32_t shuffleDelta(const messageqcpp::ByteStream& in, bool counted);
 
     void setStatus(uint16_t s)
     {
@@ -207,11 +213,30 @@ public:
 
     /* Aggregation */
     void addAggregateStep(const rowgroup::SP_ROWAGG_PM_t&, const rowgroup::RowGroup&);
+    bool hasAggregateStep() const
+    {
+        return aggregatorPM.get() != NULL;
+    }
     void setJoinedRowGroup(const rowgroup::RowGroup& rg);
 
+    /* Top-N pushdown for ORDER BY ... LIMIT, specs index the rowgroup PrimProc returns */
+    void setTopN(const std::vector<ordering::IdbSortSpec>& specs, uint64_t count);
+    uint64_t getTopNCount() const
+    {
+        return topNCount;
+    }
+
     /* Tuple hashjoin */
     void useJoiners(const std::vector<boost::shared_ptr<joiner::TupleJoiner> >&);
-    bool nextTupleJoinerMsg(messageqcpp::ByteStream&);
+    /* pm returns the PM the msg is for, -1 for all of them */
+    bool nextTupleJoinerMsg(messageqcpp::ByteStream&, int32_t* pm = NULL);
+    /* Shuffle join: splits a PM joiner's small side into partCount partitions by
+       key, parts gets the small side row #s of each one. */
+    static void partitionSmallSide(joiner::TupleJoiner&, uint32_t partCount,
+                                   std::vector<std::vector<uint32_t> >* parts);
+    /* Shuffle join: sends the only PM joiner's partitions (see
+       TupleJoiner::setPartitionedOnPM()) to peers, the PrimProcs that own them, in order. */
+    void setShuffle(const std::vector<std::string>& peers);
 // 	void setSmallSideKeyColumn(uint32_t col);
 
     /* OR hacks */
@@ -317,6 +342,10 @@ private:
 
     /* for Joiner serialization */
     bool pickNextJoinerNum();
+    bool pickNextShufflePart();
+    static uint64_t typedSmallKey(rowgroup::Row& r, joiner::TupleJoiner&);
+    static bool typelessSmallKey(rowgroup::Row& r, joiner::TupleJoiner&, utils::FixedAllocator* fa,
+                                 joiner::TypelessData* key);
     uint32_t pos, joinerNum;
     boost::shared_ptr<std::vector<ElementType> > smallSide;
     boost::scoped_array<uint32_t> posByJoinerNum;
@@ -331,6 +360,10 @@ private:
     rowgroup::SP_ROWAGG_PM_t aggregatorPM;
     rowgroup::RowGroup aggregateRGPM;
 
+    /* for top-N pushdown */
+    std::vector<ordering::IdbSortSpec> topNSpecs;
+    uint64_t topNCount;
+
     /* UM portion of the PM join alg */
     std::vector<boost::shared_ptr<joiner::TupleJoiner> > tJoiners;
     std::vector<rowgroup::RowGroup> smallSideRGs;
@@ -340,6 +373,14 @@ private:
     bool sendTupleJoinRowGroupData;
     uint32_t PMJoinerCount;
 
+    /* Shuffle join, shuffleRows has the small side row #s of each partition */
+    bool shuffle;
+    uint32_t shufflePartCount;
+    uint32_t shufflePart;
+    std::vector<std::vector<uint32_t> > shuffleRows;
+    std::vector<uint32_t> shufflePos;
+    std::vector<std::string> shufflePeers;
+
     /* OR hack */
     uint8_t bop;   // BOP_AND or BOP_OR
     bool    forHJ; // indicate if feeding a hashjoin, doJoin does not cover smallside
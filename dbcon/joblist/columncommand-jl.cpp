@@ -177,6 +177,15 @@ void ColumnCommandJL::createCommand(ByteStream& bs) const
 void ColumnCommandJL::runCommand(ByteStream& bs) const
 {
     bs << lbid;
+
+    // Scans send the CP state of the extent so the PM can validate its block zone map
+    if (isScan)
+    {
+        const BRM::EMCasualPartition_t& cpRange = extents[currentExtentIndex].partition.cprange;
+
+        bs << (uint8_t) (cpRange.isValid == BRM::CP_VALID);
+        bs << (int32_t) cpRange.sequenceNum;
+    }
 }
 
 void ColumnCommandJL::setLBID(uint64_t rid, uint32_t dbRoot)
@@ -55,8 +55,9 @@ DictStepJL::DictStepJL(const pDictionaryStep& dict)
         eqOp = dict.tmpCOP;
         eqFilter = dict.eqFilter;
     }
-    else
-        filterString = dict.fFilterString;
+
+    // only sent when !hasEqFilter, but casual partitioning needs it either way
+    filterString = dict.fFilterString;
 
     filterCount = dict.fFilterCount;
     charsetNumber = dict.fColType.charsetNumber;
@@ -62,6 +62,19 @@ public:
     void createCommand(messageqcpp::ByteStream&) const;
     void runCommand(messageqcpp::ByteStream&) const;
 
+    const messageqcpp::ByteStream& getFilterString() const
+    {
+        return filterString;
+    }
+    uint32_t getFilterCount() const
+    {
+        return filterCount;
+    }
+    uint8_t getBOP() const
+    {
+        return BOP;
+    }
+
 private:
     DictStepJL(const DictStepJL&);
 
@@ -88,6 +88,20 @@ DiskJoinStep::DiskJoinStep(TupleHashJoinStep* t, int djsIndex, int joinIndex, bo
     if (largeLimit == 0)
         largeLimit = numeric_limits<int64_t>::max();
 
+    // each Joiner holds a partition's small side & hash table
+    joinThreadCount = thjs->resourceManager->getDjsJoinThreads();
+
+    if (joinThreadCount > (uint32_t) thjs->numCores)
+        joinThreadCount = thjs->numCores;
+
+    if (joinThreadCount == 0)
+        joinThreadCount = 1;
+
+    loadIt = 0;
+    loadLock.reset(new boost::mutex());
+    outputLock.reset(new boost::mutex());
+    overBudgetLock.reset(new boost::mutex());
+
     uint64_t totalUMMemory = thjs->resourceManager->getConfiguredUMMemLimit();
     jp.reset(new JoinPartition(largeRG, smallRG, smallKeyCols, largeKeyCols, typeless,
                                (joinType & ANTI) && (joinType & MATCHNULLS), (bool) fe, totalUMMemory, partitionSize));
@@ -300,52 +314,33 @@ void DiskJoinStep::loadFcn()
     loadFIFO->endOfInput();
 }
 
-void DiskJoinStep::buildFcn()
+boost::shared_ptr<TupleJoiner> DiskJoinStep::buildFcn(LoaderOutput& in)
 {
-    boost::shared_ptr<LoaderOutput> in;
-    boost::shared_ptr<BuilderOutput> out;
-    bool more = true;
-    int it = loadFIFO->getIterator();
+    boost::shared_ptr<TupleJoiner> tupleJoiner = joiner->copyForDiskJoin();
     int i, j;
     Row smallRow;
     RowGroup l_smallRG = smallRG;
 
     l_smallRG.initRow(&smallRow);
 
-    while (1)
+    //cout << "building a tuplejoiner" << endl;
+    for (i = 0; i < (int) in.smallData.size(); i++)
     {
-        //cout << "getting a partition from the loader" << endl;
-        more = loadFIFO->next(it, &in);
-
-        if (!more || cancelled())
-            goto out;
-
-        out.reset(new BuilderOutput());
-        out->smallData = in->smallData;
-        out->partitionID = in->partitionID;
-        out->jp = in->jp;
-        out->tupleJoiner = joiner->copyForDiskJoin();
-
-        //cout << "building a tuplejoiner" << endl;
-        for (i = 0; i < (int) in->smallData.size(); i++)
-        {
-            l_smallRG.setData(&in->smallData[i]);
-            l_smallRG.getRow(0, &smallRow);
-
-            for (j = 0; j < (int) l_smallRG.getRowCount(); j++, smallRow.nextRow())
-                out->tupleJoiner->insert(smallRow, (largeIterationCount == 1));
-        }
+        l_smallRG.setData(&in.smallData[i]);
+        l_smallRG.getRow(0, &smallRow);
 
-        out->tupleJoiner->doneInserting();
-        buildFIFO->insert(out);
+        for (j = 0; j < (int) l_smallRG.getRowCount(); j++, smallRow.nextRow())
+            tupleJoiner->insert(smallRow, (largeIterationCount == 1));
     }
 
-out:
-
-    while (more)
-        more = loadFIFO->next(it, &in);
+    tupleJoiner->doneInserting();
+    return tupleJoiner;
+}
 
-    buildFIFO->endOfInput();
+void DiskJoinStep::insertOutput(RGData& rgData)
+{
+    boost::mutex::scoped_lock lk(*outputLock);
+    outputDL->insert(rgData);
 }
 
 void DiskJoinStep::joinFcn()
@@ -354,10 +349,11 @@ void DiskJoinStep::joinFcn()
     /* This function mostly serves as an adapter between the
     input data and the joinOneRG() fcn in THJS.  */
 
-    boost::shared_ptr<BuilderOutput> in;
-    bool more = true;
-    int it = buildFIFO->getIterator();
+    boost::shared_ptr<LoaderOutput> in;
+    boost::shared_ptr<TupleJoiner> tupleJoiner;
+    bool more = true, nextChunk = false;
     int i, j;
+    int64_t memUsage = 0;
     vector<RGData> joinResults;
     RowGroup l_largeRG = largeRG, l_smallRG = smallRG;
     RowGroup l_outputRG = outputRG;
@@ -408,16 +404,54 @@ void DiskJoinStep::joinFcn()
     smallNullRow.setData(smallNullMem[0].get());
     smallNullRow.initToNull();
 
+    /* A heavy-hitter partition can be joined a chunk of its small side at a time,
+       replaying its large side for each chunk, when every small row stands on its
+       own.  Semi, anti, scalar & large-outer joins need all of a large row's matches
+       at once, and small-outer joins carry marks over to the next large iteration. */
+    bool chunked = !(joinType & (LARGEOUTER | SEMI | ANTI | SCALAR)) &&
+                   !((joinType & SMALLOUTER) && !lastLargeIteration);
+
     try
     {
         while (1)
         {
-            more = buildFIFO->next(it, &in);
+            if (!nextChunk)
+            {
+                {
+                    boost::mutex::scoped_lock lk(*loadLock);
+                    more = loadFIFO->next(loadIt, &in);
+                }
 
-            if (!more || cancelled())
+                if (!more || cancelled())
+                    goto out;
+
+                if (!chunked)
+                    while (in->jp->getNextSmallChunk(&in->smallData)) ;
+            }
+            else if (cancelled())
                 goto out;
 
-            joiners[0] = in->tupleJoiner;
+            /* Reserve memory for the partition's rows & hash table.  If there's
+               none left, join it while no other over-budget partition is in
+               progress, so at least one partition can always proceed. */
+            memUsage = 0;
+
+            for (i = 0; i < (int) in->smallData.size(); i++)
+            {
+                l_smallRG.setData(&in->smallData[i]);
+                memUsage += 2 * l_smallRG.getDataSize();
+            }
+
+            boost::unique_lock<boost::mutex> overBudgetLk(*overBudgetLock, boost::defer_lock);
+
+            if (!thjs->resourceManager->getMemory(memUsage, thjs->sessionMemLimit, false))
+            {
+                memUsage = 0;
+                overBudgetLk.lock();
+            }
+
+            tupleJoiner = buildFcn(*in);
+            joiners[0] = tupleJoiner;
             boost::shared_ptr<RGData> largeData;
             largeData = in->jp->getNextLargeRGData();
 
@@ -432,7 +466,7 @@ void DiskJoinStep::joinFcn()
                 {
                     //l_outputRG.setData(&joinResults[j]);
                     //cout << "got joined output " << l_outputRG.toString() << endl;
-                    outputDL->insert(joinResults[j]);
+                    insertOutput(joinResults[j]);
                 }
 
                 joinResults.clear();
@@ -447,9 +481,9 @@ void DiskJoinStep::joinFcn()
                     /* TODO: an optimization would be to detect whether any new rows were marked and if not
                        suppress the save operation */
                     vector<Row::Pointer> unmatched;
-                    in->tupleJoiner->getUnmarkedRows(&unmatched);
+                    tupleJoiner->getUnmarkedRows(&unmatched);
                     //cout << "***** saving partition " << in->partitionID << " unmarked count=" << unmatched.size() << " total count="
-                    //	<< in->tupleJoiner->size() << " vector size=" << in->smallData.size() <<  endl;
+                    //	<< tupleJoiner->size() << " vector size=" << in->smallData.size() <<  endl;
                     in->jp->saveSmallSidePartition(in->smallData);
                 }
                 else
@@ -470,7 +504,7 @@ void DiskJoinStep::joinFcn()
                     l_largeRow.setData(largeNullMem.get());
                     l_largeRow.initToNull();
 
-                    in->tupleJoiner->getUnmarkedRows(&unmatched);
+                    tupleJoiner->getUnmarkedRows(&unmatched);
 
                     //cout << " small-outer count=" << unmatched.size() << endl;
                     for (i = 0; i < (int) unmatched.size(); i++)
@@ -482,7 +516,7 @@ void DiskJoinStep::joinFcn()
 
                         if (l_outputRG.getRowCount() == 8192)
                         {
-                            outputDL->insert(rgData);
+                            insertOutput(rgData);
                             //cout << "inserting a full RG" << endl;
                             rgData.reinit(l_outputRG);
                             l_outputRG.setData(&rgData);
@@ -496,10 +530,20 @@ void DiskJoinStep::joinFcn()
                     if (l_outputRG.getRowCount() > 0)
                     {
                         //cout << "inserting an rg with " << l_outputRG.getRowCount() << endl;
-                        outputDL->insert(rgData);
+                        insertOutput(rgData);
                     }
                 }
             }
+
+            tupleJoiner.reset();
+            thjs->resourceManager->returnMemory(memUsage, thjs->sessionMemLimit);
+            memUsage = 0;
+
+            in->smallData.clear();
+            nextChunk = in->jp->getNextSmallChunk(&in->smallData);
+
+            if (!nextChunk)
+                in.reset();
         }
     }  // the try stmt above; need to reformat.
     catch (...)
@@ -514,14 +558,12 @@ void DiskJoinStep::joinFcn()
 
 out:
 
-    while (more)
-        more = buildFIFO->next(it, &in);
+    thjs->resourceManager->returnMemory(memUsage, thjs->sessionMemLimit);
 
-    if (lastLargeIteration || cancelled())
+    while (more)
     {
-        reportStats();
-        outputDL->endOfInput();
-        closedOutput = true;
+        boost::mutex::scoped_lock lk(*loadLock);
+        more = loadFIFO->next(loadIt, &in);
     }
 }
 
@@ -549,14 +591,23 @@ void DiskJoinStep::mainRunner()
                 break;
 
             loadFIFO.reset(new FIFO<boost::shared_ptr<LoaderOutput> >(1, 1));   // double buffering should be good enough
-            buildFIFO.reset(new FIFO<boost::shared_ptr<BuilderOutput> >(1, 1));
+            loadIt = loadFIFO->getIterator();
 
             std::vector<uint64_t> thrds;
-            thrds.reserve(3);
+            thrds.reserve(joinThreadCount + 1);
             thrds.push_back(jobstepThreadPool.invoke(Loader(this)));
-            thrds.push_back(jobstepThreadPool.invoke(Builder(this)));
-            thrds.push_back(jobstepThreadPool.invoke(Joiner(this)));
+
+            for (uint32_t i = 0; i < joinThreadCount; i++)
+                thrds.push_back(jobstepThreadPool.invoke(Joiner(this)));
+
             jobstepThreadPool.join(thrds);
+
+            if (lastLargeIteration || cancelled())
+            {
+                reportStats();
+                outputDL->endOfInput();
+                closedOutput = true;
+            }
         }
     }
     catch (...)
@@ -599,7 +650,8 @@ void DiskJoinStep::reportStats()
 
     os1 << "DiskJoinStep: joined (large) " << alias() << " to (small) " << joiner->getTableName() << ". Processing stages: " << largeIterationCount <<
         ", disk usage small/large: " << jp->getMaxSmallSize() << "/" << jp->getMaxLargeSize() <<
-        ", total bytes read/written: " << jp->getBytesRead() << "/" << jp->getBytesWritten() << endl;
+        ", total bytes read/written: " << jp->getBytesRead() << "/" << jp->getBytesWritten() <<
+        ", heavy-hitter partitions: " << jp->getSkewedPartitionCount() << endl;
     fExtendedInfo = os1.str();
 
     /* TODO: Can this report anything more useful in miniInfo? */
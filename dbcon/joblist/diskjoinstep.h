@@ -102,30 +102,11 @@ private:
     };
     void loadFcn();
 
-    /* Builder structs */
-    struct BuilderOutput
-    {
-        boost::shared_ptr<joiner::TupleJoiner> tupleJoiner;
-        std::vector<rowgroup::RGData> smallData;
-        uint64_t partitionID;
-        joiner::JoinPartition* jp;
-    };
-
-    boost::shared_ptr<joblist::FIFO<boost::shared_ptr<BuilderOutput> > > buildFIFO;
-
-    struct Builder
-    {
-        Builder(DiskJoinStep* d) : djs(d) { }
-        void operator()()
-        {
-            utils::setThreadName("DJSBuilder");
-            djs->buildFcn();
-        }
-        DiskJoinStep* djs;
-    };
-    void buildFcn();
+    boost::shared_ptr<joiner::TupleJoiner> buildFcn(LoaderOutput&);
 
-    /* Joining structs */
+    /* Joining structs.  Each Joiner takes the next loaded partition, builds
+       its hash table and joins the partition's large side, so several
+       partitions are processed at once. */
     struct Joiner
     {
         Joiner(DiskJoinStep* d) : djs(d) { }
@@ -137,6 +118,14 @@ private:
         DiskJoinStep* djs;
     };
     void joinFcn();
+    void insertOutput(rowgroup::RGData&);
+
+    uint32_t joinThreadCount;
+    uint64_t loadIt;
+    boost::shared_ptr<boost::mutex> loadLock;       // the Joiners share loadIt
+    boost::shared_ptr<boost::mutex> outputLock;     // outputDL takes one producer
+    // partitions that couldn't reserve UM memory are joined one at a time
+    boost::shared_ptr<boost::mutex> overBudgetLock;
 
     // limits & usage
     boost::shared_ptr<int64_t> smallUsage;
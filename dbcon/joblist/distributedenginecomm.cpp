@@ -447,11 +447,8 @@ void DistributedEngineComm::addQueue(uint32_t key, bool sendACKs)
 {
     bool b;
 
-    boost::mutex* lock = new boost::mutex();
-    condition* cond = new condition();
     boost::shared_ptr<MQE> mqe(new MQE(pmCount));
 
-    mqe->queue = StepMsgQueue(lock, cond);
     mqe->sendACKs = sendACKs;
     mqe->throttled = false;
 
@@ -905,6 +902,46 @@ void DistributedEngineComm::write(messageqcpp::ByteStream& msg, uint32_t connect
     newClients[connection]->write(msg, NULL, senderStats);
 }
 
+void DistributedEngineComm::frame(const ByteStream& msg, ByteStream& frame)
+{
+    if (fPmConnections.size() == 0)
+    {
+        writeToLog(__FILE__, __LINE__, "No PrimProcs are running", LOG_TYPE_DEBUG);
+        throw IDBExcept(ERR_NO_PRIMPROC);
+    }
+
+    // every connection is the same kind of socket
+    fPmConnections[0]->frame(msg, frame);
+}
+
+void DistributedEngineComm::writeFramed(uint32_t senderID, const ByteStream& frame, uint32_t pm)
+{
+    if (fPmConnections.size() == 0)
+    {
+        writeToLog(__FILE__, __LINE__, "No PrimProcs are running", LOG_TYPE_DEBUG);
+        throw IDBExcept(ERR_NO_PRIMPROC);
+    }
+
+    writeToClient(pm, frame, senderID, false, true);
+}
+
+void DistributedEngineComm::writeToPm(uint32_t senderID, ByteStream& msg, uint32_t pm)
+{
+    ISMPacketHeader* ism = (ISMPacketHeader*) msg.buf();
+
+    if (fPmConnections.size() == 0)
+    {
+        writeToLog(__FILE__, __LINE__, "No PrimProcs are running", LOG_TYPE_DEBUG);
+        throw IDBExcept(ERR_NO_PRIMPROC);
+    }
+
+    /* Disable flow control initially, see write() */
+    if (ism->Command == BATCH_PRIMITIVE_CREATE)
+        msg << (uint32_t) - 1;
+
+    writeToClient(pm, msg, senderID);
+}
+
 void DistributedEngineComm::StartClientListener(boost::shared_ptr<MessageQueueClient> cl, uint32_t connIndex)
 {
     boost::thread* thrd = new boost::thread(EngineCommRunner(this, cl, connIndex));
@@ -963,7 +1000,8 @@ void DistributedEngineComm::doHasBigMsgs(boost::shared_ptr<MQE> mqe, uint64_t ta
         mqe->targetQueueSize = targetSize;
 }
 
-int DistributedEngineComm::writeToClient(size_t index, const ByteStream& bs, uint32_t sender, bool doInterleaving)
+int DistributedEngineComm::writeToClient(size_t index, const ByteStream& bs, uint32_t sender, bool doInterleaving,
+        bool framed)
 {
     boost::mutex::scoped_lock lk(fMlock, boost::defer_lock_t());
     MessageQueueMap::iterator it;
@@ -1001,8 +1039,26 @@ int DistributedEngineComm::writeToClient(size_t index, const ByteStream& bs, uin
 
         if (!client->isAvailable()) return 0;
 
-        boost::mutex::scoped_lock lk(*(fWlock[index]));
-        client->write(bs, NULL, senderStats);
+        boost::mutex::scoped_lock wlk(*(fWlock[index]));
+
+        if (!framed)
+        {
+            client->write(bs, NULL, senderStats);
+            return 0;
+        }
+
+        // framed messages go to several PMs at once, don't race on the sender's stats
+        Stats frameStats;
+        client->write_raw(bs, NULL, &frameStats);
+        wlk.unlock();
+
+        if (senderStats)
+        {
+            lk.lock();
+            senderStats->dataSent(frameStats.dataSent());
+            lk.unlock();
+        }
+
         return 0;
     }
     catch (...)
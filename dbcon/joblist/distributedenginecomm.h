@@ -45,6 +45,7 @@
 #include "bytestream.h"
 #include "primitivemsg.h"
 #include "threadsafequeue.h"
+#include "ringbufferqueue.h"
 #include "rwlock_local.h"
 #include "resourcemanager.h"
 #include "messagequeue.h"
@@ -149,6 +150,26 @@ public:
     */
     EXPORT void write(messageqcpp::ByteStream& msg, uint32_t connection);
 
+    /** @brief Builds what write() would send a PM for msg
+     *
+     * Compression & framing happen once here, writeFramed() then sends the result to
+     * any PM.  Used for messages that go to every PM, like the small sides of joins.
+     */
+    EXPORT void frame(const messageqcpp::ByteStream& msg, messageqcpp::ByteStream& frame);
+
+    /** @brief Writes a message built by frame() to the PM at index pm
+     *
+     * frame isn't modified, so one thread per PM can send the same frame at once.
+     * Errors are handled like write()'s.
+     */
+    EXPORT void writeFramed(uint32_t senderID, const messageqcpp::ByteStream& frame, uint32_t pm);
+
+    /** @brief Writes a message that write() would send to every PM to the PM at index pm only
+     *
+     * For when each PM gets its own version of it, like the BPP create msgs of a shuffle join.
+     */
+    EXPORT void writeToPm(uint32_t senderID, messageqcpp::ByteStream& msg, uint32_t pm);
+
     /** @brief Shutdown this object
      *
      * Closes all the connections created during Setup() and cleans up other stuff.
@@ -196,6 +217,11 @@ public:
     {
         return pmCount;
     }
+    /* The config name ("PMS<n>") of the PM at index pm, pm < getPmCount() */
+    std::string getPmName(uint32_t pm) const
+    {
+        return fPmConnections[pm]->otherEnd();
+    }
 
     unsigned getNumConnections() const
     {
@@ -212,7 +238,7 @@ private:
     typedef std::vector<boost::shared_ptr<messageqcpp::MessageQueueClient> > ClientList;
 
     //A queue of ByteStreams coming in from PrimProc heading for a JobStep
-    typedef ThreadSafeQueue<messageqcpp::SBS> StepMsgQueue;
+    typedef RingBufferQueue<messageqcpp::SBS> StepMsgQueue;
 
     /* To keep some state associated with the connection.  These aren't copyable. */
     struct MQE : public boost::noncopyable
@@ -256,7 +282,8 @@ private:
     * Continues trying to write data to the client at the next index until all clients have been tried.
     */
     int  writeToClient(size_t index, const messageqcpp::ByteStream& bs,
-                       uint32_t senderID = std::numeric_limits<uint32_t>::max(), bool doInterleaving = false);
+                       uint32_t senderID = std::numeric_limits<uint32_t>::max(), bool doInterleaving = false,
+                       bool framed = false);
 
     static DistributedEngineComm* fInstance;
     ResourceManager* fRm;
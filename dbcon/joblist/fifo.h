@@ -33,8 +33,11 @@
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <stdexcept>
+#include <atomic>
+#include <boost/scoped_array.hpp>
 #include "elementtype.h"
 #include "datalistimpl.h"
+#include "ringbufferqueue.h"
 
 namespace joblist
 {
@@ -146,6 +149,17 @@ public:
     // false if there is no more data.  Similar to next(), but
     // does not return data.
     bool more(uint64_t id);
+
+    // Switches this FIFO to a lock-free ring buffer of maxElements slots.
+    // The producer and each consumer keep their own position in the ring,
+    // so insert() and next() don't take the datalist mutex, and a consumer
+    // can start on an element as soon as it's inserted instead of after the
+    // producer's buffer fills up.  Call it before the first insert().
+    void ringBuffer(bool b);
+    bool ringBuffer() const
+    {
+        return fRingBuffer;
+    }
 protected:
 
 private:
@@ -161,15 +175,25 @@ private:
     uint64_t fTotSize;
     bool     fInOrder;
     uint64_t fConsumerFinishedCount;
-    volatile bool fConsumptionStarted;
+    std::atomic<bool> fConsumptionStarted;
     uint32_t     fElementMode;
     uint64_t fNumFiles;
     uint64_t fNumBytes;
 
     // Counters that reflect how many many times this FIFO blocked
     // on reads and writes due to the FIFO being empty or full.
-    uint64_t blockedInsertWriteCount;
-    uint64_t blockedNextReadCount;
+    std::atomic<uint64_t> blockedInsertWriteCount;
+    std::atomic<uint64_t> blockedNextReadCount;
+
+    // The ring buffer.  Positions count elements since the start, the
+    // element at position p is in slot p % fMaxElements.
+    bool fRingBuffer;
+    element_t* fRing;
+    std::atomic<uint64_t> fRingWritePos;
+    boost::scoped_array<std::atomic<uint64_t> > fRingReadPos;
+    std::atomic<bool> fRingDone;
+    SpinParkWaiter fRingProducerWait;
+    SpinParkWaiter fRingConsumerWait;
 
     FIFO& operator=(const FIFO&);
     FIFO(const FIFO&);
@@ -179,6 +203,11 @@ private:
     bool swapBuffers(bool waitIfBlocked = true);
     bool waitForSwap(uint64_t id);
 
+    uint64_t ringSpace() const;
+    void ringInsert(const element_t* e, uint64_t count);
+    bool ringNext(uint64_t id, element_t* e);
+    void ringResetReaders();
+
 };
 
 // #define FIFO_DEBUG
@@ -210,6 +239,11 @@ FIFO<element_t>::FIFO(uint32_t con, uint32_t max) : DataListImpl<std::vector<ele
     cDone = con;
 
     blockedInsertWriteCount = blockedNextReadCount = 0;
+
+    fRingBuffer = false;
+    fRing = 0;
+    fRingWritePos = 0;
+    fRingDone = false;
 }
 
 template<typename element_t>
@@ -239,6 +273,7 @@ FIFO<element_t>::~FIFO()
     if (cBuffer)
         delete [] cBuffer;
 
+    delete [] fRing;
     delete [] cpos;
 }
 
@@ -280,6 +315,12 @@ bool FIFO<element_t>::swapBuffers(bool waitIfBlocked)
 template<typename element_t>
 inline void FIFO<element_t>::insert(const element_t& e)
 {
+    if (fRingBuffer)
+    {
+        ringInsert(&e, 1);
+        return;
+    }
+
     if (!pBuffer)
     {
         pBuffer = new element_t[fMaxElements];
@@ -298,6 +339,14 @@ template<typename element_t>
 inline void FIFO<element_t>::insert(const element_t& e,
                                     bool& bufferFullBlocked, bool& consumptionStarted)
 {
+    if (fRingBuffer)
+    {
+        ringInsert(&e, 1);
+        bufferFullBlocked = (ringSpace() == 0);
+        consumptionStarted = fConsumptionStarted;
+        return;
+    }
+
     if (!pBuffer)
     {
         pBuffer = new element_t[fMaxElements];
@@ -317,6 +366,12 @@ inline void FIFO<element_t>::insert(const element_t& e,
 template<typename element_t>
 inline void FIFO<element_t>::waitTillReadyForInserts()
 {
+    if (fRingBuffer)
+    {
+        fRingProducerWait.wait([this]() { return ringSpace() > 0; });
+        return;
+    }
+
     if (ppos == fMaxElements)
         swapBuffers();
 }
@@ -324,6 +379,9 @@ inline void FIFO<element_t>::waitTillReadyForInserts()
 template<typename element_t>
 inline bool FIFO<element_t>::isOutputBlocked() const
 {
+    if (fRingBuffer)
+        return ringSpace() == 0;
+
     if (ppos == fMaxElements)
         return true;
     else
@@ -333,6 +391,14 @@ inline bool FIFO<element_t>::isOutputBlocked() const
 template<typename element_t>
 inline void FIFO<element_t>::insert(const std::vector<element_t>& e)
 {
+    if (fRingBuffer)
+    {
+        if (!e.empty())
+            ringInsert(&e[0], e.size());
+
+        return;
+    }
+
     typename std::vector<element_t>::const_iterator it = e.begin();
     typename std::vector<element_t>::const_iterator end = e.end();
 
@@ -382,6 +448,9 @@ bool FIFO<element_t>::waitForSwap(uint64_t id)
 template<typename element_t>
 bool FIFO<element_t>::more(uint64_t id)
 {
+    if (fRingBuffer)
+        return !(fRingReadPos[id].load() == fRingWritePos.load() && fRingDone.load());
+
     boost::mutex::scoped_lock scoped(base::mutex);
     return !(cpos[id] == fMaxElements && base::noMoreInput);
 }
@@ -398,6 +467,9 @@ void FIFO<element_t>::signalPs()
 template<typename element_t>
 inline bool FIFO<element_t>::next(uint64_t id, element_t* out)
 {
+    if (fRingBuffer)
+        return ringNext(id, out);
+
     base::mutex.lock();
     fConsumptionStarted = true;
 
@@ -429,6 +501,16 @@ void FIFO<element_t>::endOfInput()
 {
     element_t* tmp;
 
+    if (fRingBuffer)
+    {
+        boost::mutex::scoped_lock scoped(base::mutex);
+        base::endOfInput();
+        fRingDone.store(true, std::memory_order_release);
+        scoped.unlock();
+        fRingConsumerWait.notify();
+        return;
+    }
+
     boost::mutex::scoped_lock scoped(base::mutex);
 
     if (ppos != 0)
@@ -491,6 +573,9 @@ void FIFO<element_t>::setNumConsumers( uint32_t nc )
         cpos[i] = fMaxElements;
 
     cDone = nc;
+
+    if (fRingBuffer)
+        ringResetReaders();
 }
 
 //@bug 864
@@ -512,9 +597,119 @@ void FIFO<element_t>::maxElements(uint64_t max)
 
         for (uint64_t i = 0; i < base::numConsumers; ++i)
             cpos[i] = fMaxElements;
+
+        delete [] fRing;
+        fRing = 0;
     }
 }
 
+template<typename element_t>
+void FIFO<element_t>::ringBuffer(bool b)
+{
+    fRingBuffer = b;
+
+    if (fRingBuffer)
+        ringResetReaders();
+}
+
+template<typename element_t>
+void FIFO<element_t>::ringResetReaders()
+{
+    fRingReadPos.reset(new std::atomic<uint64_t>[base::numConsumers]);
+
+    for (uint64_t i = 0; i < base::numConsumers; ++i)
+        fRingReadPos[i] = 0;
+}
+
+// # of free slots, the slowest consumer decides
+template<typename element_t>
+uint64_t FIFO<element_t>::ringSpace() const
+{
+    uint64_t writePos = fRingWritePos.load(std::memory_order_relaxed);
+    uint64_t minReadPos = writePos;
+
+    for (uint64_t i = 0; i < base::numConsumers; ++i)
+        minReadPos = std::min(minReadPos, fRingReadPos[i].load(std::memory_order_acquire));
+
+    return fMaxElements - (writePos - minReadPos);
+}
+
+// publishes as many elements at a time as there is room for
+template<typename element_t>
+void FIFO<element_t>::ringInsert(const element_t* e, uint64_t count)
+{
+    if (!fRing)
+        fRing = new element_t[fMaxElements];
+
+    while (count > 0)
+    {
+        uint64_t space = ringSpace();
+
+        // once full, wait for room for a batch rather than trading single slots with the consumers
+        if (space == 0)
+        {
+            blockedInsertWriteCount++;
+            fRingProducerWait.wait([this]() { return ringSpace() >= (fMaxElements + 1) / 2; });
+            continue;
+        }
+
+        uint64_t pos = fRingWritePos.load(std::memory_order_relaxed);
+        uint64_t n = std::min(space, count);
+
+        for (uint64_t i = 0; i < n; ++i)
+            fRing[(pos + i) % fMaxElements] = e[i];
+
+        fRingWritePos.store(pos + n, std::memory_order_release);
+        fTotSize += n;
+        e += n;
+        count -= n;
+        fRingConsumerWait.notify();
+    }
+}
+
+template<typename element_t>
+bool FIFO<element_t>::ringNext(uint64_t id, element_t* out)
+{
+    uint64_t pos = fRingReadPos[id].load(std::memory_order_relaxed);
+
+    fConsumptionStarted = true;
+
+    if (pos == fRingWritePos.load(std::memory_order_acquire))
+    {
+        blockedNextReadCount++;
+        fRingConsumerWait.wait([this, pos]()
+        {
+            return pos != fRingWritePos.load(std::memory_order_acquire) ||
+                   fRingDone.load(std::memory_order_acquire);
+        });
+
+        // endOfInput() sets fRingDone after the last insert, so this is the final position
+        if (pos == fRingWritePos.load(std::memory_order_acquire))
+        {
+            boost::mutex::scoped_lock scoped(base::mutex);
+
+            if (++fConsumerFinishedCount == base::numConsumers)
+            {
+                delete [] fRing;
+                fRing = 0;
+            }
+
+            return false;
+        }
+    }
+
+    element_t& slot = fRing[pos % fMaxElements];
+    *out = slot;
+
+    // with one consumer nothing else needs the element, don't hold on to it
+    if (base::numConsumers == 1)
+        slot = element_t();
+
+    fRingReadPos[id].store(pos + 1, std::memory_order_release);
+    fRingProducerWait.notify();
+    return true;
+}
+
 //
 // Sets/Returns the number of temp files and the space taken up by those files
 // (in bytes) by this FIFO collection, if the application code chose to cache
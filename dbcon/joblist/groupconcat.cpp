@@ -851,6 +851,7 @@ void GroupConcatOrderBy::processRow(const rowgroup::Row& row)
         int16_t estLen = lengthEstimate(fRow2);
         fRow2.setRid(estLen);
         fCurrentLength += estLen;
+        swapRow.fKey = fRule.abbreviate(swapRow.fData);
 
         fOrderByQueue.push(swapRow);
     }
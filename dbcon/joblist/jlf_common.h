@@ -177,6 +177,7 @@ struct JobInfo
         flushInterval(rm->getJLFlushInterval()),
         fifoSize(rm->getJlFifoSize()),
         fifoSizeLargeSideHj(rm->getHjFifoSizeLargeSide()),
+        ringBufferFifo(rm->getJlRingBufferFifo()),
         scanLbidReqLimit(rm->getJlScanLbidReqLimit()),
         scanLbidReqThreshold(rm->getJlScanLbidReqThreshold()),
         tempSaveSize(rm->getScTempSaveSize()),
@@ -217,6 +218,7 @@ struct JobInfo
     uint32_t  flushInterval;
     uint32_t  fifoSize;
     uint32_t  fifoSizeLargeSideHj;
+    bool      ringBufferFifo;
     //...joblist does not use scanLbidReqLimit and SdanLbidReqThreshold.
     //...They are actually used by pcolscan and pdictionaryscan, but
     //...we have joblist get and report the values here since they
@@ -520,6 +520,18 @@ void adjustLastStep(JobStepVector& querySteps, DeliveredTableMap& deliverySteps,
 
 //    }
 
+    // ORDER BY ... LIMIT straight off a scan, let PrimProc trim the rows it returns
+    if (bps && !jobInfo.hasAggregation && !jobInfo.havingStep && jobInfo.windowCols.empty() &&
+            !jobInfo.hasDistinct && jobInfo.orderByColVec.size() > 0 &&
+            jobInfo.limitCount != (uint64_t) - 1 &&
+            jobInfo.limitStart + jobInfo.limitCount < (uint64_t) rowgroup::rgCommonSize)
+    {
+        TupleBPS* tbps = dynamic_cast<TupleBPS*>(bps);
+
+        if (tbps != NULL)
+            tbps->setTopN(jobInfo.orderByColVec, jobInfo.limitStart + jobInfo.limitCount);
+    }
+
     if (jobInfo.annexStep)
     {
         TupleDeliveryStep* ds =
@@ -46,6 +46,30 @@ using namespace execplan;
 
 #include "atomicops.h"
 
+#include <cxxabi.h>
+#include <set>
+#include <boost/thread/mutex.hpp>
+
+namespace
+{
+// Running joblists, for JobList::memoryUsage()
+boost::mutex runningJobListsLock;
+std::set<joblist::JobList*> runningJobLists;
+
+std::string stepTypeName(const joblist::JobStep* js)
+{
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(typeid(*js).name(), NULL, NULL, &status);
+    std::string ret(status == 0 ? demangled : typeid(*js).name());
+    free(demangled);
+
+    if (ret.compare(0, 9, "joblist::") == 0)
+        ret.erase(0, 9);
+
+    return ret;
+}
+}
+
 namespace joblist
 {
 int  JobList::fPmsConfigured = 0;
@@ -73,6 +97,11 @@ JobList::JobList(bool isEM) :
 
 JobList::~JobList()
 {
+    {
+        boost::mutex::scoped_lock lk(runningJobListsLock);
+        runningJobLists.erase(this);
+    }
+
     try
     {
         if (fIsRunning)
@@ -247,10 +276,46 @@ int JobList::doQuery()
     }
 
     fIsRunning = true;
+
+    {
+        boost::mutex::scoped_lock lk(runningJobListsLock);
+        runningJobLists.insert(this);
+    }
+
     rc = 0;
     return rc;
 }
 
+void JobList::memoryUsage(std::vector<StepMemUsage>& out)
+{
+    boost::mutex::scoped_lock lk(runningJobListsLock);
+    std::set<JobList*>::const_iterator it;
+
+    for (it = runningJobLists.begin(); it != runningJobLists.end(); ++it)
+    {
+        const JobStepVector* steps[] = { &(*it)->fQuery, &(*it)->fProject };
+
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            for (uint32_t j = 0; j < steps[i]->size(); j++)
+            {
+                const JobStep* js = (*steps[i])[j].get();
+                int64_t bytes = js->umMemUsage();
+
+                if (bytes == 0)
+                    continue;
+
+                StepMemUsage usage;
+                usage.sessionID = js->sessionId();
+                usage.stepID = js->stepId();
+                usage.stepType = stepTypeName(js);
+                usage.bytes = bytes;
+                out.push_back(usage);
+            }
+        }
+    }
+}
+
 int JobList::putEngineComm(DistributedEngineComm* dec)
 {
     int retryCnt = 0;
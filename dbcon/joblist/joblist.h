@@ -55,6 +55,17 @@ typedef std::map<execplan::CalpontSystemCatalog::OID, SJSTEP> DeliveredTableMap;
 
 class DistributedEngineComm;
 
+/** @brief UM memory held by one step of a running query
+ *
+ */
+struct StepMemUsage
+{
+    uint32_t sessionID;
+    uint16_t stepID;
+    std::string stepType;
+    int64_t bytes;
+};
+
 /** @brief class JobList
  *
  */
@@ -190,6 +201,9 @@ public:
         fPmsConfigured = pms;
     }
 
+    /** Appends the UM memory currently held by each step of the running joblists */
+    EXPORT static void memoryUsage(std::vector<StepMemUsage>& out);
+
 protected:
     //defaults okay
     //JobList(const JobList& rhs);
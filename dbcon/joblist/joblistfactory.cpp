@@ -1385,6 +1385,26 @@ uint16_t numberSteps(JobStepVector& steps, uint16_t stepNo, uint32_t flags)
     return stepNo;
 }
 
+// Switches the RowGroup FIFOs the steps write to to ring buffers
+void useRingBuffers(JobStep* step)
+{
+    const JobStepAssociation& outJsa = step->outputAssociation();
+
+    for (size_t i = 0; i < outJsa.outSize(); i++)
+    {
+        RowGroupDL* dl = outJsa.outAt(i)->rowGroupDL();
+
+        if (dl != NULL)
+            dl->ringBuffer(true);
+    }
+}
+
+void useRingBuffers(JobStepVector& steps)
+{
+    for (JobStepVector::iterator iter = steps.begin(); iter != steps.end(); ++iter)
+        useRingBuffers(iter->get());
+}
+
 void changePcolStepToPcolScan(JobStepVector::iterator& it, JobStepVector::iterator& end)
 {
     // make sure no pseudo column is a scan column
@@ -1919,6 +1939,15 @@ SJLP makeJobList_(
         uint16_t stepNo = numberSteps(querySteps, 0, jobInfo.traceFlags);
         stepNo = numberSteps(projectSteps, stepNo, jobInfo.traceFlags);
 
+        if (jobInfo.ringBufferFifo)
+        {
+            useRingBuffers(querySteps);
+            useRingBuffers(projectSteps);
+
+            for (DeliveredTableMap::iterator dsi = deliverySteps.begin(); dsi != deliverySteps.end(); ++dsi)
+                useRingBuffers(dsi->second.get());
+        }
+
         struct timeval stTime;
 
         if (jobInfo.trace)
@@ -280,6 +280,12 @@ public:
     {
         return fCardinality;
     }
+    //...UM memory this step currently holds from ResourceManager. Unlike
+    //...the counters above this is read while the step runs, for reporting.
+    virtual int64_t umMemUsage     ( ) const
+    {
+        return 0;
+    }
     virtual void cardinality ( const uint64_t cardinality )
     {
         fCardinality = cardinality;
@@ -392,6 +392,11 @@ void LBIDList::UpdateMinMax(T min, T max, int64_t lbid,
             {
                 if (datatypes::isCharType(type.colDataType))
                 {
+                    // a block of NULLs comes with an empty range
+                    if (min == numeric_limits<int64_t>::max() ||
+                            max == numeric_limits<int64_t>::min())
+                        return;
+
                     datatypes::Charset cs(const_cast<CalpontSystemCatalog::ColType &>(type).getCharset());
                     if (datatypes::TCharShort::strnncollsp(cs, min, mmp->min) < 0 ||
                             mmp->min == numeric_limits<int64_t>::max())
@@ -579,6 +584,20 @@ bool LBIDList::CasualPartitionDataType(const CalpontSystemCatalog::ColDataType t
     }
 }
 
+bool LBIDList::CasualPartitionPrefixDataType(const CalpontSystemCatalog::ColDataType type) const
+{
+    switch (type)
+    {
+        case CalpontSystemCatalog::CHAR:
+        case CalpontSystemCatalog::VARCHAR:
+        case CalpontSystemCatalog::TEXT:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
 /* Check for casual partitioning predicate optimization. This function applies the predicate using
  * column Min/Max values to determine if the scan is required.
  *
@@ -903,6 +922,126 @@ bool LBIDList::CasualPartitionPredicate(const BRM::EMCasualPartition_t& cpRange,
     return scan;
 } // CasualPartitioningPredicate
 
+// The literal a LIKE pattern begins with, as the PM matches it (see
+// PrimitiveProcessor::convertToRegexp())
+static string likePrefix(const char* pattern, uint16_t len)
+{
+    string ret;
+
+    for (uint16_t i = 0; i < len; i++)
+    {
+        char c = pattern[i];
+
+        if (c == '%' || c == '_')
+            break;
+
+        if (c == '\\' && i + 1 < len &&
+                (pattern[i + 1] == '%' || pattern[i + 1] == '_' || pattern[i + 1] == '\\'))
+            c = pattern[++i];
+
+        ret += c;
+    }
+
+    return ret;
+}
+
+/* Casual partitioning for dictionary columns.  The min & max are the first 8 bytes of
+ * the smallest and largest strings, so values are compared to them with
+ * Charset::strnncollPrefix(), under which a string equals its prefixes.  That only
+ * holds for collations where Charset::isPrefixOrdered(); others always scan.  Only =,
+ * <, <=, >, >= and LIKE 'literal%' can eliminate an extent.  The filter is that of a
+ * pDictionaryStep; each element is a COP, a 16-bit length and the string.
+ *
+ *   returns true if scan should be executed.
+ *   returns false if casual partitioning predicate optimization has eliminated the scan.
+ */
+bool LBIDList::CasualPartitionPrefixPredicate(const BRM::EMCasualPartition_t& cpRange,
+        const messageqcpp::ByteStream* bs,
+        const uint16_t NOPS,
+        const execplan::CalpontSystemCatalog::ColType& ct,
+        const uint8_t BOP)
+{
+    // Only NULLs, or the range of an extent nothing has been loaded into yet
+    if (cpRange.loVal == numeric_limits<int64_t>::max() ||
+            cpRange.hiVal == numeric_limits<int64_t>::min())
+        return true;
+
+    datatypes::Charset cs(ct.charsetNumber);
+
+    if (!cs.isPrefixOrdered())
+        return true;
+
+    const uint8_t* pos = bs->buf();
+    const uint8_t* end = pos + bs->length();
+    utils::ConstString sMin((const char*) &cpRange.loVal, 8);
+    utils::ConstString sMax((const char*) &cpRange.hiVal, 8);
+    bool scan = true;
+
+    sMin.rtrimZero();
+    sMax.rtrimZero();
+
+    for (int i = 0; i < NOPS; i++)
+    {
+        scan = true;
+
+        if (pos + 3 > end)
+            return true;
+
+        uint8_t op = *pos++;
+        uint16_t len = *((const uint16_t*) pos);
+        pos += 2;
+
+        if (pos + len > end)
+            return true;
+
+        const char* data = (const char*) pos;
+        pos += len;
+
+        if (op == COMPARE_LIKE)
+        {
+            string prefix = likePrefix(data, len);
+            utils::ConstString sVal(prefix.data(), prefix.length());
+
+            scan = cs.strnncollPrefix(sVal, sMin) >= 0 &&
+                   cs.strnncollPrefix(sVal, sMax) <= 0;
+        }
+        else
+        {
+            // trailing spaces would only make the comparisons stricter
+            while (len > 0 && data[len - 1] == ' ')
+                len--;
+
+            utils::ConstString sVal(data, len);
+
+            switch (op)
+            {
+                case COMPARE_LT:
+                case COMPARE_LE:
+                    scan = cs.strnncollPrefix(sVal, sMin) >= 0;
+                    break;
+
+                case COMPARE_GT:
+                case COMPARE_GE:
+                    scan = cs.strnncollPrefix(sVal, sMax) <= 0;
+                    break;
+
+                case COMPARE_EQ:
+                    scan = cs.strnncollPrefix(sVal, sMin) >= 0 &&
+                           cs.strnncollPrefix(sVal, sMax) <= 0;
+                    break;
+            }
+        }
+
+        if (BOP == BOP_AND && !scan)
+            break;
+
+        if (BOP == BOP_OR && scan)
+            break;
+    }
+
+    return scan;
+}
+
 void LBIDList::copyLbidList(const LBIDList& rhs)
 {
     em = rhs.em;
@@ -128,6 +128,17 @@ public:
     // is a data type  to apply casual paritioning.
     bool CasualPartitionDataType(const execplan::CalpontSystemCatalog::ColDataType type, const uint8_t size) const;
 
+    // Dictionary columns of these types keep the range of the strings' 8-byte
+    // prefixes, which CasualPartitionPrefixPredicate() applies the string
+    // filter of the dictionary step to.
+    bool CasualPartitionPrefixDataType(const execplan::CalpontSystemCatalog::ColDataType type) const;
+
+    bool CasualPartitionPrefixPredicate(const BRM::EMCasualPartition_t& cpRange,
+                                        const messageqcpp::ByteStream* filterString,
+                                        const uint16_t NOPS,
+                                        const execplan::CalpontSystemCatalog::ColType& ct,
+                                        const uint8_t BOP);
+
     LBIDList(const LBIDList& rhs)
     {
         copyLbidList(rhs);
@@ -19,14 +19,29 @@
 
 
 #include <iostream>
+#include <fstream>
 //#define NDEBUG
 #include <cassert>
+#include <cerrno>
+#include <cstring>
 #include <string>
+#include <limits>
+#include <unistd.h>
 using namespace std;
 
 #include <boost/shared_array.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/uuid/uuid_io.hpp>
 using namespace boost;
 
+#include "configcpp.h"
+#include "installdir.h"
+#include "querytele.h"
+using namespace querytele;
+
+#include "bytestream.h"
+using namespace messageqcpp;
+
 #include "errorids.h"
 #include "exceptclasses.h"
 using namespace logging;
@@ -39,12 +54,20 @@ using namespace rowgroup;
 
 using namespace ordering;
 
+namespace
+{
+// The most runs merged at once, each one has a rowgroup in memory.  When
+// there are more, they're first merged into longer runs on disk.
+const uint32_t MaxMergeFanIn = 64;
+}
+
 namespace joblist
 {
 
 
 // LimitedOrderBy class implementation
-LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1)
+LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1), fAllowDiskSort(false),
+    fUseCompression(false), fMergeSkip(0), fMergeCount(0)
 {
     fRule.fIdbCompare = this;
 }
@@ -52,6 +75,7 @@ LimitedOrderBy::LimitedOrderBy() : fStart(0), fCount(-1)
 
 LimitedOrderBy::~LimitedOrderBy()
 {
+    releaseRuns();
 }
 
 
@@ -61,6 +85,13 @@ void LimitedOrderBy::initialize(const RowGroup& rg, const JobInfo& jobInfo, bool
     fSessionMemLimit = jobInfo.umMemLimit;
     fErrorCode = ERR_LIMIT_TOO_BIG;
 
+    // The distinct map only knows the rows in memory, so DISTINCT can't spill.
+    config::Config* config = config::Config::makeConfig();
+    string str = config->getConfig("JobList", "AllowDiskBasedOrderBy");
+    fAllowDiskSort = !(str == "n" || str == "N") && !fDistinct;
+    str = config->getConfig("HashJoin", "TempFileCompression");
+    fUseCompression = !(str == "n" || str == "N");
+
     // locate column position in the rowgroup
     map<uint32_t, uint32_t> keyToIndexMap;
 
@@ -135,11 +166,20 @@ void LimitedOrderBy::processRow(const rowgroup::Row& row)
             uint64_t newSize = fRowsPerRG * fRowGroup.getRowSize();
             fMemSize += newSize;
 
-            if (!fRm->getMemory(newSize, fSessionMemLimit))
+            // don't wait on other queries if the rows can go to disk instead
+            if (!fRm->getMemory(newSize, fSessionMemLimit, !fAllowDiskSort))
             {
-                cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode)
-                     << " @" << __FILE__ << ":" << __LINE__;
-                throw IDBExcept(fErrorCode);
+                fMemSize -= newSize;
+
+                if (!fAllowDiskSort)
+                {
+                    cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode)
+                         << " @" << __FILE__ << ":" << __LINE__;
+                    throw IDBExcept(fErrorCode);
+                }
+
+                spillRun();
+                return;
             }
 
             fData.reinit(fRowGroup, fRowsPerRG);
@@ -149,11 +189,18 @@ void LimitedOrderBy::processRow(const rowgroup::Row& row)
         }
     }
 
-    else if (fOrderByCond.size() > 0 && fRule.less(row.getPointer(), fOrderByQueue.top().fData))
+    else if (fOrderByCond.size() > 0)
     {
+        // most rows lose to the top on the abbreviated key alone
+        OrderByRow candidate(row, fRule);
+
+        if (!(candidate < fOrderByQueue.top()))
+            return;
+
         OrderByRow swapRow = fOrderByQueue.top();
         row1.setData(swapRow.fData);
         copyRow(row, &row1);
+        swapRow.fKey = candidate.fKey;
 
         if (fDistinct)
         {
@@ -177,6 +224,23 @@ void LimitedOrderBy::finalize()
     if (fRowGroup.getRowCount() > 0)
         fDataQueue.push(fData);
 
+    // The rows in memory become the last run, getData() merges the runs.
+    if (spilled())
+    {
+        spillRun();
+        mergeRuns();
+
+        for (uint32_t i = 0; i < fRuns.size(); i++)
+        {
+            if (readRun(fRuns[i]))
+                pushRunHead(i);
+        }
+
+        fMergeSkip = fStart;
+        fMergeCount = fCount;
+        return;
+    }
+
     if (fOrderByQueue.size() > 0)
     {
         // *DRRTUY Very memory intensive. CS needs to account active
@@ -266,6 +330,404 @@ void LimitedOrderBy::finalize()
 }
 
 
+/*
+ * Writes the rows of the queue out as a sorted run and gives back the memory
+ * of the rowgroups holding them.  The rows of fData must be in fDataQueue.
+ */
+void LimitedOrderBy::spillRun()
+{
+    vector<OrderByRow> rows;
+    RGData runData;
+    RowGroup runRG = fRowGroup;
+    Row runRow;
+    uint64_t rgSize = fRowsPerRG * fRowGroup.getRowSize();
+
+    rows.reserve(fOrderByQueue.size());
+
+    // the queue pops the last row first
+    while (!fOrderByQueue.empty())
+    {
+        rows.push_back(fOrderByQueue.top());
+        fOrderByQueue.pop();
+    }
+
+    if (!rows.empty())
+    {
+        fRuns.push_back(SortedRun());
+        fRuns.back().fFilename = runFilename();
+
+        runData.reinit(fRowGroup, fRowsPerRG);
+        runRG.setData(&runData);
+        runRG.resetRowGroup(0);
+        runRG.initRow(&runRow);
+        runRG.getRow(0, &runRow);
+    }
+
+    for (size_t i = rows.size(); i-- > 0; )
+    {
+        row1.setData(rows[i].fData);
+        copyRow(row1, &runRow);
+        runRG.incRowCount();
+        runRow.nextRow();
+
+        if (runRG.getRowCount() == fRowsPerRG || i == 0)
+        {
+            writeRun(fRuns.back(), runRG);
+            runData.reinit(fRowGroup, fRowsPerRG);
+            runRG.setData(&runData);
+            runRG.resetRowGroup(0);
+            runRG.getRow(0, &runRow);
+        }
+    }
+
+    // done writing, it's reopened to be read
+    if (!rows.empty())
+        fRuns.back().fStream.reset();
+
+    fDataQueue = queue<RGData>();
+    fData.reinit(fRowGroup, fRowsPerRG);
+    fRowGroup.setData(&fData);
+    fRowGroup.resetRowGroup(0);
+    fRowGroup.getRow(0, &fRow0);
+
+    // keep the one rowgroup being filled
+    fRm->returnMemory(fMemSize - rgSize, fSessionMemLimit);
+    fMemSize = rgSize;
+}
+
+
+string LimitedOrderBy::runFilename() const
+{
+    ostringstream os;
+    os << startup::StartUp::tmpDir() << "/Columnstore-orderby-data-"
+       << uuids::to_string(QueryTeleClient::genUUID());
+    return os.str();
+}
+
+
+// Appends the rowgroup to the run, opening the run's file on the first one.
+void LimitedOrderBy::writeRun(SortedRun& run, RowGroup& rg)
+{
+    ByteStream bs;
+    int saveErrno;
+
+    if (!run.fStream)
+    {
+        run.fStream.reset(new fstream(run.fFilename.c_str(), ios::binary | ios::out | ios::trunc));
+        saveErrno = errno;
+
+        if (!*run.fStream)
+        {
+            ostringstream os;
+            os << "Disk-based ORDER BY could not open file (write access) " << run.fFilename
+               << ": " << strerror(saveErrno) << endl;
+            throw IDBExcept(os.str().c_str(), ERR_DBJ_FILE_IO_ERROR);
+        }
+    }
+
+    fstream& fs = *run.fStream;
+    rg.serializeRGData(bs);
+    size_t len = bs.length();
+
+    if (!fUseCompression)
+    {
+        fs.write((char*) &len, sizeof(len));
+        fs.write((char*) bs.buf(), len);
+    }
+    else
+    {
+        size_t actualSize;
+        scoped_array<char> compressed(new char[fCompressor.maxCompressedSize(len)]);
+
+        fCompressor.compress((char*) bs.buf(), len, compressed.get(), &actualSize);
+        fs.write((char*) &actualSize, sizeof(actualSize));
+        fs.write(compressed.get(), actualSize);
+    }
+
+    saveErrno = errno;
+
+    if (!fs)
+    {
+        ostringstream os;
+        os << "Disk-based ORDER BY could not write file " << run.fFilename << ": "
+           << strerror(saveErrno) << endl;
+        throw IDBExcept(os.str().c_str(), ERR_DBJ_FILE_IO_ERROR);
+    }
+}
+
+
+// Reads the next rowgroup of the run, the file is removed once it's all read.
+bool LimitedOrderBy::readRun(SortedRun& run)
+{
+    ByteStream bs;
+    size_t len;
+    int saveErrno;
+
+    if (!run.fStream)
+    {
+        run.fStream.reset(new fstream(run.fFilename.c_str(), ios::binary | ios::in));
+        saveErrno = errno;
+
+        if (!*run.fStream)
+        {
+            ostringstream os;
+            os << "Disk-based ORDER BY could not open file (read access) " << run.fFilename
+               << ": " << strerror(saveErrno) << endl;
+            throw IDBExcept(os.str().c_str(), ERR_DBJ_FILE_IO_ERROR);
+        }
+    }
+
+    fstream& fs = *run.fStream;
+    fs.read((char*) &len, sizeof(len));
+
+    if (fs.eof())
+    {
+        releaseRun(run);
+        return false;
+    }
+
+    if (!fUseCompression)
+    {
+        bs.needAtLeast(len);
+        fs.read((char*) bs.getInputPtr(), len);
+        bs.advanceInputPtr(len);
+    }
+    else
+    {
+        size_t uncompressedSize;
+        scoped_array<char> buf(new char[len]);
+
+        fs.read(buf.get(), len);
+        fCompressor.getUncompressedSize(buf.get(), len, &uncompressedSize);
+        bs.needAtLeast(uncompressedSize);
+        fCompressor.uncompress(buf.get(), len, (char*) bs.getInputPtr());
+        bs.advanceInputPtr(uncompressedSize);
+    }
+
+    saveErrno = errno;
+
+    if (!fs)
+    {
+        ostringstream os;
+        os << "Disk-based ORDER BY could not read file " << run.fFilename << ": "
+           << strerror(saveErrno) << endl;
+        throw IDBExcept(os.str().c_str(), ERR_DBJ_FILE_IO_ERROR);
+    }
+
+    run.fData.deserialize(bs);
+    fRunRG.setData(&run.fData);
+    run.fRowCount = fRunRG.getRowCount();
+    run.fNext = 0;
+    return true;
+}
+
+
+void LimitedOrderBy::pushRunHead(uint32_t i)
+{
+    SortedRun& run = fRuns[i];
+
+    fRunRG.setData(&run.fData);
+    fRunRG.getRow(run.fNext, &fRunRow);
+    fRunHeads.push(RunHead(OrderByRow(fRunRow, fRule), i));
+}
+
+
+void LimitedOrderBy::nextRunHead(uint32_t i)
+{
+    SortedRun& run = fRuns[i];
+
+    if (++run.fNext < run.fRowCount || readRun(run))
+        pushRunHead(i);
+}
+
+
+/*
+ * Gets the memory to merge up to MaxMergeFanIn runs, fewer if that much isn't
+ * available, then merges runs in passes until no more than that many are left
+ * for getData() to merge.
+ */
+void LimitedOrderBy::mergeRuns()
+{
+    uint64_t rgSize = fRowsPerRG * fRowGroup.getRowSize();
+    uint32_t fanIn = min<size_t>(MaxMergeFanIn, fRuns.size());
+
+    // only wait for memory once down to a 2-way merge
+    while (!fRm->getMemory(fanIn * rgSize, fSessionMemLimit, fanIn <= 2))
+    {
+        if (fanIn <= 2)
+        {
+            cerr << IDBErrorInfo::instance()->errorMsg(fErrorCode)
+                 << " @" << __FILE__ << ":" << __LINE__;
+            throw IDBExcept(fErrorCode);
+        }
+
+        fanIn /= 2;
+    }
+
+    fMemSize += fanIn * rgSize;
+    fRunRG = fRowGroup;
+    fRunRG.initRow(&fRunRow);
+
+    // no run needs more rows than the offset and the limit take
+    uint64_t keep = (fCount > numeric_limits<uint64_t>::max() - fStart) ?
+                    numeric_limits<uint64_t>::max() : fStart + fCount;
+
+    while (fRuns.size() > fanIn)
+    {
+        vector<SortedRun> merged;
+
+        for (uint32_t i = 0; i < fRuns.size(); i += fanIn)
+        {
+            uint32_t end = min<size_t>(i + fanIn, fRuns.size());
+
+            if (end - i == 1)
+                merged.push_back(fRuns[i]);
+            else
+                merged.push_back(mergeRunGroup(i, end, keep));
+        }
+
+        fRuns.swap(merged);
+    }
+}
+
+
+/*
+ * Merges runs [begin, end) into a new run of at most keep rows, using fData as
+ * the output rowgroup.  The runs merged are released.
+ */
+LimitedOrderBy::SortedRun LimitedOrderBy::mergeRunGroup(uint32_t begin, uint32_t end, uint64_t keep)
+{
+    SortedRun out;
+    uint64_t rows = 0;
+
+    out.fFilename = runFilename();
+
+    try
+    {
+        for (uint32_t i = begin; i < end; i++)
+        {
+            if (readRun(fRuns[i]))
+                pushRunHead(i);
+        }
+
+        fRowGroup.resetRowGroup(0);
+        fRowGroup.getRow(0, &fRow0);
+
+        while (!fRunHeads.empty() && rows < keep)
+        {
+            RunHead head = fRunHeads.top();
+            fRunHeads.pop();
+
+            row1.setData(head.fRow.fData);
+            copyRow(row1, &fRow0);
+            fRowGroup.incRowCount();
+            fRow0.nextRow();
+            rows++;
+
+            if (fRowGroup.getRowCount() == fRowsPerRG)
+            {
+                writeRun(out, fRowGroup);
+                fRowGroup.resetRowGroup(0);
+                fRowGroup.getRow(0, &fRow0);
+            }
+
+            nextRunHead(head.fRun);
+        }
+
+        if (fRowGroup.getRowCount() > 0)
+            writeRun(out, fRowGroup);
+
+        fRowGroup.resetRowGroup(0);
+        fRunHeads = priority_queue<RunHead, vector<RunHead>, RunHeadGreater>();
+    }
+    catch (...)
+    {
+        releaseRun(out);
+        throw;
+    }
+
+    for (uint32_t i = begin; i < end; i++)
+        releaseRun(fRuns[i]);
+
+    // done writing, it's reopened to be read
+    out.fStream.reset();
+    return out;
+}
+
+
+void LimitedOrderBy::releaseRun(SortedRun& run)
+{
+    run.fStream.reset();
+
+    if (!run.fFilename.empty())
+        unlink(run.fFilename.c_str());
+
+    run.fFilename.clear();
+    run.fData = RGData();
+    run.fRowCount = run.fNext = 0;
+}
+
+
+void LimitedOrderBy::releaseRuns()
+{
+    for (uint32_t i = 0; i < fRuns.size(); i++)
+        releaseRun(fRuns[i]);
+
+    fRuns.clear();
+    fRunHeads = priority_queue<RunHead, vector<RunHead>, RunHeadGreater>();
+}
+
+
+void LimitedOrderBy::takeRuns(LimitedOrderBy& other)
+{
+    if (other.fRowGroup.getRowCount() > 0)
+        other.fDataQueue.push(other.fData);
+
+    other.spillRun();
+    fRuns.insert(fRuns.end(), other.fRuns.begin(), other.fRuns.end());
+    other.fRuns.clear();
+}
+
+
+/*
+ * Once rows have spilled the output is a k-way merge of the runs left by
+ * mergeRuns(), in order and with the offset & limit applied.
+ */
+bool LimitedOrderBy::getData(RGData& data)
+{
+    if (!spilled())
+        return IdbOrderBy::getData(data);
+
+    data.reinit(fRowGroup, fRowsPerRG);
+    fRowGroup.setData(&data);
+    fRowGroup.resetRowGroup(0);
+    fRowGroup.getRow(0, &fRow0);
+
+    while (!fRunHeads.empty() && fMergeCount > 0 && fRowGroup.getRowCount() < fRowsPerRG)
+    {
+        RunHead head = fRunHeads.top();
+        fRunHeads.pop();
+
+        if (fMergeSkip > 0)
+        {
+            fMergeSkip--;
+        }
+        else
+        {
+            row1.setData(head.fRow.fData);
+            copyRow(row1, &fRow0);
+            fRowGroup.incRowCount();
+            fRow0.nextRow();
+            fMergeCount--;
+        }
+
+        nextRunHead(head.fRun);
+    }
+
+    return (fRowGroup.getRowCount() > 0);
+}
+
+
 const string LimitedOrderBy::toString() const
 {
     ostringstream oss;
@@ -24,7 +24,12 @@
 #define LIMITED_ORDER_BY_H
 
 #include <string>
+#include <vector>
+#include <fstream>
+#include <boost/shared_ptr.hpp>
 #include "rowgroup.h"
+#include "bytestream.h"
+#include "idbcompress.h"
 #include "../../utils/windowfunction/idborderby.h"
 
 
@@ -56,13 +61,78 @@ public:
     {
         return fCount;
     }
+    void setLimit(uint64_t start, uint64_t count)
+    {
+        fStart = start;
+        fCount = count;
+    }
     const std::string toString() const;
 
     void finalize();
+    bool getData(rowgroup::RGData& data);
+
+    // True once rows have been written to disk as sorted runs.  That happens
+    // when the memory limit is hit & JobList/AllowDiskBasedOrderBy is on.
+    bool spilled() const
+    {
+        return !fRuns.empty();
+    }
+    // Writes out what the other instance holds in memory and takes over its runs,
+    // so that finalize() merges them with this instance's.
+    void takeRuns(LimitedOrderBy& other);
 
 protected:
+    // A sorted run on disk, read back a rowgroup at a time during the merge.
+    // fStream stays open while the run is being written or read.
+    struct SortedRun
+    {
+        SortedRun() : fRowCount(0), fNext(0) { }
+        std::string                     fFilename;
+        boost::shared_ptr<std::fstream> fStream;
+        rowgroup::RGData                fData;
+        uint32_t                        fRowCount;
+        uint32_t                        fNext;
+    };
+
+    struct RunHead
+    {
+        RunHead(const ordering::OrderByRow& r, uint32_t i) : fRow(r), fRun(i) { }
+        ordering::OrderByRow            fRow;
+        uint32_t                        fRun;
+    };
+
+    // the priority_queue is a max heap, the merge wants the least row on top
+    struct RunHeadGreater
+    {
+        bool operator()(const RunHead& a, const RunHead& b) const
+        {
+            return b.fRow < a.fRow;
+        }
+    };
+
+    void spillRun();
+    std::string runFilename() const;
+    void writeRun(SortedRun&, rowgroup::RowGroup&);
+    bool readRun(SortedRun&);
+    void pushRunHead(uint32_t);
+    void nextRunHead(uint32_t);
+    void mergeRuns();
+    SortedRun mergeRunGroup(uint32_t, uint32_t, uint64_t);
+    void releaseRun(SortedRun&);
+    void releaseRuns();
+
     uint64_t                            fStart;
     uint64_t                            fCount;
+
+    bool                                fAllowDiskSort;
+    bool                                fUseCompression;
+    std::vector<SortedRun>              fRuns;
+    std::priority_queue<RunHead, std::vector<RunHead>, RunHeadGreater> fRunHeads;
+    rowgroup::RowGroup                  fRunRG;
+    rowgroup::Row                       fRunRow;
+    uint64_t                            fMergeSkip;
+    uint64_t                            fMergeCount;
+    compress::IDBCompressInterface      fCompressor;
 };
 
 
@@ -128,6 +128,7 @@ enum ISMPACKETCOMMAND
     BATCH_PRIMITIVE_END_JOINER  = PRIM_LOCALBASE + 11,
     BATCH_PRIMITIVE_ACK			= PRIM_LOCALBASE + 12,
     BATCH_PRIMITIVE_ABORT		= PRIM_LOCALBASE + 13,
+    BATCH_PRIMITIVE_SHUFFLE     = PRIM_LOCALBASE + 14,
 
     //max of 100-50=50 commands
     COL_RESULTS                 = PRIM_COLBASE + 0,
@@ -199,6 +200,14 @@ const uint16_t SEND_RIDS_AT_DELIVERY = 0x20; //32;
 const uint16_t HAS_ROWGROUP          = 0x40; //64;
 const uint16_t JOIN_ROWGROUP_DATA    = 0x80; //128
 const uint16_t HAS_WIDE_COLUMNS      = 0x100; //256;
+const uint16_t SHUFFLE_JOIN          = 0x200; //512;
+
+/* On a shuffle join every response ends with a trailer.  A counted msg ends with
+   the # of BATCH_PRIMITIVE_SHUFFLE msgs the PM sent to other PMs since its last
+   counted msg, the others end with one of these. */
+const uint8_t SHUFFLE_MSG_NONE      = 0;    // part of the result of a scan
+const uint8_t SHUFFLE_MSG_PART      = 1;    // part of the result of a shuffle msg
+const uint8_t SHUFFLE_MSG_LAST      = 2;    // the end of the result of a shuffle msg
 
 //TODO: put this in a namespace to stop global ns pollution
 enum PrimFlags
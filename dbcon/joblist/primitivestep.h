@@ -43,6 +43,7 @@
 
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 
@@ -67,6 +68,7 @@
 #include "rowgroup.h"
 #include "rowaggregation.h"
 #include "funcexpwrapper.h"
+#include "../../utils/windowfunction/idborderby.h"
 
 namespace joblist
 {
@@ -1249,6 +1251,10 @@ public:
     }
     void useJoiner(boost::shared_ptr<joiner::TupleJoiner>);
     void useJoiners(const std::vector<boost::shared_ptr<joiner::TupleJoiner> >&);
+    uint32_t pmCount() const
+    {
+        return fDec->getPmCount();
+    }
     bool wasStepRun() const
     {
         return fRunExecuted;
@@ -1319,6 +1325,12 @@ public:
     void  deliverStringTableRowGroup(bool b);
     bool  deliverStringTableRowGroup() const;
 
+    /* ORDER BY ... LIMIT pushdown.  orderByCols are (key, asc) pairs on the delivered
+     * rowgroup, count is limitStart + limitCount.  Returns false if the order by
+     * can't be evaluated on the rows PrimProc returns.
+     */
+    bool setTopN(const std::vector<std::pair<uint32_t, bool> >& orderByCols, uint64_t count);
+
     /* Interface for adding add'l predicates for casual partitioning.
      * This fcn checks for any intersection between the values in vals
      * and the range of a given extent.  If there is no intersection, that extent
@@ -1409,6 +1421,7 @@ private:
     uint64_t fMsgBytesIn;   // total byte count for incoming messages
     uint64_t fMsgBytesOut;  // total byte count for outcoming messages
     uint64_t fBlockTouched; // total blocks touched
+    uint64_t fPMAggFlushes; // early flushes by PM aggregations that switched to bounded mode
     uint32_t fExtentsPerSegFile;//config num of Extents Per Segment File
     // uint64_t cThread;  //consumer thread. thread handle from thread pool
     uint64_t pThread;  //producer thread. thread handle from thread pool
@@ -1436,6 +1449,11 @@ private:
 
     std::vector<boost::shared_ptr<joiner::TupleJoiner> > tjoiners;
     bool doJoin, hasPMJoin, hasUMJoin;
+    bool shuffleJoin;                   // the small side is partitioned across the PMs
+    int64_t shuffleOutstanding;         // shuffled row groups the PMs are still joining
+    // Throttles the sending side.  The row groups the PMs shuffled to each other are
+    // work in flight just like the requests sent, so they count against the same window.
+    bool overWindow() const;
     std::vector<rowgroup::RowGroup> joinerMatchesRGs;   // parses the small-side matches from joiner
 
     uint32_t smallSideCount;
@@ -1495,18 +1513,36 @@ private:
     /* shared nothing support */
     struct Job
     {
-        Job(uint32_t d, uint32_t n, uint32_t b, boost::shared_ptr<messageqcpp::ByteStream>& bs) :
-            dbroot(d), connectionNum(n), expectedResponses(b), msg(bs) { }
+        Job(uint32_t d, uint32_t n, uint32_t b, boost::shared_ptr<messageqcpp::ByteStream>& bs,
+            uint32_t e = 0) :
+            dbroot(d), connectionNum(n), expectedResponses(b), extentIndex(e), msg(bs) { }
         uint32_t dbroot;
         uint32_t connectionNum;
         uint32_t expectedResponses;
+        uint32_t extentIndex;  // into scannedExtents
         boost::shared_ptr<messageqcpp::ByteStream> msg;
     };
 
     void prepCasualPartitioning();
+    bool dictPrefixCP();
     void makeJobs(std::vector<Job>* jobs);
     void interleaveJobs(std::vector<Job>* jobs) const;
     void sendJobs(const std::vector<Job>& jobs);
+    bool topNSkipsJob(const Job& job);
+
+    /* Adaptive dispatch.  Jobs wait in per-PM queues and each PM is sent more as
+       its responses come back, so a slow PM can't hold most of the send window.
+       With work stealing a PM that ran out of jobs takes unsent ones from the
+       PM expected to finish last, which needs every PM to see every dbroot. */
+    void dispatchJobs(const std::vector<Job>& jobs);
+    const Job* stealJob(std::deque<const Job*>* bins, std::vector<uint64_t>& queuedBlocks,
+                        uint32_t thief);
+    bool fAdaptiveDispatch;
+    bool fScanWorkStealing;
+    int64_t fPMWindow;                           // blocks in progress allowed per PM
+    std::vector<int64_t> fPMBlocksOutstanding;   // these are indexed by PM, guarded by tplMutex
+    std::vector<uint64_t> fPMBlocksDone;
+    uint64_t fJobsStolen;
     uint32_t numDBRoots;
 
     /* Pseudo column filter processing.  Think about refactoring into a separate class. */
@@ -1525,6 +1561,24 @@ private:
     bool hasPCFilter, hasPMFilter, hasRIDFilter, hasSegmentFilter, hasDBRootFilter, hasSegmentDirFilter,
          hasPartitionFilter, hasMaxFilter, hasMinFilter, hasLBIDFilter, hasExtentIDFilter;
 
+    /* Top-N pushdown.  The threshold is the worst row of a full set of topNCount rows
+     * returned so far; it goes out with every job so PrimProc can drop rows that
+     * can't make the final result, and extents whose CP range can't beat it are skipped.
+     */
+    void initTopN();
+    void updateTopNThreshold(rowgroup::RGData& rgData);
+    void appendTopNThreshold(messageqcpp::ByteStream& bs);
+    bool topNRulesOutExtent(uint32_t extentIndex);
+    uint64_t topNCount;
+    std::vector<ordering::IdbSortSpec> topNSpecs;
+    boost::scoped_ptr<ordering::OrderByData> topNOrder;
+    rowgroup::RowGroup topNThresholdRG;
+    rowgroup::RGData topNThresholdData;
+    rowgroup::Row topNThreshold, topNRow, topNWorst;
+    bool topNHaveThreshold;
+    ColumnCommandJL* topNColCmd;  // the leading order by column, if its CP data can rule out extents
+    boost::mutex topNMutex;
+
 };
 
 /** @brief class FilterStep
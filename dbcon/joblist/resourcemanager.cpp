@@ -88,6 +88,7 @@ ResourceManager::ResourceManager(bool runningInExeMgr) :
                                        0),
     fHJPmMaxMemorySmallSideSessionMap(
         getUintVal(fHashJoinStr, "PmMaxMemorySmallSide", defaultHJPmMaxMemorySmallSide)),
+    fMemWaiters(0),
     isExeMgr(runningInExeMgr)
 {
     int temp;
@@ -399,19 +400,48 @@ bool ResourceManager::getMemory(int64_t amount, boost::shared_ptr<int64_t> sessi
     bool ret1 = (atomicops::atomicSub(&totalUmMemLimit, amount) >= 0);
     bool ret2 = (atomicops::atomicSub(sessionLimit.get(), amount) >= 0);
 
-    uint32_t retryCounter = 0, maxRetries = 20;   // 10s delay
+    if (ret1 && ret2)
+        return true;
 
-    while (patience && !(ret1 && ret2) && retryCounter++ < maxRetries)
+    atomicops::atomicAdd(&totalUmMemLimit, amount);
+    atomicops::atomicAdd(sessionLimit.get(), amount);
+
+    if (!patience)
+        return false;
+
+    // Wait up to 10s for other steps/queries to give memory back.  returnMemory()
+    // wakes us up, so a reservation goes through as soon as the memory is there
+    // instead of at the next 500ms poll.
+    boost::posix_time::ptime deadline = boost::get_system_time() + boost::posix_time::seconds(10);
+    boost::mutex::scoped_lock lk(fMemWaitLock);
+    atomicops::atomicInc(&fMemWaiters);
+
+    while (true)
     {
-        atomicops::atomicAdd(&totalUmMemLimit, amount);
-        atomicops::atomicAdd(sessionLimit.get(), amount);
-        usleep(500000);
         ret1 = (atomicops::atomicSub(&totalUmMemLimit, amount) >= 0);
         ret2 = (atomicops::atomicSub(sessionLimit.get(), amount) >= 0);
+
+        if (ret1 && ret2)
+            break;
+
+        atomicops::atomicAdd(&totalUmMemLimit, amount);
+        atomicops::atomicAdd(sessionLimit.get(), amount);
+
+        if (!fMemReturned.timed_wait(lk, deadline))
+            break;
     }
 
+    atomicops::atomicDec(&fMemWaiters);
     return (ret1 && ret2);
 }
 
+void ResourceManager::wakeMemoryWaiters()
+{
+    // Taking the lock closes the window between a waiter's failed attempt
+    // and its wait, so the wakeup can't be lost.
+    boost::mutex::scoped_lock lk(fMemWaitLock);
+    fMemReturned.notify_all();
+}
+
 
 } //namespace
@@ -37,6 +37,7 @@
 #include "installdir.h"
 
 #include "atomicops.h"
+#include "branchpred.h"
 
 #if defined(_MSC_VER) && defined(JOBLIST_DLLEXPORT)
 #define EXPORT __declspec(dllexport)
@@ -99,6 +100,8 @@ const int defaultEMSecondsBetweenMemChecks = 1;
 const int defaultEMMaxPct = 95;
 const int defaultEMPriority = 21; // @Bug 3385
 const int defaultEMExecQueueSize = 20;
+const uint64_t defaultEMResultCacheSize = 0;
+const uint64_t defaultEMResultCacheMaxEntrySize = 16 * 1024 * 1024;
 
 
 const uint64_t defaultInitialCapacity = 1024 * 1024;
@@ -119,6 +122,9 @@ const uint64_t defaultRowsPerBatch  = 10000;
 /* HJ CP feedback, see bug #1465 */
 const uint32_t defaultHjCPUniqueLimit = 100;
 
+/* # of partitions a disk-based join works on at once */
+const uint32_t defaultDjsJoinThreads = 4;
+
 // Order By and Limit
 const uint64_t defaultOrderByLimitMaxMemory = 1 * 1024 * 1024 * 1024ULL;
 
@@ -175,6 +181,19 @@ public:
     {
         return  getIntVal(fExeMgrStr, "ExecQueueSize", defaultEMExecQueueSize);
     }
+    uint64_t    getEmResultCacheSize() const
+    {
+        return  getUintVal(fExeMgrStr, "ResultCacheSize", defaultEMResultCacheSize);
+    }
+    uint64_t    getEmResultCacheMaxEntrySize() const
+    {
+        return  getUintVal(fExeMgrStr, "ResultCacheMaxEntrySize", defaultEMResultCacheMaxEntrySize);
+    }
+    bool        getEmCatalogSnapshot() const
+    {
+        std::string val(getStringVal(fExeMgrStr, "CatalogSnapshot", "N"));
+        return val == "Y" || val == "y";
+    }
 
     int	      	getHjMaxBuckets() const
     {
@@ -196,6 +215,10 @@ public:
     {
         return getUintVal(fHashJoinStr, "CPUniqueLimit", defaultHjCPUniqueLimit);
     }
+    uint32_t 	getDjsJoinThreads() const
+    {
+        return getUintVal(fHashJoinStr, "DiskJoinThreads", defaultDjsJoinThreads);
+    }
     uint64_t	getPMJoinMemLimit() const
     {
         return pmJoinMemLimit;
@@ -209,6 +232,21 @@ public:
     {
         return  getUintVal(fJobListStr, "FifoSize", defaultFifoSize);
     }
+    bool  	getJlRingBufferFifo() const
+    {
+        std::string val(getStringVal(fJobListStr, "RingBufferFifo", "N"));
+        return val == "Y" || val == "y";
+    }
+    bool  	getJlAdaptiveScanDispatch() const
+    {
+        std::string val(getStringVal(fJobListStr, "AdaptiveScanDispatch", "N"));
+        return val == "Y" || val == "y";
+    }
+    bool  	getJlScanWorkStealing() const
+    {
+        std::string val(getStringVal(fJobListStr, "ScanWorkStealing", "N"));
+        return val == "Y" || val == "y";
+    }
     uint32_t  	getJlScanLbidReqLimit() const
     {
         return  getUintVal(fJobListStr, "ScanLbidReqLimit", defaultScanLbidReqLimit);
@@ -383,12 +421,23 @@ public:
     /* new HJ/Union/Aggregation mem interface, used by TupleBPS */
     /* sessionLimit is a pointer to the var holding the session-scope limit, should be JobInfo.umMemLimit
        for the query. */
-    /* Temporary parameter 'patience', will wait for up to 10s to get the memory. */
+    /* Temporary parameter 'patience', will wait for up to 10s to get the memory.  Waiters
+       sleep until some memory is returned rather than polling. */
     EXPORT bool getMemory(int64_t amount, boost::shared_ptr<int64_t> sessionLimit, bool patience = true);
     inline void returnMemory(int64_t amount, boost::shared_ptr<int64_t> sessionLimit)
     {
         atomicops::atomicAdd(&totalUmMemLimit, amount);
         atomicops::atomicAdd(sessionLimit.get(), amount);
+
+        if (UNLIKELY(fMemWaiters > 0))
+            wakeMemoryWaiters();
+    }
+    /* Charges memory that's already in use whether or not it fits, so a later
+       returnMemory() balances out.  The limits can go negative until it's returned. */
+    inline void chargeMemory(int64_t amount, boost::shared_ptr<int64_t> sessionLimit)
+    {
+        atomicops::atomicSub(&totalUmMemLimit, amount);
+        atomicops::atomicSub(sessionLimit.get(), amount);
     }
     inline int64_t availableMemory()
     {
@@ -587,6 +636,10 @@ private:
     /* new HJ/Union/Aggregation support */
     volatile int64_t totalUmMemLimit;	// mem limit for join, union, and aggregation on the UM
     uint64_t configuredUmMemLimit;
+    volatile uint32_t fMemWaiters;	// # of threads blocked in getMemory()
+    boost::mutex fMemWaitLock;
+    boost::condition_variable fMemReturned;
+    EXPORT void wakeMemoryWaiters();
     uint64_t pmJoinMemLimit;	// mem limit on individual PM joins
 
     /* multi-thread aggregate */
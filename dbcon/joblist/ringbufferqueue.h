@@ -0,0 +1,428 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file ringbufferqueue.h
+ * Lock-free queues between the DEC and the jobsteps, and between jobsteps.
+ */
+
+#ifndef RINGBUFFERQUEUE_H_
+#define RINGBUFFERQUEUE_H_
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "atomicops.h"
+#include "threadsafequeue.h"
+
+namespace joblist
+{
+
+/** @brief Spin-then-park waiting for the lock-free queues.
+ *
+ * In a busy pipeline the other side usually delivers within microseconds, so
+ * a waiter polls its condition for a while, then yields, and only then sleeps
+ * on a condition variable.  notify() only takes the mutex if someone sleeps.
+ */
+class SpinParkWaiter
+{
+public:
+    SpinParkWaiter() : fSleepers(0) { }
+
+    /** @brief Returns once ready() is true.  ready() must be safe to call concurrently. */
+    template<typename Pred>
+    void wait(Pred ready)
+    {
+        uint32_t i;
+        // spinning only burns the time slice of the thread we wait for on one core
+        static const uint32_t spinCount = (boost::thread::hardware_concurrency() > 1 ? SpinCount : 0);
+
+        for (i = 0; i < spinCount; i++)
+        {
+            if (ready())
+                return;
+
+            cpuRelax();
+        }
+
+        for (i = 0; i < YieldCount; i++)
+        {
+            if (ready())
+                return;
+
+            atomicops::atomicYield();
+        }
+
+        boost::mutex::scoped_lock lk(fMutex);
+        fSleepers.fetch_add(1);
+        // pairs with the fence in notify(), either it sees the sleeper or ready() sees its change
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        while (!ready())
+            fCond.wait(lk);
+
+        fSleepers.fetch_sub(1);
+    }
+
+    static void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    /** @brief Wakes the sleepers, call it after making ready() true. */
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (fSleepers.load(std::memory_order_relaxed) > 0)
+        {
+            boost::mutex::scoped_lock lk(fMutex);
+            fCond.notify_all();
+        }
+    }
+
+private:
+    static const uint32_t SpinCount = 1000;
+    static const uint32_t YieldCount = 10;
+
+    std::atomic<uint32_t> fSleepers;
+    boost::mutex fMutex;
+    boost::condition_variable fCond;
+};
+
+/** @brief A lock-free multiple producer queue of ByteStreams
+ *
+ * A drop-in replacement for ThreadSafeQueue<SBS> as the DEC uses it: the PM
+ * reader threads push, one jobstep thread pops.  Pushes and pops go through a
+ * bounded ring buffer of sequenced cells (Vyukov's MPMC queue) so neither side
+ * takes a lock.  A producer can't block though, one reader thread serves every
+ * session on its connection, so when the ring is full pushes go to a locked
+ * overflow list until the reader has drained it.  The overflow list is only
+ * read once the ring is empty, including cells a producer has claimed but not
+ * filled in yet, so each producer's messages come out in the order it pushed
+ * them.
+ */
+template <typename T>
+class RingBufferQueue
+{
+public:
+    typedef T value_type;
+
+    explicit RingBufferQueue(uint32_t capacity = DefaultCapacity) :
+        fShutdown(false), fBytes(0), fCount(0), fEnqueuePos(0), fDequeuePos(0),
+        fOverflowCount(0), zeroCount(0)
+    {
+        uint64_t size = 2;
+
+        while (size < capacity)
+            size <<= 1;
+
+        fMask = size - 1;
+        fCells.reset(new Cell[size]);
+
+        for (uint64_t i = 0; i < size; i++)
+            fCells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    /** @brief put an item on the end of the queue
+     *
+     * Returns the size of the queue after the push.
+     */
+    TSQSize_t push(const T& v)
+    {
+        TSQSize_t ret = {0, 0};
+
+        if (fShutdown.load(std::memory_order_relaxed))
+            return ret;
+
+        // counted before the item is visible so a concurrent pop never takes the totals below 0
+        size_t len = v->lengthWithHdrOverhead();
+        ret.size = fBytes.fetch_add(len) + len;
+        ret.count = fCount.fetch_add(1) + 1;
+
+        if (fOverflowCount.load(std::memory_order_acquire) != 0 || !tryPush(v))
+        {
+            boost::mutex::scoped_lock lk(fOverflowLock);
+            fOverflow.push_back(v);
+            fOverflowCount.fetch_add(1, std::memory_order_release);
+        }
+
+        fWaiter.notify();
+        return ret;
+    }
+
+    /** @brief remove the front item in the queue
+     *
+     * Blocks until there is an item.  After shutdown() it returns a default-constructed T.
+     */
+    TSQSize_t pop(T* out)
+    {
+        TSQSize_t ret = {0, 0};
+        bool popped = false;
+
+        *out = fBs0;
+
+        if (fShutdown.load(std::memory_order_relaxed))
+            return ret;
+
+        fWaiter.wait([&]()
+        {
+            popped = tryPopAny(*out);
+            return popped || fShutdown.load(std::memory_order_relaxed);
+        });
+
+        if (!popped)
+            return ret;
+
+        size_t len = (*out)->lengthWithHdrOverhead();
+        ret.size = fBytes.fetch_sub(len) - len;
+        ret.count = fCount.fetch_sub(1) - 1;
+        return ret;
+    }
+
+    /* Doesn't block.  Same policy as ThreadSafeQueue::pop_some(): if there are less
+     * than min elements it returns nothing for up to 10 consecutive calls, then
+     * everything there is. */
+    TSQSize_t pop_some(uint32_t divisor, std::vector<T>& t, uint32_t min = 1)
+    {
+        uint32_t curSize, workSize;
+        TSQSize_t ret = {0, 0};
+        T v;
+
+        t.clear();
+
+        if (fShutdown.load(std::memory_order_relaxed))
+            return ret;
+
+        curSize = fCount.load();
+
+        if (curSize < min)
+        {
+            workSize = 0;
+            zeroCount++;
+        }
+        else if (curSize / divisor <= min)
+        {
+            workSize = min;
+            zeroCount = 0;
+        }
+        else
+        {
+            workSize = curSize / divisor;
+            zeroCount = 0;
+        }
+
+        if (zeroCount > 10)
+        {
+            workSize = curSize;
+            zeroCount = 0;
+        }
+
+        size_t len = 0;
+
+        while (t.size() < workSize && tryPopAny(v))
+        {
+            len += v->lengthWithHdrOverhead();
+            t.push_back(v);
+        }
+
+        ret.size = fBytes.fetch_sub(len) - len;
+        ret.count = fCount.fetch_sub(t.size()) - t.size();
+        return ret;
+    }
+
+    inline void pop_all(std::vector<T>& t)
+    {
+        pop_some(1, t);
+    }
+
+    bool empty() const
+    {
+        return fCount.load() == 0;
+    }
+
+    TSQSize_t size() const
+    {
+        TSQSize_t ret;
+        ret.size = fBytes.load();
+        ret.count = fCount.load();
+        return ret;
+    }
+
+    /** @brief shutdown the queue
+     *
+     * causes a reader blocked in pop() to return a default-constructed T
+     */
+    void shutdown()
+    {
+        fShutdown.store(true);
+        fWaiter.notify();
+    }
+
+    void clear()
+    {
+        T v;
+
+        while (tryPopAny(v))
+        {
+            fBytes.fetch_sub(v->lengthWithHdrOverhead());
+            fCount.fetch_sub(1);
+        }
+    }
+
+private:
+    static const uint32_t DefaultCapacity = 1024;
+    static const uint32_t SpinCount = 1000;
+
+    struct Cell
+    {
+        std::atomic<uint64_t> seq;
+        T data;
+    };
+
+    // a cell is free for the producer that claims position pos when its seq is pos,
+    // and holds that producer's item when its seq is pos + 1
+    bool tryPush(const T& v)
+    {
+        uint64_t pos = fEnqueuePos.load(std::memory_order_relaxed);
+
+        while (true)
+        {
+            Cell& cell = fCells[pos & fMask];
+            int64_t dif = (int64_t) cell.seq.load(std::memory_order_acquire) - (int64_t) pos;
+
+            if (dif == 0)
+            {
+                if (fEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.data = v;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+                return false;   // full
+            else
+                pos = fEnqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    bool tryPop(T& out)
+    {
+        uint64_t pos = fDequeuePos.load(std::memory_order_relaxed);
+        uint32_t spins = 0;
+
+        while (true)
+        {
+            Cell& cell = fCells[pos & fMask];
+            int64_t dif = (int64_t) cell.seq.load(std::memory_order_acquire) - (int64_t) (pos + 1);
+
+            if (dif == 0)
+            {
+                if (fDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    out = cell.data;
+                    cell.data = T();
+                    cell.seq.store(pos + fMask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (dif < 0)
+            {
+                if (fEnqueuePos.load(std::memory_order_acquire) == pos)
+                    return false;   // empty
+
+                // Claimed but not filled in yet.  It's older than anything its producer
+                // put on the overflow list since, so wait for it instead of reporting empty.
+                if (++spins < SpinCount)
+                    SpinParkWaiter::cpuRelax();
+                else
+                    atomicops::atomicYield();
+
+                pos = fDequeuePos.load(std::memory_order_relaxed);
+            }
+            else
+                pos = fDequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // The ring holds the older items, a producer only goes to the overflow list while
+    // it's non-empty or the ring is full.  So it's read strictly after the ring.
+    bool tryPopAny(T& out)
+    {
+        while (true)
+        {
+            if (tryPop(out))
+                return true;
+
+            if (fOverflowCount.load(std::memory_order_acquire) == 0)
+                return false;
+
+            boost::mutex::scoped_lock lk(fOverflowLock);
+
+            if (fOverflow.empty())
+                return false;
+
+            // A producer claims its ring cell before it appends to the list under this
+            // lock, so if the ring got an item since tryPop() it's visible here.
+            if (fEnqueuePos.load(std::memory_order_acquire) !=
+                    fDequeuePos.load(std::memory_order_relaxed))
+                continue;
+
+            out = fOverflow.front();
+            fOverflow.pop_front();
+            fOverflowCount.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+    }
+
+    RingBufferQueue(const RingBufferQueue&);
+    RingBufferQueue& operator=(const RingBufferQueue&);
+
+    std::atomic<bool> fShutdown;
+    std::atomic<size_t> fBytes;
+    std::atomic<uint32_t> fCount;
+
+    boost::scoped_array<Cell> fCells;
+    uint64_t fMask;
+    // on their own cache lines, the producers & the consumer bang on these
+    char fPad0[64];
+    std::atomic<uint64_t> fEnqueuePos;
+    char fPad1[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> fDequeuePos;
+    char fPad2[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> fOverflowCount;
+    char fPad3[64 - sizeof(std::atomic<uint64_t>)];
+
+    boost::mutex fOverflowLock;
+    std::deque<T> fOverflow;
+    SpinParkWaiter fWaiter;
+    T fBs0;
+    uint32_t zeroCount;   // counts the # of times pop_some returned 0
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
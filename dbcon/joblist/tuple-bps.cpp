@@ -33,6 +33,7 @@ using namespace std;
 #include <boost/thread.hpp>
 #include <boost/thread/condition.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 using namespace boost;
 
 #include "bpp-jl.h"
@@ -87,6 +88,22 @@ const uint32_t LOGICAL_EXTENT_CONVERTER = 10;  		// 10 + 13.  13 to convert to l
 // 10 to convert to groups of 1024 logical blocks
 const uint32_t DEFAULT_EXTENTS_PER_SEG_FILE = 2;
 
+// Whether every PM can read every DBRoot, which a stolen scan job relies on.
+// That's the case with StorageManager or HDFS, but not with internal or
+// external (SAN) storage, where each DBRoot is mounted on a single PM.
+bool sharedDBRootStorage()
+{
+    config::Config* cf = config::Config::makeConfig();
+    string smEnabled = cf->getConfig("StorageManager", "Enabled");
+    string storageType = cf->getConfig("Installation", "DBRootStorageType");
+
+    if (!smEnabled.empty() && (smEnabled[0] == 'Y' || smEnabled[0] == 'y' ||
+                               smEnabled[0] == 'T' || smEnabled[0] == 't'))
+        return true;
+
+    return boost::iequals(storageType, "storagemanager") || boost::iequals(storageType, "hdfs");
+}
+
 }
 
 /** Debug macro */
@@ -177,6 +194,10 @@ void TupleBPS::initializeConfigParms()
     fRequestSize = fRm->getJlRequestSize();
     fMaxOutstandingRequests = fRm->getJlMaxOutstandingRequests();
     fProcessorThreadsPerScan = fRm->getJlProcessorThreadsPerScan();
+    fAdaptiveDispatch = fRm->getJlAdaptiveScanDispatch();
+    fScanWorkStealing = fAdaptiveDispatch && fRm->getJlScanWorkStealing() &&
+                        sharedDBRootStorage();
+    fPMWindow = 0;
     fNumThreads = 0;
 
     config::Config* cf = config::Config::makeConfig();
@@ -233,6 +254,8 @@ TupleBPS::TupleBPS(const pColStep& rhs, const JobInfo& jobInfo) :
     fMsgBytesIn = 0;
     fMsgBytesOut = 0;
     fBlockTouched = 0;
+    fPMAggFlushes = 0;
+    fJobsStolen = 0;
     fExtentsPerSegFile = DEFAULT_EXTENTS_PER_SEG_FILE;
     recvWaiting = 0;
     fStepCount = 1;
@@ -254,6 +277,9 @@ TupleBPS::TupleBPS(const pColStep& rhs, const JobInfo& jobInfo) :
     fBPP->setOutputType(ROW_GROUP);
     finishedSending = sendWaiting = false;
     fNumBlksSkipped = 0;
+    topNCount = 0;
+    topNHaveThreshold = false;
+    topNColCmd = NULL;
     fPhysicalIO = 0;
     fCacheIO = 0;
     BPPIsAllocated = false;
@@ -263,6 +289,8 @@ TupleBPS::TupleBPS(const pColStep& rhs, const JobInfo& jobInfo) :
     fCardinality = rhs.cardinality();
     doJoin = false;
     hasPMJoin = false;
+    shuffleJoin = false;
+    shuffleOutstanding = 0;
     hasUMJoin = false;
     fRunExecuted = false;
     fSwallowRows = false;
@@ -312,9 +340,14 @@ TupleBPS::TupleBPS(const pColScanStep& rhs, const JobInfo& jobInfo) :
     ridsReturned = 0;
     ridsRequested = 0;
     fNumBlksSkipped = 0;
+    topNCount = 0;
+    topNHaveThreshold = false;
+    topNColCmd = NULL;
     fMsgBytesIn = 0;
     fMsgBytesOut = 0;
     fBlockTouched = 0;
+    fPMAggFlushes = 0;
+    fJobsStolen = 0;
     fExtentsPerSegFile = DEFAULT_EXTENTS_PER_SEG_FILE;
     recvWaiting = 0;
     fSwallowRows = false;
@@ -351,6 +384,8 @@ TupleBPS::TupleBPS(const pColScanStep& rhs, const JobInfo& jobInfo) :
     fCardinality = rhs.cardinality();
     doJoin = false;
     hasPMJoin = false;
+    shuffleJoin = false;
+    shuffleOutstanding = 0;
     hasUMJoin = false;
     fRunExecuted = false;
     smallOuterJoiner = -1;
@@ -381,6 +416,8 @@ TupleBPS::TupleBPS(const PassThruStep& rhs, const JobInfo& jobInfo) :
     fMsgBytesIn = 0;
     fMsgBytesOut = 0;
     fBlockTouched = 0;
+    fPMAggFlushes = 0;
+    fJobsStolen = 0;
     fExtentsPerSegFile = DEFAULT_EXTENTS_PER_SEG_FILE;
     recvExited = 0;
     totalMsgs = 0;
@@ -407,6 +444,9 @@ TupleBPS::TupleBPS(const PassThruStep& rhs, const JobInfo& jobInfo) :
     finishedSending = sendWaiting = false;
     fSwallowRows = false;
     fNumBlksSkipped = 0;
+    topNCount = 0;
+    topNHaveThreshold = false;
+    topNColCmd = NULL;
     fPhysicalIO = 0;
     fCacheIO = 0;
     BPPIsAllocated = false;
@@ -415,6 +455,8 @@ TupleBPS::TupleBPS(const PassThruStep& rhs, const JobInfo& jobInfo) :
     fBPP->setUuid(fStepUuid);
     doJoin = false;
     hasPMJoin = false;
+    shuffleJoin = false;
+    shuffleOutstanding = 0;
     hasUMJoin = false;
     fRunExecuted = false;
     isFilterFeeder = false;
@@ -449,7 +491,12 @@ TupleBPS::TupleBPS(const pDictionaryStep& rhs, const JobInfo& jobInfo) :
     ridsReturned = 0;
     ridsRequested = 0;
     fNumBlksSkipped = 0;
+    topNCount = 0;
+    topNHaveThreshold = false;
+    topNColCmd = NULL;
     fBlockTouched = 0;
+    fPMAggFlushes = 0;
+    fJobsStolen = 0;
     fMsgBytesIn = 0;
     fMsgBytesOut = 0;
     fExtentsPerSegFile = DEFAULT_EXTENTS_PER_SEG_FILE;
@@ -481,6 +528,8 @@ TupleBPS::TupleBPS(const pDictionaryStep& rhs, const JobInfo& jobInfo) :
     fCardinality = rhs.cardinality();
     doJoin = false;
     hasPMJoin = false;
+    shuffleJoin = false;
+    shuffleOutstanding = 0;
     hasUMJoin = false;
     fRunExecuted = false;
     isFilterFeeder = false;
@@ -784,6 +833,10 @@ void TupleBPS::storeCasualPartitionInfo(const bool estimateRowCounts)
     vector<ColumnCommandJL*> cpColVec;
     vector<SP_LBIDList> lbidListVec;
     ColumnCommandJL* colCmd = 0;
+    vector<ColumnCommandJL*> dictColVec;
+    vector<DictStepJL*> dictStepVec;
+    DictStepJL* dictStep = 0;
+    LBIDList dictLbidList(0);
 
     // @bug 2123.  We call this earlier in the process for the hash join estimation process now.  Return if we've already done the work.
     if (fCPEvaluated)
@@ -810,17 +863,29 @@ void TupleBPS::storeCasualPartitionInfo(const bool estimateRowCounts)
             lbidListVec.push_back(tmplbidList);
             cpColVec.push_back(colCmd);
         }
-
-        // @Bug 3503. Use the total table size as the estimate for non CP columns.
-        else if (fEstimatedRows == 0 && estimateRowCounts)
+        else
         {
-            RowEstimator rowEstimator;
-            fEstimatedRows = rowEstimator.estimateRowsForNonCPColumn(*colCmd);
+            // A dictionary column's string filter is in the step after its token column
+            if (colCmd->isDict() && colCmd->getFilterCount() == 0 && i + 1 < colCmdVec.size() &&
+                    dictLbidList.CasualPartitionPrefixDataType(colCmd->getColType().colDataType) &&
+                    (dictStep = dynamic_cast<DictStepJL*>(colCmdVec[i + 1].get())) != NULL &&
+                    dictStep->getFilterCount() > 0)
+            {
+                dictColVec.push_back(colCmd);
+                dictStepVec.push_back(dictStep);
+            }
+
+            // @Bug 3503. Use the total table size as the estimate for non CP columns.
+            if (fEstimatedRows == 0 && estimateRowCounts)
+            {
+                RowEstimator rowEstimator;
+                fEstimatedRows = rowEstimator.estimateRowsForNonCPColumn(*colCmd);
+            }
         }
     }
 
 
-    if (cpColVec.size() == 0)
+    if (cpColVec.size() == 0 && dictColVec.size() == 0)
         return;
 
     const bool ignoreCP = ((fTraceFlags & CalpontSelectExecutionPlan::IGNORE_CP) != 0);
@@ -850,11 +915,25 @@ void TupleBPS::storeCasualPartitionInfo(const bool estimateRowCounts)
                 break;
             }
         }
+
+        for (uint32_t i = 0; scanFlags[idx] && i < dictColVec.size(); i++)
+        {
+            const EMEntry& extent = dictColVec[i]->getExtents()[idx];
+
+            scanFlags[idx] = (ignoreCP || extent.partition.cprange.isValid != BRM::CP_VALID ||
+                              dictLbidList.CasualPartitionPrefixPredicate(
+                                  extent.partition.cprange,
+                                  &(dictStepVec[i]->getFilterString()),
+                                  dictStepVec[i]->getFilterCount(),
+                                  dictColVec[i]->getColType(),
+                                  dictStepVec[i]->getBOP())
+                             );
+        }
     }
 
     // @bug 2123.  Use the casual partitioning information to estimate the number of rows that will be returned for use in estimating
     // the large side table for hashjoins.
-    if (estimateRowCounts)
+    if (estimateRowCounts && cpColVec.size() > 0)
     {
         RowEstimator rowEstimator;
         fEstimatedRows = rowEstimator.estimateRows(cpColVec, scanFlags, dbrm, fOid);
@@ -882,27 +961,133 @@ void TupleBPS::startAggregationThread()
     fProducerThreads.push_back(jobstepThreadPool.invoke(TupleBPSAggregators(this, fNumThreads - 1)));
 }
 
+namespace
+{
+// A framed small-side message and the PM it's for, -1 for all of them
+struct JoinerFrame
+{
+    SBS frame;
+    int32_t pm;
+};
+
+// Sends every frame of the small side to one PM.  After an error it keeps
+// reading so the other senders aren't blocked by a full FIFO.
+struct JoinerSender
+{
+    JoinerSender(DistributedEngineComm* dec, uint32_t uniqueID, FIFO<JoinerFrame>* frames, uint64_t it,
+                 uint32_t pm, string* error) :
+        fDec(dec), fUniqueID(uniqueID), fFrames(frames), fIt(it), fPm(pm), fError(error)
+    { }
+
+    void operator()()
+    {
+        utils::setThreadName("BPSJoinerSend");
+        JoinerFrame frame;
+
+        while (fFrames->next(fIt, &frame))
+        {
+            if (!fError->empty() || (frame.pm >= 0 && (uint32_t) frame.pm != fPm))
+                continue;
+
+            try
+            {
+                fDec->writeFramed(fUniqueID, *frame.frame, fPm);
+            }
+            catch (std::exception& ex)
+            {
+                *fError = ex.what();
+            }
+            catch (...)
+            {
+                *fError = "unknown error";
+            }
+        }
+    }
+
+    DistributedEngineComm* fDec;
+    uint32_t fUniqueID;
+    FIFO<JoinerFrame>* fFrames;
+    uint64_t fIt;
+    uint32_t fPm;
+    string* fError;
+};
+}
+
 void TupleBPS::serializeJoiner()
 {
     ByteStream bs;
     bool more = true;
+    uint32_t pmCount = fDec->getPmCount();
 
-    /* false from nextJoinerMsg means it's the last msg,
-    	it's not exactly the exit condition*/
-    while (more)
+    if (pmCount <= 1)
     {
+        /* false from nextJoinerMsg means it's the last msg,
+        	it's not exactly the exit condition*/
+        while (more)
         {
-            // code block to release the lock immediatly
-            boost::mutex::scoped_lock lk(serializeJoinerMutex);
-            more = fBPP->nextTupleJoinerMsg(bs);
+            {
+                // code block to release the lock immediatly
+                boost::mutex::scoped_lock lk(serializeJoinerMutex);
+                more = fBPP->nextTupleJoinerMsg(bs);
+            }
+#ifdef JLF_DEBUG
+            cout << "serializing joiner into " << bs.length() << " bytes" << endl;
+#endif
+            fDec->write(uniqueID, bs);
+            bs.restart();
         }
+
+        return;
+    }
+
+    /* Each message is serialized & compressed once, then one sender per PM sends
+       the same frame.  A PM builds its hash tables as the messages arrive, so the
+       PMs all get there at the speed of the slowest one instead of the sum of all.
+       In a shuffle join most messages are for a single PM. */
+    FIFO<JoinerFrame> frames(pmCount, 8);
+    vector<string> errors(pmCount);
+    vector<uint64_t> senders;
+    uint32_t i;
+
+    frames.ringBuffer(true);
+
+    for (i = 0; i < pmCount; i++)
+        senders.push_back(jobstepThreadPool.invoke(
+                              JoinerSender(fDec, uniqueID, &frames, frames.getIterator(), i, &errors[i])));
+
+    try
+    {
+        while (more)
+        {
+            JoinerFrame frame;
+            frame.frame.reset(new ByteStream());
+
+            {
+                // code block to release the lock immediatly
+                boost::mutex::scoped_lock lk(serializeJoinerMutex);
+                more = fBPP->nextTupleJoinerMsg(bs, &frame.pm);
+            }
 #ifdef JLF_DEBUG
-        cout << "serializing joiner into " << bs.length() << " bytes" << endl;
+            cout << "serializing joiner into " << bs.length() << " bytes" << endl;
 #endif
-        fDec->write(uniqueID, bs);
-        bs.restart();
+            fDec->frame(bs, *frame.frame);
+            frames.insert(frame);
+            bs.restart();
+        }
+    }
+    catch (...)
+    {
+        frames.endOfInput();
+        jobstepThreadPool.join(senders);
+        throw;
     }
 
+    frames.endOfInput();
+    jobstepThreadPool.join(senders);
+
+    for (i = 0; i < pmCount; i++)
+        if (!errors[i].empty())
+            throw runtime_error(errors[i]);
 }
 
 void TupleBPS::serializeJoiner(uint32_t conn)
@@ -923,12 +1108,29 @@ void TupleBPS::serializeJoiner(uint32_t conn)
     }
 }
 
+// The PM reports the range of string prefixes for a dictionary column when its
+// string filter runs right after the scan of the token column (see DictStep::prep()).
+bool TupleBPS::dictPrefixCP()
+{
+    const vector<SCommand>& steps = fBPP->getFilterSteps();
+    ColumnCommandJL* colCmd;
+
+    if (steps.size() < 2 || dynamic_cast<DictStepJL*>(steps[1].get()) == NULL)
+        return false;
+
+    colCmd = dynamic_cast<ColumnCommandJL*>(steps[0].get());
+    return (colCmd != NULL && colCmd->isDict() && colCmd->getFilterCount() == 0 &&
+            lbidList->CasualPartitionPrefixDataType(fColType.colDataType));
+}
+
 void TupleBPS::prepCasualPartitioning()
 {
     uint32_t i;
     int64_t min, max, seq;
     int128_t bigMin, bigMax;
     boost::mutex::scoped_lock lk(cpMutex);
+    const bool cpDataType = (lbidList->CasualPartitionDataType(fColType.colDataType, fColType.colWidth) ||
+                             dictPrefixCP());
 
     for (i = 0; i < scannedExtents.size(); i++)
     {
@@ -936,8 +1138,7 @@ void TupleBPS::prepCasualPartitioning()
         {
             scanFlags[i] = scanFlags[i] && runtimeCPFlags[i];
 
-            if (scanFlags[i] && lbidList->CasualPartitionDataType(fColType.colDataType,
-                    fColType.colWidth))
+            if (scanFlags[i] && cpDataType)
             {
                 if (fColType.colWidth <= 8)
                 {
@@ -1198,12 +1399,40 @@ void TupleBPS::run()
         fe2Output.initRow(&fe2OutRow);
     }
 
+    if (topNCount > 0)
+        initTopN();
+
     try
     {
         fDec->addDECEventListener(this);
         fBPP->priority(priority());
-        fBPP->createBPP(bs);
-        fDec->write(uniqueID, bs);
+
+        if (shuffleJoin)
+        {
+            // each PM gets its own partition of the small side and the names of the others
+            vector<string> peers;
+
+            if (tjoiners[0]->getPmPartitions().size() != pmCount())
+                throw runtime_error("The number of PMs changed while setting up a shuffle join");
+
+            for (i = 0; i < pmCount(); i++)
+                peers.push_back(fDec->getPmName(i));
+
+            fBPP->setShuffle(peers);
+
+            for (i = 0; i < pmCount(); i++)
+            {
+                bs.restart();
+                fBPP->createBPP(bs, i);
+                fDec->writeToPm(uniqueID, bs, i);
+            }
+        }
+        else
+        {
+            fBPP->createBPP(bs);
+            fDec->write(uniqueID, bs);
+        }
+
         BPPIsAllocated = true;
 
         if (doJoin && tjoiners[0]->inPM())
@@ -1395,6 +1624,24 @@ void TupleBPS::interleaveJobs(vector<Job>* jobs) const
 //				<< (*jobs)[i].connectionNum + 1 << endl;
 }
 
+bool TupleBPS::topNSkipsJob(const Job& job)
+{
+    if (topNCount == 0)
+        return false;
+
+    // the rows already returned make this extent irrelevant
+    if (topNRulesOutExtent(job.extentIndex))
+    {
+        fNumBlksSkipped += job.expectedResponses * fColType.colWidth;
+        boost::mutex::scoped_lock tplLock(tplMutex);
+        totalMsgs -= job.expectedResponses;
+        return true;
+    }
+
+    appendTopNThreshold(*(job.msg));
+    return false;
+}
+
 void TupleBPS::sendJobs(const vector<Job>& jobs)
 {
     uint32_t i;
@@ -1402,6 +1649,9 @@ void TupleBPS::sendJobs(const vector<Job>& jobs)
 
     for (i = 0; i < jobs.size() && !cancelled(); i++)
     {
+        if (topNSkipsJob(jobs[i]))
+            continue;
+
         fDec->write(uniqueID, *(jobs[i].msg));
         tplLock.lock();
         msgsSent += jobs[i].expectedResponses;
@@ -1409,8 +1659,7 @@ void TupleBPS::sendJobs(const vector<Job>& jobs)
         if (recvWaiting)
             condvar.notify_all();
 
-        while ((msgsSent - msgsRecvd > fMaxOutstandingRequests << LOGICAL_EXTENT_CONVERTER)
-                && !fDie)
+        while (overWindow() && !fDie)
         {
             sendWaiting = true;
             condvarWakeupProducer.wait(tplLock);
@@ -1421,6 +1670,145 @@ void TupleBPS::sendJobs(const vector<Job>& jobs)
     }
 }
 
+bool TupleBPS::overWindow() const
+{
+    return (int64_t) (msgsSent - msgsRecvd) + shuffleOutstanding >
+           (int64_t) fMaxOutstandingRequests << LOGICAL_EXTENT_CONVERTER;
+}
+
+/* Picks the PM with the most work left relative to how fast it's been going.  The
+ * PMs started together, so the blocks each has finished stand in for its rate.
+ * The job comes off the back of its queue, away from the blocks that PM is reading.
+ */
+const TupleBPS::Job* TupleBPS::stealJob(deque<const Job*>* bins, vector<uint64_t>& queuedBlocks,
+                                        uint32_t thief)
+{
+    uint32_t i, victim = thief;
+    double score, bestScore = 0;
+    const Job* job;
+
+    for (i = 0; i < queuedBlocks.size(); i++)
+    {
+        if (i == thief || bins[i].empty())
+            continue;
+
+        score = (double) (queuedBlocks[i] + fPMBlocksOutstanding[i]) / (fPMBlocksDone[i] + 1);
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            victim = i;
+        }
+    }
+
+    if (victim == thief)
+        return NULL;
+
+    job = bins[victim].back();
+    bins[victim].pop_back();
+    queuedBlocks[victim] -= job->expectedResponses;
+    // the PM reads the dbroot named in the msg, only the destination changes
+    ((ISMPacketHeader*) job->msg->buf())->Interleave = thief;
+    fJobsStolen++;
+    return job;
+}
+
+/* The pull model version of interleaveJobs() + sendJobs().  Each PM gets a share of
+ * the send window, and whenever one has room it's sent its next job.  The receive
+ * side tracks the blocks each PM has finished from the PM index it echoes back.
+ */
+void TupleBPS::dispatchJobs(const vector<Job>& jobs)
+{
+    uint32_t i, pm = 0, next = 0;
+    uint32_t pmCount = fDec->getPmCount();
+    uint64_t remaining = jobs.size();
+    scoped_array<deque<const Job*> > bins;
+    vector<uint64_t> queuedBlocks;
+    const Job* job;
+    // the other PMs can't take jobs for a query that's only allowed to run here
+    bool canSteal = fScanWorkStealing &&
+                    fLocalQuery != execplan::CalpontSelectExecutionPlan::LOCAL_QUERY;
+    boost::unique_lock<boost::mutex> tplLock(tplMutex, boost::defer_lock);
+
+    for (i = 0; i < jobs.size(); i++)
+        if (pmCount < jobs[i].connectionNum + 1)
+            pmCount = jobs[i].connectionNum + 1;
+
+    if (pmCount == 0)
+        return;
+
+    // the jobs come grouped by dbroot, which the queues keep
+    bins.reset(new deque<const Job*>[pmCount]);
+    queuedBlocks.resize(pmCount, 0);
+
+    for (i = 0; i < jobs.size(); i++)
+    {
+        bins[jobs[i].connectionNum].push_back(&jobs[i]);
+        queuedBlocks[jobs[i].connectionNum] += jobs[i].expectedResponses;
+    }
+
+    tplLock.lock();
+    fPMBlocksOutstanding.assign(pmCount, 0);
+    fPMBlocksDone.assign(pmCount, 0);
+    fPMWindow = max<int64_t>((fMaxOutstandingRequests << LOGICAL_EXTENT_CONVERTER) / pmCount, 1);
+    tplLock.unlock();
+
+    while (remaining > 0 && !cancelled())
+    {
+        job = NULL;
+        tplLock.lock();
+
+        while (job == NULL && !fDie)
+        {
+            // round robin over the PMs that have room
+            for (i = 0; i < pmCount && job == NULL && !overWindow(); i++)
+            {
+                pm = (next + i) % pmCount;
+
+                if (fPMBlocksOutstanding[pm] >= fPMWindow)
+                    continue;
+
+                if (!bins[pm].empty())
+                {
+                    job = bins[pm].front();
+                    bins[pm].pop_front();
+                    queuedBlocks[pm] -= job->expectedResponses;
+                }
+                else if (canSteal)
+                    job = stealJob(bins.get(), queuedBlocks, pm);
+            }
+
+            if (job == NULL)
+            {
+                sendWaiting = true;
+                condvarWakeupProducer.wait(tplLock);
+                sendWaiting = false;
+            }
+        }
+
+        tplLock.unlock();
+
+        if (job == NULL)
+            break;
+
+        next = (pm + 1) % pmCount;
+        remaining--;
+
+        if (topNSkipsJob(*job))
+            continue;
+
+        fDec->write(uniqueID, *(job->msg));
+        tplLock.lock();
+        msgsSent += job->expectedResponses;
+        fPMBlocksOutstanding[pm] += job->expectedResponses;
+
+        if (recvWaiting)
+            condvar.notify_all();
+
+        tplLock.unlock();
+    }
+}
+
 template<typename T>
 bool TupleBPS::compareSingleValue(uint8_t COP, T val1, T val2) const
 {
@@ -1845,7 +2233,7 @@ void TupleBPS::makeJobs(vector<Job>* jobs)
             bs.reset(new ByteStream());
             fBPP->runBPP(*bs, (*dbRootConnectionMap)[scannedExtents[i].dbRoot]);
             jobs->push_back(Job(scannedExtents[i].dbRoot, (*dbRootConnectionMap)[scannedExtents[i].dbRoot],
-                                blocksThisJob, bs));
+                                blocksThisJob, bs, i));
             blocksToScan -= blocksThisJob;
             startingLBID += fColType.colWidth * blocksThisJob;
             fBPP->reset();
@@ -1866,8 +2254,14 @@ void TupleBPS::sendPrimitiveMessages()
     try
     {
         makeJobs(&jobs);
-        interleaveJobs(&jobs);
-        sendJobs(jobs);
+
+        if (fAdaptiveDispatch)
+            dispatchJobs(jobs);
+        else
+        {
+            interleaveJobs(&jobs);
+            sendJobs(jobs);
+        }
     }
     catch (...)
     {
@@ -1919,6 +2313,7 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
 
     bool validCPData;
     bool hasBinaryColumn;
+    bool fromShuffle = false;
     int128_t min;
     int128_t max;
     uint64_t lbid;
@@ -1926,9 +2321,11 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
     uint32_t cachedIO;
     uint32_t physIO;
     uint32_t touchedBlocks;
+    uint32_t pmAggFlushes;
     uint32_t cachedIO_Thread = 0;
     uint32_t physIO_Thread = 0;
     uint32_t touchedBlocks_Thread = 0;
+    uint64_t pmAggFlushes_Thread = 0;
     int64_t ridsReturned_Thread = 0;
     bool lastThread = false;
     uint32_t i, j, k;
@@ -2082,14 +2479,14 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
         while (1)
         {
             // sync with the send side
-            while (!finishedSending && msgsSent == msgsRecvd)
+            while (!finishedSending && msgsSent == msgsRecvd && shuffleOutstanding == 0)
             {
                 recvWaiting++;
                 condvar.wait(tplLock);
                 recvWaiting--;
             }
 
-            if (msgsSent == msgsRecvd && finishedSending)
+            if (msgsSent == msgsRecvd && finishedSending && shuffleOutstanding == 0)
                 break;
 
             bool flowControlOn;
@@ -2128,14 +2525,38 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
 
             for (uint32_t z = 0; z < size; z++)
             {
-                if (bsv[z]->length() > 0 && fBPP->countThisMsg(*(bsv[z])))
-                    ++msgsRecvd;
+                if (bsv[z]->length() > 0)
+                {
+                    bool counted = fBPP->countThisMsg(*(bsv[z]));
+
+                    if (counted)
+                    {
+                        ++msgsRecvd;
+
+                        // the PM echoes its index, see dispatchJobs()
+                        uint32_t pm = ((ISMPacketHeader*) bsv[z]->buf())->Interleave;
+
+                        if (fAdaptiveDispatch && pm < fPMBlocksOutstanding.size())
+                        {
+                            fPMBlocksOutstanding[pm]--;
+                            fPMBlocksDone[pm]++;
+
+                            if (sendWaiting && fPMBlocksOutstanding[pm] < fPMWindow)
+                                condvarWakeupProducer.notify_one();
+                        }
+                    }
+
+                    /* In a shuffle join the PMs also answer for the row groups they were
+                       sent by other PMs.  Each counted msg says how many its PM sent,
+                       the last answer for each of those says it's done. */
+                    if (shuffleJoin && ((ISMPacketHeader*) bsv[z]->buf())->Status == 0)
+                        shuffleOutstanding += fBPP->shuffleDelta(*(bsv[z]), counted);
+                }
             }
 
             //@Bug 1424,1298
 
-            if (sendWaiting && ((msgsSent - msgsRecvd) <=
-                                (fMaxOutstandingRequests << LOGICAL_EXTENT_CONVERTER)))
+            if (sendWaiting && !overWindow())
             {
                 condvarWakeupProducer.notify_one();
                 THROTTLEDEBUG << "receiveMultiPrimitiveMessages wakes up sending side .. " << "  msgsSent: " << msgsSent << "  msgsRecvd = " << msgsRecvd << endl;
@@ -2195,7 +2616,8 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
 
                 fromPrimProc.clear();
                 fBPP->getRowGroupData(*bs, &fromPrimProc, &validCPData, &lbid, &min, &max,
-                                      &cachedIO, &physIO, &touchedBlocks, &unused, threadID, &hasBinaryColumn, fColType);
+                                      &cachedIO, &physIO, &touchedBlocks, &pmAggFlushes, &unused, threadID,
+                                      &hasBinaryColumn, fColType, &fromShuffle);
 
                 /* Another layer of messiness.  Need to refactor this fcn. */
                 while (!fromPrimProc.empty() && !cancelled())
@@ -2206,6 +2628,9 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
                     local_primRG.setData(&rgData);
                     ridsReturned_Thread += local_primRG.getRowCount();   // TODO need the pre-join count even on PM joins... later
 
+                    if (topNCount > 0)
+                        updateTopNThreshold(rgData);
+
                     /* TupleHashJoinStep::joinOneRG() is a port of the main join loop here.  Any
                     * changes made here should also be made there and vice versa. */
                     if (hasUMJoin || !fBPP->pmSendsFinalResult())
@@ -2357,8 +2782,10 @@ void TupleBPS::receiveMultiPrimitiveMessages(uint32_t threadID)
                     cachedIO_Thread += cachedIO;
                     physIO_Thread += physIO;
                     touchedBlocks_Thread += touchedBlocks;
+                    pmAggFlushes_Thread += pmAggFlushes;
 
-                    if (fOid >= 3000 && ffirstStepType == SCAN && bop == BOP_AND)
+                    // rows another PM shuffled here don't carry casual partitioning data
+                    if (fOid >= 3000 && ffirstStepType == SCAN && bop == BOP_AND && !fromShuffle)
                     {
                         if (fColType.colWidth <= 8)
                         {
@@ -2573,6 +3000,7 @@ out:
     fPhysicalIO += physIO_Thread;
     fCacheIO += cachedIO_Thread;
     fBlockTouched += touchedBlocks_Thread;
+    fPMAggFlushes += pmAggFlushes_Thread;
     tplLock.unlock();
 
     if (fTableOid >= 3000 && lastThread)
@@ -2634,7 +3062,15 @@ out:
                    "\tPartitionBlocksEliminated-" << fNumBlksSkipped <<
                    "; MsgBytesIn-"  << msgBytesInKB  << "KB" <<
                    "; MsgBytesOut-" << msgBytesOutKB << "KB" <<
-                   "; TotalMsgs-" << totalMsgs << endl  <<
+                   "; TotalMsgs-" << totalMsgs;
+
+            if (fBPP->hasAggregateStep())
+                logStr << "; PMAggBoundedFlushes-" << fPMAggFlushes;
+
+            if (fScanWorkStealing)
+                logStr << "; JobsStolen-" << fJobsStolen;
+
+            logStr << endl <<
                    "\t1st read " << dlTimes.FirstReadTimeString() <<
                    "; EOI " << dlTimes.EndOfInputTimeString() << "; runtime-" <<
                    JSTimeStamp::tsdiffstr(dlTimes.EndOfInputTime(), dlTimes.FirstReadTime()) <<
@@ -2790,6 +3226,8 @@ void TupleBPS::useJoiners(const vector<boost::shared_ptr<joiner::TupleJoiner> >&
     joinerMatchesRGs.clear();
     smallSideCount = tjoiners.size();
     hasPMJoin = false;
+    shuffleJoin = false;
+    shuffleOutstanding = 0;
     hasUMJoin = false;
 
     for (i = 0; i < smallSideCount; i++)
@@ -2805,6 +3243,8 @@ void TupleBPS::useJoiners(const vector<boost::shared_ptr<joiner::TupleJoiner> >&
             smallOuterJoiner = i;
     }
 
+    shuffleJoin = (smallSideCount == 1 && tjoiners[0]->inPM() && tjoiners[0]->partitionedOnPM());
+
     if (hasPMJoin)
         fBPP->useJoiners(tjoiners);
 }
@@ -2813,6 +3253,14 @@ void TupleBPS::newPMOnline(uint32_t connectionNumber)
 {
     ByteStream bs;
 
+    // the small side is already split over the PMs that were there
+    if (shuffleJoin)
+    {
+        abort();
+        catchHandler("A PM came online during a shuffle join", ERR_TUPLE_BPS, fErrorInfo, fSessionId);
+        return;
+    }
+
     fBPP->createBPP(bs);
 
     try
@@ -3160,6 +3608,175 @@ bool TupleBPS::deliverStringTableRowGroup() const
     return outputRowGroup.usesStringTable();
 }
 
+bool TupleBPS::setTopN(const vector<pair<uint32_t, bool> >& orderByCols, uint64_t count)
+{
+    const RowGroup& rg = getDeliveredRowGroup();
+    const vector<uint32_t>& keys = rg.getKeys();
+    vector<ordering::IdbSortSpec> specs;
+
+    // the rows have to be final by the time PrimProc sees them
+    if (doJoin || (fe2 && !runFEonPM) || count == 0)
+        return false;
+
+    for (uint32_t i = 0; i < orderByCols.size(); i++)
+    {
+        vector<uint32_t>::const_iterator it = find(keys.begin(), keys.end(), orderByCols[i].first);
+
+        if (it == keys.end())
+            return false;
+
+        specs.push_back(ordering::IdbSortSpec(it - keys.begin(), orderByCols[i].second));
+    }
+
+    topNSpecs.swap(specs);
+    topNCount = count;
+    return true;
+}
+
+void TupleBPS::initTopN()
+{
+    // joins may have been added since setTopN()
+    if (doJoin || (fe2 && !runFEonPM))
+    {
+        topNCount = 0;
+        return;
+    }
+
+    topNThresholdRG = getDeliveredRowGroup();
+    topNThresholdData.reinit(topNThresholdRG, 1);
+    topNThresholdRG.setData(&topNThresholdData);
+    topNThresholdRG.resetRowGroup(0);
+    topNThresholdRG.initRow(&topNThreshold);
+    topNThresholdRG.initRow(&topNRow);
+    topNThresholdRG.initRow(&topNWorst);
+    topNThresholdRG.getRow(0, &topNThreshold);
+    topNOrder.reset(new ordering::OrderByData(topNSpecs, topNThresholdRG));
+    topNHaveThreshold = false;
+    fBPP->setTopN(topNSpecs, topNCount);
+
+    /* Extents can be skipped on the CP range of the leading column when it sorts
+     * descending; NULLs sort last then, and CP doesn't say whether an extent has any.
+     */
+    const ordering::IdbSortSpec& lead = topNSpecs[0];
+    uint32_t oid = topNThresholdRG.getOIDs()[lead.fIndex];
+    CalpontSystemCatalog::ColDataType type = topNThresholdRG.getColTypes()[lead.fIndex];
+    const vector<SCommand>& filters = fBPP->getFilterSteps();
+    const vector<SCommand>& projections = fBPP->getProjectSteps();
+    ColumnCommandJL* cc;
+    uint32_t i;
+
+    topNColCmd = NULL;
+
+    if (lead.fAsc > 0 || bop != BOP_AND || ffirstStepType != SCAN ||
+            (fTraceFlags & CalpontSelectExecutionPlan::IGNORE_CP) != 0)
+        return;
+
+    switch (type)
+    {
+        case CalpontSystemCatalog::TINYINT:
+        case CalpontSystemCatalog::SMALLINT:
+        case CalpontSystemCatalog::MEDINT:
+        case CalpontSystemCatalog::INT:
+        case CalpontSystemCatalog::BIGINT:
+        case CalpontSystemCatalog::DECIMAL:
+        case CalpontSystemCatalog::UTINYINT:
+        case CalpontSystemCatalog::USMALLINT:
+        case CalpontSystemCatalog::UMEDINT:
+        case CalpontSystemCatalog::UINT:
+        case CalpontSystemCatalog::UBIGINT:
+        case CalpontSystemCatalog::UDECIMAL:
+        case CalpontSystemCatalog::DATE:
+        case CalpontSystemCatalog::DATETIME:
+        case CalpontSystemCatalog::TIMESTAMP:
+            break;
+
+        default:
+            return;
+    }
+
+    for (i = 0; i < filters.size() + projections.size() && !topNColCmd; i++)
+    {
+        cc = dynamic_cast<ColumnCommandJL*>(i < filters.size() ?
+                                            filters[i].get() : projections[i - filters.size()].get());
+
+        if (!cc || dynamic_cast<PseudoCCJL*>(cc) || cc->getOID() != oid)
+            continue;
+
+        // make sure the delivered column is the stored value and not an expression on it
+        if (cc->getColType().colDataType == type &&
+                cc->getColType().colWidth == (int32_t) topNThresholdRG.getColumnWidth(lead.fIndex) &&
+                cc->getColType().colWidth <= 8 &&
+                cc->getColType().scale == (int32_t) topNThresholdRG.getScale()[lead.fIndex])
+            topNColCmd = cc;
+    }
+}
+
+void TupleBPS::updateTopNThreshold(RGData& rgData)
+{
+    boost::mutex::scoped_lock lk(topNMutex);
+    RowGroup rg = topNThresholdRG;
+    uint32_t i;
+
+    rg.setData(&rgData);
+
+    if (rg.getRowCount() < topNCount)
+        return;
+
+    // any topNCount rows bound the final result; their worst row is a usable threshold
+    rg.getRow(0, &topNWorst);
+    rg.getRow(1, &topNRow);
+
+    for (i = 1; i < rg.getRowCount(); i++, topNRow.nextRow())
+        if ((*topNOrder)(topNWorst.getPointer(), topNRow.getPointer()))
+            topNWorst.setPointer(topNRow.getPointer());
+
+    if (topNHaveThreshold && !(*topNOrder)(topNWorst.getPointer(), topNThreshold.getPointer()))
+        return;
+
+    // start from a fresh RGData so a string table doesn't keep the old values
+    topNThresholdData.reinit(topNThresholdRG, 1);
+    topNThresholdRG.setData(&topNThresholdData);
+    topNThresholdRG.resetRowGroup(0);
+    topNThresholdRG.getRow(0, &topNThreshold);
+    copyRow(topNWorst, &topNThreshold);
+    topNThresholdRG.setRowCount(1);
+    topNHaveThreshold = true;
+}
+
+void TupleBPS::appendTopNThreshold(ByteStream& bs)
+{
+    boost::mutex::scoped_lock lk(topNMutex);
+
+    if (!topNHaveThreshold)
+    {
+        bs << (uint8_t) 0;
+        return;
+    }
+
+    bs << (uint8_t) 1;
+    topNThresholdRG.serializeRGData(bs);
+}
+
+bool TupleBPS::topNRulesOutExtent(uint32_t extentIndex)
+{
+    if (!topNColCmd)
+        return false;
+
+    const EMEntry& extent = topNColCmd->getExtents()[extentIndex];
+    uint32_t col = topNSpecs[0].fIndex;
+    boost::mutex::scoped_lock lk(topNMutex);
+
+    if (!topNHaveThreshold || extent.partition.cprange.isValid != BRM::CP_VALID ||
+            topNThreshold.isNullValue(col))
+        return false;
+
+    // every row in the extent sorts after the threshold
+    if (isUnsigned(topNColCmd->getColType().colDataType))
+        return ((uint64_t) extent.partition.cprange.hiVal < topNThreshold.getUintField(col));
+
+    return (extent.partition.cprange.hiVal < topNThreshold.getIntField(col));
+}
+
 void TupleBPS::formatMiniStats()
 {
 
@@ -386,6 +386,8 @@ TupleAggregateStep::TupleAggregateStep(
     fRm(jobInfo.rm),
     fBucketNum(0),
     fInputIter(-1),
+    fUmMemUsage(0),
+    fAggMemReported(0),
     fSessionMemLimit(jobInfo.umMemLimit)
 {
     fRowGroupData.reinit(fRowGroupOut);
@@ -432,6 +434,7 @@ void TupleAggregateStep::initializeMultiThread()
     fRowGroupIns.resize(fNumOfThreads);
     fRowGroupOuts.resize(fNumOfBuckets);
     fRowGroupDatas.resize(fNumOfBuckets);
+    fBucketMemReported.assign(fNumOfBuckets, 0);
 
     rowgroup::SP_ROWAGG_UM_t agg;
     RGData rgData;
@@ -567,6 +570,7 @@ void TupleAggregateStep::doThreadedSecondPhaseAggregate(uint32_t threadID)
                         throw;
                     }
 
+                    reportMemUsage(fBucketMemReported[c], fAggregators[c]->getMemUsage());
                     fAgg_mutex[c]->unlock();
                     bucketDone[c] = true;
                     rowBucketVecs[c][0].clear();
@@ -622,11 +626,13 @@ uint32_t TupleAggregateStep::nextBand_singleThread(messageqcpp::ByteStream& bs)
             if (dynamic_cast<RowAggregationDistinct*>(fAggregator.get()) != NULL)
             {
                 dynamic_cast<RowAggregationDistinct*>(fAggregator.get())->doDistinctAggregation();
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
             }
 
             if (fAggregator->nextRowGroup())
             {
                 fAggregator->finalize();
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
                 rowCount = fRowGroupOut.getRowCount();
                 fRowsReturned += rowCount;
                 fRowGroupDelivered.setData(fRowGroupOut.getRGData());
@@ -869,6 +875,19 @@ const string TupleAggregateStep::toString() const
     return oss.str();
 }
 
+
+int64_t TupleAggregateStep::umMemUsage() const
+{
+    return fUmMemUsage;
+}
+
+
+void TupleAggregateStep::reportMemUsage(uint64_t& reported, uint64_t now)
+{
+    fUmMemUsage += (int64_t) now - (int64_t) reported;
+    reported = now;
+}
+
 SJSTEP TupleAggregateStep::prepAggregate(SJSTEP& step, JobInfo& jobInfo)
 {
     SJSTEP spjs;
@@ -5219,6 +5238,7 @@ void TupleAggregateStep::aggregateRowGroups()
             {
                 fRowGroupIn.setData(&rgData);
                 fAggregator->addRowGroup(&fRowGroupIn);
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
                 more = dlIn->next(fInputIter, &rgData);
 
                 // error checking
@@ -5357,6 +5377,7 @@ void TupleAggregateStep::threadedAggregateRowGroups(uint32_t threadID)
                     {
                         fRowGroupIns[threadID].setData(&rgData);
                         fMemUsage[threadID] += fRowGroupIns[threadID].getSizeWithStrings();
+                        fUmMemUsage += fRowGroupIns[threadID].getSizeWithStrings();
 
                         if (!fRm->getMemory(fRowGroupIns[threadID].getSizeWithStrings(), fSessionMemLimit))
                         {
@@ -5481,6 +5502,7 @@ void TupleAggregateStep::threadedAggregateRowGroups(uint32_t threadID)
                                 throw;
                             }
 
+                            reportMemUsage(fBucketMemReported[c], fAggregators[c]->getMemUsage());
                             fAgg_mutex[c]->unlock();
                             rowBucketVecs[c][0].clear();
                             bucketDone[c] = true;
@@ -5497,6 +5519,7 @@ void TupleAggregateStep::threadedAggregateRowGroups(uint32_t threadID)
 
                 rgDatas.clear();
                 fRm->returnMemory(fMemUsage[threadID], fSessionMemLimit);
+                fUmMemUsage -= fMemUsage[threadID];
                 fMemUsage[threadID] = 0;
 
                 if (cancelled())
@@ -5555,11 +5578,13 @@ void TupleAggregateStep::doAggregate_singleThread()
             if (dynamic_cast<RowAggregationDistinct*>(fAggregator.get()) != NULL)
             {
                 dynamic_cast<RowAggregationDistinct*>(fAggregator.get())->doDistinctAggregation();
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
             }
 
             while (fAggregator->nextRowGroup())
             {
                 fAggregator->finalize();
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
                 fRowsReturned += fRowGroupOut.getRowCount();
                 rgData = fRowGroupOut.duplicate();
                 fRowGroupDelivered.setData(&rgData);
@@ -5746,6 +5771,7 @@ uint64_t TupleAggregateStep::doThreadedAggregate(ByteStream& bs, RowGroupDL* dlp
             {
                 done = false;
                 fAggregator->finalize();
+                reportMemUsage(fAggMemReported, fAggregator->getMemUsage());
                 rowCount = fRowGroupOut.getRowCount();
                 fRowsReturned += rowCount;
                 fRowGroupDelivered.setData(fRowGroupOut.getRGData());
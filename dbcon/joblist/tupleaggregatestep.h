@@ -26,6 +26,7 @@
 #include "rowaggregation.h"
 #include "threadnaming.h"
 
+#include <atomic>
 #include <boost/thread.hpp>
 
 
@@ -59,6 +60,7 @@ public:
     void join();
 
     const std::string toString() const;
+    int64_t umMemUsage() const;
 
     void setOutputRowGroup(const rowgroup::RowGroup&);
     const rowgroup::RowGroup& getOutputRowGroup() const;
@@ -108,6 +110,7 @@ private:
     void doThreadedSecondPhaseAggregate(uint32_t threadID);
     bool nextDeliveredRowGroup();
     void pruneAuxColumns();
+    void reportMemUsage(uint64_t& reported, uint64_t now);
     void formatMiniStats();
     void printCalTrace();
 
@@ -205,6 +208,12 @@ private:
     int fInputIter; // iterator
     boost::scoped_array<uint64_t> fMemUsage;
 
+    // memory charged by this step, reported by umMemUsage(); the aggregators
+    // report their growth at the points they are driven from
+    std::atomic<int64_t> fUmMemUsage;
+    uint64_t fAggMemReported;
+    std::vector<uint64_t> fBucketMemReported;   // guarded by fAgg_mutex[bucket]
+
     boost::shared_ptr<int64_t> fSessionMemLimit;
 };
 
@@ -125,7 +125,8 @@ TupleAnnexStep::TupleAnnexStep(const JobInfo& jobInfo) :
     fConstant(NULL),
     fFeInstance(funcexp::FuncExp::instance()),
     fJobList(jobInfo.jobListPtr),
-    fFinishedThreads(0)
+    fFinishedThreads(0),
+    fUmMemUsage(0)
 {
     fExtendedInfo = "TNS: ";
     fQtc.stepParms().stepType = StepTeleStats::T_TNS;
@@ -572,12 +573,62 @@ void TupleAnnexStep::executeNoOrderByWithDistinct()
 }
 
 
+/*
+    Sends the sorted output of a LimitedOrderBy into the output DL,
+    filling in constant columns or dropping the deleted ones.
+*/
+void TupleAnnexStep::deliverOrderBy(LimitedOrderBy* orderBy)
+{
+    RGData rgDataIn;
+    RGData rgDataOut;
+
+    while (!cancelled() && orderBy->getData(rgDataIn))
+    {
+        if (fConstant == NULL &&
+                fRowGroupOut.getColumnCount() == fRowGroupIn.getColumnCount())
+        {
+            rgDataOut = rgDataIn;
+            fRowGroupOut.setData(&rgDataOut);
+        }
+        else
+        {
+            fRowGroupIn.setData(&rgDataIn);
+            fRowGroupIn.getRow(0, &fRowIn);
+
+            rgDataOut.reinit(fRowGroupOut, fRowGroupIn.getRowCount());
+            fRowGroupOut.setData(&rgDataOut);
+            fRowGroupOut.resetRowGroup(fRowGroupIn.getBaseRid());
+            fRowGroupOut.setDBRoot(fRowGroupIn.getDBRoot());
+            fRowGroupOut.getRow(0, &fRowOut);
+
+            for (uint64_t i = 0; i < fRowGroupIn.getRowCount(); ++i)
+            {
+                if (fConstant)
+                    fConstant->fillInConstants(fRowIn, fRowOut);
+                else
+                    copyRow(fRowIn, &fRowOut);
+
+                fRowGroupOut.incRowCount();
+                fRowOut.nextRow();
+                fRowIn.nextRow();
+            }
+        }
+
+        if (fRowGroupOut.getRowCount() > 0)
+        {
+            fRowsReturned += fRowGroupOut.getRowCount();
+            fOutputDL->insert(rgDataOut);
+        }
+    }
+}
+
+
 void TupleAnnexStep::executeWithOrderBy()
 {
     utils::setThreadName("TASwOrd");
     RGData rgDataIn;
-    RGData rgDataOut;
     bool more = false;
+    uint64_t reported = 0;
 
     try
     {
@@ -603,52 +654,15 @@ void TupleAnnexStep::executeWithOrderBy()
                 fRowIn.nextRow();
             }
 
+            reportMemUsage(reported, fOrderBy->getMemUsage());
             more = fInputDL->next(fInputIterator, &rgDataIn);
         }
 
         fOrderBy->finalize();
+        reportMemUsage(reported, fOrderBy->getMemUsage());
 
         if (!cancelled())
-        {
-            while (fOrderBy->getData(rgDataIn))
-            {
-                if (fConstant == NULL &&
-                        fRowGroupOut.getColumnCount() == fRowGroupIn.getColumnCount())
-                {
-                    rgDataOut = rgDataIn;
-                    fRowGroupOut.setData(&rgDataOut);
-                }
-                else
-                {
-                    fRowGroupIn.setData(&rgDataIn);
-                    fRowGroupIn.getRow(0, &fRowIn);
-
-                    rgDataOut.reinit(fRowGroupOut, fRowGroupIn.getRowCount());
-                    fRowGroupOut.setData(&rgDataOut);
-                    fRowGroupOut.resetRowGroup(fRowGroupIn.getBaseRid());
-                    fRowGroupOut.setDBRoot(fRowGroupIn.getDBRoot());
-                    fRowGroupOut.getRow(0, &fRowOut);
-
-                    for (uint64_t i = 0; i < fRowGroupIn.getRowCount(); ++i)
-                    {
-                        if (fConstant)
-                            fConstant->fillInConstants(fRowIn, fRowOut);
-                        else
-                            copyRow(fRowIn, &fRowOut);
-
-                        fRowGroupOut.incRowCount();
-                        fRowOut.nextRow();
-                        fRowIn.nextRow();
-                    }
-                }
-
-                if (fRowGroupOut.getRowCount() > 0)
-                {
-                    fRowsReturned += fRowGroupOut.getRowCount();
-                    fOutputDL->insert(rgDataOut);
-                }
-            }
-        }
+            deliverOrderBy(fOrderBy);
     }
     catch (...)
     {
@@ -887,6 +901,16 @@ void TupleAnnexStep::finalizeParallelOrderByDistinct()
 void TupleAnnexStep::finalizeParallelOrderBy()
 {
     utils::setThreadName("TASwParOrdMerge");
+
+    for (uint64_t id = 1; id <= fMaxThreads; id++)
+    {
+        if (fOrderByList[id]->spilled())
+        {
+            finalizeSpilledOrderBy();
+            return;
+        }
+    }
+
     uint64_t count = 0;
     uint64_t offset = 0;
     uint32_t rowSize = 0;
@@ -1067,6 +1091,56 @@ void TupleAnnexStep::finalizeParallelOrderBy()
     }
 }
 
+/*
+    Used instead of finalizeParallelOrderBy() when a thread's LimitedOrderBy
+    ran out of memory and wrote sorted runs to disk.  The spare LimitedOrderBy
+    takes the runs of all the threads, the rows they still hold included,
+    and merges them with OFFSET and LIMIT applied.
+*/
+void TupleAnnexStep::finalizeSpilledOrderBy()
+{
+    LimitedOrderBy* merger = fOrderByList[0];
+
+    try
+    {
+        for (uint64_t id = 1; id <= fMaxThreads && !cancelled(); id++)
+            merger->takeRuns(*fOrderByList[id]);
+
+        merger->setLimit(fLimitStart, fLimitCount);
+        merger->finalize();
+
+        if (!cancelled())
+            deliverOrderBy(merger);
+    }
+    catch (...)
+    {
+        handleException(std::current_exception(),
+                        logging::ERR_IN_PROCESS,
+                        logging::ERR_ALWAYS_CRITICAL,
+                        "TupleAnnexStep::finalizeSpilledOrderBy()");
+    }
+
+    fOutputDL->endOfInput();
+
+    StepTeleStats sts;
+    sts.query_uuid = fQueryUuid;
+    sts.step_uuid = fStepUuid;
+    sts.msg_type = StepTeleStats::ST_SUMMARY;
+    sts.total_units_of_work = sts.units_of_work_completed = 1;
+    sts.rows = fRowsReturned;
+    postStepSummaryTele(sts);
+
+    if (traceOn())
+    {
+        if (dlTimes.FirstReadTime().tv_sec == 0)
+            dlTimes.setFirstReadTime();
+
+        dlTimes.setLastReadTime();
+        dlTimes.setEndOfInputTime();
+        printCalTrace();
+    }
+}
+
 void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
 {
     utils::setThreadName("TASwParOrd");
@@ -1077,6 +1151,7 @@ void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
     uint32_t rowSize = 0;
 
     uint64_t rowCount = 0;
+    uint64_t reported = 0;
     uint64_t doubleRGSize = 2*rowgroup::rgCommonSize;
     rowgroup::Row r = fRowIn;
     rowgroup::RowGroup rg = fRowGroupIn;
@@ -1122,6 +1197,8 @@ void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
                     limOrderBy->processRow(r);
                     r.nextRow(rowSize);
                }
+
+                reportMemUsage(reported, limOrderBy->getMemUsage());
             }
             
             // *DRRTUY Implement a method to skip elements in FIFO
@@ -1156,6 +1233,15 @@ void TupleAnnexStep::executeParallelOrderBy(uint64_t id)
         {
             finalizeParallelOrderBy();
         }
+
+        // the other threads are done with their LimitedOrderBys
+        int64_t memUsage = 0;
+
+        for (uint64_t i = 0; i < fOrderByList.size(); i++)
+            if (fOrderByList[i])
+                memUsage += fOrderByList[i]->getMemUsage();
+
+        fUmMemUsage = memUsage;
     }
     else
     {
@@ -1217,6 +1303,20 @@ const string TupleAnnexStep::toString() const
 }
 
 
+int64_t TupleAnnexStep::umMemUsage() const
+{
+    return fUmMemUsage;
+}
+
+// Called by the thread using an order by, with what it holds now & held when
+// that thread last reported.
+void TupleAnnexStep::reportMemUsage(uint64_t& reported, uint64_t now)
+{
+    fUmMemUsage += (int64_t) now - (int64_t) reported;
+    reported = now;
+}
+
+
 void TupleAnnexStep::printCalTrace()
 {
     time_t t = time (0);
@@ -23,6 +23,7 @@
 #define JOBLIST_TUPLEANNEXSTEP_H
 
 #include <queue>
+#include <atomic>
 #include <boost/thread/thread.hpp>
 
 #include "jobstep.h"
@@ -57,6 +58,7 @@ public:
     void run();
     void join();
     const std::string toString() const;
+    int64_t umMemUsage() const;
 
     /** @brief TupleJobStep's pure virtual methods
      */
@@ -110,12 +112,15 @@ protected:
     void execute(uint32_t);
     void executeNoOrderBy();
     void executeWithOrderBy();
+    void deliverOrderBy(LimitedOrderBy*);
     void executeParallelOrderBy(uint64_t id);
     void executeNoOrderByWithDistinct();
     void formatMiniStats();
     void printCalTrace();
     void finalizeParallelOrderBy();
     void finalizeParallelOrderByDistinct();
+    void finalizeSpilledOrderBy();
+    void reportMemUsage(uint64_t& reported, uint64_t now);
 
     // input/output rowgroup and row
     rowgroup::RowGroup      fRowGroupIn;
@@ -171,6 +176,9 @@ protected:
     std::vector<uint64_t> fRunnersList;
     uint16_t fFinishedThreads;
     boost::mutex fParallelFinalizeMutex;
+
+    // what fOrderBy or fOrderByList hold, as the threads using them last saw it
+    std::atomic<int64_t> fUmMemUsage;
 };
 
 template <class T>
@@ -37,6 +37,7 @@ using namespace std;
 
 #include "jlf_common.h"
 #include "primitivestep.h"
+#include "batchprimitiveprocessor-jl.h"
 #include "tuplehashjoin.h"
 #include "calpontsystemcatalog.h"
 #include "elementcompression.h"
@@ -85,6 +86,7 @@ TupleHashJoinStep::TupleHashJoinStep(const JobInfo& jobInfo) :
     fTokenJoin(-1),
     fStatsMutexPtr(new boost::mutex()),
     fFunctionJoinKeys(jobInfo.keyInfo->functionJoinKeys),
+    umMemUsed(0),
     sessionMemLimit(jobInfo.umMemLimit),
     rgdLock(false)
 {
@@ -94,6 +96,7 @@ TupleHashJoinStep::TupleHashJoinStep(const JobInfo& jobInfo) :
     */
 
     pmMemLimit = resourceManager->getHjPmMaxMemorySmallSide(fSessionId);
+    pmJoinLimit = pmMemLimit;
     uniqueLimit = resourceManager->getHjCPUniqueLimit();
 
     fExtendedInfo = "THJS: ";
@@ -118,6 +121,9 @@ TupleHashJoinStep::TupleHashJoinStep(const JobInfo& jobInfo) :
     else
         allowDJS = false;
 
+    str = config->getConfig("HashJoin", "AllowShuffleJoin");
+    allowShuffle = (str == "y" || str == "Y");
+
     numCores = resourceManager->numCores();
     if (numCores <= 0)
         numCores = 8;
@@ -225,6 +231,7 @@ void TupleHashJoinStep::trackMem(uint index)
         {
             gotMem = resourceManager->getMemory(memAfter - memBefore, sessionMemLimit, false);
             atomicops::atomicAdd(&memUsedByEachJoin[index], memAfter - memBefore);
+            umMemUsed += memAfter - memBefore;
             memBefore = memAfter;
             if (!gotMem)
                 return;
@@ -239,6 +246,7 @@ void TupleHashJoinStep::trackMem(uint index)
         return;
     gotMem = resourceManager->getMemory(memAfter - memBefore, sessionMemLimit, false);
     atomicops::atomicAdd(&memUsedByEachJoin[index], memAfter - memBefore);
+    umMemUsed += memAfter - memBefore;
     if (!gotMem)
     {
         if (!joinIsTooBig && (isDML || !allowDJS || (fSessionId & 0x80000000) ||
@@ -347,7 +355,19 @@ void TupleHashJoinStep::startSmallRunners(uint index)
     {
         // add extended info, and if not aborted then tell joiner
         // we're done reading the small side.
-        if (joiner->inPM())
+        // it doesn't fit on one PM, so each PM gets a partition of it
+        if (joiner->inPM() && memUsedByEachJoin[index] > pmMemLimit && !cancelled())
+            partitionOnPMs(index);
+
+        if (joiner->inPM() && joiner->partitionedOnPM())
+        {
+            oss << "PM shuffle join (" << index << ")" << endl;
+            #ifdef JLF_DEBUG
+            cout << oss.str();
+            #endif
+            extendedInfo += oss.str();
+        }
+        else if (joiner->inPM())
         {
             oss << "PM join (" << index << ")" << endl;
             #ifdef JLF_DEBUG
@@ -372,6 +392,30 @@ void TupleHashJoinStep::startSmallRunners(uint index)
     formatMiniStats(index);
 }
 
+/* Splits the small side of join index across the PMs for a shuffle join.  A
+ * skewed key can put most of it in one partition, so if any partition would
+ * be over one PM's limit it's a UM join instead. */
+void TupleHashJoinStep::partitionOnPMs(uint32_t index)
+{
+    boost::shared_ptr<TupleJoiner> joiner = joiners[index];
+    vector<vector<uint32_t> > parts;
+    size_t rowCount = joiner->getSmallSide()->size(), maxPart = 0;
+
+    BatchPrimitiveProcessorJL::partitionSmallSide(*joiner, largeBPS->pmCount(), &parts);
+
+    for (uint32_t i = 0; i < parts.size(); i++)
+        maxPart = max(maxPart, parts[i].size());
+
+    // the rows of a partition are charged at the average row size of the small side
+    if ((double) memUsedByEachJoin[index] * maxPart / rowCount > pmMemLimit)
+    {
+        joiner->setInUM(rgData[index]);
+        return;
+    }
+
+    joiner->setPartitionedOnPM(parts);
+}
+
 /* Index is which small input to read. */
 void TupleHashJoinStep::smallRunnerFcn(uint32_t index, uint threadID, uint64_t *jobs)
 {
@@ -408,6 +452,7 @@ void TupleHashJoinStep::smallRunnerFcn(uint32_t index, uint threadID, uint64_t *
 
             rgSize = smallRG.getSizeWithStrings();
             atomicops::atomicAdd(&memUsedByEachJoin[index], rgSize);
+            umMemUsed += rgSize;
             gotMem = resourceManager->getMemory(rgSize, sessionMemLimit, false);
             if (!gotMem)
             {
@@ -436,7 +481,7 @@ void TupleHashJoinStep::smallRunnerFcn(uint32_t index, uint threadID, uint64_t *
 
             joiner->insertRGData(smallRG, threadID);
 
-            if (!joiner->inUM() && (memUsedByEachJoin[index] > pmMemLimit))
+            if (!joiner->inUM() && (memUsedByEachJoin[index] > pmJoinLimit))
             {
                 joiner->setInUM(rgData[index]);
                 for (int i = 1; i < numCores; i++)
@@ -679,6 +724,16 @@ void TupleHashJoinStep::hjRunner()
             }
         }
 
+        /* A small side that's too big for one PM can still be joined on the PMs
+         * if it fits in all of them, each one holding the rows of a range of key
+         * hashes, and the large side rows going to the PM that has their key.
+         * Supported for a single join whose PM-side matching doesn't depend on
+         * the whole small side. */
+        if (allowShuffle && largeBPS && isExeMgr && !isDML && smallDLs.size() == 1 &&
+                !(joinTypes[0] & (SMALLOUTER | MATCHNULLS)) && fe.empty() &&
+                largeBPS->pmCount() > 1)
+            pmJoinLimit = pmMemLimit * largeBPS->pmCount();
+
         smallRunners.clear();
         smallRunners.reserve(smallDLs.size());
 
@@ -747,6 +802,7 @@ void TupleHashJoinStep::hjRunner()
             {
                 vector<RGData> empty;
                 resourceManager->returnMemory(memUsedByEachJoin[djsJoinerMap[i]], sessionMemLimit);
+                umMemUsed -= memUsedByEachJoin[djsJoinerMap[i]];
                 memUsedByEachJoin[djsJoinerMap[i]] = 0;
                 djs[i].loadExistingData(rgData[djsJoinerMap[i]]);
                 rgData[djsJoinerMap[i]].swap(empty);
@@ -847,6 +903,7 @@ void TupleHashJoinStep::hjRunner()
                 for (uint i = 0; i < smallDLs.size(); i++)
                 {
                     resourceManager->returnMemory(memUsedByEachJoin[i], sessionMemLimit);
+                    umMemUsed -= memUsedByEachJoin[i];
                     memUsedByEachJoin[i] = 0;
                 }
             }
@@ -1027,6 +1084,7 @@ uint32_t TupleHashJoinStep::nextBand(messageqcpp::ByteStream& bs)
             for (uint i = 0; i < smallDLs.size(); i++)
             {
                 resourceManager->returnMemory(memUsedByEachJoin[i], sessionMemLimit);
+                umMemUsed -= memUsedByEachJoin[i];
                 memUsedByEachJoin[i] = 0;
             }
             return 0;
@@ -1051,6 +1109,7 @@ uint32_t TupleHashJoinStep::nextBand(messageqcpp::ByteStream& bs)
             for (uint i = 0; i < smallDLs.size(); i++)
             {
                 resourceManager->returnMemory(memUsedByEachJoin[i], sessionMemLimit);
+                umMemUsed -= memUsedByEachJoin[i];
                 memUsedByEachJoin[i] = 0;
             }
             return 0;
@@ -1119,6 +1178,12 @@ const string TupleHashJoinStep::toString() const
     return oss.str();
 }
 
+
+int64_t TupleHashJoinStep::umMemUsage() const
+{
+    return umMemUsed;
+}
+
 //------------------------------------------------------------------------------
 // Log specified error to stderr and the critical log
 //------------------------------------------------------------------------------
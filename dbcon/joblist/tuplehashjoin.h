@@ -32,6 +32,7 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <atomic>
 
 namespace joblist
 {
@@ -58,6 +59,7 @@ public:
     void run();
     void join();
     const std::string toString() const;
+    int64_t umMemUsage() const;
 
     /* These tableOID accessors can go away soon */
     execplan::CalpontSystemCatalog::OID tableOid() const
@@ -442,9 +444,12 @@ private:
     rowgroup::RowGroup largeRG, outputRG;
     std::vector<rowgroup::RowGroup> smallRGs;
     ssize_t pmMemLimit;
+    // small sides up to this size stay on the PMs, > pmMemLimit for a shuffle join
+    ssize_t pmJoinLimit;
 
     void hjRunner();
     void smallRunnerFcn(uint32_t index, uint threadID, uint64_t *threads);
+    void partitionOnPMs(uint32_t index);
 
     struct HJRunner
     {
@@ -599,6 +604,7 @@ private:
     uint64_t djsPartitionSize;
     bool isDML;
     bool allowDJS;
+    bool allowShuffle;
 
     // hacky mechanism to prevent nextBand from starting before the final
     // THJS configuration is settled.  Debatable whether to use a bool and poll instead;
@@ -612,6 +618,7 @@ private:
     std::vector<boost::shared_ptr<joiner::TupleJoiner> > djsJoiners;
     std::vector<int> djsJoinerMap;
     boost::scoped_array<ssize_t> memUsedByEachJoin;
+    std::atomic<int64_t> umMemUsed;     // the sum of memUsedByEachJoin, for umMemUsage()
     boost::mutex djsLock;
     boost::shared_ptr<int64_t> sessionMemLimit;
 
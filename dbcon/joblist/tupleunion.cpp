@@ -22,6 +22,10 @@
  ****************************************************************************/
 
 #include <string>
+#include <fstream>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/uuid/uuid_io.hpp>
@@ -29,8 +33,11 @@
 #include "querytele.h"
 using namespace querytele;
 
+#include "configcpp.h"
 #include "dataconvert.h"
+#include "exceptclasses.h"
 #include "hasher.h"
+#include "installdir.h"
 #include "jlf_common.h"
 #include "resourcemanager.h"
 #include "tupleunion.h"
@@ -41,6 +48,7 @@ using namespace boost;
 using namespace execplan;
 using namespace rowgroup;
 using namespace dataconvert;
+using namespace messageqcpp;
 
 #ifndef __linux__
 #ifndef M_LN10
@@ -60,30 +68,21 @@ namespace joblist
 {
 inline uint64_t TupleUnion::Hasher::operator()(const RowPosition& p) const
 {
-    Row& row = ts->row;
-
+    // the hashes of the rows being inserted were already computed to pick the partition
     if (p.group & RowPosition::normalizedFlag)
-        ts->normalizedData[p.group & ~RowPosition::normalizedFlag].getRow(p.row, &row);
-    else
-        ts->rowMemory[p.group].getRow(p.row, &row);
+        return part->probeHashes[p.row];
 
+    Row& row = part->row;
+    part->rowMemory[p.group].getRow(p.row, &row);
     return row.hash();
 }
 
 inline bool TupleUnion::Eq::operator()(const RowPosition& d1, const RowPosition& d2) const
 {
-    Row& r1 = ts->row, &r2 = ts->row2;
-
-    if (d1.group & RowPosition::normalizedFlag)
-        ts->normalizedData[d1.group & ~RowPosition::normalizedFlag].getRow(d1.row, &r1);
-    else
-        ts->rowMemory[d1.group].getRow(d1.row, &r1);
-
-    if (d2.group & RowPosition::normalizedFlag)
-        ts->normalizedData[d2.group & ~RowPosition::normalizedFlag].getRow(d2.row, &r2);
-    else
-        ts->rowMemory[d2.group].getRow(d2.row, &r2);
+    Row& r1 = part->row, &r2 = part->row2;
 
+    part->getRow(d1, &r1);
+    part->getRow(d2, &r2);
     return r1.equals(r2);
 }
 
@@ -103,13 +102,32 @@ TupleUnion::TupleUnion(CalpontSystemCatalog::OID tableOID, const JobInfo& jobInf
     sessionMemLimit(jobInfo.umMemLimit),
     fTimeZone(jobInfo.timeZone)
 {
-    uniquer.reset(new Uniquer_t(10, Hasher(this), Eq(this), allocator));
     fExtendedInfo = "TUN: ";
     fQtc.stepParms().stepType = StepTeleStats::T_TUN;
+
+    // enough partitions to keep the input threads apart, and to keep the amount of
+    // data that has to be spilled at a time reasonably small
+    partitionCount = rm->numCores() * 2;
+
+    if (partitionCount < 8)
+        partitionCount = 8;
+    else if (partitionCount > 64)
+        partitionCount = 64;
+
+    partitions.reset(new Partition[partitionCount]);
+
+    config::Config* config = config::Config::makeConfig();
+    string str = config->getConfig("JobList", "AllowDiskBasedUnion");
+    allowDiskUnion = !(str == "n" || str == "N");
+    str = config->getConfig("HashJoin", "TempFileCompression");
+    useCompression = !(str == "n" || str == "N");
 }
 
 TupleUnion::~TupleUnion()
 {
+    for (uint32_t i = 0; i < partitionCount; i++)
+        releasePartition(partitions[i]);
+
     rm->returnMemory(memUsage, sessionMemLimit);
 
     if (!runRan && output)
@@ -141,10 +159,11 @@ void TupleUnion::readInput(uint32_t which)
 {
     /* The handling of the output got a little kludgey with the string table enhancement.
      * When there is no distinct check, the outputs are all generated independently of
-     * each other locally in this fcn.  When there is a distinct check, threads
-     * share the output, which is built in the 'rowMemory' vector rather than in
-     * thread-local memory.  Building the result in a common space allows us to
-     * store 8-byte offsets in rowMemory rather than 16-bytes for absolute pointers.
+     * each other locally in this fcn.  When there is a distinct check, each row is
+     * routed to a partition by its hash, and the partition builds the result in
+     * its 'rowMemory' vector rather than in thread-local memory.  Building the result
+     * in a common space allows us to store 8-byte offsets in rowMemory rather than
+     * 16-bytes for absolute pointers.
      */
 
     RowGroupDL* dl = NULL;
@@ -154,7 +173,8 @@ void TupleUnion::readInput(uint32_t which)
     RowGroup l_inputRG, l_outputRG, l_tmpRG;
     Row inRow, outRow, tmpRow;
     bool distinct;
-    uint64_t memUsageBefore, memUsageAfter, memDiff;
+    vector<uint64_t> hashes;
+    vector<vector<uint32_t> > partRows;
     StepTeleStats sts;
     sts.query_uuid = fQueryUuid;
     sts.step_uuid = fStepUuid;
@@ -174,6 +194,8 @@ void TupleUnion::readInput(uint32_t which)
         l_tmpRG.setData(tmpRGData);
         l_tmpRG.resetRowGroup(0);
         l_tmpRG.getRow(0, &tmpRow);
+        hashes.resize(8192);
+        partRows.resize(partitionCount);
     }
     else
     {
@@ -214,52 +236,40 @@ void TupleUnion::readInput(uint32_t which)
 
             if (distinct)
             {
-                memDiff = 0;
                 l_tmpRG.resetRowGroup(0);
                 l_tmpRG.getRow(0, &tmpRow);
                 l_tmpRG.setRowCount(l_inputRG.getRowCount());
 
                 for (uint32_t i = 0; i < l_inputRG.getRowCount(); i++, inRow.nextRow(),
                         tmpRow.nextRow())
+                {
                     normalize(inRow, &tmpRow);
+                    hashes[i] = tmpRow.hash();
+                    partRows[hashes[i] % partitionCount].push_back(i);
+                }
 
-                l_tmpRG.getRow(0, &tmpRow);
+                for (uint32_t i = 0; i < partitionCount; i++)
                 {
-                    boost::mutex::scoped_lock lk(uniquerMutex);
-                    getOutput(&l_outputRG, &outRow, &outRGData);
-                    memUsageBefore = allocator.getMemUsage();
+                    if (partRows[i].empty())
+                        continue;
 
-                    for (uint32_t i = 0; i < l_tmpRG.getRowCount(); i++, tmpRow.nextRow())
+                    if (!insertIntoPartition(partitions[i], *tmpRGData, hashes, partRows[i],
+                                             allowDiskUnion))
                     {
-                        pair<Uniquer_t::iterator, bool> inserted;
-                        inserted = uniquer->insert(RowPosition(which | RowPosition::normalizedFlag, i));
+                        fLogger->logMessage(logging::LOG_TYPE_INFO, logging::ERR_UNION_TOO_BIG);
 
-                        if (inserted.second)
+                        if (status() == 0) // preserve existing error code
                         {
-                            copyRow(tmpRow, &outRow);
-                            const_cast<RowPosition&>(*(inserted.first)) = RowPosition(rowMemory.size() - 1, l_outputRG.getRowCount());
-                            memDiff += outRow.getRealSize();
-                            addToOutput(&outRow, &l_outputRG, true, outRGData);
+                            errorMessage(logging::IDBErrorInfo::instance()->errorMsg(
+                                             logging::ERR_UNION_TOO_BIG));
+                            status(logging::ERR_UNION_TOO_BIG);
                         }
-                    }
-
-                    memUsageAfter = allocator.getMemUsage();
-                    memDiff += (memUsageAfter - memUsageBefore);
-                    memUsage += memDiff;
-                }
 
-                if (!rm->getMemory(memDiff, sessionMemLimit))
-                {
-                    fLogger->logMessage(logging::LOG_TYPE_INFO, logging::ERR_UNION_TOO_BIG);
-
-                    if (status() == 0) // preserve existing error code
-                    {
-                        errorMessage(logging::IDBErrorInfo::instance()->errorMsg(
-                                         logging::ERR_UNION_TOO_BIG));
-                        status(logging::ERR_UNION_TOO_BIG);
+                        abort();
+                        break;
                     }
 
-                    abort();
+                    partRows[i].clear();
                 }
             }
             else
@@ -267,7 +277,7 @@ void TupleUnion::readInput(uint32_t which)
                 for (uint32_t i = 0; i < l_inputRG.getRowCount(); i++, inRow.nextRow())
                 {
                     normalize(inRow, &outRow);
-                    addToOutput(&outRow, &l_outputRG, false, outRGData);
+                    addToOutput(&outRow, &l_outputRG, NULL, outRGData);
                 }
             }
 
@@ -290,20 +300,37 @@ void TupleUnion::readInput(uint32_t which)
         while (more)
             more = dl->next(it, &inRGData);
 
-    {
-        boost::mutex::scoped_lock lock1(uniquerMutex);
-        boost::mutex::scoped_lock lock2(sMutex);
+    bool lastDistinct = false;
 
-        if (!distinct && l_outputRG.getRowCount() > 0)
-            output->insert(outRGData);
+    if (distinct)
+    {
+        boost::mutex::scoped_lock lock(sMutex);
+        lastDistinct = (++distinctDone == distinctCount);
+    }
 
-        if (distinct)
+    // the last distinct input to finish drains the partitions, including the spilled ones
+    if (lastDistinct)
+    {
+        try
         {
-            getOutput(&l_outputRG, &outRow, &outRGData);
-
-            if (++distinctDone == distinctCount && l_outputRG.getRowCount() > 0)
-                output->insert(outRGData);
+            finishDistinct();
+        }
+        catch (...)
+        {
+            handleException(std::current_exception(),
+                            logging::unionStepErr,
+                            logging::ERR_UNION_TOO_BIG,
+                            "TupleUnion::finishDistinct()");
+            status(logging::unionStepErr);
+            abort();
         }
+    }
+
+    {
+        boost::mutex::scoped_lock lock(sMutex);
+
+        if (!distinct && l_outputRG.getRowCount() > 0)
+            output->insert(outRGData);
 
         if (++runnersDone == fInputJobStepAssociation.outSize())
         {
@@ -364,47 +391,335 @@ uint32_t TupleUnion::nextBand(messageqcpp::ByteStream& bs)
     return ret;
 }
 
-void TupleUnion::getOutput(RowGroup* rg, Row* row, RGData* data)
+void TupleUnion::addToOutput(Row* r, RowGroup* rg, vector<RGData>* keep,
+                             RGData& data)
 {
-    if (UNLIKELY(rowMemory.empty()))
+    r->nextRow();
+    rg->incRowCount();
+    atomicops::atomicInc(&fRowsReturned);
+
+    if (rg->getRowCount() == 8192)
     {
-        *data = RGData(*rg);
-        rg->setData(data);
+        {
+            boost::mutex::scoped_lock lock(sMutex);
+            output->insert(data);
+        }
+        data = RGData(*rg);
+        rg->setData(&data);
         rg->resetRowGroup(0);
-        rowMemory.push_back(*data);
+        rg->getRow(0, r);
+
+        if (keep)
+            keep->push_back(data);
+    }
+}
+
+void TupleUnion::initPartitionOutput(Partition& part)
+{
+    part.outRG = outputRG;
+    part.outData = RGData(outputRG);
+    part.outRG.setData(&part.outData);
+    part.outRG.resetRowGroup(0);
+    part.outRG.initRow(&part.outRow);
+    part.outRG.getRow(0, &part.outRow);
+    part.rowMemory.push_back(part.outData);
+}
+
+bool TupleUnion::insertIntoPartition(Partition& part, RGData& data,
+                                     const vector<uint64_t>& hashes, const vector<uint32_t>& rows, bool canSpill)
+{
+    uint64_t memBefore, memDiff = 0;
+    boost::mutex::scoped_lock lk(part.mutex);
+
+    if (part.spilled)
+    {
+        spillRows(part, data, rows);
+        return true;
+    }
+
+    // a partition's output buffer is only made once something hashes to it
+    if (part.rowMemory.empty())
+    {
+        initPartitionOutput(part);
+        memDiff += part.outRG.getMaxDataSize();
+    }
+
+    part.probeData = &data;
+    part.probeHashes = &hashes[0];
+    memBefore = part.allocator.getMemUsage();
+
+    for (uint32_t i = 0; i < rows.size(); i++)
+    {
+        pair<Uniquer_t::iterator, bool> inserted;
+        inserted = part.uniquer->insert(RowPosition(RowPosition::normalizedFlag, rows[i]));
+
+        if (inserted.second)
+        {
+            data.getRow(rows[i], &part.row);
+            copyRow(part.row, &part.outRow);
+            const_cast<RowPosition&>(*(inserted.first)) =
+                RowPosition(part.rowMemory.size() - 1, part.outRG.getRowCount());
+            memDiff += part.outRow.getRealSize();
+            addToOutput(&part.outRow, &part.outRG, &part.rowMemory, part.outData);
+        }
+    }
+
+    part.probeData = NULL;
+    part.probeHashes = NULL;
+    memDiff += part.allocator.getMemUsage() - memBefore;
+
+    // don't wait on other queries if this partition can go to disk instead
+    if (rm->getMemory(memDiff, sessionMemLimit, !canSpill))
+    {
+        part.memUsage += memDiff;
+        atomicops::atomicAdd(&memUsage, memDiff);
+        return true;
+    }
+
+    if (!canSpill)
+        return false;
+
+    // the rows added above stay resident until the partition is released
+    rm->chargeMemory(memDiff, sessionMemLimit);
+    part.memUsage += memDiff;
+    atomicops::atomicAdd(&memUsage, memDiff);
+
+    ostringstream os;
+    os << startup::StartUp::tmpDir() << "/Columnstore-union-data-" << uuids::to_string(fStepUuid)
+       << "-" << (&part - &partitions[0]);
+    part.spilled = true;
+    part.spillFilename = os.str();
+    fstream fs(part.spillFilename.c_str(), ios::binary | ios::out | ios::trunc);
+    part.spillRG = outputRG;
+    part.spillData.reinit(outputRG);
+    part.spillRG.setData(&part.spillData);
+    part.spillRG.resetRowGroup(0);
+    part.spillRG.initRow(&part.spillRow);
+    part.spillRG.getRow(0, &part.spillRow);
+    return true;
+}
+
+void TupleUnion::spillRows(Partition& part, RGData& data, const vector<uint32_t>& rows)
+{
+    for (uint32_t i = 0; i < rows.size(); i++)
+    {
+        data.getRow(rows[i], &part.row);
+        copyRow(part.row, &part.spillRow);
+        part.spillRow.nextRow();
+        part.spillRG.incRowCount();
+
+        if (part.spillRG.getRowCount() == 8192)
+            flushSpill(part);
+    }
+}
+
+void TupleUnion::flushSpill(Partition& part)
+{
+    ByteStream bs;
+
+    if (part.spillRG.getRowCount() == 0)
+        return;
+
+    part.spillRG.serializeRGData(bs);
+    writeSpill(part, bs);
+    part.spillRG.resetRowGroup(0);
+    part.spillRG.getRow(0, &part.spillRow);
+}
+
+void TupleUnion::writeSpill(Partition& part, ByteStream& bs)
+{
+    fstream fs;
+    size_t len = bs.length();
+    int saveErrno;
+
+    fs.open(part.spillFilename.c_str(), ios::binary | ios::out | ios::app);
+    saveErrno = errno;
+
+    if (!fs)
+    {
+        ostringstream os;
+        os << "Disk-based union could not open file (write access) " << part.spillFilename
+           << ": " << strerror(saveErrno) << endl;
+        throw logging::IDBExcept(os.str().c_str(), logging::ERR_DBJ_FILE_IO_ERROR);
+    }
+
+    if (!useCompression)
+    {
+        fs.write((char*) &len, sizeof(len));
+        fs.write((char*) bs.buf(), len);
     }
     else
     {
-        *data = rowMemory.back();
-        rg->setData(data);
+        size_t actualSize;
+        boost::scoped_array<char> compressed(new char[compressor.maxCompressedSize(len)]);
+
+        compressor.compress((char*) bs.buf(), len, compressed.get(), &actualSize);
+        fs.write((char*) &actualSize, sizeof(actualSize));
+        fs.write(compressed.get(), actualSize);
     }
 
-    rg->getRow(rg->getRowCount(), row);
+    saveErrno = errno;
+
+    if (!fs)
+    {
+        ostringstream os;
+        os << "Disk-based union could not write file " << part.spillFilename << ": "
+           << strerror(saveErrno) << endl;
+        throw logging::IDBExcept(os.str().c_str(), logging::ERR_DBJ_FILE_IO_ERROR);
+    }
 }
 
-void TupleUnion::addToOutput(Row* r, RowGroup* rg, bool keepit,
-                             RGData& data)
+bool TupleUnion::readSpill(Partition& part, ByteStream& bs)
 {
-    r->nextRow();
-    rg->incRowCount();
-    fRowsReturned++;
+    ifstream& fs = *part.spillIn;
+    size_t len;
+    int saveErrno;
 
-    if (rg->getRowCount() == 8192)
+    bs.restart();
+    fs.read((char*) &len, sizeof(len));
+
+    if (fs.eof())
+        return false;
+
+    if (!useCompression)
+    {
+        bs.needAtLeast(len);
+        fs.read((char*) bs.getInputPtr(), len);
+        bs.advanceInputPtr(len);
+    }
+    else
+    {
+        size_t uncompressedSize;
+        boost::scoped_array<char> buf(new char[len]);
+
+        fs.read(buf.get(), len);
+        compressor.getUncompressedSize(buf.get(), len, &uncompressedSize);
+        bs.needAtLeast(uncompressedSize);
+        compressor.uncompress(buf.get(), len, (char*) bs.getInputPtr());
+        bs.advanceInputPtr(uncompressedSize);
+    }
+
+    saveErrno = errno;
+
+    if (!fs)
+    {
+        ostringstream os;
+        os << "Disk-based union could not read file " << part.spillFilename << ": "
+           << strerror(saveErrno) << endl;
+        throw logging::IDBExcept(os.str().c_str(), logging::ERR_DBJ_FILE_IO_ERROR);
+    }
+
+    return true;
+}
+
+void TupleUnion::dedupSpilled(Partition& part)
+{
+    ByteStream bs;
+    RGData data;
+    RowGroup l_rg = outputRG;
+    Row r;
+    vector<uint64_t> hashes;
+    vector<uint32_t> rows;
+    uint32_t i;
+    int saveErrno;
+
+    flushSpill(part);
+    part.spilled = false;
+    l_rg.initRow(&r);
+
+    part.spillIn.reset(new ifstream(part.spillFilename.c_str(), ios::binary | ios::in));
+    saveErrno = errno;
+
+    if (!*part.spillIn)
+    {
+        ostringstream os;
+        os << "Disk-based union could not open file (read access) " << part.spillFilename
+           << ": " << strerror(saveErrno) << endl;
+        throw logging::IDBExcept(os.str().c_str(), logging::ERR_DBJ_FILE_IO_ERROR);
+    }
+
+    // The partition's memory has to fit now that the others have been released.
+    while (!cancelled() && readSpill(part, bs))
+    {
+        data.deserialize(bs);
+        l_rg.setData(&data);
+        l_rg.getRow(0, &r);
+        hashes.resize(l_rg.getRowCount());
+        rows.resize(l_rg.getRowCount());
+
+        for (i = 0; i < l_rg.getRowCount(); i++, r.nextRow())
+        {
+            hashes[i] = r.hash();
+            rows[i] = i;
+        }
+
+        if (!insertIntoPartition(part, data, hashes, rows, false))
+            throw logging::IDBExcept(logging::ERR_UNION_TOO_BIG);
+    }
+}
+
+void TupleUnion::finishDistinct()
+{
+    uint32_t i;
+
+    /* Deliver what's in memory, and give back the memory of the partitions that
+     * didn't spill.  That's what makes room for the spilled ones. */
+    for (i = 0; i < partitionCount; i++)
     {
+        Partition& part = partitions[i];
+
+        if (part.spilled)
+            continue;
+
+        if (!part.rowMemory.empty() && part.outRG.getRowCount() > 0)
         {
             boost::mutex::scoped_lock lock(sMutex);
-            output->insert(data);
+            output->insert(part.outData);
+        }
+
+        releasePartition(part);
+    }
+
+    for (i = 0; i < partitionCount && !cancelled(); i++)
+    {
+        Partition& part = partitions[i];
+
+        if (!part.spilled)
+            continue;
+
+        dedupSpilled(part);
+
+        if (!part.rowMemory.empty() && part.outRG.getRowCount() > 0)
+        {
+            boost::mutex::scoped_lock lock(sMutex);
+            output->insert(part.outData);
         }
-        data = RGData(*rg);
-        rg->setData(&data);
-        rg->resetRowGroup(0);
-        rg->getRow(0, r);
 
-        if (keepit)
-            rowMemory.push_back(data);
+        releasePartition(part);
     }
 }
 
+void TupleUnion::releasePartition(Partition& part)
+{
+    part.uniquer.reset();
+    part.allocator = utils::STLPoolAllocator<RowPosition>();
+    part.rowMemory.clear();
+    part.outData = RGData();
+    part.spillData = RGData();
+    part.spilled = false;
+    part.spillIn.reset();
+
+    if (!part.spillFilename.empty())
+    {
+        unlink(part.spillFilename.c_str());
+        part.spillFilename.clear();
+    }
+
+    rm->returnMemory(part.memUsage, sessionMemLimit);
+    atomicops::atomicSub(&memUsage, part.memUsage);
+    part.memUsage = 0;
+}
+
 void TupleUnion::normalize(const Row& in, Row* out)
 {
     uint32_t i;
@@ -1250,9 +1565,6 @@ void TupleUnion::run()
         outputIt = output->getIterator();
     }
 
-    outputRG.initRow(&row);
-    outputRG.initRow(&row2);
-
     distinctCount = 0;
     normalizedData.reset(new RGData[inputs.size()]);
 
@@ -1265,6 +1577,18 @@ void TupleUnion::run()
         }
     }
 
+    if (distinctCount > 0)
+    {
+        for (i = 0; i < partitionCount; i++)
+        {
+            Partition& part = partitions[i];
+
+            part.uniquer.reset(new Uniquer_t(10, Hasher(&part), Eq(&part), part.allocator));
+            outputRG.initRow(&part.row);
+            outputRG.initRow(&part.row2);
+        }
+    }
+
     runners.reserve(inputs.size());
 
     for (i = 0; i < inputs.size(); i++)
@@ -1285,10 +1609,9 @@ void TupleUnion::join()
 
     jobstepThreadPool.join(runners);
     runners.clear();
-    uniquer->clear();
-    rowMemory.clear();
-    rm->returnMemory(memUsage, sessionMemLimit);
-    memUsage = 0;
+
+    for (uint32_t i = 0; i < partitionCount; i++)
+        releasePartition(partitions[i]);
 }
 
 const string TupleUnion::toString() const
@@ -1312,6 +1635,12 @@ const string TupleUnion::toString() const
 
 }
 
+
+int64_t TupleUnion::umMemUsage() const
+{
+    return memUsage;
+}
+
 void TupleUnion::writeNull(Row* out, uint32_t col)
 {
     switch (out->getColTypes()[col])
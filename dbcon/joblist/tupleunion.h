@@ -27,6 +27,8 @@
 //
 //
 
+#include <fstream>
+
 #include "jobstep.h"
 #ifndef _MSC_VER
 #include <tr1/unordered_set>
@@ -36,6 +38,7 @@
 
 #include "stlpoolallocator.h"
 #include "threadnaming.h"
+#include "idbcompress.h"
 
 #ifndef TUPLEUNION2_H_
 #define TUPLEUNION2_H_
@@ -55,6 +58,7 @@ public:
     void join();
 
     const std::string toString() const;
+    int64_t umMemUsage() const;
     execplan::CalpontSystemCatalog::OID tableOid() const;
 
     void setInputRowGroups(const std::vector<rowgroup::RowGroup>&);
@@ -127,14 +131,31 @@ private:
         static const uint64_t normalizedFlag = 0x800000000000ULL;   // 48th bit is set
     };
 
-    void getOutput(rowgroup::RowGroup* rg, rowgroup::Row* row, rowgroup::RGData* data);
-    void addToOutput(rowgroup::Row* r, rowgroup::RowGroup* rg, bool keepit,
-                     rowgroup::RGData& data);
+    void addToOutput(rowgroup::Row* r, rowgroup::RowGroup* rg,
+                     std::vector<rowgroup::RGData>* keep, rowgroup::RGData& data);
     void normalize(const rowgroup::Row& in, rowgroup::Row* out);
     void writeNull(rowgroup::Row* out, uint32_t col);
     void readInput(uint32_t);
     void formatMiniStats();
 
+    /* UNION DISTINCT is deduplicated in independent hash partitions.  Duplicates always
+     * hash to the same partition, so each partition can be locked & processed separately,
+     * and the input threads only contend when they're working on the same one.  If a
+     * partition can't get more memory, it's marked as spilled and the rest of its input
+     * is written to a temp file.  Once all inputs are done, the resident partitions are
+     * released, and the spilled partitions are deduplicated one at a time. */
+    struct Partition;
+    void initPartitionOutput(Partition&);
+    bool insertIntoPartition(Partition&, rowgroup::RGData&, const std::vector<uint64_t>& hashes,
+                             const std::vector<uint32_t>& rows, bool canSpill);
+    void spillRows(Partition&, rowgroup::RGData&, const std::vector<uint32_t>& rows);
+    void flushSpill(Partition&);
+    void writeSpill(Partition&, messageqcpp::ByteStream&);
+    bool readSpill(Partition&, messageqcpp::ByteStream&);
+    void dedupSpilled(Partition&);
+    void finishDistinct();
+    void releasePartition(Partition&);
+
     execplan::CalpontSystemCatalog::OID fTableOID;
     // @bug 598 for self-join
     std::string fAlias1;
@@ -164,37 +185,70 @@ private:
 
     struct Hasher
     {
-        TupleUnion* ts;
-        utils::Hasher_r h;
-        Hasher(TupleUnion* t) : ts(t) { }
+        Partition* part;
+        Hasher(Partition* p) : part(p) { }
         uint64_t operator()(const RowPosition&) const;
     };
     struct Eq
     {
-        TupleUnion* ts;
-        Eq(TupleUnion* t) : ts(t) { }
+        Partition* part;
+        Eq(Partition* p) : part(p) { }
         bool operator()(const RowPosition&, const RowPosition&) const;
     };
 
     typedef std::tr1::unordered_set<RowPosition, Hasher, Eq,
             utils::STLPoolAllocator<RowPosition> > Uniquer_t;
 
-    boost::scoped_ptr<Uniquer_t> uniquer;
-    std::vector<rowgroup::RGData> rowMemory;
-    boost::mutex sMutex, uniquerMutex;
+    struct Partition
+    {
+        Partition() : probeData(NULL), probeHashes(NULL), memUsage(0), spilled(false) { }
+
+        // RowPosition::normalizedFlag refers to a row in probeData, otherwise to rowMemory
+        inline void getRow(const RowPosition& p, rowgroup::Row* r)
+        {
+            if (p.group & RowPosition::normalizedFlag)
+                probeData->getRow(p.row, r);
+            else
+                rowMemory[p.group].getRow(p.row, r);
+        }
+
+        boost::mutex mutex;
+        boost::scoped_ptr<Uniquer_t> uniquer;
+        utils::STLPoolAllocator<RowPosition> allocator;
+        std::vector<rowgroup::RGData> rowMemory;
+        rowgroup::RowGroup outRG;
+        rowgroup::RGData outData;
+        rowgroup::Row outRow;
+        rowgroup::Row row, row2;    // scratch rows for Hasher & Eq
+        rowgroup::RGData* probeData;
+        const uint64_t* probeHashes;
+        uint64_t memUsage;
+
+        bool spilled;
+        std::string spillFilename;
+        rowgroup::RowGroup spillRG;
+        rowgroup::RGData spillData;
+        rowgroup::Row spillRow;
+        boost::scoped_ptr<std::ifstream> spillIn;   // open while the spill is read back
+    };
+
+    boost::scoped_array<Partition> partitions;
+    uint32_t partitionCount;
+    boost::mutex sMutex;
     uint64_t memUsage;
     uint32_t rowLength;
-    rowgroup::Row row, row2;
     std::vector<bool> distinctFlags;
     ResourceManager* rm;
-    utils::STLPoolAllocator<RowPosition> allocator;
     boost::scoped_array<rowgroup::RGData> normalizedData;
+    bool allowDiskUnion;
+    bool useCompression;
+    compress::IDBCompressInterface compressor;
 
     uint32_t runnersDone;
     uint32_t distinctCount;
     uint32_t distinctDone;
 
-    uint64_t fRowsReturned;
+    volatile uint64_t fRowsReturned;    // bumped by the input threads
 
     // temporary hack to make sure JobList only calls run, join once
     boost::mutex jlLock;
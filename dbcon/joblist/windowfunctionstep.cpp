@@ -309,6 +309,12 @@ const string WindowFunctionStep::toString() const
     return oss.str();
 }
 
+
+int64_t WindowFunctionStep::umMemUsage() const
+{
+    return fMemUsage;
+}
+
 void WindowFunctionStep::AddSimplColumn(const vector<SimpleColumn*>& scs,
                                      JobInfo& jobInfo)
 {
@@ -1592,35 +1598,12 @@ void WindowFunctionStep::updateWindowCols(ParseTree* pt,
 
 void WindowFunctionStep::sort(std::vector<RowPosition>::iterator v, uint64_t n)
 {
-    // recursive function termination condition.
     if (n < 2 || cancelled())
         return;
 
-    RowPosition                   p = *(v + n / 2); // pivot value
-    vector<RowPosition>::iterator l = v;            // low   address
-    vector<RowPosition>::iterator h = v + (n - 1);  // high  address
-
-    while (l <= h && !cancelled())
-    {
-        // Can use while here, but need check boundary and cancel status.
-        if (fQueryOrderBy->operator()(getPointer(*l), getPointer(p)))
-        {
-            l++;
-        }
-        else if (fQueryOrderBy->operator()(getPointer(p), getPointer(*h)))
-        {
-            h--;
-        }
-        else
-        {
-            RowPosition t = *l;    // temp value for swap
-            *l++ = *h;
-            *h-- = t;
-        }
-    }
-
-    sort(v, std::distance(v, h) + 1);
-    sort(l, std::distance(l, v) + n);
+    sortByKey<RowPosition>(v, n, *fQueryOrderBy,
+                           [this](RowPosition & p) { return getPointer(p); },
+                           [this]() { return cancelled(); });
 }
 
 
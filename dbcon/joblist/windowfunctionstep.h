@@ -90,6 +90,7 @@ public:
     void run();
     void join();
     const std::string toString() const;
+    int64_t umMemUsage() const;
     void setOutputRowGroup(const rowgroup::RowGroup&);
     const rowgroup::RowGroup& getOutputRowGroup() const;
     const rowgroup::RowGroup& getDeliveredRowGroup() const;
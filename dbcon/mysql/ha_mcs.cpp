@@ -1986,6 +1986,21 @@ maria_declare_plugin(columnstore)
     NULL,
     MCSVERSION,
     COLUMNSTORE_MATURITY
+},
+{
+    MYSQL_INFORMATION_SCHEMA_PLUGIN,
+    &is_columnstore_plugin_version,
+    "COLUMNSTORE_MEMORY_USAGE",
+    "MariaDB Corporation",
+    "An information schema plugin to list ColumnStore UM memory usage per query step",
+    PLUGIN_LICENSE_GPL,
+    is_columnstore_memory_usage_plugin_init,
+    NULL,
+    MCSVERSIONHEX,
+    NULL,
+    NULL,
+    MCSVERSION,
+    COLUMNSTORE_MATURITY
 }
 maria_declare_plugin_end;
 
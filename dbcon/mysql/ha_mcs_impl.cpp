@@ -309,6 +309,182 @@ bool onlyOneTableinTM(cal_impl_if::cal_connection_info* ci)
 }
 
 
+namespace
+{
+// Converters for fetchNextRow(). The integer ones are specialized on the
+// storage type so the hot loop avoids Row::isNullValue()'s type switch and
+// the TypeHandler/StoreField virtual calls; everything else goes through
+// the TypeHandler.
+bool isNullGeneric(const cal_field_converter& conv, const rowgroup::Row& row)
+{
+    return row.isNullValue(conv.rgPos);
+}
+
+int storeGeneric(const cal_field_converter& conv, const rowgroup::Row& row, Field* f)
+{
+    datatypes::StoreFieldMariaDB mf(f, *conv.colType);
+    return conv.handler->storeValueToField(const_cast<rowgroup::Row&>(row), conv.rgPos, &mf);
+}
+
+template<typename T, uint64_t NULLVAL>
+bool isNullInt(const cal_field_converter& conv, const rowgroup::Row& row)
+{
+    return static_cast<T>(row.getUintField<sizeof(T)>(conv.rgPos)) == static_cast<T>(NULLVAL);
+}
+
+template<int len>
+int storeSInt(const cal_field_converter& conv, const rowgroup::Row& row, Field* f)
+{
+    return f->store(row.getIntField<len>(conv.rgPos), static_cast<Field_num*>(f)->unsigned_flag);
+}
+
+template<int len>
+int storeUInt(const cal_field_converter& conv, const rowgroup::Row& row, Field* f)
+{
+    return f->store(static_cast<int64_t>(row.getUintField<len>(conv.rgPos)),
+                    static_cast<Field_num*>(f)->unsigned_flag);
+}
+
+void setIntConverter(cal_field_converter& conv)
+{
+    switch (conv.colType->colDataType)
+    {
+        case CalpontSystemCatalog::TINYINT:
+            conv.isNull = isNullInt<uint8_t, joblist::TINYINTNULL>;
+            conv.store = storeSInt<1>;
+            break;
+
+        case CalpontSystemCatalog::SMALLINT:
+            conv.isNull = isNullInt<uint16_t, joblist::SMALLINTNULL>;
+            conv.store = storeSInt<2>;
+            break;
+
+        case CalpontSystemCatalog::MEDINT:
+        case CalpontSystemCatalog::INT:
+            conv.isNull = isNullInt<uint32_t, joblist::INTNULL>;
+            conv.store = storeSInt<4>;
+            break;
+
+        case CalpontSystemCatalog::BIGINT:
+            conv.isNull = isNullInt<uint64_t, joblist::BIGINTNULL>;
+            conv.store = storeSInt<8>;
+            break;
+
+        case CalpontSystemCatalog::UTINYINT:
+            conv.isNull = isNullInt<uint8_t, joblist::UTINYINTNULL>;
+            conv.store = storeUInt<1>;
+            break;
+
+        case CalpontSystemCatalog::USMALLINT:
+            conv.isNull = isNullInt<uint16_t, joblist::USMALLINTNULL>;
+            conv.store = storeUInt<2>;
+            break;
+
+        case CalpontSystemCatalog::UMEDINT:
+        case CalpontSystemCatalog::UINT:
+            conv.isNull = isNullInt<uint32_t, joblist::UINTNULL>;
+            conv.store = storeUInt<4>;
+            break;
+
+        case CalpontSystemCatalog::UBIGINT:
+            conv.isNull = isNullInt<uint64_t, joblist::UBIGINTNULL>;
+            conv.store = storeUInt<8>;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void makeFieldConverters(cal_table_info& ti, int num_attr)
+{
+    std::vector<CalpontSystemCatalog::ColType>& colTypes = ti.tpl_scan_ctx->ctp;
+    RowGroup* rowGroup = ti.tpl_scan_ctx->rowGroup;
+    bool tableMode = (ti.tpl_scan_ctx->traceFlags & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF);
+
+    // table mode mysql expects all columns of the table. mapping between columnoid and position in rowgroup
+    // set coltype.position to be the position in rowgroup.
+    if (tableMode)
+    {
+        for (uint32_t i = 0; i < rowGroup->getColumnCount(); i++)
+        {
+            int oid = rowGroup->getOIDs()[i];
+
+            for (int j = 0; j < num_attr; j++)
+            {
+                // mysql should haved eliminated duplicate projection columns
+                if (oid == colTypes[j].columnOID || oid == colTypes[j].ddn.dictOID)
+                {
+                    colTypes[j].colPosition = i;
+                    break;
+                }
+            }
+        }
+    }
+
+    // get coltype if not there yet
+    if (num_attr > 0 && colTypes[0].colWidth == 0)
+    {
+        for (short c = 0; c < num_attr; c++)
+        {
+            colTypes[c].colPosition = c;
+            colTypes[c].colWidth = rowGroup->getColumnWidth(c);
+            colTypes[c].colDataType = rowGroup->getColTypes()[c];
+            colTypes[c].columnOID = rowGroup->getOIDs()[c];
+            colTypes[c].scale = rowGroup->getScale()[c];
+            colTypes[c].precision = rowGroup->getPrecision()[c];
+        }
+    }
+
+    rowGroup->initRow(&ti.convRow);
+    ti.fieldConverters.assign(num_attr, cal_field_converter());
+    Field** f = ti.msTablePtr->field;
+
+    for (int p = 0; p < num_attr; p++, f++)
+    {
+        //This col is going to be written
+        bitmap_set_bit(ti.msTablePtr->write_set, (*f)->field_index);
+
+        cal_field_converter& conv = ti.fieldConverters[p];
+        CalpontSystemCatalog::ColType& colType = colTypes[p];
+
+        // table mode handling
+        conv.rgPos = tableMode ? colType.colPosition : p;
+
+        if (conv.rgPos < 0)
+            continue;
+
+        conv.colType = &colType;
+        // precision == -16 is borrowed as skip null check indicator for bit ops.
+        conv.checkNull = (colType.precision != -16);
+        conv.emptyOnNull = (colType.colDataType == CalpontSystemCatalog::CHAR ||
+                            colType.colDataType == CalpontSystemCatalog::VARCHAR ||
+                            colType.colDataType == CalpontSystemCatalog::VARBINARY);
+        conv.handler = colType.typeHandler();
+        conv.isNull = isNullGeneric;
+        conv.store = conv.handler ? storeGeneric : 0;
+
+        // The specialized integer path relies on the RowGroup storage matching
+        // the column type; anything else keeps the generic conversion.
+        if (conv.handler && dynamic_cast<Field_num*>(*f) &&
+                rowGroup->getColTypes()[conv.rgPos] == colType.colDataType &&
+                rowGroup->getColumnWidth(conv.rgPos) == (uint32_t)colType.colWidth)
+            setIntConverter(conv);
+    }
+}
+
+}
+
+// Undo what a fetchNextRow() that threw had changed in ti, the table's entry
+// in tableMap: the row count and moreRows go back to what they were before the
+// call, and the conversion plan is rebuilt on the next fetch.
+void resetFetchState(cal_table_info& ti, unsigned c, bool moreRows)
+{
+    ti.c = c;
+    ti.moreRows = moreRows;
+    ti.fieldConverters.clear();
+}
+
 int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool handler_flag = false)
 {
     int rc = HA_ERR_END_OF_FILE;
@@ -360,87 +536,32 @@ int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool h
             memset(ti.msTablePtr->null_flags, -1, ti.msTablePtr->s->null_bytes);
         }
 
-        std::vector<CalpontSystemCatalog::ColType>& colTypes = ti.tpl_scan_ctx->ctp;
-
         RowGroup* rowGroup = ti.tpl_scan_ctx->rowGroup;
 
-        // table mode mysql expects all columns of the table. mapping between columnoid and position in rowgroup
-        // set coltype.position to be the position in rowgroup. only set once.
-        if (ti.tpl_scan_ctx->rowsreturned == 0 &&
-                (ti.tpl_scan_ctx->traceFlags & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF))
-        {
-            for (uint32_t i = 0; i < rowGroup->getColumnCount(); i++)
-            {
-                int oid = rowGroup->getOIDs()[i];
-                int j = 0;
+        // First row of a new band: (re)build the conversion plan.
+        if (ti.tpl_scan_ctx->rowsreturned == 0 || ti.fieldConverters.empty())
+            makeFieldConverters(ti, num_attr);
 
-                for (; j < num_attr; j++)
-                {
-                    // mysql should haved eliminated duplicate projection columns
-                    if (oid == colTypes[j].columnOID || oid == colTypes[j].ddn.dictOID)
-                    {
-                        colTypes[j].colPosition = i;
-                        break;
-                    }
-                }
-            }
-        }
-
-        rowgroup::Row row;
-        rowGroup->initRow(&row);
+        rowgroup::Row& row = ti.convRow;
         rowGroup->getRow(ti.tpl_scan_ctx->rowsreturned, &row);
-        int s;
 
         for (int p = 0; p < num_attr; p++, f++)
         {
-            //This col is going to be written
-            bitmap_set_bit(ti.msTablePtr->write_set, (*f)->field_index);
+            const cal_field_converter& conv = ti.fieldConverters[p];
 
-            // get coltype if not there yet
-            if (colTypes[0].colWidth == 0)
-            {
-                for (short c = 0; c < num_attr; c++)
-                {
-                    colTypes[c].colPosition = c;
-                    colTypes[c].colWidth = rowGroup->getColumnWidth(c);
-                    colTypes[c].colDataType = rowGroup->getColTypes()[c];
-                    colTypes[c].columnOID = rowGroup->getOIDs()[c];
-                    colTypes[c].scale = rowGroup->getScale()[c];
-                    colTypes[c].precision = rowGroup->getPrecision()[c];
-                }
-            }
-
-            CalpontSystemCatalog::ColType colType(colTypes[p]);
-
-            // table mode handling
-            if (ti.tpl_scan_ctx->traceFlags & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF)
-            {
-                if (colType.colPosition == -1) // not projected by tuplejoblist
-                    continue;
-                else
-                    s = colType.colPosition;
-            }
-            else
-            {
-                s = p;
-            }
+            if (conv.rgPos < 0) // not projected by tuplejoblist
+                continue;
 
-            // precision == -16 is borrowed as skip null check indicator for bit ops.
-            if (row.isNullValue(s) && colType.precision != -16)
+            if (conv.checkNull && conv.isNull(conv, row))
             {
                 // @2835. Handle empty string and null confusion. store empty string for string column
-                if (colType.colDataType == CalpontSystemCatalog::CHAR ||
-                        colType.colDataType == CalpontSystemCatalog::VARCHAR ||
-                        colType.colDataType == CalpontSystemCatalog::VARBINARY)
-                {
+                if (conv.emptyOnNull)
                     (*f)->store("", 0, (*f)->charset());
-                }
 
                 continue;
             }
 
-            const datatypes::TypeHandler *h= colType.typeHandler();
-            if (!h)
+            if (!conv.store)
             {
               idbassert(0);
               (*f)->reset();
@@ -450,8 +571,7 @@ int fetchNextRow(uchar* buf, cal_table_info& ti, cal_connection_info* ci, bool h
             {
               // fetch and store data
               (*f)->set_notnull();
-              datatypes::StoreFieldMariaDB mf(*f, colType);
-              h->storeValueToField(row, s, &mf);
+              conv.store(conv, row, *f);
             }
         }
 
@@ -2390,8 +2510,9 @@ int ha_mcs_impl_rnd_next(uchar* buf, TABLE* table)
 
     if (ci->alterTableState > 0) return HA_ERR_END_OF_FILE;
 
-    cal_table_info ti;
-    ti = ci->tableMap[table];
+    // Work on the map entry in place; copying cal_table_info for every row
+    // is measurable on large result sets.
+    cal_table_info& ti = ci->tableMap[table];
     int rc = HA_ERR_END_OF_FILE;
 
     if (!ti.tpl_ctx || !ti.tpl_scan_ctx)
@@ -2402,20 +2523,22 @@ int ha_mcs_impl_rnd_next(uchar* buf, TABLE* table)
 
     idbassert(ti.msTablePtr == table);
 
+    unsigned c = ti.c;
+    bool moreRows = ti.moreRows;
+
     try
     {
         rc = fetchNextRow(buf, ti, ci);
     }
     catch (std::exception& e)
     {
+        resetFetchState(ti, c, moreRows);
         string emsg = string("Error while fetching from ExeMgr: ") + e.what();
         setError(thd, ER_INTERNAL_ERROR, emsg);
         CalpontSystemCatalog::removeCalpontSystemCatalog(tid2sid(thd->thread_id));
         return ER_INTERNAL_ERROR;
     }
 
-    ci->tableMap[table] = ti;
-
     if (rc != 0 && rc != HA_ERR_END_OF_FILE)
     {
         string emsg;
@@ -4349,8 +4472,9 @@ int ha_mcs_impl_group_by_next(TABLE* table)
 
     if (ci->alterTableState > 0) return HA_ERR_END_OF_FILE;
 
-    cal_table_info ti;
-    ti = ci->tableMap[table];
+    // Work on the map entry in place; copying cal_table_info for every row
+    // is measurable on large result sets.
+    cal_table_info& ti = ci->tableMap[table];
     int rc = HA_ERR_END_OF_FILE;
 
     if (!ti.tpl_ctx || !ti.tpl_scan_ctx)
@@ -4361,6 +4485,9 @@ int ha_mcs_impl_group_by_next(TABLE* table)
 
     idbassert(ti.msTablePtr == table);
 
+    unsigned c = ti.c;
+    bool moreRows = ti.moreRows;
+
     try
     {
         // fetchNextRow interface forces to use buf.
@@ -4369,14 +4496,13 @@ int ha_mcs_impl_group_by_next(TABLE* table)
     }
     catch (std::exception& e)
     {
+        resetFetchState(ti, c, moreRows);
         string emsg = string("Error while fetching from ExeMgr: ") + e.what();
         setError(thd, ER_INTERNAL_ERROR, emsg);
         CalpontSystemCatalog::removeCalpontSystemCatalog(tid2sid(thd->thread_id));
         return ER_INTERNAL_ERROR;
     }
 
-    ci->tableMap[table] = ti;
-
     if (rc != 0 && rc != HA_ERR_END_OF_FILE)
     {
         string emsg;
@@ -5066,8 +5192,9 @@ int ha_mcs_impl_select_next(uchar* buf, TABLE* table)
 
     if (ci->alterTableState > 0) return rc;
 
-    cal_table_info ti;
-    ti= ci->tableMap[table];
+    // Work on the map entry in place; copying cal_table_info for every row
+    // is measurable on large result sets.
+    cal_table_info& ti= ci->tableMap[table];
     // This is the server's temp table for the result.
     ti.msTablePtr= table;
     sm::tableid_t tableid= execplan::IDB_VTABLE_ID;
@@ -5119,7 +5246,6 @@ int ha_mcs_impl_select_next(uchar* buf, TABLE* table)
                 ti.tpl_scan_ctx->ctp.push_back(ctype);
             }
         }
-        ci->tableMap[table] = ti;
         hndl->queryState= sm::QUERY_IN_PROCESS;
     }
 
@@ -5132,12 +5258,16 @@ int ha_mcs_impl_select_next(uchar* buf, TABLE* table)
 
     idbassert(ti.msTablePtr == table);
 
+    unsigned c = ti.c;
+    bool moreRows = ti.moreRows;
+
     try
     {
         rc = fetchNextRow(buf, ti, ci);
     }
     catch (std::exception& e)
     {
+        resetFetchState(ti, c, moreRows);
         uint32_t sessionID = tid2sid(thd->thread_id);
         string emsg = string("Error while fetching from ExeMgr: ") + e.what();
         setError(thd, ER_INTERNAL_ERROR, emsg);
@@ -5145,8 +5275,6 @@ int ha_mcs_impl_select_next(uchar* buf, TABLE* table)
         return ER_INTERNAL_ERROR;
     }
 
-    ci->tableMap[table]= ti;
-
     if (rc != 0 && rc != HA_ERR_END_OF_FILE)
     {
         string emsg;
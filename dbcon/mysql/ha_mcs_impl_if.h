@@ -183,6 +183,27 @@ struct gp_walk_info
     ~gp_walk_info() {}
 };
 
+struct cal_field_converter;
+typedef bool (*cal_field_null_fn)(const cal_field_converter&, const rowgroup::Row&);
+typedef int (*cal_field_store_fn)(const cal_field_converter&, const rowgroup::Row&, Field*);
+
+// Per-column conversion plan from the result RowGroup into a MariaDB Field.
+// Built once per band by fetchNextRow() so the per-row loop doesn't
+// redo the type dispatch, catalog lookups and null check type switch.
+struct cal_field_converter
+{
+    cal_field_converter() : rgPos(-1), checkNull(true), emptyOnNull(false),
+        colType(0), handler(0), isNull(0), store(0)
+    { }
+    int32_t rgPos;       // position in the RowGroup, -1 if not projected
+    bool checkNull;      // false for bit ops (precision == -16)
+    bool emptyOnNull;    // @2835. NULL char/varchar/varbinary are stored as ''
+    execplan::CalpontSystemCatalog::ColType* colType;
+    const datatypes::TypeHandler* handler;
+    cal_field_null_fn isNull;
+    cal_field_store_fn store;
+};
+
 struct cal_table_info
 {
     enum RowSources { FROM_ENGINE, FROM_FILE };
@@ -205,6 +226,8 @@ struct cal_table_info
     gp_walk_info* condInfo;
     execplan::SCSEP csep;
     bool moreRows; //are there more rows to consume (b/c of limit)
+    std::vector<cal_field_converter> fieldConverters;
+    rowgroup::Row convRow; // row cursor into the band fieldConverters was built for
 };
 
 struct cal_group_info
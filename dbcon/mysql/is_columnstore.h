@@ -21,3 +21,4 @@ int is_columnstore_extents_plugin_init(void* p);
 int is_columnstore_files_plugin_init(void* p);
 int is_columnstore_tables_plugin_init(void* p);
 int is_columnstore_columns_plugin_init(void* p);
+int is_columnstore_memory_usage_plugin_init(void* p);
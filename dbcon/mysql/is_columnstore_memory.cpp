@@ -0,0 +1,114 @@
+/* c-basic-offset: 4; tab-width: 4; indent-tabs-mode: nil
+ * vi: set shiftwidth=4 tabstop=4 expandtab:
+ *  :indentSize=4:tabSize=4:noTabs=true:
+ *
+ * Copyright (C) 2021 MariaDB Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2 of
+ * the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "idb_mysql.h"
+
+#include <string>
+#include <boost/scoped_ptr.hpp>
+
+#include "bytestream.h"
+#include "messagequeue.h"
+#include "is_columnstore.h"
+
+// Required declaration as it isn't in a MairaDB include
+bool schema_table_store_record(THD* thd, TABLE* table);
+
+ST_FIELD_INFO is_columnstore_memory_usage_fields[] =
+{
+    Show::Column("SESSION_ID", Show::ULong(0), NOT_NULL),
+    Show::Column("STEP_ID", Show::ULong(0), NOT_NULL),
+    Show::Column("STEP_TYPE", Show::Varchar(64), NOT_NULL),
+    Show::Column("MEMORY_USED", Show::SLonglong(0), NOT_NULL),
+    Show::Column("UM_MEMORY_AVAILABLE", Show::SLonglong(0), NOT_NULL),
+    Show::Column("UM_MEMORY_LIMIT", Show::ULonglong(0), NOT_NULL),
+    Show::CEnd()
+};
+
+static int is_columnstore_memory_usage_fill(THD* thd, TABLE_LIST* tables, COND* cond)
+{
+    CHARSET_INFO* cs = system_charset_info;
+    TABLE* table = tables->table;
+    messageqcpp::ByteStream bs;
+    uint64_t umMemLimit;
+    int64_t umMemAvailable;
+    uint32_t count;
+
+    try
+    {
+        // Same request channel as calgetsqlcount(), message 6 is the memory report
+        boost::scoped_ptr<messageqcpp::MessageQueueClient> mqc(
+            new messageqcpp::MessageQueueClient("ExeMgr1"));
+        messageqcpp::ByteStream::quadbyte qb = 6;
+        bs << qb;
+        mqc->write(bs);
+        bs = mqc->read();
+    }
+    catch (std::exception& e)
+    {
+        thd->raise_error_printf(ER_INTERNAL_ERROR, e.what());
+        return 1;
+    }
+
+    if (bs.length() == 0)
+    {
+        thd->raise_error_printf(ER_INTERNAL_ERROR, "Lost connection to ExeMgr");
+        return 1;
+    }
+
+    bs >> umMemLimit;
+    bs >> umMemAvailable;
+    bs >> count;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t sessionID;
+        uint16_t stepID;
+        std::string stepType;
+        int64_t bytes;
+
+        bs >> sessionID;
+        bs >> stepID;
+        bs >> stepType;
+        bs >> bytes;
+
+        table->field[0]->store(sessionID);
+        table->field[1]->store(stepID);
+        table->field[2]->store(stepType.c_str(), stepType.length(), cs);
+        table->field[3]->store(bytes);
+        table->field[4]->store(umMemAvailable);
+        table->field[5]->store(umMemLimit, true);
+
+        if (schema_table_store_record(thd, table))
+            return 1;
+    }
+
+    return 0;
+}
+
+int is_columnstore_memory_usage_plugin_init(void* p)
+{
+    ST_SCHEMA_TABLE* schema = (ST_SCHEMA_TABLE*) p;
+    schema->fields_info = is_columnstore_memory_usage_fields;
+    schema->fill_table = is_columnstore_memory_usage_fill;
+    return 0;
+}
+
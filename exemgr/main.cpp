@@ -64,6 +64,7 @@
 #include "messagelog.h"
 #include "sqllogger.h"
 #include "femsghandler.h"
+#include "resultcache.h"
 #include "idberrorinfo.h"
 #include "MonitorProcMem.h"
 #include "liboamcpp.h"
@@ -190,6 +191,9 @@ std::mutex threadCntPerSessionMapMutex;
 //This var is only accessed using thread-safe inc/dec calls
 ActiveStatementCounter* statementsRunningCount;
 
+// NULL unless ExeMgr1/ResultCacheSize is set
+ResultCache* resultCache = NULL;
+
 joblist::DistributedEngineComm* ec;
 
 auto rm = joblist::ResourceManager::instance(true);
@@ -402,7 +406,8 @@ private:
         // Get stats if not already acquired for current query
         if ( !fStatsRetrieved )
         {
-            if (wantExtendedStats)
+            // a query answered from the result cache has no joblist, nor any I/O to report
+            if (jl && wantExtendedStats)
             {
                 //wait for the ei data to be written by another thread (brain-dead)
                 struct timespec req = { 0, 250000 }; //250 usec
@@ -414,8 +419,12 @@ private:
             }
 
             // Get % memory usage during current query for sessionId
-            jl->querySummary( wantExtendedStats );
-            fStats = jl->queryStats();
+            if (jl)
+            {
+                jl->querySummary( wantExtendedStats );
+                fStats = jl->queryStats();
+            }
+
             fStats.fMaxMemPct = getMaxMemPct( fStats.fSessionID );
             fStats.fRows = rowsReturned;
             fStatsRetrieved = true;
@@ -594,6 +603,226 @@ private:
         }
     }
 
+    //...Answer a tuple query from the result cache, the way the projection
+    //...loop in operator() does.  Returns true if the FE sent the next plan
+    //...instead of ending the query; it's left in bs.
+    bool sendCachedResult(const ResultCache::Result& result,
+                          const execplan::CalpontSelectExecutionPlan& csep,
+                          messageqcpp::ByteStream& bs,
+                          bool& selfJoin,
+                          uint64_t& bytesSent)
+    {
+        std::string emsg("NOERROR");
+        messageqcpp::ByteStream::quadbyte qb = 0;
+        bool delivered = false;
+
+        bs.restart();
+        bs << qb;
+        fIos.write(bs);
+        bs.restart();
+        bs << emsg;
+        fIos.write(bs);
+        fIos.write(result.rowGroup);
+
+        for (;;)
+        {
+            bs = fIos.read();
+
+            if (bs.length() == 0)
+                return false;
+
+            if (bs.length() > 4)
+            {
+                selfJoin = true;
+                return true;
+            }
+
+            bs >> qb;
+
+            if (qb == 0)
+                return false;
+            else if (qb == 1)
+                continue;
+            else if (qb == 2 && delivered)
+            {
+                bs.restart();
+                bs << (messageqcpp::ByteStream::byte)1;
+                fIos.write(bs);
+            }
+            else if (qb == 3)
+            {
+                joblist::SJLP noJobList;
+                std::string empty;
+
+                bs.restart();
+                bs << formatQueryStats(
+                          noJobList,
+                          "Query Stats",
+                          false,
+                          !(csep.traceFlags() & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF),
+                          false,
+                          result.rowCount);
+                bs << empty;
+                bs << empty;
+                fStats.serialize(bs);
+                fIos.write(bs);
+            }
+            else if (qb == 4)
+            {
+                bs = fIos.read();
+                return true;
+            }
+            else
+            {
+                // the tuple table is the only one there is
+                for (uint32_t i = 0; i < result.bands.size(); i++)
+                {
+                    fIos.write(result.bands[i]);
+                    bytesSent += result.bands[i].length();
+                }
+
+                delivered = true;
+            }
+        }
+    }
+
+    //...Log the end of a statement, print its trace output and post its
+    //...telemetry summary.  jl is empty for a query answered from the result
+    //...cache; its stats are then this thread's own.
+    void endStatement(const execplan::CalpontSelectExecutionPlan& csep,
+                      joblist::SJLP& jl,
+                      querytele::QueryTeleStats& qts,
+                      logging::LoggingID& li,
+                      bool needDbProfEndStatementMsg,
+                      uint64_t totalRowCount,
+                      uint64_t totalBytesSent,
+                      std::mutex& jlMutex,
+                      std::condition_variable& jlCleanupDone,
+                      int& destructing)
+    {
+        logging::Message::Args args;
+
+        if (needDbProfEndStatementMsg)
+        {
+            std::string ss;
+            std::ostringstream prefix;
+            prefix << "ses:" << csep.sessionID() << " Query Totals";
+
+            //Log stats std::string to standard out
+            ss = formatQueryStats(
+                     jl,
+                     prefix.str(),
+                     true,
+                     !(csep.traceFlags() & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF),
+                     (csep.traceFlags() & execplan::CalpontSelectExecutionPlan::TRACE_LOG),
+                     totalRowCount);
+            //@Bug 1306. Added timing info for real time tracking.
+            std::cout << ss << " at " << timeNow() << std::endl;
+
+            // log query stats to debug log file
+            args.reset();
+            args.add((int)csep.statementID());
+            args.add(fStats.fMaxMemPct);
+            args.add(fStats.fNumFiles);
+            args.add(fStats.fFileBytes); // log raw byte count instead of MB
+            args.add(fStats.fPhyIO);
+            args.add(fStats.fCacheIO);
+            args.add(fStats.fMsgRcvCnt);
+            args.add(fStats.fMsgBytesIn);
+            args.add(fStats.fMsgBytesOut);
+            args.add(fStats.fCPBlocksSkipped);
+            msgLog.logMessage(logging::LOG_TYPE_DEBUG,
+                              logDbProfQueryStats,
+                              args,
+                              li);
+            //@bug 1327
+            deleteMaxMemPct( csep.sessionID() );
+            // Calling reset here, will cause joblist destructor to be
+            // called, which "joins" the threads.  We need to do that
+            // here to make sure all syslogging from all the threads
+            // are complete; and that our logDbProfEndStatement will
+            // appear "last" in the syslog for this SQL statement.
+            // puts the real destruction in another thread to avoid
+            // making the whole session wait.  It can take several seconds.
+            int stmtID = csep.statementID();
+            std::unique_lock<std::mutex> scoped(jlMutex);
+            // C7's compiler complains about the msgLog capture here
+            // msgLog is global scope, and passed by copy, so, unclear
+            // what the warning is about.
+            destructing++;
+            std::thread bgdtor([jl, &jlMutex, &jlCleanupDone, stmtID, &li, &destructing] {
+                std::unique_lock<std::mutex> scoped(jlMutex);
+                const_cast<joblist::SJLP &>(jl).reset();    // this happens second; does real destruction
+                logging::Message::Args args;
+                args.add(stmtID);
+                msgLog.logMessage(logging::LOG_TYPE_DEBUG,
+                                  logDbProfEndStatement,
+                                  args,
+                                  li);
+                if (--destructing == 0)
+                    jlCleanupDone.notify_one();
+            });
+            jl.reset();   // this happens first
+            bgdtor.detach();
+        }
+        else
+            // delete sessionMemMap entry for this session's memory % use
+            deleteMaxMemPct( csep.sessionID() );
+
+        std::string endtime(timeNow());
+
+        if ((csep.traceFlags() & flagsWantOutput) && (csep.sessionID() < 0x80000000))
+        {
+            std::cout << "For session " << csep.sessionID() << ": " <<
+                 totalBytesSent <<
+                 " bytes sent back at " << endtime << std::endl;
+
+            // @bug 663 - Implemented caltraceon(16) to replace the
+            // $FIFO_SINK compiler definition in pColStep.
+            // This option consumes rows in the project steps.
+            if (csep.traceFlags() &
+              execplan::CalpontSelectExecutionPlan::TRACE_NO_ROWS4)
+            {
+                std::cout << std::endl;
+                std::cout << "**** No data returned to DM.  Rows consumed "
+                     "in ProjectSteps - caltrace(16) is on (FIFO_SINK)."
+                     " ****" << std::endl;
+                std::cout << std::endl;
+            }
+            else if (csep.traceFlags() &
+              execplan::CalpontSelectExecutionPlan::TRACE_NO_ROWS3)
+            {
+                std::cout << std::endl;
+                std::cout << "**** No data returned to DM - caltrace(8) is "
+                     "on (SWALLOW_ROWS_EXEMGR). ****" << std::endl;
+                std::cout << std::endl;
+            }
+        }
+
+        if ( !csep.isInternal() &&
+                (csep.queryType() == "SELECT" || csep.queryType() == "INSERT_SELECT") )
+        {
+            qts.msg_type = querytele::QueryTeleStats::QT_SUMMARY;
+            qts.max_mem_pct = fStats.fMaxMemPct;
+            qts.num_files = fStats.fNumFiles;
+            qts.phy_io = fStats.fPhyIO;
+            qts.cache_io = fStats.fCacheIO;
+            qts.msg_rcv_cnt = fStats.fMsgRcvCnt;
+            qts.cp_blocks_skipped = fStats.fCPBlocksSkipped;
+            qts.msg_bytes_in = fStats.fMsgBytesIn;
+            qts.msg_bytes_out = fStats.fMsgBytesOut;
+            qts.rows = totalRowCount;
+            qts.end_time = querytele::QueryTeleClient::timeNowms();
+            qts.session_id = csep.sessionID();
+            qts.query_type = csep.queryType();
+            qts.query = csep.data();
+            qts.system_name = fOamCachePtr->getSystemName();
+            qts.module_name = fOamCachePtr->getModuleName();
+            qts.local_query = csep.localQuery();
+            fTeleClient.postQueryTele(qts);
+        }
+    }
+
 public:
 
     void operator()()
@@ -681,6 +910,27 @@ public:
                         fIos.close();
                         break;
                     }
+                    else if (qb == 6) //somebody wants UM memory usage
+                    {
+                        std::vector<joblist::StepMemUsage> usage;
+                        joblist::JobList::memoryUsage(usage);
+                        bs.restart();
+                        bs << (uint64_t) fRm->getConfiguredUMMemLimit();
+                        bs << (int64_t) fRm->availableMemory();
+                        bs << (uint32_t) usage.size();
+
+                        for (uint32_t i = 0; i < usage.size(); i++)
+                        {
+                            bs << usage[i].sessionID;
+                            bs << usage[i].stepID;
+                            bs << usage[i].stepType;
+                            bs << usage[i].bytes;
+                        }
+
+                        fIos.write(bs);
+                        fIos.close();
+                        break;
+                    }
                     else
                     {
                         if (gDebug)
@@ -775,6 +1025,35 @@ new_plan:
                 oss << sqlText << "; |" << csep.schemaName() << "|";
                 logging::SQLLogger sqlLog(oss.str(), li);
 
+                std::string cacheKey;
+                uint64_t cacheVersion = 0;
+                ResultCache::ResultPtr cacheResult;
+
+                // hits don't wait for a slot in the exec queue, there's no work to them
+                if (resultCache && tryTuples && resultCache->makeKey(csep, cacheKey, cacheVersion))
+                {
+                    ResultCache::ResultPtr hit = resultCache->lookup(cacheKey, cacheVersion);
+
+                    if (hit)
+                    {
+                        uint64_t bytesSent = 0;
+
+                        if (sendCachedResult(*hit, csep, bs, selfJoin, bytesSent))
+                        {
+                            deleteMaxMemPct( csep.sessionID() );
+                            goto new_plan;
+                        }
+
+                        // the statement ends the way an executed one does, minus the joblist
+                        joblist::SJLP noJobList;
+                        endStatement(csep, noJobList, qts, li, needDbProfEndStatementMsg, hit->rowCount,
+                                     bytesSent, jlMutex, jlCleanupDone, destructing);
+                        continue;
+                    }
+
+                    cacheResult.reset(new ResultCache::Result());
+                }
+
                 statementsRunningCount->incr(stmtCounted);
 
                 if (tryTuples)
@@ -805,6 +1084,9 @@ new_plan:
                             tbs.restart();
                             tbs << tjlp->getOutputRowGroup();
                             fIos.write(tbs);
+
+                            if (cacheResult)
+                                cacheResult->rowGroup = tbs;
                         }
                         else
                         {
@@ -1092,6 +1374,35 @@ new_plan:
                         totalRowCount += rowCount;
                         totalBytesSent += bs.length();
 
+                        // a cancelled query's bands stop short of its result
+                        if (msgHandler.aborted() || jl->aborted())
+                            cacheResult.reset();
+
+                        // keep what was sent for the result cache, within its entry limit
+                        if (cacheResult && tableOID == 100)
+                        {
+                            cacheResult->bytes += bs.length();
+
+                            if (jl->status() == 0 && cacheResult->bytes <= resultCache->maxEntryBytes())
+                            {
+                                cacheResult->bands.push_back(bs);
+                                cacheResult->rowCount += rowCount;
+
+                                // the data can't have changed under the query, or the result
+                                // would be filed under a version it doesn't belong to
+                                uint64_t version;
+
+                                if (rowCount == 0 && resultCache->dataVersion(csep, version) &&
+                                        version == cacheVersion)
+                                    resultCache->store(cacheKey, cacheVersion, cacheResult);
+                            }
+                            else
+                                cacheResult.reset();
+
+                            if (rowCount == 0)
+                                cacheResult.reset();
+                        }
+
                         if (rowCount == 0)
                         {
                             msgHandler.stop();
@@ -1115,127 +1426,10 @@ new_plan:
                 if (csep.traceOn())
                     jl->graph(csep.sessionID());
 
-                if (needDbProfEndStatementMsg)
-                {
-                    std::string ss;
-                    std::ostringstream prefix;
-                    prefix << "ses:" << csep.sessionID() << " Query Totals";
-
-                    //Log stats std::string to standard out
-                    ss = formatQueryStats(
-                             jl,
-                             prefix.str(),
-                             true,
-                             !(csep.traceFlags() & execplan::CalpontSelectExecutionPlan::TRACE_TUPLE_OFF),
-                             (csep.traceFlags() & execplan::CalpontSelectExecutionPlan::TRACE_LOG),
-                             totalRowCount);
-                    //@Bug 1306. Added timing info for real time tracking.
-                    std::cout << ss << " at " << timeNow() << std::endl;
-
-                    // log query stats to debug log file
-                    args.reset();
-                    args.add((int)csep.statementID());
-                    args.add(fStats.fMaxMemPct);
-                    args.add(fStats.fNumFiles);
-                    args.add(fStats.fFileBytes); // log raw byte count instead of MB
-                    args.add(fStats.fPhyIO);
-                    args.add(fStats.fCacheIO);
-                    args.add(fStats.fMsgRcvCnt);
-                    args.add(fStats.fMsgBytesIn);
-                    args.add(fStats.fMsgBytesOut);
-                    args.add(fStats.fCPBlocksSkipped);
-                    msgLog.logMessage(logging::LOG_TYPE_DEBUG,
-                                      logDbProfQueryStats,
-                                      args,
-                                      li);
-                    //@bug 1327
-                    deleteMaxMemPct( csep.sessionID() );
-                    // Calling reset here, will cause joblist destructor to be
-                    // called, which "joins" the threads.  We need to do that
-                    // here to make sure all syslogging from all the threads
-                    // are complete; and that our logDbProfEndStatement will
-                    // appear "last" in the syslog for this SQL statement.
-                    // puts the real destruction in another thread to avoid
-                    // making the whole session wait.  It can take several seconds.
-                    int stmtID = csep.statementID();
-                    std::unique_lock<std::mutex> scoped(jlMutex);
-                    // C7's compiler complains about the msgLog capture here
-                    // msgLog is global scope, and passed by copy, so, unclear
-                    // what the warning is about.
-                    destructing++;
-                    std::thread bgdtor([jl, &jlMutex, &jlCleanupDone, stmtID, &li, &destructing] {
-                        std::unique_lock<std::mutex> scoped(jlMutex);
-                        const_cast<joblist::SJLP &>(jl).reset();    // this happens second; does real destruction
-                        logging::Message::Args args;
-                        args.add(stmtID);
-                        msgLog.logMessage(logging::LOG_TYPE_DEBUG,
-                                          logDbProfEndStatement,
-                                          args,
-                                          li);
-                        if (--destructing == 0)
-                            jlCleanupDone.notify_one();
-                    });
-                    jl.reset();   // this happens first
-                    bgdtor.detach();
-                }
-                else
-                    // delete sessionMemMap entry for this session's memory % use
-                    deleteMaxMemPct( csep.sessionID() );
-
-                std::string endtime(timeNow());
-
-                if ((csep.traceFlags() & flagsWantOutput) && (csep.sessionID() < 0x80000000))
-                {
-                    std::cout << "For session " << csep.sessionID() << ": " <<
-                         totalBytesSent <<
-                         " bytes sent back at " << endtime << std::endl;
-
-                    // @bug 663 - Implemented caltraceon(16) to replace the
-                    // $FIFO_SINK compiler definition in pColStep.
-                    // This option consumes rows in the project steps.
-                    if (csep.traceFlags() &
-                      execplan::CalpontSelectExecutionPlan::TRACE_NO_ROWS4)
-                    {
-                        std::cout << std::endl;
-                        std::cout << "**** No data returned to DM.  Rows consumed "
-                             "in ProjectSteps - caltrace(16) is on (FIFO_SINK)."
-                             " ****" << std::endl;
-                        std::cout << std::endl;
-                    }
-                    else if (csep.traceFlags() &
-                      execplan::CalpontSelectExecutionPlan::TRACE_NO_ROWS3)
-                    {
-                        std::cout << std::endl;
-                        std::cout << "**** No data returned to DM - caltrace(8) is "
-                             "on (SWALLOW_ROWS_EXEMGR). ****" << std::endl;
-                        std::cout << std::endl;
-                    }
-                }
+                endStatement(csep, jl, qts, li, needDbProfEndStatementMsg, totalRowCount, totalBytesSent,
+                             jlMutex, jlCleanupDone, destructing);
 
                 statementsRunningCount->decr(stmtCounted);
-
-                if ( !csep.isInternal() &&
-                        (csep.queryType() == "SELECT" || csep.queryType() == "INSERT_SELECT") )
-                {
-                    qts.msg_type = querytele::QueryTeleStats::QT_SUMMARY;
-                    qts.max_mem_pct = fStats.fMaxMemPct;
-                    qts.num_files = fStats.fNumFiles;
-                    qts.phy_io = fStats.fPhyIO;
-                    qts.cache_io = fStats.fCacheIO;
-                    qts.msg_rcv_cnt = fStats.fMsgRcvCnt;
-                    qts.cp_blocks_skipped = fStats.fCPBlocksSkipped;
-                    qts.msg_bytes_in = fStats.fMsgBytesIn;
-                    qts.msg_bytes_out = fStats.fMsgBytesOut;
-                    qts.rows = totalRowCount;
-                    qts.end_time = querytele::QueryTeleClient::timeNowms();
-                    qts.session_id = csep.sessionID();
-                    qts.query_type = csep.queryType();
-                    qts.query = csep.data();
-                    qts.system_name = fOamCachePtr->getSystemName();
-                    qts.module_name = fOamCachePtr->getModuleName();
-                    qts.local_query = csep.localQuery();
-                    fTeleClient.postQueryTele(qts);
-                }
             }
 
             // Release CSC object (for sessionID) that was added by makeJobList()
@@ -1426,6 +1620,59 @@ void startRssMon(size_t maxPct, int pauseSeconds)
     new boost::thread(RssMonFcn(maxPct, pauseSeconds));
 }
 
+// Rebuilds the catalog snapshot after DDL.  The first build reads the syscat
+// through this ExeMgr, so it fails until we're accepting connections; a failure
+// is logged once, and retried less and less often until a build succeeds.
+void catalogSnapshotFcn()
+{
+    const unsigned maxPause = 60;
+    unsigned pause = 1;
+    bool logged = false;
+
+    for (;;)
+    {
+        std::string error;
+
+        try
+        {
+            execplan::CalpontSystemCatalog::refreshSnapshot();
+        }
+        catch (std::exception& e)
+        {
+            error = e.what();
+        }
+        catch (...)
+        {
+            error = "caught unknown exception";
+        }
+
+        if (error.empty())
+        {
+            pause = 1;
+            logged = false;
+        }
+        else
+        {
+            if (!logged)
+            {
+                logging::Message::Args args;
+                args.add("Catalog snapshot: " + error);
+                msgLog.logMessage(logging::LOG_TYPE_WARNING, logDefaultMsg, args, logging::LoggingID(16));
+                logged = true;
+            }
+
+            pause = std::min(pause * 2, maxPause);
+        }
+
+        sleep(pause);
+    }
+}
+
+void startCatalogSnapshot()
+{
+    new boost::thread(catalogSnapshotFcn);
+}
+
 int setupResources()
 {
 #ifdef _MSC_VER
@@ -1610,6 +1857,9 @@ int ServiceExeMgr::Child()
 
     statementsRunningCount = new ActiveStatementCounter(rm->getEmExecQueueSize());
 
+    if (rm->getEmResultCacheSize() > 0)
+        resultCache = new ResultCache(rm->getEmResultCacheSize(), rm->getEmResultCacheMaxEntrySize(), rm);
+
     for (;;)
     {
         try
@@ -1663,6 +1913,9 @@ int ServiceExeMgr::Child()
     if (maxPct > 0)
         startRssMon(maxPct, pauseSeconds);
 
+    if (rm->getEmCatalogSnapshot())
+        startCatalogSnapshot();
+
 #ifndef _MSC_VER
     setpriority(PRIO_PROCESS, 0, priority);
 #endif
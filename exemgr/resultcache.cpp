@@ -0,0 +1,394 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file resultcache.cpp
+ *
+ */
+
+#include <set>
+#include <boost/uuid/nil_generator.hpp>
+
+#include "resultcache.h"
+#include "simplecolumn.h"
+#include "arithmeticcolumn.h"
+#include "functioncolumn.h"
+#include "aggregatecolumn.h"
+#include "windowfunctioncolumn.h"
+#include "rowcolumn.h"
+#include "simplefilter.h"
+#include "constantfilter.h"
+#include "existsfilter.h"
+#include "selectfilter.h"
+#include "simplescalarfilter.h"
+#include "parsetree.h"
+#include "dbrm.h"
+#include "hasher.h"
+
+using namespace std;
+using namespace execplan;
+using namespace messageqcpp;
+
+namespace
+{
+
+// what's read from a table may change between two runs of these.  The FE folds
+// the ones it can evaluate once (NOW(), user variables, ...) into constants, which
+// end up in the key; these are for whatever reaches ExeMgr as a function.
+const char* nonDeterministic[] =
+{
+    "rand", "uuid", "uuid_short", "now", "sysdate", "curdate", "curtime", "current_date",
+    "current_time", "current_timestamp", "localtime", "localtimestamp", "utc_date", "utc_time",
+    "utc_timestamp", "connection_id", "last_insert_id", "found_rows", "row_count", "user",
+    "current_user", "session_user", "system_user", "sleep", "benchmark", "nextval", "lastval",
+    "setval", "get_user_var", "set_user_var", NULL
+};
+
+struct PlanWalk
+{
+    explicit PlanWalk(uint32_t sessionID) :
+        csc(CalpontSystemCatalog::makeCalpontSystemCatalog(sessionID)), cacheable(true) { }
+
+    boost::shared_ptr<CalpontSystemCatalog> csc;
+    set<uint32_t> tableOIDs;
+    bool cacheable;
+};
+
+void normalizePlan(CalpontExecutionPlan* ep, PlanWalk& walk);
+void checkColumn(const ReturnedColumn* rc, PlanWalk& walk);
+
+bool isDeterministic(const string& funcName)
+{
+    for (uint32_t i = 0; nonDeterministic[i] != NULL; i++)
+        if (funcName == nonDeterministic[i])
+            return false;
+
+    return true;
+}
+
+void checkColumns(const vector<SRCP>& cols, PlanWalk& walk)
+{
+    for (uint32_t i = 0; i < cols.size(); i++)
+        checkColumn(cols[i].get(), walk);
+}
+
+/* Walks a filter or expression tree for non-deterministic functions, and
+   normalizes the subqueries in it. */
+void normalizeNode(ParseTree* n, void* obj)
+{
+    PlanWalk* walk = reinterpret_cast<PlanWalk*>(obj);
+    TreeNode* tn = n->data();
+    ExistsFilter* ef;
+    SelectFilter* sf;
+    SimpleScalarFilter* ssf;
+    SimpleFilter* simf;
+    ConstantFilter* cf;
+
+    if ((ef = dynamic_cast<ExistsFilter*>(tn)) != NULL)
+        normalizePlan(ef->sub().get(), *walk);
+    else if ((sf = dynamic_cast<SelectFilter*>(tn)) != NULL)
+        normalizePlan(sf->sub().get(), *walk);
+    else if ((ssf = dynamic_cast<SimpleScalarFilter*>(tn)) != NULL)
+        normalizePlan(ssf->sub().get(), *walk);
+    else if ((simf = dynamic_cast<SimpleFilter*>(tn)) != NULL)
+    {
+        checkColumn(simf->lhs(), *walk);
+        checkColumn(simf->rhs(), *walk);
+    }
+    else if ((cf = dynamic_cast<ConstantFilter*>(tn)) != NULL)
+    {
+        checkColumn(cf->col().get(), *walk);
+
+        for (uint32_t i = 0; i < cf->filterList().size(); i++)
+        {
+            checkColumn(cf->filterList()[i]->lhs(), *walk);
+            checkColumn(cf->filterList()[i]->rhs(), *walk);
+        }
+    }
+    else
+        checkColumn(dynamic_cast<ReturnedColumn*>(tn), *walk);
+}
+
+void checkColumn(const ReturnedColumn* rc, PlanWalk& walk)
+{
+    const FunctionColumn* fc;
+    const ArithmeticColumn* ac;
+    const AggregateColumn* agc;
+    const WindowFunctionColumn* wc;
+    const RowColumn* rowc;
+
+    if (rc == NULL || !walk.cacheable)
+        return;
+
+    if ((fc = dynamic_cast<const FunctionColumn*>(rc)) != NULL)
+    {
+        const funcexp::FunctionParm& parms = fc->functionParms();
+
+        // unix_timestamp() of a column is fine, of nothing it's now()
+        if (!isDeterministic(fc->functionName()) ||
+                (fc->functionName() == "unix_timestamp" && parms.empty()))
+            walk.cacheable = false;
+
+        for (uint32_t i = 0; i < parms.size(); i++)
+            parms[i]->walk(normalizeNode, &walk);
+    }
+    else if ((ac = dynamic_cast<const ArithmeticColumn*>(rc)) != NULL)
+    {
+        if (ac->expression())
+            ac->expression()->walk(normalizeNode, &walk);
+    }
+    else if ((wc = dynamic_cast<const WindowFunctionColumn*>(rc)) != NULL)
+    {
+        checkColumns(wc->functionParms(), walk);
+        checkColumns(wc->partitions(), walk);
+    }
+    else if ((agc = dynamic_cast<const AggregateColumn*>(rc)) != NULL)
+        checkColumns(agc->aggParms(), walk);
+    else if ((rowc = dynamic_cast<const RowColumn*>(rc)) != NULL)
+        checkColumns(rowc->columnVec(), walk);
+}
+
+void normalizePlans(const CalpontSelectExecutionPlan::SelectList& plans, PlanWalk& walk)
+{
+    for (uint32_t i = 0; i < plans.size(); i++)
+        normalizePlan(plans[i].get(), walk);
+}
+
+/* Clears the fields that differ between two runs of the same statement, in
+   this plan & every plan nested in it, checks them for non-deterministic
+   functions and collects the tables they read. */
+void normalizePlan(CalpontExecutionPlan* ep, PlanWalk& walk)
+{
+    CalpontSelectExecutionPlan* csep = dynamic_cast<CalpontSelectExecutionPlan*>(ep);
+
+    if (csep == NULL)
+        return;
+
+    csep->sessionID(0);
+    csep->txnID(0);
+    csep->verID(BRM::QueryContext());
+    csep->statementID(0);
+    csep->traceFlags(0);
+    csep->uuid(boost::uuids::nil_uuid());
+    csep->rmParms(CalpontSelectExecutionPlan::RMParmVec());
+
+    const CalpontSelectExecutionPlan::ColumnMap& colMap = csep->columnMap();
+    CalpontSelectExecutionPlan::ColumnMap::const_iterator it;
+
+    for (it = colMap.begin(); it != colMap.end(); ++it)
+    {
+        const SimpleColumn* sc = dynamic_cast<const SimpleColumn*>(it->second.get());
+
+        // the syscat & other engines' tables aren't versioned by their locks
+        if (sc != NULL && sc->oid() != 0 && (!sc->isColumnStore() || sc->oid() < 3000))
+            walk.cacheable = false;
+    }
+
+    const CalpontSelectExecutionPlan::TableList& tables = csep->tableList();
+
+    for (uint32_t i = 0; i < tables.size(); i++)
+    {
+        // derived tables are walked as subqueries below
+        if (tables[i].schema.empty())
+            continue;
+
+        if (!tables[i].fisColumnStore || tables[i].schema == CALPONT_SCHEMA)
+        {
+            walk.cacheable = false;
+            continue;
+        }
+
+        try
+        {
+            walk.tableOIDs.insert(walk.csc->tableRID(make_table(tables[i].schema, tables[i].table)).objnum);
+        }
+        catch (...)
+        {
+            walk.cacheable = false;
+        }
+    }
+
+    checkColumns(csep->returnedCols(), walk);
+    checkColumns(csep->groupByCols(), walk);
+    checkColumns(csep->orderByCols(), walk);
+
+    if (csep->filters())
+        csep->filters()->walk(normalizeNode, &walk);
+
+    if (csep->having())
+        csep->having()->walk(normalizeNode, &walk);
+
+    normalizePlans(csep->subSelects(), walk);
+    normalizePlans(csep->derivedTableList(), walk);
+    normalizePlans(csep->unionVec(), walk);
+    normalizePlans(csep->selectSubList(), walk);
+
+    for (uint32_t i = 0; i < csep->subSelectList().size(); i++)
+        normalizePlan(csep->subSelectList()[i].get(), walk);
+}
+
+/* Every writer (DML, cpimport, DDL) holds a table lock while it changes a table,
+   and the lock server versions a table each time it's locked or unlocked, so
+   the data is unchanged as long as the versions are. */
+bool versionOf(const set<uint32_t>& tableOIDs, uint64_t& version)
+{
+    BRM::DBRM dbrm;
+    set<BRM::VER_t> txns;
+    vector<uint32_t> oids(tableOIDs.begin(), tableOIDs.end());
+    vector<uint64_t> versions;
+    bool locked;
+
+    // an open transaction keeps its table locks until it ends
+    if (dbrm.getCurrentTxnIDs(txns) != 0 || !txns.empty())
+        return false;
+
+    try
+    {
+        dbrm.getTableVersions(oids, &versions, &locked);
+    }
+    catch (exception&)
+    {
+        return false;
+    }
+
+    if (locked || versions.size() != oids.size())
+        return false;
+
+    utils::Hasher128 hasher;
+    version = 0;
+
+    for (uint32_t i = 0; i < oids.size(); i++)
+    {
+        uint64_t fields[] = { oids[i], versions[i] };
+        version = version * 31 + hasher((const char*) fields, sizeof(fields));
+    }
+
+    return true;
+}
+
+}
+
+ResultCache::ResultCache(uint64_t maxBytes, uint64_t maxEntryBytes, joblist::ResourceManager* rm) :
+    fMaxEntryBytes(maxEntryBytes), fRm(rm), fMemLimit(new int64_t(maxBytes))
+{
+}
+
+ResultCache::~ResultCache()
+{
+    clear();
+}
+
+bool ResultCache::makeKey(const CalpontSelectExecutionPlan& csep, string& key, uint64_t& version)
+{
+    if (csep.isInternal() || csep.queryType() != "SELECT" || csep.txnID() != 0)
+        return false;
+
+    if ((csep.traceFlags() & ~(CalpontSelectExecutionPlan::TRACE_TUPLE_AUTOSWITCH |
+                               CalpontSelectExecutionPlan::TRACE_TUPLE_OFF)) != 0)
+        return false;
+
+    // the key is the plan as the FE sent it, less what's particular to this statement
+    CalpontSelectExecutionPlan copy;
+    PlanWalk walk(csep.sessionID());
+    ByteStream bs;
+
+    csep.serialize(bs);
+    copy.unserialize(bs);
+    normalizePlan(&copy, walk);
+
+    if (!walk.cacheable || walk.tableOIDs.empty())
+        return false;
+
+    if (!versionOf(walk.tableOIDs, version))
+        return false;
+
+    bs.restart();
+    copy.serialize(bs);
+    key.assign((const char*) bs.buf(), bs.length());
+    return true;
+}
+
+bool ResultCache::dataVersion(const CalpontSelectExecutionPlan& csep, uint64_t& version)
+{
+    CalpontSelectExecutionPlan copy;
+    PlanWalk walk(csep.sessionID());
+    ByteStream bs;
+
+    csep.serialize(bs);
+    copy.unserialize(bs);
+    normalizePlan(&copy, walk);
+    return walk.cacheable && versionOf(walk.tableOIDs, version);
+}
+
+ResultCache::ResultPtr ResultCache::lookup(const string& key, uint64_t version)
+{
+    boost::mutex::scoped_lock lk(fMutex);
+    EntryMap::iterator it = fEntries.find(key);
+
+    if (it == fEntries.end())
+        return ResultPtr();
+
+    // the data changed since it was computed
+    if (it->second->version != version)
+    {
+        erase(it->second);
+        return ResultPtr();
+    }
+
+    fLRU.splice(fLRU.begin(), fLRU, it->second);
+    return it->second->result;
+}
+
+void ResultCache::store(const string& key, uint64_t version, const ResultPtr& result)
+{
+    int64_t size = key.length() + result->bytes;
+    boost::mutex::scoped_lock lk(fMutex);
+    EntryMap::iterator it = fEntries.find(key);
+
+    if (it != fEntries.end())
+        erase(it->second);
+
+    while (*fMemLimit < size && !fLRU.empty())
+        erase(--fLRU.end());
+
+    // it doesn't fit, or the running queries need the memory more
+    if (!fRm->getMemory(size, fMemLimit, false))
+        return;
+
+    Entry e;
+    e.key = key;
+    e.version = version;
+    e.result = result;
+    fLRU.push_front(e);
+    fEntries[key] = fLRU.begin();
+}
+
+void ResultCache::clear()
+{
+    boost::mutex::scoped_lock lk(fMutex);
+
+    while (!fLRU.empty())
+        erase(fLRU.begin());
+}
+
+void ResultCache::erase(EntryList::iterator it)
+{
+    fRm->returnMemory(it->key.length() + it->result->bytes, fMemLimit);
+    fEntries.erase(it->key);
+    fLRU.erase(it);
+}
+
+// vim:ts=4 sw=4:
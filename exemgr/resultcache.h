@@ -0,0 +1,117 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file resultcache.h
+ * A cache of query results in ExeMgr.
+ */
+
+#ifndef RESULTCACHE_H_
+#define RESULTCACHE_H_
+
+#include <stdint.h>
+#include <list>
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "bytestream.h"
+#include "calpontselectexecutionplan.h"
+#include "resourcemanager.h"
+
+/** @brief Keeps the results of repeated read-only queries
+ *
+ * Dashboards send the same SELECTs over and over against data that changes a
+ * few times a day.  A result is keyed by its plan with the per-statement fields
+ * (session, transaction, SCN, statement ID, uuid) cleared, and carries a
+ * version: a hash of the lock server's versions of the tables the plan reads.
+ * DML, cpimport and DDL all lock a table while they change it, and each lock
+ * & unlock moves its version on, so a result is only served while the data
+ * it was computed from is unchanged.  Stale entries are dropped when they're
+ * next looked up, or pushed out by LRU.
+ *
+ * The memory is charged to the UM memory limit (TotalUmMemory).
+ */
+class ResultCache
+{
+public:
+    /** @brief The messages a tuple query sends for table 100, in order */
+    struct Result
+    {
+        Result() : rowCount(0), bytes(0) { }
+
+        messageqcpp::ByteStream rowGroup;               // the output RowGroup
+        std::vector<messageqcpp::ByteStream> bands;     // ends with the empty band
+        uint64_t rowCount;
+        uint64_t bytes;
+    };
+    typedef boost::shared_ptr<Result> ResultPtr;
+
+    ResultCache(uint64_t maxBytes, uint64_t maxEntryBytes, joblist::ResourceManager* rm);
+    virtual ~ResultCache();
+
+    /** @brief Builds the key of a query & the version of the data it reads.
+     *
+     * Returns false if the result can't be cached: it's not a user SELECT, it's
+     * part of an explicit transaction or traced, it calls a non-deterministic
+     * function, or the data it reads is being modified.
+     */
+    bool makeKey(const execplan::CalpontSelectExecutionPlan& csep, std::string& key, uint64_t& version);
+
+    /** @brief Returns the version of the data the plan reads, false if it's being modified */
+    bool dataVersion(const execplan::CalpontSelectExecutionPlan& csep, uint64_t& version);
+
+    /** @brief Returns the cached result, or an empty pointer if there's none for this version */
+    ResultPtr lookup(const std::string& key, uint64_t version);
+
+    /** @brief Adds a result, replacing any older version of it */
+    void store(const std::string& key, uint64_t version, const ResultPtr& result);
+
+    void clear();
+
+    uint64_t maxEntryBytes() const
+    {
+        return fMaxEntryBytes;
+    }
+
+private:
+    struct Entry
+    {
+        std::string key;
+        uint64_t version;
+        ResultPtr result;
+    };
+    typedef std::list<Entry> EntryList;
+    typedef std::tr1::unordered_map<std::string, EntryList::iterator> EntryMap;
+
+    ResultCache(const ResultCache&);
+    ResultCache& operator=(const ResultCache&);
+
+    // call with fMutex held
+    void erase(EntryList::iterator it);
+
+    boost::mutex fMutex;
+    EntryList fLRU;         // most recently used first
+    EntryMap fEntries;
+    uint64_t fMaxEntryBytes;
+    joblist::ResourceManager* fRm;
+    boost::shared_ptr<int64_t> fMemLimit;   // what's left of the cache's size limit
+};
+
+#endif
+// vim:ts=4 sw=4:
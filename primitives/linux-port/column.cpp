@@ -215,6 +215,9 @@ bool isLike(const char* val, const idb_regex_t* regex)
     if (!regex)
         throw runtime_error("PrimitiveProcessor::isLike: Missing regular expression for LIKE operator");
 
+    if (regex->matcher.literal())
+        return regex->matcher.match(val, strlen(val));
+
 #ifdef POSIX_REGEX
     return (regexec(&regex->regex, val, 0, NULL, 0) == 0);
 #else
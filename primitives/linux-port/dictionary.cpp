@@ -515,6 +515,13 @@ inline bool PrimitiveProcessor::isEscapedChar(char c)
 //FIXME: copy/pasted to dataconvert.h: refactor
 int PrimitiveProcessor::convertToRegexp(idb_regex_t* regex, const p_DataValue* str)
 {
+    // 'abc%', '%abc%' and the like are matched without a regex, see isLike()
+    if (regex->matcher.compileLike(reinterpret_cast<const char*>(str->data), str->len))
+    {
+        regex->used = true;
+        return 0;
+    }
+
     //In the worst case, every char is quadrupled, plus some leading/trailing cruft...
     char* cBuf = new char[(4 * str->len) + 3];
     char c;
@@ -603,6 +610,14 @@ int PrimitiveProcessor::convertToRegexp(idb_regex_t* regex, const p_DataValue* s
 
 bool PrimitiveProcessor::isLike(const p_DataValue* dict, const idb_regex_t* regex) throw()
 {
+    if (regex->matcher.literal())
+    {
+        // regexec() stops at the first null, so does the literal match
+        const char* data = reinterpret_cast<const char*>(dict->data);
+        const void* nul = memchr(data, 0, dict->len);
+        return regex->matcher.match(data, nul ? static_cast<const char*>(nul) - data : dict->len);
+    }
+
 #ifdef POSIX_REGEX
     char* cBuf = new char[dict->len + 1];
     memcpy(cBuf, dict->data, dict->len);
@@ -701,8 +716,8 @@ void PrimitiveProcessor::p_Dictionary(const DictInput* in,
         // do aggregate processing
         if (in->OutputType & OT_AGGREGATE)
         {
-            // len == 0 indicates this is the first pass
-            if (max.len != 0)
+            // aggCount == 0 indicates this is the first pass; the strings may be empty
+            if (aggCount != 0)
             {
                 tmp = cs->strnncollsp(sigptr.data, sigptr.len, max.data, max.len);
 
@@ -712,7 +727,7 @@ void PrimitiveProcessor::p_Dictionary(const DictInput* in,
             else
                 max = sigptr;
 
-            if (min.len != 0)
+            if (aggCount != 0)
             {
                 tmp = cs->strnncollsp(sigptr.data, sigptr.len, min.data, min.len);
 
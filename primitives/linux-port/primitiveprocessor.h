@@ -51,6 +51,7 @@
 #include "stats.h"
 #include "primproc.h"
 #include "hasher.h"
+#include "likematcher.h"
 
 class PrimTest;
 
@@ -133,12 +134,14 @@ struct idb_regex_t
     boost::regex regex;
 #endif
     bool used;
+    // takes the place of regex when the pattern has no single char wildcard
+    utils::LikeMatcher matcher;
     idb_regex_t() : used(false) { }
     ~idb_regex_t()
     {
 #ifdef POSIX_REGEX
 
-        if (used)
+        if (used && !matcher.literal())
             regfree(&regex);
 
 #endif
@@ -124,8 +124,19 @@ BatchPrimitiveProcessor::BatchPrimitiveProcessor() :
     hasFilterStep(false),
     filtOnString(false),
     prefetchThreshold(0),
+    shuffleJoin(false),
+    processingShuffle(false),
+    shufflePart(0),
+    shuffleMsgsSent(0),
+    jobPriority(0),
     hasDictStep(false),
+    topNCount(0),
+    topNHaveThreshold(false),
+    aggMode(AGG_SAMPLING),
+    aggRowsIn(0),
+    aggFlushes(0),
     sockIndex(0),
+    pmIndex(0),
     endOfJoinerRan(false),
     processorThreads(0),
     ptMask(0),
@@ -170,8 +181,19 @@ BatchPrimitiveProcessor::BatchPrimitiveProcessor(ByteStream& b, double prefetch,
     hasFilterStep(false),
     filtOnString(false),
     prefetchThreshold(prefetch),
+    shuffleJoin(false),
+    processingShuffle(false),
+    shufflePart(0),
+    shuffleMsgsSent(0),
+    jobPriority(0),
     hasDictStep(false),
+    topNCount(0),
+    topNHaveThreshold(false),
+    aggMode(AGG_SAMPLING),
+    aggRowsIn(0),
+    aggFlushes(0),
     sockIndex(0),
+    pmIndex(0),
     endOfJoinerRan(false),
     processorThreads(_processorThreads),
     //processorThreads(32),
@@ -243,6 +265,7 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
     hasRowGroup = tmp16 & HAS_ROWGROUP;
     getTupleJoinRowGroupData = tmp16 & JOIN_ROWGROUP_DATA;
     bool hasWideColumnsIn = tmp16 & HAS_WIDE_COLUMNS;
+    shuffleJoin = tmp16 & SHUFFLE_JOIN;
 
     // This used to signify that there was input row data from previous jobsteps, and
     // it never quite worked right. No need to fix it or update it; all BPP's have started
@@ -407,6 +430,16 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
                 bs >> joinedRG;
 // 				cout << "got the joined Rowgroup: " << joinedRG.toString() << "\n";
             }
+
+            if (shuffleJoin)
+            {
+                uint32_t partCount;
+
+                bs >> shufflePart;
+                bs >> partCount;
+                deserializeVector(bs, shufflePeers);
+                idbassert(joinerCount == 1 && shufflePeers.size() == partCount);
+            }
         }
 
 #ifdef __FreeBSD__
@@ -486,6 +519,28 @@ void BatchPrimitiveProcessor::initBPP(ByteStream& bs)
                 }
             }
         }
+
+        bs >> tmp8;
+
+        if (tmp8 > 0)
+        {
+            uint32_t specCount;
+            int32_t tmp32;
+
+            bs >> topNCount;
+            bs >> specCount;
+            topNSpecs.resize(specCount);
+
+            for (i = 0; i < specCount; i++)
+            {
+                bs >> tmp32;
+                topNSpecs[i].fIndex = tmp32;
+                bs >> tmp32;
+                topNSpecs[i].fAsc = tmp32;
+                bs >> tmp32;
+                topNSpecs[i].fNf = tmp32;
+            }
+        }
     }
 
     initProcessor();
@@ -506,9 +561,11 @@ void BatchPrimitiveProcessor::resetBPP(ByteStream& bs, const SP_UM_MUTEX& w,
     writelock = w;
     sock = s;
     newConnection = true;
+    pmIndex = ((const ISMPacketHeader*) bs.buf())->Interleave;
 
-    // skip the header, sessionID, stepID, uniqueID, and priority
-    bs.advance(sizeof(ISMPacketHeader) + 16);
+    // skip the header, sessionID, stepID, and uniqueID
+    bs.advance(sizeof(ISMPacketHeader) + 12);
+    bs >> jobPriority;
     bs >> dbRoot;
     bs >> count;
     bs >> ridCount;
@@ -552,6 +609,26 @@ void BatchPrimitiveProcessor::resetBPP(ByteStream& bs, const SP_UM_MUTEX& w,
         projectSteps[i]->resetCommand(bs);
     }
 
+    // the UM's current top-N threshold, if it has one
+    if (topNCount > 0)
+    {
+        uint8_t tmp8;
+        bs >> tmp8;
+
+        if (tmp8)
+        {
+            RGData umThreshold;
+            RowGroup rg = topNThresholdRG;
+            Row r;
+
+            umThreshold.deserialize(bs);
+            rg.setData(&umThreshold);
+            rg.initRow(&r);
+            rg.getRow(0, &r);
+            offerTopNThreshold(r);
+        }
+    }
+
     idbassert(bs.length() == 0);
 
     /* init vars not part of the BS */
@@ -958,6 +1035,13 @@ void BatchPrimitiveProcessor::initProcessor()
 
                 joinFEMappings[joinerCount] = makeMapping(largeSideRG, *joinFERG);
             }
+
+            if (shuffleJoin)
+            {
+                shuffleRG = outputRG;
+                shuffleRG.initRow(&shuffleRow);
+                shuffleData.reset(new scoped_ptr<RGData>[shufflePeers.size()]);
+            }
         }
 
         /*
@@ -1109,6 +1193,23 @@ void BatchPrimitiveProcessor::initProcessor()
         min128Val = datatypes::Decimal::maxInt128;
     }
 
+    if (topNCount > 0)
+    {
+        RowGroup& topNRG = (fe2 ? fe2Output : outputRG);
+
+        topNOrder.reset(new ordering::OrderByData(topNSpecs, topNRG));
+        topNRG.initRow(&topNRow);
+        topNRG.initRow(&topNRow2);
+        topNThresholdRG = topNRG;
+        topNThresholdData.reinit(topNThresholdRG, 1);
+        topNThresholdRG.setData(&topNThresholdData);
+        topNThresholdRG.resetRowGroup(0);
+        topNThresholdRG.initRow(&topNThreshold);
+        topNThresholdRG.getRow(0, &topNThreshold);
+        topNHaveThreshold = false;
+        topNHeap.reserve(topNCount);
+    }
+
     // @bug 1269, initialize data used by execute() for async loading blocks
     // +1 for the scan filter step with no predicate, if any
     relLBID.reset(new uint64_t[projectCount + 1]);
@@ -1610,7 +1711,7 @@ void BatchPrimitiveProcessor::execute()
                    Valgrind will legitimately complain about copying uninit'd values for the
                    other types but that is technically safe. */
                 for (j = 0; j < projectCount; j++)
-                    if (keyColumnProj[j] || (projectionMap[j] != -1 && (hasJoinFEFilters ||
+                    if (keyColumnProj[j] || (projectionMap[j] != -1 && (hasJoinFEFilters || shuffleJoin ||
                         oldRow.isLongString(projectionMap[j]))))
                     {
 #ifdef PRIMPROC_STOPWATCH
@@ -1623,6 +1724,10 @@ void BatchPrimitiveProcessor::execute()
                     }
 
 
+                // rows with keys another PM owns get sent there, shuffled rows need every column
+                if (shuffleJoin)
+                    shuffleRows((currentBlockOffset + 1) == count);
+
 #ifdef PRIMPROC_STOPWATCH
                 stopwatch->start("-- executeTupleJoin()");
                 executeTupleJoin();
@@ -1634,7 +1739,7 @@ void BatchPrimitiveProcessor::execute()
                 /* project the non-key columns */
                 for (j = 0; j < projectCount; ++j)
                 {
-                    if (projectionMap[j] != -1 && !keyColumnProj[j] && !hasJoinFEFilters &&
+                    if (projectionMap[j] != -1 && !keyColumnProj[j] && !hasJoinFEFilters && !shuffleJoin &&
                         !oldRow.isLongString(projectionMap[j]))
                     {
 #ifdef PRIMPROC_STOPWATCH
@@ -1648,183 +1753,7 @@ void BatchPrimitiveProcessor::execute()
                 }
             }
 
-            /* The RowGroup is fully joined at this point.
-            Add additional RowGroup processing here.
-            TODO:  Try to clean up all of the switching */
-
-            if (doJoin && (fe2 || fAggregator))
-            {
-                bool moreRGs = true;
-                ByteStream preamble = *serialized;
-                initGJRG();
-
-                while (moreRGs && !sendThread->aborted())
-                {
-                    /*
-                    	generate 1 rowgroup (8192 rows max) of joined rows
-                    	if there's an FE2, run it
-                    		-pack results into a new rowgroup
-                    		-if there are < 8192 rows in the new RG, continue
-                    	if there's an agg, run it
-                    	send the result
-                    */
-                    resetGJRG();
-                    moreRGs = generateJoinedRowGroup(baseJRow);
-                    *serialized << (uint8_t) !moreRGs;
-
-                    if (fe2)
-                    {
-                        /* functionize this -> processFE2()*/
-                        fe2Output.resetRowGroup(baseRid);
-                        fe2Output.setDBRoot(dbRoot);
-                        fe2Output.getRow(0, &fe2Out);
-                        fe2Input->getRow(0, &fe2In);
-
-                        for (j = 0; j < joinedRG.getRowCount(); j++, fe2In.nextRow())
-                            if (fe2->evaluate(&fe2In))
-                            {
-                                applyMapping(fe2Mapping, fe2In, &fe2Out);
-                                fe2Out.setRid(fe2In.getRelRid());
-                                fe2Output.incRowCount();
-                                fe2Out.nextRow();
-                            }
-                    }
-
-                    RowGroup& nextRG = (fe2 ? fe2Output : joinedRG);
-                    nextRG.setDBRoot(dbRoot);
-
-                    if (fAggregator)
-                    {
-                        fAggregator->addRowGroup(&nextRG);
-
-                        if ((currentBlockOffset + 1) == count && moreRGs == false)  // @bug4507, 8k
-                        {
-                            fAggregator->loadResult(*serialized);                   // @bug4507, 8k
-                        }                                                           // @bug4507, 8k
-                        else if (utils::MonitorProcMem::isMemAvailable())           // @bug4507, 8k
-                        {
-                            fAggregator->loadEmptySet(*serialized);                 // @bug4507, 8k
-                        }                                                           // @bug4507, 8k
-                        else                                                        // @bug4507, 8k
-                        {
-                            fAggregator->loadResult(*serialized);                   // @bug4507, 8k
-                            fAggregator->aggReset();                                // @bug4507, 8k
-                        }                                                           // @bug4507, 8k
-                    }
-                    else
-                    {
-                        //cerr <<" * serialzing " << nextRG.toString() << endl;
-                        nextRG.serializeRGData(*serialized);
-                    }
-
-                    /* send the msg & reinit the BS */
-                    if (moreRGs)
-                    {
-                        sendResponse();
-                        serialized.reset(new ByteStream());
-                        *serialized = preamble;
-                    }
-                }
-
-                if (hasSmallOuterJoin)
-                {
-                    *serialized << ridCount;
-
-                    for (i = 0; i < joinerCount; i++)
-                        for (j = 0; j < ridCount; ++j)
-                            serializeInlineVector<uint32_t>(*serialized,
-                                                            tSmallSideMatches[i][j]);
-                }
-            }
-
-            if (!doJoin && fe2)
-            {
-                /* functionize this -> processFE2() */
-                fe2Output.resetRowGroup(baseRid);
-                fe2Output.getRow(0, &fe2Out);
-                fe2Input->getRow(0, &fe2In);
-
-                //cerr << "input row: " << fe2In.toString() << endl;
-                for (j = 0; j < outputRG.getRowCount(); j++, fe2In.nextRow())
-                {
-                    if (fe2->evaluate(&fe2In))
-                    {
-                        applyMapping(fe2Mapping, fe2In, &fe2Out);
-                        //cerr << "   passed. output row: " << fe2Out.toString() << endl;
-                        fe2Out.setRid (fe2In.getRelRid());
-                        fe2Output.incRowCount();
-                        fe2Out.nextRow();
-                    }
-                }
-
-                if (!fAggregator)
-                {
-                    *serialized << (uint8_t) 1;  // the "count this msg" var
-                    fe2Output.setDBRoot(dbRoot);
-                    fe2Output.serializeRGData(*serialized);
-                    //*serialized << fe2Output.getDataSize();
-                    //serialized->append(fe2Output.getData(), fe2Output.getDataSize());
-                }
-            }
-
-            if (!doJoin && fAggregator)
-            {
-                *serialized << (uint8_t) 1;  // the "count this msg" var
-
-                RowGroup& toAggregate = (fe2 ? fe2Output : outputRG);
-                //toAggregate.convertToInlineDataInPlace();
-
-                if (fe2)
-                    fe2Output.setDBRoot(dbRoot);
-                else
-                    outputRG.setDBRoot(dbRoot);
-
-                fAggregator->addRowGroup(&toAggregate);
-
-                if ((currentBlockOffset + 1) == count)                    // @bug4507, 8k
-                {
-                    fAggregator->loadResult(*serialized);                 // @bug4507, 8k
-                }                                                         // @bug4507, 8k
-                else if (utils::MonitorProcMem::isMemAvailable())         // @bug4507, 8k
-                {
-                    fAggregator->loadEmptySet(*serialized);               // @bug4507, 8k
-                }                                                         // @bug4507, 8k
-                else                                                      // @bug4507, 8k
-                {
-                    fAggregator->loadResult(*serialized);                 // @bug4507, 8k
-                    fAggregator->aggReset();                              // @bug4507, 8k
-                }                                                         // @bug4507, 8k
-            }
-
-            if (!fAggregator && !fe2)
-            {
-                *serialized << (uint8_t) 1;  // the "count this msg" var
-                outputRG.setDBRoot(dbRoot);
-                //cerr << "serializing " << outputRG.toString() << endl;
-                outputRG.serializeRGData(*serialized);
-
-                //*serialized << outputRG.getDataSize();
-                //serialized->append(outputRG.getData(), outputRG.getDataSize());
-                if (doJoin)
-                {
-                    for (i = 0; i < joinerCount; i++)
-                    {
-                        for (j = 0; j < ridCount; ++j)
-                        {
-                            serializeInlineVector<uint32_t>(*serialized,
-                                                            tSmallSideMatches[i][j]);
-                        }
-                    }
-                }
-            }
-
-            // clear small side match vector
-            if (doJoin)
-            {
-                for (i = 0; i < joinerCount; i++)
-                    for (j = 0; j < ridCount; ++j)
-                        tSmallSideMatches[i][j].clear();
-            }
+            finishRowGroup((currentBlockOffset + 1) == count);
 
 #ifdef PRIMPROC_STOPWATCH
             stopwatch->stop("- if(ot != ROW_GROUP) else");
@@ -1839,6 +1768,19 @@ void BatchPrimitiveProcessor::execute()
             physIO = 0;
             *serialized << touchedBlocks;
             touchedBlocks = 0;
+
+            if (fAggregator)
+            {
+                *serialized << aggFlushes;
+                aggFlushes = 0;
+            }
+
+            if (shuffleJoin)
+            {
+                *serialized << shuffleMsgsSent;
+                shuffleMsgsSent = 0;
+            }
+
 // 		cout << "sent physIO=" << physIO << " cachedIO=" << cachedIO <<
 // 			" touchedBlocks=" << touchedBlocks << endl;
         }
@@ -1940,6 +1882,544 @@ void BatchPrimitiveProcessor::execute()
     }
 }
 
+/* The RowGroup is fully joined at this point, serialize the response.  lastRG is
+   true for the last one of a job, that's when an aggregation sends its result.
+   Add additional RowGroup processing here.
+   TODO:  Try to clean up all of the switching */
+void BatchPrimitiveProcessor::finishRowGroup(bool lastRG)
+{
+    uint32_t i, j;
+
+    if (doJoin && (fe2 || fAggregator))
+    {
+        bool moreRGs = true;
+        ByteStream preamble = *serialized;
+        initGJRG();
+
+        while (moreRGs && !sendThread->aborted())
+        {
+            /*
+            	generate 1 rowgroup (8192 rows max) of joined rows
+            	if there's an FE2, run it
+            		-pack results into a new rowgroup
+            		-if there are < 8192 rows in the new RG, continue
+            	if there's an agg, run it
+            	send the result
+            */
+            resetGJRG();
+            moreRGs = generateJoinedRowGroup(baseJRow);
+            *serialized << (uint8_t) (!moreRGs && !processingShuffle);
+
+            if (fe2)
+            {
+                /* functionize this -> processFE2()*/
+                fe2Output.resetRowGroup(baseRid);
+                fe2Output.setDBRoot(dbRoot);
+                fe2Output.getRow(0, &fe2Out);
+                fe2Input->getRow(0, &fe2In);
+
+                for (j = 0; j < joinedRG.getRowCount(); j++, fe2In.nextRow())
+                    if (fe2->evaluate(&fe2In))
+                    {
+                        applyMapping(fe2Mapping, fe2In, &fe2Out);
+                        fe2Out.setRid(fe2In.getRelRid());
+                        fe2Output.incRowCount();
+                        fe2Out.nextRow();
+                    }
+            }
+
+            RowGroup& nextRG = (fe2 ? fe2Output : joinedRG);
+            nextRG.setDBRoot(dbRoot);
+
+            if (fAggregator)
+            {
+                aggregateRG(nextRG, lastRG && moreRGs == false);
+            }
+            else
+            {
+                //cerr <<" * serialzing " << nextRG.toString() << endl;
+                nextRG.serializeRGData(*serialized);
+            }
+
+            /* send the msg & reinit the BS */
+            if (moreRGs)
+            {
+                if (shuffleJoin)
+                    *serialized << (processingShuffle ? SHUFFLE_MSG_PART : SHUFFLE_MSG_NONE);
+
+                sendResponse();
+                serialized.reset(new ByteStream());
+                *serialized = preamble;
+            }
+        }
+
+        if (hasSmallOuterJoin)
+        {
+            *serialized << ridCount;
+
+            for (i = 0; i < joinerCount; i++)
+                for (j = 0; j < ridCount; ++j)
+                    serializeInlineVector<uint32_t>(*serialized,
+                                                    tSmallSideMatches[i][j]);
+        }
+    }
+
+    if (!doJoin && fe2)
+    {
+        /* functionize this -> processFE2() */
+        fe2Output.resetRowGroup(baseRid);
+        fe2Output.getRow(0, &fe2Out);
+        fe2Input->getRow(0, &fe2In);
+
+        //cerr << "input row: " << fe2In.toString() << endl;
+        for (j = 0; j < outputRG.getRowCount(); j++, fe2In.nextRow())
+        {
+            if (fe2->evaluate(&fe2In))
+            {
+                applyMapping(fe2Mapping, fe2In, &fe2Out);
+                //cerr << "   passed. output row: " << fe2Out.toString() << endl;
+                fe2Out.setRid (fe2In.getRelRid());
+                fe2Output.incRowCount();
+                fe2Out.nextRow();
+            }
+        }
+
+        if (!fAggregator)
+        {
+            if (topNCount > 0)
+                applyTopN(fe2Output);
+
+            *serialized << (uint8_t) 1;  // the "count this msg" var
+            fe2Output.setDBRoot(dbRoot);
+            fe2Output.serializeRGData(*serialized);
+            //*serialized << fe2Output.getDataSize();
+            //serialized->append(fe2Output.getData(), fe2Output.getDataSize());
+        }
+    }
+
+    if (!doJoin && fAggregator)
+    {
+        *serialized << (uint8_t) 1;  // the "count this msg" var
+
+        RowGroup& toAggregate = (fe2 ? fe2Output : outputRG);
+        //toAggregate.convertToInlineDataInPlace();
+
+        if (fe2)
+            fe2Output.setDBRoot(dbRoot);
+        else
+            outputRG.setDBRoot(dbRoot);
+
+        aggregateRG(toAggregate, lastRG);
+    }
+
+    if (!fAggregator && !fe2)
+    {
+        if (topNCount > 0 && !doJoin)
+            applyTopN(outputRG);
+
+        *serialized << (uint8_t) (processingShuffle ? 0 : 1);  // the "count this msg" var
+        outputRG.setDBRoot(dbRoot);
+        //cerr << "serializing " << outputRG.toString() << endl;
+        outputRG.serializeRGData(*serialized);
+
+        //*serialized << outputRG.getDataSize();
+        //serialized->append(outputRG.getData(), outputRG.getDataSize());
+        if (doJoin)
+        {
+            for (i = 0; i < joinerCount; i++)
+            {
+                for (j = 0; j < ridCount; ++j)
+                {
+                    serializeInlineVector<uint32_t>(*serialized,
+                                                    tSmallSideMatches[i][j]);
+                }
+            }
+        }
+    }
+
+    // clear small side match vector
+    if (doJoin)
+    {
+        for (i = 0; i < joinerCount; i++)
+            for (j = 0; j < ridCount; ++j)
+                tSmallSideMatches[i][j].clear();
+    }
+}
+
+namespace
+{
+/* Connections to the other PrimProcs for shuffle joins, shared by every BPP.
+   A connection is made on first use and dropped if a write fails. */
+struct ShufflePeer
+{
+    boost::mutex lock;
+    boost::scoped_ptr<MessageQueueClient> client;
+};
+
+boost::mutex shufflePeerMapLock;
+map<string, boost::shared_ptr<ShufflePeer> > shufflePeerMap;
+
+boost::shared_ptr<ShufflePeer> getShufflePeer(const string& name)
+{
+    boost::mutex::scoped_lock lk(shufflePeerMapLock);
+    boost::shared_ptr<ShufflePeer>& peer = shufflePeerMap[name];
+
+    if (!peer)
+        peer.reset(new ShufflePeer());
+
+    return peer;
+}
+}
+
+/* Moves the rows whose key belongs to another partition out of outputRG & into
+   that partition's buffer.  The rows that stay are compacted in place, the same
+   way executeTupleJoin() does it.  A NULL key can't match anything so it stays. */
+void BatchPrimitiveProcessor::shuffleRows(bool lastBlock)
+{
+    uint32_t i, part, newRowCount = 0;
+    uint32_t partCount = shufflePeers.size();
+    TypelessData tlKey;
+
+    outputRG.getRow(0, &oldRow);
+    outputRG.getRow(0, &newRow);
+
+    for (i = 0; i < ridCount; i++, oldRow.nextRow())
+    {
+        if (!typelessJoin[0])
+        {
+            uint32_t colIndex = largeSideKeyColumns[0];
+            uint64_t key = (oldRow.isUnsigned(colIndex) ? oldRow.getUintField(colIndex) :
+                            oldRow.getIntField(colIndex));
+
+            part = (oldRow.isNullValue(colIndex) ? shufflePart : shufflePartition(key, partCount));
+        }
+        else
+        {
+            tlKey = makeTypelessKey(oldRow, tlLargeSideKeyColumns[0], tlKeyLengths[0],
+                                    &tmpKeyAllocators[0]);
+            part = (tlKey.len == 0 ? shufflePart :
+                    shufflePartition(tlKey.hash(outputRG, tlLargeSideKeyColumns[0]), partCount));
+        }
+
+        if (part == shufflePart)
+        {
+            if (newRowCount != i)
+            {
+                relRids[newRowCount] = relRids[i];
+                values[newRowCount] = values[i];
+                copyRow(oldRow, &newRow);
+            }
+
+            newRowCount++;
+            newRow.nextRow();
+            continue;
+        }
+
+        if (!shuffleData[part])
+        {
+            shuffleData[part].reset(new RGData(shuffleRG));
+            shuffleRG.setData(shuffleData[part].get());
+            shuffleRG.resetRowGroup(0);
+        }
+        else
+            shuffleRG.setData(shuffleData[part].get());
+
+        shuffleRG.getRow(shuffleRG.getRowCount(), &shuffleRow);
+        copyRow(oldRow, &shuffleRow);
+        shuffleRG.incRowCount();
+
+        if (shuffleRG.getRowCount() == LOGICAL_BLOCK_RIDS)
+            sendShuffleData(part);
+    }
+
+    ridCount = newRowCount;
+    outputRG.setRowCount(ridCount);
+
+    // the partially filled buffers go out with the job's last block, then get freed
+    if (lastBlock)
+    {
+        for (part = 0; part < partCount; part++)
+        {
+            if (!shuffleData[part])
+                continue;
+
+            shuffleRG.setData(shuffleData[part].get());
+
+            if (shuffleRG.getRowCount() > 0)
+                sendShuffleData(part);
+
+            shuffleData[part].reset();
+        }
+    }
+}
+
+/* Sends the buffered rows for a partition to the PrimProc that owns it.  The
+   message looks like a BPP run for the job, so the peer can schedule it the same way. */
+void BatchPrimitiveProcessor::sendShuffleData(uint32_t part)
+{
+    ISMPacketHeader ism;
+    ByteStream msg;
+
+    shuffleRG.setData(shuffleData[part].get());
+    ism.Command = BATCH_PRIMITIVE_SHUFFLE;
+    ism.Size = 1;   // the job weight, joining one row group
+    msg.append((uint8_t*) &ism, sizeof(ism));
+    msg << sessionID;
+    msg << stepID;
+    msg << uniqueID;
+    msg << jobPriority;
+    msg << dbRoot;
+    shuffleRG.serializeRGData(msg);
+
+    boost::shared_ptr<ShufflePeer> peer = getShufflePeer(shufflePeers[part]);
+    boost::mutex::scoped_lock lk(peer->lock);
+
+    try
+    {
+        if (!peer->client)
+            peer->client.reset(new MessageQueueClient(shufflePeers[part]));
+
+        peer->client->write(msg);
+    }
+    catch (...)
+    {
+        peer->client.reset();
+        throw;
+    }
+
+    lk.unlock();
+    shuffleRG.resetRowGroup(0);
+    shuffleMsgsSent++;
+}
+
+/* Joins rows another PM shuffled here.  They were filtered & projected there, so
+   this is the back half of execute().  The responses aren't counted by the UM as
+   a block of the scan, the last one is marked so the UM can tell it's done. */
+void BatchPrimitiveProcessor::processShuffle(ByteStream& bs, const SP_UM_IOSOCK& s,
+        const SP_UM_MUTEX& w)
+{
+    RGData incoming;
+    uint32_t i;
+    Row r;
+
+#ifndef __FreeBSD__
+    pthread_mutex_lock(&objLock);
+#endif
+    sock = s;
+    writelock = w;
+    newConnection = true;
+
+    bs.advance(sizeof(ISMPacketHeader) + 12);
+    bs >> jobPriority;
+    bs >> dbRoot;
+    incoming.deserialize(bs, true);
+
+    allocLargeBuffers();
+    outputRG.setData(&incoming);
+    ridCount = outputRG.getRowCount();
+    baseRid = outputRG.getBaseRid();
+    outputRG.initRow(&r);
+    outputRG.getRow(0, &r);
+
+    for (i = 0; i < ridCount; i++, r.nextRow())
+    {
+        relRids[i] = r.getRelRid();
+        values[i] = 0;
+    }
+
+    if (fAggregator)
+    {
+        fAggregator->aggReset();
+        aggRowsIn = 0;
+    }
+
+    processingShuffle = true;
+    validCPData = false;
+    lbidForCP = 0;
+
+    try
+    {
+        writeProjectionPreamble();
+        executeTupleJoin();
+        finishRowGroup(true);
+        *serialized << SHUFFLE_MSG_LAST;
+    }
+    catch (std::exception& e)
+    {
+        writeErrorMsg(e.what(), logging::batchPrimitiveProcessorErr);
+    }
+    catch (...)
+    {
+        string msg("BatchPrimitiveProcessor caught an unknown exception");
+        writeErrorMsg(msg, logging::batchPrimitiveProcessorErr);
+    }
+
+    try
+    {
+        sendResponse();
+    }
+    catch (std::exception& e)
+    {
+        cerr << "BPP::processShuffle(): " << e.what() << endl;
+    }
+
+    processingShuffle = false;
+    outputRG.setData(outRowGroupData.get());
+#ifndef __FreeBSD__
+    pthread_mutex_unlock(&objLock);
+#endif
+    freeLargeBuffers();
+    fBusy = false;
+}
+
+namespace
+{
+// rows to aggregate before judging how well the GROUP BY reduces them
+const uint64_t AGG_SAMPLE_ROWS = 65536;
+// reduction is poor if the groups are more than this percentage of the rows
+const uint64_t AGG_POOR_REDUCTION_PCT = 50;
+// group count at which a bounded-mode aggregator is flushed
+const uint64_t AGG_BOUNDED_GROUPS = 8192;
+}
+
+void BatchPrimitiveProcessor::aggregateRG(RowGroup& rg, bool lastRG)
+{
+    bool flush;
+
+    fAggregator->addRowGroup(&rg);
+    aggRowsIn += rg.getRowCount();
+
+    if (aggMode == AGG_SAMPLING && aggRowsIn >= AGG_SAMPLE_ROWS && !fAggregator->getGroupByCols().empty())
+    {
+        if (fAggregator->getGroupCount() * 100 > aggRowsIn * AGG_POOR_REDUCTION_PCT)
+            aggMode = AGG_BOUNDED;
+        else
+            aggMode = AGG_FULL;
+    }
+
+    flush = (aggMode == AGG_BOUNDED && fAggregator->getGroupCount() >= AGG_BOUNDED_GROUPS);
+
+    // @bug4507, send what's there and start over if memory is short
+    if (lastRG)
+    {
+        fAggregator->loadResult(*serialized);
+    }
+    else if (!flush && utils::MonitorProcMem::isMemAvailable())
+    {
+        fAggregator->loadEmptySet(*serialized);
+    }
+    else
+    {
+        if (flush)
+        {
+            aggFlushes++;
+
+            // the data got more clustered, the full hash table pays off again
+            if (fAggregator->getGroupCount() * 100 <= aggRowsIn * AGG_POOR_REDUCTION_PCT)
+                aggMode = AGG_FULL;
+        }
+
+        fAggregator->loadResult(*serialized);
+        fAggregator->aggReset();
+        aggRowsIn = 0;
+    }
+}
+
+namespace
+{
+// orders (row, index) pairs by the top-N sort spec, the worst row ends up on top of the heap
+struct TopNLess
+{
+    ordering::OrderByData* order;
+    TopNLess(ordering::OrderByData* o) : order(o) { }
+    bool operator()(const pair<Row::Pointer, uint32_t>& a, const pair<Row::Pointer, uint32_t>& b) const
+    {
+        return (*order)(a.first, b.first);
+    }
+};
+
+struct TopNByPosition
+{
+    bool operator()(const pair<Row::Pointer, uint32_t>& a, const pair<Row::Pointer, uint32_t>& b) const
+    {
+        return a.second < b.second;
+    }
+};
+}
+
+void BatchPrimitiveProcessor::applyTopN(RowGroup& rg)
+{
+    uint32_t i, rowCount = rg.getRowCount();
+    TopNLess less(topNOrder.get());
+
+    if (rowCount == 0)
+        return;
+
+    topNHeap.clear();
+    rg.getRow(0, &topNRow);
+
+    for (i = 0; i < rowCount; i++, topNRow.nextRow())
+    {
+        pair<Row::Pointer, uint32_t> entry(topNRow.getPointer(), i);
+
+        // the UM already has topNCount rows at least as good as the threshold
+        if (topNHaveThreshold && !(*topNOrder)(entry.first, topNThreshold.getPointer()))
+            continue;
+
+        if (topNHeap.size() < topNCount)
+        {
+            topNHeap.push_back(entry);
+            push_heap(topNHeap.begin(), topNHeap.end(), less);
+        }
+        else if (less(entry, topNHeap.front()))
+        {
+            pop_heap(topNHeap.begin(), topNHeap.end(), less);
+            topNHeap.back() = entry;
+            push_heap(topNHeap.begin(), topNHeap.end(), less);
+        }
+    }
+
+    if (topNHeap.size() == topNCount)
+    {
+        topNRow.setPointer(topNHeap.front().first);
+        offerTopNThreshold(topNRow);
+    }
+
+    if (topNHeap.size() == rowCount)
+        return;
+
+    // compact the surviving rows to the front, preserving their order
+    sort(topNHeap.begin(), topNHeap.end(), TopNByPosition());
+    rg.getRow(0, &topNRow2);
+
+    for (i = 0; i < topNHeap.size(); i++, topNRow2.nextRow())
+    {
+        if (topNHeap[i].second == i)
+            continue;
+
+        rg.getRow(topNHeap[i].second, &topNRow);
+        copyRow(topNRow, &topNRow2);
+        topNRow2.setRid(topNRow.getRelRid());
+    }
+
+    rg.setRowCount(topNHeap.size());
+}
+
+void BatchPrimitiveProcessor::offerTopNThreshold(const Row& candidate)
+{
+    if (topNHaveThreshold && !(*topNOrder)(candidate.getPointer(), topNThreshold.getPointer()))
+        return;
+
+    // start from a fresh RGData so a string table doesn't keep the old values
+    topNThresholdData.reinit(topNThresholdRG, 1);
+    topNThresholdRG.setData(&topNThresholdData);
+    topNThresholdRG.resetRowGroup(0);
+    topNThresholdRG.getRow(0, &topNThreshold);
+    copyRow(candidate, &topNThreshold);
+    topNThresholdRG.setRowCount(1);
+    topNHaveThreshold = true;
+}
+
 void BatchPrimitiveProcessor::writeErrorMsg(const string& error, uint16_t errCode, bool logIt, bool critical)
 {
     ISMPacketHeader ism;
@@ -1979,6 +2459,7 @@ void BatchPrimitiveProcessor::writeProjectionPreamble()
     void *php = static_cast<void*>(&ph);
     memset(ismp, 0, sizeof(ISMPacketHeader));
     memset(php, 0, sizeof(PrimitiveHeader));
+    ism.Interleave = pmIndex;
     ph.SessionID = sessionID;
     ph.StepID = stepID;
     ph.UniqueID = uniqueID;
@@ -2196,7 +2677,10 @@ int BatchPrimitiveProcessor::operator()()
     }
 
     if (fAggregator && currentBlockOffset == 0)                     // @bug4507, 8k
+    {
         fAggregator->aggReset();                                    // @bug4507, 8k
+        aggRowsIn = 0;
+    }
 
     for (; currentBlockOffset < count; currentBlockOffset++)
     {
@@ -2413,6 +2897,9 @@ SBPP BatchPrimitiveProcessor::duplicate()
         bpp->doMatchNulls = doMatchNulls;
         bpp->hasJoinFEFilters = hasJoinFEFilters;
         bpp->hasSmallOuterJoin = hasSmallOuterJoin;
+        bpp->shuffleJoin = shuffleJoin;
+        bpp->shufflePart = shufflePart;
+        bpp->shufflePeers = shufflePeers;
 
         if (hasJoinFEFilters)
         {
@@ -2460,6 +2947,8 @@ SBPP BatchPrimitiveProcessor::duplicate()
         bpp->fAggregator->timeZone(fAggregator->timeZone());
     }
 
+    bpp->topNCount = topNCount;
+    bpp->topNSpecs = topNSpecs;
     bpp->sendRidsAtDelivery = sendRidsAtDelivery;
     bpp->prefetchThreshold = prefetchThreshold;
 
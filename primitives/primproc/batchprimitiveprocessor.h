@@ -51,6 +51,7 @@
 #include "rowgroup.h"
 #include "rowaggregation.h"
 #include "funcexpwrapper.h"
+#include "../../utils/windowfunction/idborderby.h"
 #include "bppsendthread.h"
 #include "columnwidth.h"
 
@@ -95,6 +96,8 @@ public:
     void initBPP(messageqcpp::ByteStream&);
     void resetBPP(messageqcpp::ByteStream&, const SP_UM_MUTEX& wLock, const SP_UM_IOSOCK& outputSock);
     void addToJoiner(messageqcpp::ByteStream&);
+    /* Joins a row group another PM shuffled here, the results go to the UM on sock */
+    void processShuffle(messageqcpp::ByteStream&, const SP_UM_IOSOCK& sock, const SP_UM_MUTEX& wLock);
     int endOfJoiner();
     void doneSendingJoinerData();
     int operator()();
@@ -177,6 +180,7 @@ private:
     void execute();
 #endif
     void writeProjectionPreamble();
+    void finishRowGroup(bool lastRG);
     void makeResponse();
     void sendResponse();
 
@@ -340,6 +344,21 @@ private:
     bool hasJoinFEFilters;
     bool hasSmallOuterJoin;
 
+    /* Shuffle join.  This PM holds partition shufflePart of the small side.  Large
+       side rows whose key belongs to another partition are buffered per partition
+       & sent to the PrimProc that owns it, which joins them & replies to the UM. */
+    void shuffleRows(bool lastBlock);
+    void sendShuffleData(uint32_t part);
+    bool shuffleJoin;
+    bool processingShuffle;    // joining rows from another PM
+    uint32_t shufflePart;
+    uint32_t shuffleMsgsSent;  // since the last counted response
+    uint32_t jobPriority;
+    std::vector<std::string> shufflePeers;
+    boost::scoped_array<boost::scoped_ptr<rowgroup::RGData> > shuffleData;  // per partition, on demand
+    rowgroup::RowGroup shuffleRG;
+    rowgroup::Row shuffleRow;
+
     /* extra typeless join vars & fcns*/
     boost::shared_array<bool> typelessJoin;
     boost::shared_array<std::vector<uint32_t> > tlLargeSideKeyColumns;
@@ -358,6 +377,16 @@ private:
     rowgroup::RGData fAggRowGroupData;
     //boost::scoped_array<uint8_t> fAggRowGroupData;
 
+    /* Adaptive PM aggregation.  The group count is sampled against the rows fed
+       to fAggregator; if the GROUP BY barely reduces the input, the hash table is
+       kept small by flushing partial results whenever it reaches a bounded size
+       instead of holding every group until the end of the job. */
+    enum AggMode { AGG_SAMPLING, AGG_FULL, AGG_BOUNDED };
+    void aggregateRG(rowgroup::RowGroup& rg, bool lastRG);
+    AggMode aggMode;
+    uint64_t aggRowsIn;      // rows added since the last aggReset()
+    uint32_t aggFlushes;     // bounded-mode flushes since the last response
+
     /* OR hacks */
     uint8_t bop;   // BOP_AND or BOP_OR
     bool hasPassThru;
@@ -376,6 +405,21 @@ private:
 
     bool hasDictStep;
 
+    /* Top-N pushdown for ORDER BY ... LIMIT.  Each block's result is cut down to
+       the topNCount best rows, and rows that can't beat a set of topNCount rows
+       already sent to the UM are dropped.  The worst row of such a set is the
+       threshold; the UM can send a tighter one with each job. */
+    void applyTopN(rowgroup::RowGroup& rg);
+    void offerTopNThreshold(const rowgroup::Row& candidate);
+    uint64_t topNCount;
+    std::vector<ordering::IdbSortSpec> topNSpecs;
+    boost::scoped_ptr<ordering::OrderByData> topNOrder;
+    rowgroup::RowGroup topNThresholdRG;
+    rowgroup::RGData topNThresholdData;
+    rowgroup::Row topNRow, topNRow2, topNThreshold;
+    bool topNHaveThreshold;
+    std::vector<std::pair<rowgroup::Row::Pointer, uint32_t> > topNHeap;
+
     primitives::PrimitiveProcessor pp;
 
     /* VSS cache members */
@@ -401,6 +445,9 @@ private:
 
     /* Shared nothing vars */
     uint32_t dbRoot;
+    // the PM index the UM sent the run to, echoed in the responses so it can
+    // track each PM's progress
+    uint32_t pmIndex;
 
     bool endOfJoinerRan;
     /* Some addJoiner() profiling stuff */
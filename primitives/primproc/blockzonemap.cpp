@@ -0,0 +1,221 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file blockzonemap.cpp
+ *
+ */
+
+#include "blockzonemap.h"
+
+using namespace std;
+
+namespace
+{
+boost::mutex instanceMutex;
+}
+
+namespace primitiveprocessor
+{
+
+BlockZoneMap* BlockZoneMap::instance()
+{
+    static BlockZoneMap* zoneMap = NULL;
+    boost::mutex::scoped_lock lk(instanceMutex);
+
+    if (zoneMap == NULL)
+        zoneMap = new BlockZoneMap();
+
+    return zoneMap;
+}
+
+BlockZoneMap::BlockZoneMap() : fShards(new Shard[ShardCount]), fShardCapacity(0)
+{
+}
+
+void BlockZoneMap::configure(uint64_t maxEntries)
+{
+    fShardCapacity = maxEntries / ShardCount;
+
+    if (maxEntries > 0 && fShardCapacity == 0)
+        fShardCapacity = 1;
+}
+
+bool BlockZoneMap::lookup(int64_t lbid, int32_t seqNum, int64_t* min, int64_t* max)
+{
+    Shard& shard = shardFor(lbid);
+    boost::mutex::scoped_lock lk(shard.mutex);
+    EntryMap::iterator it = shard.entries.find(lbid);
+
+    if (it == shard.entries.end())
+        return false;
+
+    // the extent changed since the range was recorded
+    if (it->second.seqNum != seqNum)
+    {
+        erase(shard, it);
+        return false;
+    }
+
+    it->second.referenced = true;
+    *min = it->second.min;
+    *max = it->second.max;
+    return true;
+}
+
+void BlockZoneMap::store(int64_t lbid, uint8_t colWidth, uint32_t oid, int32_t seqNum, int64_t min,
+                         int64_t max)
+{
+    Shard& shard = shardFor(lbid);
+    boost::mutex::scoped_lock lk(shard.mutex);
+    EntryMap::iterator it = shard.entries.find(lbid);
+
+    // a range stored again keeps its place on the clock
+    if (it == shard.entries.end())
+    {
+        uint32_t slot;
+
+        if (shard.entries.size() < fShardCapacity)
+        {
+            slot = shard.clock.size();
+            shard.clock.push_back(lbid);
+        }
+        else
+        {
+            // advance the hand to an entry that hasn't been looked up since it
+            // last passed, and take its slot
+            while (true)
+            {
+                Entry& victim = shard.entries[shard.clock[shard.hand]];
+
+                if (!victim.referenced)
+                    break;
+
+                victim.referenced = false;
+                shard.hand = (shard.hand + 1) % shard.clock.size();
+            }
+
+            slot = shard.hand;
+            shard.entries.erase(shard.clock[slot]);
+            shard.clock[slot] = lbid;
+            shard.hand = (shard.hand + 1) % shard.clock.size();
+        }
+
+        it = shard.entries.insert(make_pair(lbid, Entry())).first;
+        it->second.slot = slot;
+        it->second.referenced = false;
+    }
+
+    Entry& e = it->second;
+
+    e.min = min;
+    e.max = max;
+    e.oid = oid;
+    e.seqNum = seqNum;
+    e.colWidth = colWidth;
+}
+
+// Removes the entry and its place on the clock, the last key takes its slot.
+BlockZoneMap::EntryMap::iterator BlockZoneMap::erase(Shard& shard, EntryMap::iterator it)
+{
+    uint32_t slot = it->second.slot;
+    int64_t last = shard.clock.back();
+
+    if (last != it->first)
+    {
+        shard.clock[slot] = last;
+        shard.entries[last].slot = slot;
+    }
+
+    shard.clock.pop_back();
+
+    if (shard.hand >= shard.clock.size())
+        shard.hand = 0;
+
+    return shard.entries.erase(it);
+}
+
+void BlockZoneMap::invalidateLBID(int64_t lbid)
+{
+    // entries are keyed by the first LBID of a logical block, which is at most 7 blocks back
+    for (int64_t key = lbid; key >= 0 && key > lbid - 8; key--)
+    {
+        Shard& shard = shardFor(key);
+        boost::mutex::scoped_lock lk(shard.mutex);
+        EntryMap::iterator it = shard.entries.find(key);
+
+        if (it != shard.entries.end() && key + it->second.colWidth > lbid)
+            erase(shard, it);
+    }
+}
+
+void BlockZoneMap::invalidateLBIDs(const BRM::LBID_t* lbids, uint32_t count)
+{
+    if (!enabled())
+        return;
+
+    for (uint32_t i = 0; i < count; i++)
+        invalidateLBID(lbids[i]);
+}
+
+void BlockZoneMap::invalidateLBIDs(const LbidAtVer* lbids, uint32_t count)
+{
+    if (!enabled())
+        return;
+
+    for (uint32_t i = 0; i < count; i++)
+        invalidateLBID(lbids[i].LBID);
+}
+
+void BlockZoneMap::invalidateOIDs(const uint32_t* oids, uint32_t count)
+{
+    uint32_t i, j;
+
+    if (!enabled())
+        return;
+
+    for (i = 0; i < ShardCount; i++)
+    {
+        boost::mutex::scoped_lock lk(fShards[i].mutex);
+        EntryMap::iterator it = fShards[i].entries.begin();
+
+        while (it != fShards[i].entries.end())
+        {
+            for (j = 0; j < count; j++)
+                if (it->second.oid == oids[j])
+                    break;
+
+            if (j < count)
+                it = erase(fShards[i], it);
+            else
+                ++it;
+        }
+    }
+}
+
+void BlockZoneMap::clear()
+{
+    for (uint32_t i = 0; i < ShardCount; i++)
+    {
+        boost::mutex::scoped_lock lk(fShards[i].mutex);
+        fShards[i].entries.clear();
+        fShards[i].clock.clear();
+        fShards[i].hand = 0;
+    }
+}
+
+}
+// vim:ts=4 sw=4:
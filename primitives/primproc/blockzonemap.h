@@ -0,0 +1,121 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file blockzonemap.h
+ * Min/max summaries of individual logical blocks of scanned columns.
+ */
+
+#ifndef BLOCKZONEMAP_H_
+#define BLOCKZONEMAP_H_
+
+#include <stdint.h>
+#include <vector>
+#include <tr1/unordered_map>
+#include <boost/thread/mutex.hpp>
+#include <boost/scoped_array.hpp>
+
+#include "brmtypes.h"
+#include "primitivemsg.h"
+
+namespace primitiveprocessor
+{
+
+/** @brief Caches the min & max of each logical block a column scan has read.
+ *
+ * Casual partitioning keeps one range per extent, so a few out of order values
+ * force every block of the extent to be read.  ColumnCommand records the range
+ * p_Col computes for each logical block here and checks it before reading that
+ * block again.  An entry is tagged with the CP sequence number of its extent;
+ * any change to the extent bumps that number, so stale entries never match.
+ * Entries are also dropped when the block cache is flushed for their LBIDs or OIDs.
+ * A full shard evicts with the CLOCK algorithm: lookups mark an entry referenced,
+ * and the hand skips referenced entries once, clearing the mark.
+ */
+class BlockZoneMap
+{
+public:
+    static BlockZoneMap* instance();
+
+    /** @brief Sets the max # of entries, 0 disables the zone map.  Call from main(). */
+    void configure(uint64_t maxEntries);
+
+    bool enabled() const
+    {
+        return fShardCapacity > 0;
+    }
+
+    /** @brief Looks up the range of the logical block starting at lbid.
+     *
+     * @returns true if there is a range recorded under extent sequence number seqNum.
+     */
+    bool lookup(int64_t lbid, int32_t seqNum, int64_t* min, int64_t* max);
+
+    /** @brief Records the range of a logical block colWidth LBIDs long. */
+    void store(int64_t lbid, uint8_t colWidth, uint32_t oid, int32_t seqNum, int64_t min, int64_t max);
+
+    /** @brief Drops the entries covering any of the given LBIDs */
+    void invalidateLBIDs(const BRM::LBID_t* lbids, uint32_t count);
+    void invalidateLBIDs(const LbidAtVer* lbids, uint32_t count);
+
+    /** @brief Drops the entries belonging to any of the given OIDs */
+    void invalidateOIDs(const uint32_t* oids, uint32_t count);
+
+    void clear();
+
+private:
+    BlockZoneMap();
+    BlockZoneMap(const BlockZoneMap&);
+    BlockZoneMap& operator=(const BlockZoneMap&);
+
+    struct Entry
+    {
+        int64_t min;
+        int64_t max;
+        uint32_t oid;
+        int32_t seqNum;
+        uint32_t slot;      // position in Shard::clock
+        uint8_t colWidth;
+        bool referenced;
+    };
+
+    typedef std::tr1::unordered_map<int64_t, Entry> EntryMap;
+
+    struct Shard
+    {
+        Shard() : hand(0) { }
+        boost::mutex mutex;
+        EntryMap entries;
+        std::vector<int64_t> clock;     // the keys of entries, in eviction order
+        uint32_t hand;
+    };
+
+    Shard& shardFor(int64_t lbid)
+    {
+        return fShards[(lbid >> 3) % ShardCount];
+    }
+    void invalidateLBID(int64_t lbid);
+    EntryMap::iterator erase(Shard& shard, EntryMap::iterator it);
+
+    static const uint32_t ShardCount = 16;
+    boost::scoped_array<Shard> fShards;
+    uint64_t fShardCapacity;
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
@@ -41,6 +41,8 @@ using namespace std;
 #include "primproc.h"
 #include "stats.h"
 #include "datatypes/mcs_int128.h"
+#include "lbidlist.h"
+#include "blockzonemap.h"
 
 using namespace messageqcpp;
 using namespace rowgroup;
@@ -63,7 +65,11 @@ ColumnCommand::ColumnCommand() :
     Command(COLUMN_COMMAND),
     blockCount(0),
     loadCount(0),
-    suppressFilter(false)
+    suppressFilter(false),
+    hasExtentCP(false),
+    extentCPValid(false),
+    extentSeqNum(0),
+    partialBlock(false)
 {
 }
 
@@ -72,7 +78,12 @@ ColumnCommand::~ColumnCommand() { }
 void ColumnCommand::_execute()
 {
     if (_isScan)
+    {
+        if (skipByZoneMap())
+            return;
+
         makeScanMsg();
+    }
     else if (bpp->ridCount == 0)     // this would cause a scan
     {
         blockCount += colType.colWidth;
@@ -116,6 +127,41 @@ void ColumnCommand::execute(int64_t* vals)
     _execute();
 }
 
+/* Checks the filter against the recorded range of the logical block about to be
+   scanned.  Only plain AND filters are eligible; OR mode and FilterCommand feeders
+   need the column values even when nothing here matches. */
+bool ColumnCommand::skipByZoneMap()
+{
+    BlockZoneMap* zoneMap = BlockZoneMap::instance();
+    int64_t min, max;
+
+    if (!hasExtentCP || !extentCPValid || filterCount == 0 || suppressFilter ||
+            fFilterFeeder != NOT_FEEDER || bpp->bop != BOP_AND ||
+            colType.colWidth > 8 || !zoneMap->enabled())
+        return false;
+
+    if (!cpCheck)
+        cpCheck.reset(new joblist::LBIDList(0));
+
+    if (!cpCheck->CasualPartitionDataType(colType.colDataType, colType.colWidth))
+        return false;
+
+    if (!zoneMap->lookup(lbid, extentSeqNum, &min, &max))
+        return false;
+
+    BRM::EMCasualPartition_t blockRange(min, max, extentSeqNum);
+
+    if (cpCheck->CasualPartitionPredicate(blockRange, &filterString, filterCount, colType, BOP))
+        return false;
+
+    bpp->ridCount = 0;
+    bpp->ridMap = 0;
+    bpp->validCPData = false;
+    bpp->lbidForCP = lbid;
+    blockCount += colType.colWidth;
+    return true;
+}
+
 void ColumnCommand::makeScanMsg()
 {
     /* Finish the NewColRequestHeader. */
@@ -159,7 +205,7 @@ void ColumnCommand::loadData()
     uint8_t** blockPtrs = (uint8_t**) alloca(colType.colWidth * sizeof(uint8_t*));
     int i;
 
-
+    partialBlock = false;
     _mask = mask;
 // 	primMsg->RidFlags = 0xffff;   // disables selective block loading
     //cout <<__FILE__ << "::issuePrimitive() o: " << getOID() << " l:" << primMsg->LBID << " ll: " << oidLastLbid << endl;
@@ -239,7 +285,10 @@ void ColumnCommand::loadData()
         }// else
 
         if ( (primMsg->LBID + i) == oidLastLbid)
+        {
             lastBlockReached = true;
+            partialBlock = true;
+        }
 
         blockCount++;
     } // for
@@ -306,6 +355,11 @@ void ColumnCommand::issuePrimitive()
         {
             bpp->maxVal = static_cast<int64_t>(outMsg->Max);
             bpp->minVal = static_cast<int64_t>(outMsg->Min);
+
+            // remember the range of full, current blocks for the next scan of this extent
+            if (hasExtentCP && extentCPValid && bpp->validCPData && !partialBlock)
+                BlockZoneMap::instance()->store(lbid, colType.colWidth, OID, extentSeqNum,
+                                                bpp->minVal, bpp->maxVal);
         }
     }
 
@@ -502,6 +556,8 @@ void ColumnCommand::createCommand(ByteStream& bs)
     bs.advance(1);
     bs >> tmp8;
     _isScan = tmp8;
+    // the UM sends the extent's CP state with every scan job
+    hasExtentCP = _isScan;
     bs >> traceFlags;
     bs >> filterString;
 #if 0
@@ -552,6 +608,15 @@ void ColumnCommand::createCommand(ByteStream& bs)
 void ColumnCommand::resetCommand(ByteStream& bs)
 {
     bs >> lbid;
+
+    if (hasExtentCP)
+    {
+        uint8_t tmp8;
+
+        bs >> tmp8;
+        extentCPValid = tmp8;
+        bs >> extentSeqNum;
+    }
 }
 
 void ColumnCommand::prep(int8_t outputType, bool absRids)
@@ -873,12 +938,15 @@ void ColumnCommand::duplicate(ColumnCommand* cc)
     cc->colType.colDataType = colType.colDataType;
     cc->colType.compressionType = colType.compressionType;
     cc->colType.colWidth = colType.colWidth;
+    cc->colType.scale = colType.scale;
+    cc->colType.charsetNumber = colType.charsetNumber;
     cc->BOP = BOP;
     cc->filterCount = filterCount;
     cc->fFilterFeeder = fFilterFeeder;
     cc->parsedColumnFilter = parsedColumnFilter;
     cc->suppressFilter = suppressFilter;
     cc->lastLbid = lastLbid;
+    cc->hasExtentCP = hasExtentCP;
     cc->r = r;
     cc->rowSize = rowSize;
     cc->Command::duplicate(this);
@@ -31,9 +31,16 @@
 #ifndef COLUMNCOMMAND_H_
 #define COLUMNCOMMAND_H_
 
+#include <boost/scoped_ptr.hpp>
+
 #include "command.h"
 #include "calpontsystemcatalog.h"
 
+namespace joblist
+{
+class LBIDList;
+}
+
 using CSCDataType = execplan::CalpontSystemCatalog::ColDataType;
 
 namespace primitiveprocessor
@@ -129,6 +136,7 @@ private:
     void makeScanMsg();
     void makeStepMsg();
     void setLBID(uint64_t rid);
+    bool skipByZoneMap();
 
     bool _isScan;
 
@@ -168,6 +176,13 @@ private:
 
     bool wasVersioned;
 
+    /* block zone map.  The CP state of the extent being scanned comes with each job. */
+    bool hasExtentCP;
+    bool extentCPValid;
+    int32_t extentSeqNum;
+    bool partialBlock;   // the logical block holds the HWM, it may still get rows
+    boost::scoped_ptr<joblist::LBIDList> cpCheck;
+
     friend class RTSCommand;
 };
 
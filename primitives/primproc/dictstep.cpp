@@ -30,11 +30,13 @@
 
 #include <unistd.h>
 #include <algorithm>
+#include <limits>
 
 #include "bpp.h"
 #include "primitiveserver.h"
 #include "pp_logger.h"
 #include "../linux-port/primitiveprocessor.h"
+#include "collation.h"
 
 using namespace std;
 using namespace messageqcpp;
@@ -46,7 +48,7 @@ namespace primitiveprocessor
 extern uint32_t dictBufferSize;
 
 DictStep::DictStep() : Command(DICT_STEP), strValues(NULL), filterCount(0),
-    bufferSize(0)
+    bufferSize(0), computeCP(false), cpHasStrings(false), cacheTokenResults(false)
 {
 }
 
@@ -147,6 +149,16 @@ void DictStep::prep(int8_t outputType, bool makeAbsRids)
     primMsg->NVALS = 0;
 
     likeFilter = bpp->pp.makeLikeFilter((DictFilterElement*) filterString.buf(), primMsg->NOPS);
+
+    // the scan reports CP data for filterSteps[0]; without a filter on the
+    // token column this step gets all of its rows
+    computeCP = (bpp->hasScan && bpp->bop == BOP_AND && fFilterFeeder == NOT_FEEDER &&
+                 bpp->filterCount > 1 && bpp->filterSteps[1].get() == this &&
+                 bpp->filterSteps[0]->getCommandType() == COLUMN_COMMAND &&
+                 ((ColumnCommand*) bpp->filterSteps[0].get())->getFilterCount() == 0);
+
+    // only a plain filter can be answered from the outcome of earlier tokens
+    cacheTokenResults = (fFilterFeeder == NOT_FEEDER && !computeCP && (eqFilter || filterCount > 0));
 }
 
 void DictStep::issuePrimitive(bool isFilter)
@@ -275,6 +287,101 @@ void DictStep::processResult()
     }
 }
 
+// Merges the min & max p_Dictionary found in one dictionary block.  They are
+// appended to the rids, which is all the output when computeCP is set.
+void DictStep::mergeCPAggregate()
+{
+    DictOutput* header = (DictOutput*) &result[0];
+    uint8_t* pos = &result[sizeof(DictOutput) + header->NVALS * 8];
+    uint16_t aggCount;
+    DataValue* min, *max;
+
+    aggCount = *((uint16_t*) pos);
+    pos += 2;
+
+    if (aggCount == 0)
+        return;
+
+    min = (DataValue*) pos;
+    pos += sizeof(DataValue) + min->len;
+    max = (DataValue*) pos;
+
+    datatypes::Charset cs(charsetNumber);
+    utils::ConstString sMin((const char*) min->data, min->len);
+    utils::ConstString sMax((const char*) max->data, max->len);
+
+    if (!cpHasStrings || cs.strnncollsp(sMin, utils::ConstString(cpMin)) < 0)
+        cpMin.assign(sMin.str(), sMin.length());
+
+    if (!cpHasStrings || cs.strnncollsp(sMax, utils::ConstString(cpMax)) > 0)
+        cpMax.assign(sMax.str(), sMax.length());
+
+    cpHasStrings = true;
+}
+
+// Filters the rows of ot[i] onwards that point into the same dictionary block.
+// Every distinct token not seen before is sent to p_Dictionary once, with the
+// token itself as its rid; the block isn't read if there are none.  Returns
+// the index of the first row of the next block.
+uint64_t DictStep::filterByToken(const OrderedToken* ot, uint64_t i)
+{
+    const uint32_t maxCachedTokens = 65536;
+    int64_t l_lbid = ((int64_t) ot[i].token) >> 10;
+    OldGetSigParams* pt = (OldGetSigParams*) (primMsg->tokens);
+    TokenResultMap::iterator it;
+    uint64_t end, j;
+
+    if (tokenResults.size() > maxCachedTokens)
+        tokenResults.clear();
+
+    primMsg->LBID = l_lbid & 0xFFFFFFFFFL;
+    primMsg->NVALS = 0;
+    primMsg->OutputType = OT_RID;
+
+    for (end = i; end < bpp->ridCount && (((int64_t) ot[end].token) >> 10) == l_lbid; end++)
+    {
+        // the tokens are sorted, so duplicates are adjacent
+        if (end > i && ot[end].token == ot[end - 1].token)
+            continue;
+
+        if (tokenResults.find(ot[end].token) != tokenResults.end())
+            continue;
+
+        tokenResults[ot[end].token] = false;
+        pt[primMsg->NVALS].rid = ot[end].token;
+        pt[primMsg->NVALS].offsetIndex = ot[end].token & 0x3ff;
+        idbassert(pt[primMsg->NVALS].offsetIndex != 0);
+        primMsg->NVALS++;
+    }
+
+    if (primMsg->NVALS > 0)
+    {
+        memcpy(&pt[primMsg->NVALS], filterString.buf(), filterString.length());
+        issuePrimitive(true);
+
+        DictOutput* header = (DictOutput*) &result[0];
+        uint64_t* passed = (uint64_t*) &result[sizeof(DictOutput)];
+
+        for (j = 0; j < header->NVALS; j++)
+            tokenResults[passed[j]] = true;
+    }
+
+    for (j = i; j < end; j++)
+    {
+        if (j == i || ot[j].token != ot[j - 1].token)
+            it = tokenResults.find(ot[j].token);
+
+        if (it->second)
+        {
+            bpp->absRids[tmpResultCounter] = ot[j].rid;
+            bpp->relRids[tmpResultCounter] = ot[j].rid - bpp->baseRid;
+            tmpResultCounter++;
+        }
+    }
+
+    return end;
+}
+
 void DictStep::projectResult(string* strings)
 {
     uint32_t i;
@@ -365,11 +472,19 @@ void DictStep::_execute()
     sort(&newRidList[0], &newRidList[bpp->ridCount], TokenSorter());
 
     tmpResultCounter = 0;
+    cpHasStrings = false;
     i = 0;
 
     while (i < bpp->ridCount)
     {
         l_lbid = ((int64_t) newRidList[i].token) >> 10;
+
+        if (cacheTokenResults && l_lbid >= 0)
+        {
+            i = filterByToken(newRidList.get(), i);
+            continue;
+        }
+
         primMsg->LBID = (l_lbid == -1) ? l_lbid : l_lbid & 0xFFFFFFFFFL;
         primMsg->NVALS = 0;
 
@@ -378,6 +493,9 @@ void DictStep::_execute()
          */
         primMsg->OutputType = (fFilterFeeder == NOT_FEEDER ? OT_RID : OT_RID | OT_DATAVALUE);
 
+        if (computeCP)
+            primMsg->OutputType |= OT_AGGREGATE;
+
         pt = (OldGetSigParams*) (primMsg->tokens);
 
         while (i < bpp->ridCount && ((((int64_t) newRidList[i].token) >> 10) == l_lbid ))
@@ -403,11 +521,34 @@ void DictStep::_execute()
             processResult();
         else
             copyResultToTmpSpace(newRidList.get());
+
+        if (computeCP)
+            mergeCPAggregate();
     }
 
     inputRidCount = bpp->ridCount;
     bpp->ridCount = tmpResultCounter;
 
+    // The range of 8-byte prefixes replaces the min & max of the tokens.
+    // An empty range means there were only NULLs.
+    if (computeCP)
+    {
+        if (cpHasStrings)
+        {
+            datatypes::Charset cs(charsetNumber);
+
+            bpp->minVal = 0;
+            bpp->maxVal = 0;
+            memcpy(&bpp->minVal, cpMin.data(), cs.prefixLength(cpMin.data(), cpMin.length(), 8));
+            memcpy(&bpp->maxVal, cpMax.data(), cs.prefixLength(cpMax.data(), cpMax.length(), 8));
+        }
+        else
+        {
+            bpp->minVal = numeric_limits<int64_t>::max();
+            bpp->maxVal = numeric_limits<int64_t>::min();
+        }
+    }
+
     // check if feeding a filtercommand
     if (fFilterFeeder != NOT_FEEDER)
     {
@@ -31,6 +31,8 @@
 #ifndef DICTSTEP_H_
 #define DICTSTEP_H_
 
+#include <tr1/unordered_map>
+
 #include "command.h"
 #include "primitivemsg.h"
 
@@ -88,6 +90,7 @@ private:
     void _execute();
     void issuePrimitive(bool isProjection);
     void processResult();
+    void mergeCPAggregate();
     void projectResult(std::string* tmpStrings);
     void projectResult(StringPtr* tmpStrings);
     void _project();
@@ -124,6 +127,8 @@ private:
     void copyResultToTmpSpace(OrderedToken* ot);
     void copyResultToFinalPosition(OrderedToken* ot);
 
+    uint64_t filterByToken(const OrderedToken* ot, uint64_t i);
+
     // Worst case, 8192 tokens in the msg.  Each is 10 bytes. */
     boost::scoped_array<uint8_t> inputMsg;
     uint32_t tmpResultCounter;
@@ -149,6 +154,19 @@ private:
     boost::shared_array<primitives::idb_regex_t> likeFilter;
     uint8_t eqOp;   // COMPARE_EQ or COMPARE_NE
 
+    // When this step sees every row the scan read from the token column, the
+    // CP data of the scan is replaced by the range of the strings' 8-byte prefixes
+    bool computeCP;
+    bool cpHasStrings;
+    std::string cpMin, cpMax;
+
+    // The outcome of the filter for each token seen so far.  A token always
+    // names the same string, so when the column has few distinct values most
+    // dictionary blocks need not be read at all.
+    typedef std::tr1::unordered_map<uint64_t, bool> TokenResultMap;
+    TokenResultMap tokenResults;
+    bool cacheTokenResults;
+
     friend class RTSCommand;
 };
 
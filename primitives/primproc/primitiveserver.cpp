@@ -54,6 +54,7 @@ using namespace boost;
 #include "primitiveserver.h"
 #include "primitivemsg.h"
 #include "umsocketselector.h"
+#include "blockzonemap.h"
 #include "brm.h"
 using namespace BRM;
 
@@ -1324,13 +1325,17 @@ struct BPPHandler
 
     struct Create : public BPPHandlerFunctor
     {
-        Create(boost::shared_ptr<BPPHandler> r, SBS b) : BPPHandlerFunctor(r, b) { }
+        Create(boost::shared_ptr<BPPHandler> r, SBS b, const SP_UM_IOSOCK& s, const SP_UM_MUTEX& w) :
+            BPPHandlerFunctor(r, b), sock(s), writeLock(w) { }
         int operator()()
         {
             utils::setThreadName("PPHandCreate");
-            rt->createBPP(*bs);
+            rt->createBPP(*bs, sock, writeLock);
             return 0;
         }
+
+        SP_UM_IOSOCK sock;
+        SP_UM_MUTEX writeLock;
     };
 
     struct Destroy : public BPPHandlerFunctor
@@ -1353,6 +1358,16 @@ struct BPPHandler
         }
     };
 
+    struct Shuffle : public BPPHandlerFunctor
+    {
+        Shuffle(boost::shared_ptr<BPPHandler> r, SBS b) : BPPHandlerFunctor(r, b) { }
+        int operator()()
+        {
+            utils::setThreadName("PPHandShuffle");
+            return rt->shuffleMsg(*bs, dieTime);
+        }
+    };
+
     struct Abort : public BPPHandlerFunctor
     {
         Abort(boost::shared_ptr<BPPHandler> r, SBS b) : BPPHandlerFunctor(r, b) { }
@@ -1433,7 +1448,7 @@ struct BPPHandler
             return -1;
     }
 
-    void createBPP(ByteStream& bs)
+    void createBPP(ByteStream& bs, const SP_UM_IOSOCK& sock, const SP_UM_MUTEX& writeLock)
     {
         uint32_t i;
         uint32_t key, initMsgsLeft;
@@ -1454,6 +1469,7 @@ struct BPPHandler
 
         idbassert(bs.length() == 0);
         bppv->getSendThread()->sendMore(initMsgsLeft);
+        bppv->setUMSocket(sock, writeLock);
         bppv->add(bpp);
 
         // this block of code creates some BPP instances up front for user queries,
@@ -1630,6 +1646,40 @@ struct BPPHandler
         return 0;
     }
 
+    /* Rows another PM shuffled here for a join.  Same scheduling rules as a BPP run,
+       they wait for the BPP to exist, for its join data, & for a free instance. */
+    int shuffleMsg(ByteStream& bs, const posix_time::ptime& dieTime)
+    {
+        SBPPV bppv;
+        SBPP bpp;
+        uint32_t uniqueID;
+
+        uniqueID = getUniqueID(bs, BATCH_PRIMITIVE_SHUFFLE);
+        bppv = grabBPPs(uniqueID);
+
+        if (!bppv)
+        {
+            if (posix_time::second_clock::universal_time() > dieTime)
+                return 0;
+            else
+                return -1;
+        }
+
+        boost::mutex::scoped_lock scoped(bppLock);
+
+        if (bppv->aborted())
+            return 0;
+
+        bpp = bppv->next();
+        scoped.unlock();
+
+        if (!bpp)
+            return -1;    // all BPP instances are busy, make threadpool reschedule
+
+        bpp->processShuffle(bs, bppv->getUMSocket(), bppv->getUMLock());
+        return 0;
+    }
+
     int destroyBPP(ByteStream& bs, const posix_time::ptime& dieTime)
     {
         uint32_t uniqueID, sessionID, stepID;
@@ -1733,25 +1783,31 @@ struct BPPHandler
     // Would be good to define the structure of these msgs somewhere...
     inline uint32_t getUniqueID(SBS bs, uint8_t command)
     {
-        uint8_t* buf;
+        return getUniqueID(*bs, command);
+    }
+
+    inline uint32_t getUniqueID(const ByteStream& bs, uint8_t command)
+    {
+        const uint8_t* buf;
 
-        buf = bs->buf();
+        buf = bs.buf();
 
         switch (command)
         {
             case BATCH_PRIMITIVE_ABORT:
-                return *((uint32_t*) &buf[sizeof(ISMPacketHeader)]);
+                return *((const uint32_t*) &buf[sizeof(ISMPacketHeader)]);
 
             case BATCH_PRIMITIVE_ACK:
             {
-                ISMPacketHeader* ism = (ISMPacketHeader*) buf;
+                const ISMPacketHeader* ism = (const ISMPacketHeader*) buf;
                 return ism->Interleave;
             }
 
             case BATCH_PRIMITIVE_ADD_JOINER:
             case BATCH_PRIMITIVE_END_JOINER:
             case BATCH_PRIMITIVE_DESTROY:
-                return *((uint32_t*) &buf[sizeof(ISMPacketHeader) + 2 * sizeof(uint32_t)]);
+            case BATCH_PRIMITIVE_SHUFFLE:
+                return *((const uint32_t*) &buf[sizeof(ISMPacketHeader) + 2 * sizeof(uint32_t)]);
 
             default:
                 return 0;
@@ -1895,6 +1951,8 @@ struct ReadThread
             bc.flushOIDs(oids, count);
         }
 
+        BlockZoneMap::instance()->invalidateOIDs(oids, count);
+
         ios->write(buildCacheOpResp(0));
     }
 
@@ -1922,6 +1980,11 @@ struct ReadThread
             bc.flushPartition(oids, partitions);
         }
 
+        // the zone map isn't indexed by partition, drop all of the columns' entries
+        if (!oids.empty())
+            BlockZoneMap::instance()->invalidateOIDs(reinterpret_cast<const uint32_t*>(&oids[0]),
+                    oids.size());
+
         ios->write(buildCacheOpResp(0));
     }
 
@@ -1933,6 +1996,8 @@ struct ReadThread
             bc.flushCache();
         }
 
+        BlockZoneMap::instance()->clear();
+
         ios->write(buildCacheOpResp(0));
     }
 
@@ -1970,6 +2035,8 @@ struct ReadThread
             bc.flushMany(itemp, *cntp);
         }
 
+        BlockZoneMap::instance()->invalidateLBIDs(itemp, *cntp);
+
         ios->write(buildCacheOpResp(0));
     }
 
@@ -1986,6 +2053,8 @@ struct ReadThread
             bc.flushManyAllversion(itemp, *cntp);
         }
 
+        BlockZoneMap::instance()->invalidateLBIDs(itemp, *cntp);
+
         ios->write(buildCacheOpResp(0));
     }
 
@@ -2221,7 +2290,8 @@ struct ReadThread
                         case BATCH_PRIMITIVE_CREATE:
                         {
                             PriorityThreadPool::Job job;
-                            job.functor = boost::shared_ptr<PriorityThreadPool::Functor>(new BPPHandler::Create(fBPPHandler, bs));
+                            job.functor = boost::shared_ptr<PriorityThreadPool::Functor>(new BPPHandler::Create(fBPPHandler, bs,
+                                          outIos, writeLock));
                             const uint8_t* buf = bs->buf();
                             uint32_t pos = sizeof(ISMPacketHeader) - 2;
                             job.stepID = *((uint32_t*) &buf[pos + 6]);
@@ -2281,6 +2351,23 @@ struct ReadThread
                             break;
                         }
 
+                        case BATCH_PRIMITIVE_SHUFFLE:
+                        {
+                            // from another PrimProc, scheduled like the BPP run it's part of
+                            PriorityThreadPool::Job job;
+                            job.functor = boost::shared_ptr<PriorityThreadPool::Functor>(new BPPHandler::Shuffle(fBPPHandler, bs));
+                            job.id = fBPPHandler->getUniqueID(bs, ismHdr->Command);
+                            job.weight = ismHdr->Size;
+                            const uint8_t* buf = bs->buf();
+                            uint32_t pos = sizeof(ISMPacketHeader) - 2;
+                            job.stepID = *((uint32_t*) &buf[pos + 6]);
+                            job.uniqueID = *((uint32_t*) &buf[pos + 10]);
+                            job.priority = *((uint32_t*) &buf[pos + 14]);
+                            job.sock = outIos;
+                            procPoolPtr->addJob(job);
+                            break;
+                        }
+
                         case BATCH_PRIMITIVE_ACK:
                         {
                             fBPPHandler->doAck(*bs);
@@ -83,9 +83,26 @@ public:
     void abort();
     bool aborted();
     volatile bool joinDataReceived;
+
+    // the UM connection the job was created on, results of shuffled rows go there
+    inline void setUMSocket(const SP_UM_IOSOCK& s, const SP_UM_MUTEX& w)
+    {
+        umSock = s;
+        umLock = w;
+    }
+    inline const SP_UM_IOSOCK& getUMSocket() const
+    {
+        return umSock;
+    }
+    inline const SP_UM_MUTEX& getUMLock() const
+    {
+        return umLock;
+    }
 private:
     std::vector<boost::shared_ptr<BatchPrimitiveProcessor> > v;
     boost::shared_ptr<BPPSendThread> sendThread;
+    SP_UM_IOSOCK umSock;
+    SP_UM_MUTEX umLock;
 
     // the instance other instances are created from
     boost::shared_ptr<BatchPrimitiveProcessor> unusedInstance;
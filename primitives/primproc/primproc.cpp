@@ -59,6 +59,7 @@ using namespace logging;
 #include "MonitorProcMem.h"
 #include "pp_logger.h"
 #include "umsocketselector.h"
+#include "blockzonemap.h"
 using namespace primitiveprocessor;
 
 #include "liboamcpp.h"
@@ -618,6 +619,16 @@ int ServicePrimProc::Child()
         blocksReadAhead = temp;
     }
 
+    // per-block min/max ranges kept to skip blocks casual partitioning can't, 0 disables
+    string zoneMapEntries = cf->getConfig(primitiveServers, "BlockZoneMapEntries");
+
+    if (zoneMapEntries.length() > 0)
+        temp = toInt(zoneMapEntries);
+    else
+        temp = 1048576;
+
+    BlockZoneMap::instance()->configure(temp > 0 ? temp : 0);
+
     temp = toInt(cf->getConfig(primitiveServers, "PTTrace"));
 
     if (temp > 0)
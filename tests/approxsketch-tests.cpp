@@ -0,0 +1,154 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <cmath>
+#include <cstdlib>
+using namespace std;
+
+#include "gtest/gtest.h"
+
+#include "regr/approxsketch.h"
+using namespace mcsv1sdk;
+
+namespace
+{
+void addRange(HyperLogLog* hll, int64_t start, int64_t end)
+{
+    for (int64_t i = start; i < end; i++)
+        hll->add(&i, sizeof(i));
+}
+
+double relError(double estimate, double actual)
+{
+    return fabs(estimate - actual) / actual;
+}
+}
+
+TEST(HyperLogLog, Empty)
+{
+    HyperLogLog hll;
+    EXPECT_EQ(0U, hll.estimate());
+}
+
+TEST(HyperLogLog, SmallCountsAreNearlyExact)
+{
+    HyperLogLog hll;
+
+    addRange(&hll, 0, 100);
+    addRange(&hll, 0, 100);
+    EXPECT_EQ(100U, hll.estimate());
+    EXPECT_TRUE(hll.registers().empty());
+}
+
+TEST(HyperLogLog, LargeCounts)
+{
+    HyperLogLog hll;
+
+    addRange(&hll, 0, 1000000);
+    EXPECT_FALSE(hll.registers().empty());
+    EXPECT_LT(relError(hll.estimate(), 1000000), 0.03);
+}
+
+TEST(HyperLogLog, MergeIsUnion)
+{
+    HyperLogLog a, b, c, all;
+
+    addRange(&a, 0, 600);
+    addRange(&b, 400, 1000);
+    addRange(&c, 0, 200000);
+    addRange(&all, 0, 200000);
+
+    a.merge(b);
+    EXPECT_LT(relError(a.estimate(), 1000), 0.02);
+
+    // sparse into dense & dense into sparse give the same registers
+    a.merge(c);
+    EXPECT_EQ(all.registers(), a.registers());
+
+    b.merge(all);
+    c.merge(b);
+    EXPECT_EQ(all.registers(), c.registers());
+}
+
+TEST(HyperLogLog, LoadRoundTrip)
+{
+    HyperLogLog hll, copy;
+    std::vector<uint32_t> sparse;
+    std::vector<uint8_t> registers;
+
+    addRange(&hll, 0, 50000);
+    sparse = hll.sparse();
+    registers = hll.registers();
+    copy.load(sparse, registers);
+    EXPECT_EQ(hll.estimate(), copy.estimate());
+}
+
+TEST(TDigest, Empty)
+{
+    TDigest digest;
+    EXPECT_TRUE(digest.empty());
+    EXPECT_TRUE(std::isnan(digest.quantile(0.5)));
+}
+
+TEST(TDigest, SingleValue)
+{
+    TDigest digest;
+    digest.add(42);
+    EXPECT_EQ(42, digest.quantile(0));
+    EXPECT_EQ(42, digest.quantile(0.95));
+}
+
+TEST(TDigest, Uniform)
+{
+    TDigest digest;
+    const int n = 100000;
+
+    for (int i = 0; i < n; i++)
+        digest.add((i * 7919) % n);
+
+    EXPECT_EQ(0, digest.quantile(0));
+    EXPECT_EQ(n - 1, digest.quantile(1));
+    EXPECT_NEAR(n * 0.5, digest.quantile(0.5), n * 0.01);
+    EXPECT_NEAR(n * 0.95, digest.quantile(0.95), n * 0.005);
+    EXPECT_NEAR(n * 0.999, digest.quantile(0.999), n * 0.001);
+    EXPECT_LT(digest.centroids().size(), 300U);
+}
+
+TEST(TDigest, MergeMatchesOneDigest)
+{
+    TDigest parts[4], merged;
+    const int n = 40000;
+
+    srand(1);
+
+    for (int i = 0; i < n; i++)
+        parts[i % 4].add(exp((rand() % 10000) / 1000.0));
+
+    for (int i = 0; i < 4; i++)
+    {
+        std::vector<TDigest::Centroid> centroids(parts[i].centroids());
+        TDigest copy;
+
+        centroids.insert(centroids.end(), parts[i].buffer().begin(), parts[i].buffer().end());
+        copy.load(parts[i].min(), parts[i].max(), centroids);
+        merged.merge(copy);
+    }
+
+    // exp(u) for u uniform in [0, 10), so its p-quantile is exp(10p)
+    EXPECT_LT(relError(merged.quantile(0.5), exp(5.0)), 0.05);
+    EXPECT_LT(relError(merged.quantile(0.95), exp(9.5)), 0.05);
+}
@@ -0,0 +1,115 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <regex.h>
+#include <string>
+using namespace std;
+
+#include "gtest/gtest.h"
+
+#include "dataconvert.h"
+#include "likematcher.h"
+using namespace utils;
+
+namespace
+{
+const char* strings[] = {"", "a", "abc", "abcd", "xabc", "xabcx", "ac", "abbc", "aXbYc",
+                         "ab%c", "ab_c", "ab\\c", "a\\c", "b", "bb", NULL
+                        };
+
+bool likeByRegex(const string& pattern, const char* str)
+{
+    regex_t re;
+    string rx = dataconvert::DataConvert::constructRegexp(pattern);
+    regcomp(&re, rx.c_str(), REG_NOSUB | REG_EXTENDED);
+    bool ret = (regexec(&re, str, 0, NULL, 0) == 0);
+    regfree(&re);
+    return ret;
+}
+
+bool regexpByRegex(const string& pattern, const char* str)
+{
+    regex_t re;
+    regcomp(&re, pattern.c_str(), REG_NOSUB | REG_EXTENDED);
+    bool ret = (regexec(&re, str, 0, NULL, 0) == 0);
+    regfree(&re);
+    return ret;
+}
+}
+
+TEST(LikeMatcherTest, Classify)
+{
+    LikeMatcher m;
+
+    m.compileLike("abc", 3);
+    EXPECT_EQ(m.kind(), LikeMatcher::EXACT);
+    m.compileLike("abc%", 4);
+    EXPECT_EQ(m.kind(), LikeMatcher::PREFIX);
+    m.compileLike("%abc", 4);
+    EXPECT_EQ(m.kind(), LikeMatcher::SUFFIX);
+    m.compileLike("%abc%", 5);
+    EXPECT_EQ(m.kind(), LikeMatcher::CONTAINS);
+    m.compileLike("%%", 2);
+    EXPECT_EQ(m.kind(), LikeMatcher::CONTAINS);
+    m.compileLike("a%b%c", 5);
+    EXPECT_EQ(m.kind(), LikeMatcher::MULTI);
+    EXPECT_FALSE(m.compileLike("a_c", 3));
+    EXPECT_FALSE(m.literal());
+    EXPECT_TRUE(m.compileLike("a\\_c", 4));
+    EXPECT_EQ(m.kind(), LikeMatcher::EXACT);
+
+    m.compileRegexp("^abc$", 5);
+    EXPECT_EQ(m.kind(), LikeMatcher::EXACT);
+    m.compileRegexp("^abc", 4);
+    EXPECT_EQ(m.kind(), LikeMatcher::PREFIX);
+    m.compileRegexp("abc$", 4);
+    EXPECT_EQ(m.kind(), LikeMatcher::SUFFIX);
+    m.compileRegexp("abc", 3);
+    EXPECT_EQ(m.kind(), LikeMatcher::CONTAINS);
+    EXPECT_FALSE(m.compileRegexp("a.c", 3));
+    EXPECT_FALSE(m.compileRegexp("ab\\$", 4));
+}
+
+TEST(LikeMatcherTest, LikeAgreesWithRegex)
+{
+    const char* patterns[] = {"", "abc", "abc%", "%abc", "%abc%", "%", "%%", "a%b%c", "%a%b%",
+                              "a%%c", "ab\\%c", "ab\\_c", "ab\\\\c", "a\\c", "%b%b%", "a.c%", NULL
+                             };
+
+    for (const char** p = patterns; *p; p++)
+    {
+        LikeMatcher m;
+        ASSERT_TRUE(m.compileLike(*p, strlen(*p))) << *p;
+
+        for (const char** s = strings; *s; s++)
+            EXPECT_EQ(m.match(*s, strlen(*s)), likeByRegex(*p, *s)) << *p << " LIKE " << *s;
+    }
+}
+
+TEST(LikeMatcherTest, RegexpAgreesWithRegex)
+{
+    const char* patterns[] = {"abc", "^abc", "abc$", "^abc$", "^", "$", "^$", "b", "%", NULL};
+
+    for (const char** p = patterns; *p; p++)
+    {
+        LikeMatcher m;
+        ASSERT_TRUE(m.compileRegexp(*p, strlen(*p))) << *p;
+
+        for (const char** s = strings; *s; s++)
+            EXPECT_EQ(m.match(*s, strlen(*s)), regexpByRegex(*p, *s)) << *p << " REGEXP " << *s;
+    }
+}
@@ -0,0 +1,281 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <unistd.h>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+using namespace std;
+
+#include "gtest/gtest.h"
+
+#include "fifo.h"
+#include "ringbufferqueue.h"
+using namespace joblist;
+
+namespace
+{
+// stands in for a ByteStream, the length is the value
+struct Msg
+{
+    explicit Msg(uint64_t v) : value(v) { }
+    size_t lengthWithHdrOverhead() const
+    {
+        return value % 100;
+    }
+    uint64_t value;
+};
+typedef boost::shared_ptr<Msg> SMsg;
+
+const uint64_t ProducerCount = 4;
+const uint64_t PerProducer = 20000;
+
+void produce(RingBufferQueue<SMsg>* q, uint64_t producer)
+{
+    for (uint64_t i = 0; i < PerProducer; i++)
+        q->push(SMsg(new Msg(producer * PerProducer + i)));
+}
+
+// Filling in an empty handle, which is what a producer does to the ring cell it claimed,
+// yields now & then.  That leaves claimed cells unpublished while the others push.
+struct SlowMsg
+{
+    SlowMsg() { }
+    explicit SlowMsg(uint64_t v) : msg(new Msg(v)) { }
+    SlowMsg& operator=(const SlowMsg& m)
+    {
+        bool filling = !msg && m.msg;
+
+        msg = m.msg;
+
+        if (filling && msg->value % 3 == 0)
+            boost::this_thread::yield();
+
+        return *this;
+    }
+    const Msg* operator->() const
+    {
+        return msg.get();
+    }
+    SMsg msg;
+};
+
+void produceSlowly(RingBufferQueue<SlowMsg>* q, uint64_t producer)
+{
+    for (uint64_t i = 0; i < PerProducer; i++)
+        q->push(SlowMsg(producer * PerProducer + i));
+}
+
+// each producer's messages have to come out in order
+void checkOrder(vector<uint64_t>& next, const SMsg& m)
+{
+    uint64_t producer = m->value / PerProducer;
+    ASSERT_EQ(next[producer], m->value % PerProducer);
+    next[producer]++;
+}
+
+void consume(FIFO<uint64_t>* fifo, uint64_t it, uint64_t expected, bool* ok)
+{
+    uint64_t val, n = 0;
+
+    *ok = true;
+
+    while (fifo->next(it, &val))
+        *ok = *ok && (val == n++);
+
+    *ok = *ok && (n == expected);
+}
+
+void fifoRoundTrip(uint32_t consumers, uint32_t size)
+{
+    const uint64_t count = 50000;
+    FIFO<uint64_t> fifo(consumers, size);
+    vector<uint64_t> its;
+    boost::thread_group threads;
+    boost::scoped_array<bool> ok(new bool[consumers]);
+    vector<uint64_t> batch;
+
+    fifo.ringBuffer(true);
+
+    for (uint32_t c = 0; c < consumers; c++)
+        its.push_back(fifo.getIterator());
+
+    for (uint32_t c = 0; c < consumers; c++)
+        threads.create_thread(boost::bind(consume, &fifo, its[c], count, &ok[c]));
+
+    // mix single & batch inserts
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (i % 3 == 0)
+        {
+            fifo.insert(i);
+            continue;
+        }
+
+        batch.push_back(i);
+
+        if (batch.size() == 7 || i % 3 == 2)
+        {
+            fifo.insert(batch);
+            batch.clear();
+        }
+    }
+
+    fifo.insert(batch);
+    fifo.endOfInput();
+    threads.join_all();
+
+    for (uint32_t c = 0; c < consumers; c++)
+        EXPECT_TRUE(ok[c]);
+
+    EXPECT_EQ(count, fifo.totalSize());
+}
+}
+
+TEST(RingBufferQueue, PushPop)
+{
+    RingBufferQueue<SMsg> q(4);
+    SMsg m;
+
+    EXPECT_TRUE(q.empty());
+
+    // past the ring's capacity, the rest goes to the overflow list
+    for (uint64_t i = 0; i < 10; i++)
+    {
+        TSQSize_t size = q.push(SMsg(new Msg(i)));
+        EXPECT_EQ(i + 1, size.count);
+    }
+
+    EXPECT_EQ(45u, q.size().size);
+
+    for (uint64_t i = 0; i < 10; i++)
+    {
+        TSQSize_t size = q.pop(&m);
+        EXPECT_EQ(i, m->value);
+        EXPECT_EQ(9 - i, size.count);
+    }
+
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(0u, q.size().size);
+}
+
+TEST(RingBufferQueue, PopSome)
+{
+    RingBufferQueue<SMsg> q;
+    vector<SMsg> v;
+
+    for (uint64_t i = 0; i < 10; i++)
+        q.push(SMsg(new Msg(i)));
+
+    TSQSize_t size = q.pop_some(2, v);
+    EXPECT_EQ(5u, v.size());
+    EXPECT_EQ(5u, size.count);
+    EXPECT_EQ(5u + 6 + 7 + 8 + 9, size.size);
+
+    q.pop_all(v);
+    EXPECT_EQ(5u, v.size());
+    EXPECT_EQ(9u, v.back()->value);
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(RingBufferQueue, Shutdown)
+{
+    RingBufferQueue<SMsg> q;
+    SMsg m(new Msg(1));
+    boost::thread reader(boost::bind(&RingBufferQueue<SMsg>::pop, &q, &m));
+
+    usleep(10000);
+    q.shutdown();
+    reader.join();
+    EXPECT_FALSE(m);
+}
+
+TEST(RingBufferQueue, Producers)
+{
+    RingBufferQueue<SMsg> q(64);
+    boost::thread_group producers;
+    vector<uint64_t> next(ProducerCount, 0);
+    vector<SMsg> v;
+    SMsg m;
+    uint64_t received = 0;
+
+    for (uint64_t p = 0; p < ProducerCount; p++)
+        producers.create_thread(boost::bind(produce, &q, p));
+
+    while (received < ProducerCount * PerProducer)
+    {
+        q.pop(&m);
+        checkOrder(next, m);
+        received++;
+
+        q.pop_some(4, v);
+
+        for (uint32_t i = 0; i < v.size(); i++)
+            checkOrder(next, v[i]);
+
+        received += v.size();
+    }
+
+    producers.join_all();
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(0u, q.size().size);
+}
+
+// A 2-cell ring with more producers than that keeps the overflow list in use, and
+// the producers keep racing each other between the ring & the list.
+TEST(RingBufferQueue, ProducersThroughOverflow)
+{
+    const uint64_t producerCount = 8;
+    RingBufferQueue<SlowMsg> q(2);
+    boost::thread_group producers;
+    vector<uint64_t> next(producerCount, 0);
+    SlowMsg m;
+
+    for (uint64_t p = 0; p < producerCount; p++)
+        producers.create_thread(boost::bind(produceSlowly, &q, p));
+
+    for (uint64_t received = 0; received < producerCount * PerProducer; received++)
+    {
+        q.pop(&m);
+        checkOrder(next, m.msg);
+
+        if (received % 1000 == 0)
+            usleep(100);
+    }
+
+    producers.join_all();
+
+    for (uint64_t p = 0; p < producerCount; p++)
+        EXPECT_EQ(PerProducer, next[p]);
+
+    EXPECT_TRUE(q.empty());
+}
+
+TEST(FIFORingBuffer, OneConsumer)
+{
+    fifoRoundTrip(1, 10);
+}
+
+TEST(FIFORingBuffer, Consumers)
+{
+    fifoRoundTrip(3, 10);
+}
+
+TEST(FIFORingBuffer, OneSlot)
+{
+    fifoRoundTrip(2, 1);
+}
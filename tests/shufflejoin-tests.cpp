@@ -0,0 +1,213 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <vector>
+using namespace std;
+
+#include "gtest/gtest.h"
+
+#include "calpontsystemcatalog.h"
+#include "bpp-jl.h"
+using namespace messageqcpp;
+using namespace rowgroup;
+using namespace joiner;
+using namespace joblist;
+
+namespace
+{
+const uint32_t PartCount = 4;
+const uint32_t RowCount = 1000;
+
+// two BIGINT columns
+RowGroup makeRG()
+{
+    vector<uint32_t> offsets, roids, tkeys, scale, precision, charSets;
+    vector<execplan::CalpontSystemCatalog::ColDataType> types;
+
+    offsets.push_back(2);
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        offsets.push_back(offsets.back() + 8);
+        roids.push_back(3000 + i);
+        tkeys.push_back(i + 1);
+        types.push_back(execplan::CalpontSystemCatalog::BIGINT);
+        scale.push_back(0);
+        precision.push_back(18);
+        charSets.push_back(8);
+    }
+
+    return RowGroup(2, offsets, roids, tkeys, types, charSets, scale, precision, 20, false);
+}
+
+// many rows per key, so a partition has to keep every row of a key together
+void fill(RowGroup& rg, RGData& data)
+{
+    Row r;
+
+    data.reinit(rg, RowCount);
+    rg.setData(&data);
+    rg.resetRowGroup(0);
+    rg.initRow(&r);
+    rg.getRow(0, &r);
+
+    for (uint32_t i = 0; i < RowCount; i++, r.nextRow())
+    {
+        r.setIntField(i % 37, 0);
+        r.setIntField(i % 5, 1);
+    }
+
+    rg.setRowCount(RowCount);
+}
+
+void checkCoverage(const vector<vector<uint32_t> >& parts)
+{
+    vector<bool> seen(RowCount, false);
+    uint32_t total = 0;
+
+    ASSERT_EQ(PartCount, parts.size());
+
+    for (uint32_t p = 0; p < parts.size(); p++)
+    {
+        for (uint32_t i = 0; i < parts[p].size(); i++)
+        {
+            ASSERT_LT(parts[p][i], RowCount);
+            EXPECT_FALSE(seen[parts[p][i]]);
+            seen[parts[p][i]] = true;
+        }
+
+        total += parts[p].size();
+    }
+
+    EXPECT_EQ(RowCount, total);
+}
+}
+
+// a counted response ends with the # of shuffle msgs its PM sent, the others with a marker
+TEST(ShuffleJoin, Trailer)
+{
+    ISMPacketHeader ism;
+    ByteStream counted, part, last, none;
+
+    memset(&ism, 0, sizeof(ism));
+    counted.append((uint8_t*) &ism, sizeof(ism));
+    counted << (uint64_t) 12345;
+    part = last = none = counted;
+
+    counted << (uint32_t) 7;
+    part << SHUFFLE_MSG_PART;
+    last << SHUFFLE_MSG_LAST;
+    none << SHUFFLE_MSG_NONE;
+
+    EXPECT_EQ(7, BatchPrimitiveProcessorJL::shuffleDelta(counted, true));
+    EXPECT_EQ(0, BatchPrimitiveProcessorJL::shuffleDelta(part, false));
+    EXPECT_EQ(-1, BatchPrimitiveProcessorJL::shuffleDelta(last, false));
+    EXPECT_EQ(0, BatchPrimitiveProcessorJL::shuffleDelta(none, false));
+
+    // the trailer is looked at in place, the msg is still read from the front
+    EXPECT_EQ(sizeof(ism) + sizeof(uint64_t) + sizeof(uint32_t), counted.length());
+}
+
+// The UM splits the small side with partitionSmallSide(), a PM routes a large side
+// row in BatchPrimitiveProcessor::shuffleRows().  The same key has to go to the same PM.
+TEST(ShuffleJoin, TypedRouting)
+{
+    RowGroup smallRG = makeRG(), largeRG = makeRG();
+    RGData data;
+    vector<vector<uint32_t> > parts;
+    Row r;
+
+    fill(smallRG, data);
+    TupleJoiner tj(smallRG, largeRG, 0, 0, INNER, NULL);
+    tj.insertRGData(smallRG, 0);
+
+    BatchPrimitiveProcessorJL::partitionSmallSide(tj, PartCount, &parts);
+    checkCoverage(parts);
+
+    // the large side rows are the same rows, routed the way a PM does it
+    largeRG.setData(&data);
+    largeRG.initRow(&r);
+
+    for (uint32_t p = 0; p < parts.size(); p++)
+    {
+        for (uint32_t i = 0; i < parts[p].size(); i++)
+        {
+            largeRG.getRow(parts[p][i], &r);
+            EXPECT_EQ(p, shufflePartition(r.getIntField(0), PartCount));
+        }
+    }
+}
+
+TEST(ShuffleJoin, TypelessRouting)
+{
+    RowGroup smallRG = makeRG(), largeRG = makeRG();
+    RGData data;
+    vector<vector<uint32_t> > parts;
+    vector<uint32_t> keyCols;
+    Row r;
+
+    keyCols.push_back(0);
+    keyCols.push_back(1);
+    fill(smallRG, data);
+    TupleJoiner tj(smallRG, largeRG, keyCols, keyCols, INNER, NULL);
+    tj.insertRGData(smallRG, 0);
+
+    BatchPrimitiveProcessorJL::partitionSmallSide(tj, PartCount, &parts);
+    checkCoverage(parts);
+
+    utils::FixedAllocator fa(tj.getKeyLength(), true);
+    largeRG.setData(&data);
+    largeRG.initRow(&r);
+
+    for (uint32_t p = 0; p < parts.size(); p++)
+    {
+        for (uint32_t i = 0; i < parts[p].size(); i++)
+        {
+            largeRG.getRow(parts[p][i], &r);
+            TypelessData key = makeTypelessKey(r, keyCols, tj.getKeyLength(), &fa);
+            EXPECT_EQ(p, shufflePartition(key.hash(largeRG, keyCols), PartCount));
+        }
+    }
+}
+
+// all of the rows have the same key, so one partition gets all of them
+TEST(ShuffleJoin, SkewedKey)
+{
+    RowGroup smallRG = makeRG(), largeRG = makeRG();
+    RGData data;
+    vector<vector<uint32_t> > parts;
+    Row r;
+    uint32_t i, nonEmpty = 0;
+
+    fill(smallRG, data);
+    smallRG.initRow(&r);
+    smallRG.getRow(0, &r);
+
+    for (i = 0; i < RowCount; i++, r.nextRow())
+        r.setIntField(42, 0);
+
+    TupleJoiner tj(smallRG, largeRG, 0, 0, INNER, NULL);
+    tj.insertRGData(smallRG, 0);
+    BatchPrimitiveProcessorJL::partitionSmallSide(tj, PartCount, &parts);
+    checkCoverage(parts);
+
+    for (i = 0; i < parts.size(); i++)
+        nonEmpty += (parts[i].empty() ? 0 : 1);
+
+    EXPECT_EQ(1u, nonEmpty);
+    EXPECT_EQ(RowCount, parts[shufflePartition(42, PartCount)].size());
+}
@@ -18,6 +18,8 @@
 #ifndef COLLATION_H_INCLUDED
 #define COLLATION_H_INCLUDED
 
+#include <algorithm>
+
 #include "exceptclasses.h"
 #include "conststring.h"
 
@@ -137,6 +139,39 @@ public:
         return mCharset->strnncollsp(str1.str(), str1.length(),
                                      str2.str(), str2.length());
     }
+    // Byte length of the longest prefix of str that ends on a character
+    // boundary and fits into maxBytes
+    size_t prefixLength(const char *str, size_t length, size_t maxBytes) const
+    {
+        if (length <= maxBytes)
+            return length;
+
+        size_t nchars = maxBytes, res;
+
+        while ((res = mCharset->charpos(str, str + length, nchars)) > maxBytes)
+            nchars--;
+
+        return res;
+    }
+    // Whether strings order the way their prefixes do, which strnncollPrefix()
+    // relies on: binary collations, and single-level ones that map every
+    // character to one weight (no contractions, expansions or ignorables)
+    bool isPrefixOrdered() const
+    {
+        if (mCharset->state & MY_CS_BINSORT)
+            return true;
+
+        return !(mCharset->state & MY_CS_NON1TO1) && mCharset->levels_for_order == 1;
+    }
+    // Compares only as many leading bytes as the shorter string has, so
+    // a string is equal to any of its prefixes
+    int strnncollPrefix(const utils::ConstString &str1,
+                        const utils::ConstString &str2) const
+    {
+        size_t len = std::min(str1.length(), str2.length());
+        return mCharset->strnncoll(str1.str(), prefixLength(str1.str(), str1.length(), len),
+                                   str2.str(), prefixLength(str2.str(), str2.length(), len));
+    }
     bool test_if_important_data(const char *str, const char *end) const
     {
         if (mCharset->state & MY_CS_NOPAD)
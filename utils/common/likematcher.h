@@ -0,0 +1,257 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/** @file likematcher.h
+ * Literal fast paths for LIKE and REGEXP patterns.
+ */
+
+#ifndef UTILS_LIKEMATCHER_H
+#define UTILS_LIKEMATCHER_H
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace utils
+{
+
+/** @brief Matches LIKE & REGEXP patterns that reduce to plain substrings.
+ *
+ * Most patterns seen in practice are 'abc', 'abc%', '%abc', '%abc%' or
+ * 'a%b%c'.  Running those through regexec() costs far more than a memcmp()
+ * or memmem().  A pattern is classified once, when the filter is built; if
+ * it has no single char wildcard (or, for REGEXP, no metacharacter other than
+ * the anchors) literal() is true and match() answers without a regex.
+ * Otherwise the caller keeps using its compiled regex.  Matching is bytewise,
+ * which is what the C locale regex does for the same patterns.
+ */
+class LikeMatcher
+{
+public:
+    enum Kind
+    {
+        GENERAL,    // needs a regex
+        EXACT,      // 'abc'
+        PREFIX,     // 'abc%'
+        SUFFIX,     // '%abc'
+        CONTAINS,   // '%abc%', '%'
+        MULTI       // 'a%b%c'
+    };
+
+    LikeMatcher() : fKind(GENERAL) { }
+
+    Kind kind() const
+    {
+        return fKind;
+    }
+    bool literal() const
+    {
+        return fKind != GENERAL;
+    }
+
+    /** @brief Classifies a SQL LIKE pattern, using the escapes of convertToRegexp().
+     *
+     * @returns true if match() can evaluate it.
+     */
+    bool compileLike(const char* pattern, size_t len)
+    {
+        std::vector<std::string> segments(1);
+        reset();
+
+        for (size_t i = 0; i < len; i++)
+        {
+            char c = pattern[i];
+
+            if (c == '_')
+                return false;
+
+            if (c == '%')
+            {
+                segments.push_back(std::string());
+                continue;
+            }
+
+            // \% \_ and \\ stand for the char, a lone backslash is itself
+            if (c == '\\' && i + 1 < len &&
+                    (pattern[i + 1] == '%' || pattern[i + 1] == '_' || pattern[i + 1] == '\\'))
+                c = pattern[++i];
+
+            segments.back() += c;
+        }
+
+        if (segments.size() == 1)
+        {
+            fPrefix = segments[0];
+            fKind = EXACT;
+            return true;
+        }
+
+        fPrefix = segments.front();
+        fSuffix = segments.back();
+
+        for (size_t i = 1; i < segments.size() - 1; i++)
+            if (!segments[i].empty())
+                fMiddle.push_back(segments[i]);
+
+        if (fMiddle.empty() && fSuffix.empty())
+            fKind = (fPrefix.empty() ? CONTAINS : PREFIX);
+        else if (fMiddle.empty() && fPrefix.empty())
+            fKind = SUFFIX;
+        else if (fMiddle.size() == 1 && fPrefix.empty() && fSuffix.empty())
+            fKind = CONTAINS;
+        else
+            fKind = MULTI;
+
+        return true;
+    }
+
+    /** @brief Classifies a POSIX extended regex as used by REGEXP (unanchored search).
+     *
+     * @returns true if the pattern is a literal with optional ^ and $ anchors.
+     */
+    bool compileRegexp(const char* pattern, size_t len)
+    {
+        bool anchorStart = false, anchorEnd = false;
+        reset();
+
+        if (len > 0 && pattern[0] == '^')
+        {
+            anchorStart = true;
+            pattern++;
+            len--;
+        }
+
+        if (len > 0 && pattern[len - 1] == '$')
+        {
+            anchorEnd = true;
+            len--;
+        }
+
+        for (size_t i = 0; i < len; i++)
+            if (pattern[i] == '\0' || strchr(".[]{}()\\*+?|^$", pattern[i]))
+                return false;
+
+        std::string lit(pattern, len);
+
+        if (anchorStart && anchorEnd)
+        {
+            fPrefix = lit;
+            fKind = EXACT;
+        }
+        else if (anchorStart)
+        {
+            fPrefix = lit;
+            fKind = PREFIX;
+        }
+        else if (anchorEnd)
+        {
+            fSuffix = lit;
+            fKind = SUFFIX;
+        }
+        else
+        {
+            if (!lit.empty())
+                fMiddle.push_back(lit);
+
+            fKind = CONTAINS;
+        }
+
+        return true;
+    }
+
+    bool match(const char* str, size_t len) const
+    {
+        switch (fKind)
+        {
+            case EXACT:
+                return len == fPrefix.length() && memcmp(str, fPrefix.data(), len) == 0;
+
+            case PREFIX:
+                return matchPrefix(str, len);
+
+            case SUFFIX:
+                return matchSuffix(str, len);
+
+            case CONTAINS:
+                return fMiddle.empty() || find(str, len, fMiddle[0]) != NULL;
+
+            case MULTI:
+                return matchMulti(str, len);
+
+            default:
+                return false;
+        }
+    }
+
+private:
+    void reset()
+    {
+        fKind = GENERAL;
+        fPrefix.clear();
+        fSuffix.clear();
+        fMiddle.clear();
+    }
+
+    bool matchPrefix(const char* str, size_t len) const
+    {
+        return len >= fPrefix.length() && memcmp(str, fPrefix.data(), fPrefix.length()) == 0;
+    }
+
+    bool matchSuffix(const char* str, size_t len) const
+    {
+        return len >= fSuffix.length() &&
+               memcmp(str + len - fSuffix.length(), fSuffix.data(), fSuffix.length()) == 0;
+    }
+
+    static const char* find(const char* str, size_t len, const std::string& needle)
+    {
+        return static_cast<const char*>(memmem(str, len, needle.data(), needle.length()));
+    }
+
+    // the prefix & suffix are pinned to the ends, the pieces between them
+    // are taken leftmost first, which is enough for '%' wildcards
+    bool matchMulti(const char* str, size_t len) const
+    {
+        if (len < fPrefix.length() + fSuffix.length() || !matchPrefix(str, len) || !matchSuffix(str, len))
+            return false;
+
+        const char* pos = str + fPrefix.length();
+        const char* end = str + len - fSuffix.length();
+
+        for (size_t i = 0; i < fMiddle.size(); i++)
+        {
+            const char* found = find(pos, end - pos, fMiddle[i]);
+
+            if (found == NULL)
+                return false;
+
+            pos = found + fMiddle[i].length();
+        }
+
+        return true;
+    }
+
+    Kind fKind;
+    std::string fPrefix;
+    std::string fSuffix;
+    std::vector<std::string> fMiddle;
+};
+
+}
+
+#endif
+// vim:ts=4 sw=4:
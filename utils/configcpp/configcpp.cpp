@@ -112,7 +112,7 @@ Config* Config::makeConfig(const char* cf)
 }
 
 Config::Config(const string& configFile) :
-    fDoc(0), fConfigFile(configFile), fMtime(0), fParser()
+    fDoc(0), fConfigFile(configFile), fMtime(0), fLastMtimeCheck(0), fParser()
 {
     int i = 0;
     for ( ; i < 2 ; i++ )
@@ -212,19 +212,17 @@ void Config::closeConfig(void)
 {
     xmlFreeDoc(fDoc);
     fDoc = 0;
+    fValues.clear();
 }
 
-const string Config::getConfig(const string& section, const string& name)
+void Config::reloadIfChanged(void)
 {
-    boost::recursive_mutex::scoped_lock lk(fLock);
+    time_t now = time(0);
 
-    if (section.length() == 0 || name.length() == 0)
-        throw invalid_argument("Config::getConfig: both section and name must have a length");
+    if (now == fLastMtimeCheck)
+        return;
 
-    if (fDoc == 0)
-    {
-        throw runtime_error("Config::getConfig: no XML document!");
-    }
+    fLastMtimeCheck = now;
 
     struct stat statbuf;
 
@@ -237,8 +235,33 @@ const string Config::getConfig(const string& section, const string& name)
             parseDoc();
         }
     }
+}
+
+const string Config::getConfig(const string& section, const string& name)
+{
+    boost::recursive_mutex::scoped_lock lk(fLock);
+
+    if (section.length() == 0 || name.length() == 0)
+        throw invalid_argument("Config::getConfig: both section and name must have a length");
+
+    if (fDoc == 0)
+    {
+        throw runtime_error("Config::getConfig: no XML document!");
+    }
+
+    reloadIfChanged();
+
+    string key(section);
+    key += '\0';
+    key += name;
+    valueMap_t::const_iterator it = fValues.find(key);
+
+    if (it != fValues.end())
+        return it->second;
 
-    return fParser.getConfig(fDoc, section, name);
+    string value(fParser.getConfig(fDoc, section, name));
+    fValues[key] = value;
+    return value;
 }
 
 void Config::getConfig(const string& section, const string& name, vector<string>& values)
@@ -293,6 +316,7 @@ void Config::setConfig(const string& section, const string& name, const string&
     }
 
     fParser.setConfig(fDoc, section, name, value);
+    fValues.clear();
     return;
 }
 
@@ -321,6 +345,7 @@ void Config::delConfig(const string& section, const string& name)
     }
 
     fParser.delConfig(fDoc, section, name);
+    fValues.clear();
     return;
 }
 
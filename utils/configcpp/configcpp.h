@@ -208,8 +208,17 @@ protected:
     */
     void closeConfig(void);
 
+    /** @brief reparse the XML file if it changed on disk
+    *
+    * Checks at most once a second.  Job list construction reads dozens of
+    * settings per query, and a stat() plus a walk of the XML tree for each
+    * of them, all under fLock, adds up for short queries.
+    */
+    void reloadIfChanged(void);
+
 private:
     typedef std::map<std::string, Config*> configMap_t;
+    typedef std::map<std::string, std::string> valueMap_t;
 
     /*
     */
@@ -230,8 +239,10 @@ private:
     xmlDocPtr fDoc;
     const std::string fConfigFile;
     time_t fMtime;
+    time_t fLastMtimeCheck;
     mutable boost::recursive_mutex fLock;
     XMLParser fParser;
+    valueMap_t fValues;     // getConfig() results since the file was parsed
 
 };
 
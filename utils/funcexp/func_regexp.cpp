@@ -31,6 +31,7 @@ using namespace std;
 #include <boost/regex.hpp>
 using namespace boost;
 #endif
+#include <boost/thread/tss.hpp>
 
 #include "functor_bool.h"
 #include "functioncolumn.h"
@@ -38,6 +39,8 @@ using namespace boost;
 #include "constantcolumn.h"
 using namespace execplan;
 
+#include "likematcher.h"
+
 #include "rowgroup.h"
 
 #include "errorcodes.h"
@@ -47,6 +50,28 @@ using namespace logging;
 
 namespace
 {
+#ifdef __linux__
+// The pattern is nearly always a constant, so each thread keeps the last one
+// it compiled rather than running regcomp() for every row.
+struct RegexpCache
+{
+    std::string pattern;
+    utils::LikeMatcher matcher;
+    regex_t re;
+    bool valid;
+    bool compiled;
+
+    RegexpCache() : valid(false), compiled(false) { }
+    ~RegexpCache()
+    {
+        if (compiled)
+            regfree(&re);
+    }
+};
+
+boost::thread_specific_ptr<RegexpCache> regexpCache;
+#endif
+
 inline bool getBool(rowgroup::Row& row,
                     funcexp::FunctionParm& pm,
                     bool& isNull,
@@ -216,18 +241,36 @@ inline bool getBool(rowgroup::Row& row,
 
 
 #ifdef __linux__
-    regex_t    re;
+    RegexpCache* cache = regexpCache.get();
 
-    regcomp(&re, pattern.c_str(), REG_EXTENDED | REG_NOSUB );
+    if (cache == NULL)
+    {
+        cache = new RegexpCache();
+        regexpCache.reset(cache);
+    }
+
+    if (!cache->valid || cache->pattern != pattern)
+    {
+        if (cache->compiled)
+            regfree(&cache->re);
 
-    int res = regexec(&re, expr.c_str(), 0, NULL, 0);
-    regfree(&re);
+        cache->pattern = pattern;
+        cache->valid = true;
+        cache->compiled = false;
 
-    if (res == 0)
-        return true;
-    else
+        // plain substrings, optionally anchored, skip the regex engine
+        if (!cache->matcher.compileRegexp(pattern.data(), pattern.length()))
+            cache->compiled = (regcomp(&cache->re, pattern.c_str(), REG_EXTENDED | REG_NOSUB) == 0);
+    }
+
+    if (cache->matcher.literal())
+        return cache->matcher.match(expr.c_str(), strlen(expr.c_str()));
+
+    if (!cache->compiled)
         return false;
 
+    return (regexec(&cache->re, expr.c_str(), 0, NULL, 0) == 0);
+
 #else
     regex pat(pattern.c_str());
     return regex_search(expr.c_str(), pat);
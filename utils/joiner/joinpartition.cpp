@@ -67,7 +67,7 @@ JoinPartition::JoinPartition(const RowGroup& lRG,
     nextPartitionToReturn(0), htSizeEstimate(0), htTargetSize(partitionSize), rootNode(true),
     antiWithMatchNulls(antiWMN), needsAllNullRows(hasFEFilter), gotNullRow(false),
     totalBytesRead(0), totalBytesWritten(0), maxLargeSize(0), maxSmallSize(0),
-    nextSmallOffset(0), nextLargeOffset(0)
+    nextSmallOffset(0), nextLargeOffset(0), skewed(false), deferSplit(false), skewKey(0), moreSmallChunks(false)
 {
     config::Config* config = config::Config::makeConfig();
     string cfgTxt;
@@ -116,7 +116,7 @@ JoinPartition::JoinPartition(const JoinPartition& jp, bool splitMode) :
     needsAllNullRows(jp.needsAllNullRows), gotNullRow(false),
     useCompression(jp.useCompression), totalBytesRead(0),
     totalBytesWritten(0), maxLargeSize(0), maxSmallSize(0),
-    nextSmallOffset(0), nextLargeOffset(0)
+    nextSmallOffset(0), nextLargeOffset(0), skewed(false), deferSplit(false), skewKey(0), moreSmallChunks(false)
 {
     boost::posix_time::ptime t;
     ostringstream os;
@@ -294,11 +294,11 @@ int64_t JoinPartition::convertToSplitMode()
     int i, j;
     ByteStream bs;
     RGData rgData;
-    uint32_t hash;
-    uint64_t tmp;
+    uint32_t hash, keyHash, firstKey = 0;
     int64_t ret = -(int64_t)smallSizeOnDisk;    // smallFile gets deleted
     boost::scoped_array<uint32_t> rowDist(new uint32_t[bucketCount]);
     uint32_t rowCount = 0;
+    bool singleKey = true;
 
     memset(rowDist.get(), 0, sizeof(uint32_t) * bucketCount);
     fileMode = false;
@@ -306,8 +306,13 @@ int64_t JoinPartition::convertToSplitMode()
     smallSizeOnDisk = 0;
     buckets.reserve(bucketCount);
 
+    /* The new partitions don't split while the rows are redistributed, they're
+       checked once all the rows are in. */
     for (i = 0; i < (int) bucketCount; i++)
+    {
         buckets.push_back(boost::shared_ptr<JoinPartition>(new JoinPartition(*this, false)));
+        buckets[i]->deferSplit = true;
+    }
 
     RowGroup& rg = smallRG;
     Row& row = smallRow;
@@ -340,19 +345,14 @@ int64_t JoinPartition::convertToSplitMode()
                 continue;
             }
 
-            if (typelessJoin)
-                hash = getHashOfTypelessKey(row, smallKeyCols, hashSeed) % bucketCount;
-            else
-            {
-                if (UNLIKELY(row.isUnsigned(smallKeyCols[0])))
-                    tmp = row.getUintField(smallKeyCols[0]);
-                else
-                    tmp = row.getIntField(smallKeyCols[0]);
+            keyHash = hashSmallKey(row, 0);
 
-                hash = hasher((char*) &tmp, 8, hashSeed);
-                hash = hasher.finalize(hash, 8) % bucketCount;
-            }
+            if (rowCount == 0)
+                firstKey = keyHash;
+            else if (keyHash != firstKey)
+                singleKey = false;
 
+            hash = hashSmallKey(row, hashSeed) % bucketCount;
             rowCount++;
             rowDist[hash]++;
             ret += buckets[hash]->insertSmallSideRow(row);
@@ -362,9 +362,26 @@ int64_t JoinPartition::convertToSplitMode()
     boost::filesystem::remove(smallFilename);
     smallFilename.clear();
 
+    /* A partition that got every row of a single key can never be split.  The key
+       is a heavy hitter, the partition stays as it is and is handed out in chunks
+       by getNextPartition().  The rest split further if they're still too big. */
     for (i = 0; i < (int) bucketCount; i++)
-        if (rowDist[i] == rowCount)
-            throw IDBExcept("All rows hashed to the same bucket", ERR_DBJ_DATA_DISTRIBUTION);
+    {
+        buckets[i]->deferSplit = false;
+
+        if (rowDist[i] == rowCount && singleKey)
+        {
+            buckets[i]->skewed = true;
+            buckets[i]->skewKey = firstKey;
+            continue;
+        }
+
+        if (buckets[i]->smallRG.getRowCount() > 0)
+            ret += buckets[i]->processSmallBuffer();
+
+        if (buckets[i]->htSizeEstimate > htTargetSize)
+            ret += buckets[i]->convertToSplitMode();
+    }
 
     rg.setData(&buffer);
     rg.resetRowGroup(0);
@@ -401,6 +418,25 @@ int64_t JoinPartition::processSmallBuffer(RGData& rgData)
     if (fileMode)
     {
         ByteStream bs;
+
+        /* it stays a heavy-hitter partition only while no other key shows up */
+        if (skewed)
+        {
+            rg.getRow(0, &row);
+
+            for (uint32_t i = 0; i < rg.getRowCount(); i++, row.nextRow())
+            {
+                if (antiWithMatchNulls && hasNullJoinColumn(row))
+                    continue;
+
+                if (hashSmallKey(row, 0) != skewKey)
+                {
+                    skewed = false;
+                    break;
+                }
+            }
+        }
+
         rg.serializeRGData(bs);
         //cout << "writing RGData: " << rg.toString() << endl;
 
@@ -415,7 +451,7 @@ int64_t JoinPartition::processSmallBuffer(RGData& rgData)
         */
         htSizeEstimate += rg.getDataSize() + (34 * rg.getRowCount());
 
-        if (htSizeEstimate > htTargetSize)
+        if (htSizeEstimate > htTargetSize && !skewed && !deferSplit)
             ret += convertToSplitMode();
 
         //cout << "wrote some data, returning " << ret << endl;
@@ -552,27 +588,12 @@ bool JoinPartition::getNextPartition(vector<RGData>* smallData, uint64_t* partit
 
     if (fileMode)
     {
-        ByteStream bs;
-        RGData rgData;
-
         if (nextPartitionToReturn > 0)
             return false;
 
         //cout << "reading the small side" << endl;
         nextSmallOffset = 0;
-
-        while (1)
-        {
-            readByteStream(0, &bs);
-
-            if (bs.length() == 0)
-                break;
-
-            rgData.deserialize(bs);
-            //smallRG.setData(&rgData);
-            //cout << "read a smallRG with " << smallRG.getRowCount() << " rows" << endl;
-            smallData->push_back(rgData);
-        }
+        readSmallSide(smallData);
 
         nextPartitionToReturn = 1;
         *partitionID = uniqueID;
@@ -593,6 +614,52 @@ bool JoinPartition::getNextPartition(vector<RGData>* smallData, uint64_t* partit
     return ret;
 }
 
+/* A heavy-hitter partition's small side comes back htTargetSize at a time, the
+   rest of the partitions come back whole. */
+void JoinPartition::readSmallSide(vector<RGData>* smallData)
+{
+    ByteStream bs;
+    RGData rgData;
+    RowGroup l_smallRG = smallRG;
+    uint64_t chunkSize = 0;
+
+    moreSmallChunks = false;
+
+    while (1)
+    {
+        readByteStream(0, &bs);
+
+        if (bs.length() == 0)
+            break;
+
+        rgData.deserialize(bs);
+        //cout << "read a smallRG with " << smallRG.getRowCount() << " rows" << endl;
+        smallData->push_back(rgData);
+
+        if (skewed)
+        {
+            l_smallRG.setData(&rgData);
+            chunkSize += l_smallRG.getDataSize() + (34 * l_smallRG.getRowCount());
+
+            if (chunkSize > htTargetSize)
+            {
+                moreSmallChunks = true;
+                break;
+            }
+        }
+    }
+}
+
+bool JoinPartition::getNextSmallChunk(vector<RGData>* smallData)
+{
+    if (!moreSmallChunks)
+        return false;
+
+    readSmallSide(smallData);
+    nextLargeOffset = 0;
+    return true;
+}
+
 boost::shared_ptr<RGData> JoinPartition::getNextLargeRGData()
 {
     boost::shared_ptr<RGData> ret;
@@ -605,7 +672,7 @@ boost::shared_ptr<RGData> JoinPartition::getNextLargeRGData()
         ret.reset(new RGData());
         ret->deserialize(bs);
     }
-    else
+    else if (!moreSmallChunks)
     {
         boost::filesystem::remove(largeFilename);
         largeSizeOnDisk = 0;
@@ -614,6 +681,23 @@ boost::shared_ptr<RGData> JoinPartition::getNextLargeRGData()
     return ret;
 }
 
+uint32_t JoinPartition::hashSmallKey(Row& row, uint32_t seed)
+{
+    uint64_t tmp;
+    uint32_t hash;
+
+    if (typelessJoin)
+        return getHashOfTypelessKey(row, smallKeyCols, seed);
+
+    if (UNLIKELY(row.isUnsigned(smallKeyCols[0])))
+        tmp = row.getUintField(smallKeyCols[0]);
+    else
+        tmp = row.getIntField(smallKeyCols[0]);
+
+    hash = hasher((char*) &tmp, 8, seed);
+    return hasher.finalize(hash, 8);
+}
+
 bool JoinPartition::hasNullJoinColumn(Row& r)
 {
     for (uint32_t i = 0; i < smallKeyCols.size(); i++)
@@ -828,6 +912,19 @@ uint64_t JoinPartition::writeByteStream(int which, ByteStream& bs)
     return ret;
 }
 
+uint32_t JoinPartition::getSkewedPartitionCount()
+{
+    uint32_t ret = 0;
+
+    if (fileMode)
+        return (skewed ? 1 : 0);
+
+    for (int i = 0; i < (int) bucketCount; i++)
+        ret += buckets[i]->getSkewedPartitionCount();
+
+    return ret;
+}
+
 uint64_t JoinPartition::getBytesRead()
 {
     uint64_t ret;
@@ -61,6 +61,12 @@ public:
     bool getNextPartition(std::vector<rowgroup::RGData>* smallData, uint64_t* partitionID,
                           JoinPartition** jp);
 
+    /* A partition of a single heavy-hitter key can't be split, getNextPartition()
+       returns the first chunk of its small side that fits in a hash table.  This
+       appends the next chunk to smallData & rewinds the large side, so the chunk
+       can be joined to all of it.  Returns false when there are no more chunks. */
+    bool getNextSmallChunk(std::vector<rowgroup::RGData>* smallData);
+
     boost::shared_ptr<rowgroup::RGData> getNextLargeRGData();
 
     /* It's important to follow the sequence of operations to maintain the correct
@@ -103,6 +109,7 @@ public:
 
     uint64_t getBytesRead();
     uint64_t getBytesWritten();
+    uint32_t getSkewedPartitionCount();
     uint64_t getMaxLargeSize()
     {
         return maxLargeSize;
@@ -121,6 +128,7 @@ private:
 
     int64_t processSmallBuffer(rowgroup::RGData&);
     int64_t processLargeBuffer(rowgroup::RGData&);
+    void readSmallSide(std::vector<rowgroup::RGData>* smallData);
 
     rowgroup::RowGroup smallRG;
     rowgroup::RowGroup largeRG;
@@ -174,6 +182,15 @@ private:
     /* file descriptor reduction */
     size_t nextSmallOffset;
     size_t nextLargeOffset;
+
+    /* Heavy-hitter support.  A skewed partition holds the rows of one key and
+       doesn't split, its small side is read back in chunks.  deferSplit holds off
+       splitting while convertToSplitMode() redistributes rows into a partition. */
+    bool skewed;
+    bool deferSplit;
+    uint32_t skewKey;   // hashSmallKey(row, 0) of the key
+    bool moreSmallChunks;
+    uint32_t hashSmallKey(rowgroup::Row&, uint32_t seed);
 };
 
 
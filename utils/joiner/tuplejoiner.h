@@ -100,6 +100,20 @@ extern TypelessData makeTypelessKey(const rowgroup::Row&,
 extern uint64_t getHashOfTypelessKey(const rowgroup::Row&, const std::vector<uint32_t>&,
                                      uint32_t seed = 0);
 
+/* On a shuffle join this picks the PM that owns a join key.  hash is the key itself
+ * on a typed join, or TypelessData::hash() on a typeless join.  It's remixed because
+ * the PMs pick hash table buckets from the low bits of the same values.
+ */
+inline uint32_t shufflePartition(uint64_t hash, uint32_t partCount)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return (hash >> 32) % partCount;
+}
+
 class TypelessDataStructure
 {
 public:
@@ -375,6 +389,22 @@ public:
     }
     void setConvertToDiskJoin();
 
+    /* Shuffle join support.  A partitioned PM join spreads its small side across
+       the PMs by key instead of sending all of it to every PM. */
+    bool partitionedOnPM() const
+    {
+        return !pmPartitions.empty();
+    }
+    /* parts has the small side row #s of each PM's partition, it's swapped in */
+    void setPartitionedOnPM(std::vector<std::vector<uint32_t> >& parts)
+    {
+        pmPartitions.swap(parts);
+    }
+    const std::vector<std::vector<uint32_t> >& getPmPartitions() const
+    {
+        return pmPartitions;
+    }
+
 private:
     typedef std::tr1::unordered_multimap<int64_t, uint8_t*, hasher, std::equal_to<int64_t>,
             utils::STLPoolAllocator<std::pair<const int64_t, uint8_t*> > > hash_t;
@@ -466,6 +496,7 @@ private:
     void bucketsToTables(buckets_t *, hash_table_t *);
 
     bool _convertToDiskJoin;
+    std::vector<std::vector<uint32_t> > pmPartitions;
 };
 
 }
@@ -132,6 +132,32 @@ void CompressedInetStreamSocket::write(SBS msg, Stats* stats)
     write(*msg, stats);
 }
 
+/* Same choice as write(): the compressed form if it's smaller. */
+void CompressedInetStreamSocket::frame(const ByteStream& msg, ByteStream& out) const
+{
+    size_t outLen = 0;
+    uint32_t len = msg.length();
+
+    if (useCompression && (len > 512))
+    {
+        ByteStream smsg(alg.maxCompressedSize(len));
+
+        alg.compress((char*) msg.buf(), len, (char*) smsg.getInputPtr(), &outLen);
+
+        if (outLen < len)
+        {
+            out.restart();
+            out.needAtLeast(outLen + 2 * sizeof(uint32_t));
+            out << (uint32_t) COMPRESSED_BYTESTREAM_MAGIC;
+            out << (uint32_t) outLen;
+            out.append(smsg.getInputPtr(), outLen);
+            return;
+        }
+    }
+
+    InetStreamSocket::frame(msg, out);
+}
+
 /* this was cut & pasted from InetStreamSocket;
  * is there a clean way to wrap ISS::accept()?
  */
@@ -51,6 +51,7 @@ public:
                            Stats* stats = NULL) const;
     virtual void write(const ByteStream& msg, Stats* stats = NULL);
     virtual void write(SBS msg, Stats* stats = NULL);
+    virtual void frame(const ByteStream& msg, ByteStream& out) const;
     virtual const IOSocket accept(const struct timespec* timeout);
     virtual void connect(const sockaddr* addr);
 private:
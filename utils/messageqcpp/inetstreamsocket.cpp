@@ -719,6 +719,18 @@ void InetStreamSocket::write(const ByteStream& msg, Stats* stats)
     do_write(msg, BYTESTREAM_MAGIC, stats);
 }
 
+void InetStreamSocket::frame(const ByteStream& msg, ByteStream& out) const
+{
+    out.restart();
+
+    if (msg.length() == 0) return;
+
+    out.needAtLeast(msg.length() + 2 * sizeof(uint32_t));
+    out << (uint32_t) BYTESTREAM_MAGIC;
+    out << (uint32_t) msg.length();
+    out.append(msg.buf(), msg.length());
+}
+
 void InetStreamSocket::write_raw(const ByteStream& msg, Stats* stats) const
 {
     uint32_t msglen = msg.length();
@@ -134,6 +134,10 @@ public:
      */
     virtual void write(SBS msg, Stats* stats = NULL);
 
+    /** build the bytes write() would send for msg, magic & length included
+     */
+    virtual void frame(const ByteStream& msg, ByteStream& out) const;
+
     /** bind to a port
      *
      */
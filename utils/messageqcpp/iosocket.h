@@ -98,6 +98,10 @@ public:
     EXPORT virtual void write_raw(const ByteStream& msg, Stats* stats = NULL) const;
     EXPORT virtual void write(SBS msg, Stats* stats = NULL) const;
 
+    /** build the bytes write() would send for msg, see Socket::frame()
+     */
+    EXPORT virtual void frame(const ByteStream& msg, ByteStream& out) const;
+
     /** access the sockaddr member
      */
     inline virtual const sockaddr sa() const;
@@ -259,6 +263,11 @@ inline void IOSocket::write(SBS msg, Stats* stats) const
     idbassert(fSocket);
     fSocket->write(msg, stats);
 }
+inline void IOSocket::frame(const ByteStream& msg, ByteStream& out) const
+{
+    idbassert(fSocket);
+    fSocket->frame(msg, out);
+}
 inline const SocketParms IOSocket::socketParms() const
 {
     idbassert(fSocket);
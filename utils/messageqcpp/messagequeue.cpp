@@ -354,6 +354,54 @@ void MessageQueueClient::write(const ByteStream& msg, const struct timespec* tim
     }
 }
 
+void MessageQueueClient::write_raw(const ByteStream& msg, const struct timespec* timeout, Stats* stats) const
+{
+    if (!fClientSock.isOpen())
+    {
+        fClientSock.open();
+
+        try
+        {
+            fClientSock.connectionTimeout(timeout);
+            fClientSock.connect(&fServ_addr);
+        }
+        catch (...)
+        {
+            fClientSock.close();
+            throw;
+        }
+    }
+
+    try
+    {
+        fClientSock.write_raw(msg, stats);
+    }
+    catch (runtime_error& e)
+    {
+        try
+        {
+            ostringstream oss;
+            oss << "MessageQueueClient::write_raw: error writing " << msg.length() << " bytes to "
+                << fClientSock << ". Socket error was " << e.what() << endl;
+            logging::Message::Args args;
+            logging::LoggingID li(31);
+            args.add(oss.str());
+            fLogger.logMessage(logging::LOG_TYPE_WARNING, logging::M0000, args, li);
+        }
+        catch (...)
+        {
+        }
+
+        fClientSock.close();
+        throw;
+    }
+}
+
+void MessageQueueClient::frame(const ByteStream& msg, ByteStream& out) const
+{
+    fClientSock.frame(msg, out);
+}
+
 bool MessageQueueClient::connect() const
 {
     if (!fClientSock.isOpen())
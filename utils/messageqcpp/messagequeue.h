@@ -210,6 +210,22 @@ public:
      */
     EXPORT void write(const ByteStream& msg, const struct timespec* timeout = 0, Stats* stats = NULL) const;
 
+    /**
+     * @brief write a message built by frame() to the queue
+     *
+     * Same as write() except that msg goes out as is.  It isn't modified, so several
+     * threads can send the same frame to different clients at once.
+     */
+    EXPORT void write_raw(const ByteStream& msg, const struct timespec* timeout = 0, Stats* stats = NULL) const;
+
+    /**
+     * @brief build the bytes write() would send for msg
+     *
+     * The result is valid for any client of the same kind, e.g. to compress a message once
+     * that goes to several servers.
+     */
+    EXPORT void frame(const ByteStream& msg, ByteStream& out) const;
+
     /**
      * @brief shutdown the connection to the server
      *
@@ -98,6 +98,12 @@ public:
     virtual void write_raw(const ByteStream& msg, Stats* stats = NULL) const = 0;
     virtual void write(SBS msg, Stats* stats = NULL) = 0;
 
+    /** build the bytes write() would send for msg
+     *
+     * The result can go to any number of sockets of the same kind with write_raw().
+     */
+    virtual void frame(const ByteStream& msg, ByteStream& out) const = 0;
+
     /** close the socket
      *
      */
@@ -0,0 +1,245 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <sstream>
+#include <cstring>
+#include <typeinfo>
+#include "approx_count_distinct.h"
+#include "bytestream.h"
+#include "objectreader.h"
+
+using namespace mcsv1sdk;
+
+class Add_approx_count_distinct_ToUDAFMap
+{
+public:
+    Add_approx_count_distinct_ToUDAFMap()
+    {
+        UDAFMap::getMap()["approx_count_distinct"] = new approx_count_distinct();
+    }
+};
+
+static Add_approx_count_distinct_ToUDAFMap addToMap;
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::init(mcsv1Context* context,
+        ColumnDatum* colTypes)
+{
+    if (context->getParameterCount() != 1)
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_count_distinct() with other than 1 argument");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    context->setResultType(execplan::CalpontSystemCatalog::BIGINT);
+    context->setColWidth(8);
+    context->setRunFlag(mcsv1sdk::UDAF_IGNORE_NULLS);
+    context->setRunFlag(mcsv1sdk::UDAF_BATCH);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::reset(mcsv1Context* context)
+{
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    data->fSketch.clear();
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::nextValue(mcsv1Context* context, ColumnDatum* valsIn)
+{
+    static_any::any& valIn = valsIn[0].columnData;
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+
+    if (valIn.empty())
+    {
+        return mcsv1_UDAF::SUCCESS; // Ought not happen when UDAF_IGNORE_NULLS is on.
+    }
+
+    // Hash the value in a canonical form so that equal values hash the same
+    // regardless of the width they were stored with.
+    if (valIn.compatible(strTypeId))
+    {
+        const std::string& val = valIn.cast<std::string>();
+        data->fSketch.add(val.data(), val.length());
+    }
+    else if (valIn.compatible(doubleTypeId) || valIn.compatible(floatTypeId))
+    {
+        double val = convertAnyTo<double>(valIn);
+
+        if (val == 0)
+            val = 0;   // -0.0 == 0.0
+
+        data->fSketch.add(&val, sizeof(val));
+    }
+    else if (valsIn[0].dataType == execplan::CalpontSystemCatalog::LONGDOUBLE)
+    {
+        long double val = valIn.cast<long double>();
+
+        if (val == 0)
+            val = 0;
+
+        // only 10 of the bytes of an x86 long double are significant
+        data->fSketch.add(&val, std::min(sizeof(val), (size_t) 10));
+    }
+    else if (valIn.compatible(int128TypeId))
+    {
+        int128_t val = valIn.cast<int128_t>();
+        data->fSketch.add(&val, sizeof(val));
+    }
+    else
+    {
+        int64_t val = convertAnyTo<int64_t>(valIn);
+        data->fSketch.add(&val, sizeof(val));
+    }
+
+    return mcsv1_UDAF::SUCCESS;
+}
+
+// Hashes the same canonical forms as nextValue()
+mcsv1_UDAF::ReturnCode approx_count_distinct::nextValues(mcsv1Context* context, uint32_t rowCount,
+        ColumnBatch* colsIn, const uint32_t* groups, UserData** userData)
+{
+    const ColumnBatch& col = colsIn[0];
+    uint32_t i;
+
+    switch (col.dataType)
+    {
+        case execplan::CalpontSystemCatalog::FLOAT:
+        case execplan::CalpontSystemCatalog::DOUBLE:
+            for (i = 0; i < rowCount; i++)
+            {
+                double val = (col.dataType == execplan::CalpontSystemCatalog::FLOAT ?
+                              col.getValues<float>()[i] : col.getValues<double>()[i]);
+
+                if (val == 0)
+                    val = 0;
+
+                sketchOf(userData[groups[i]]).add(&val, sizeof(val));
+            }
+
+            break;
+
+        case execplan::CalpontSystemCatalog::LONGDOUBLE:
+            for (i = 0; i < rowCount; i++)
+            {
+                long double val = col.getValues<long double>()[i];
+
+                if (val == 0)
+                    val = 0;
+
+                sketchOf(userData[groups[i]]).add(&val, std::min(sizeof(val), (size_t) 10));
+            }
+
+            break;
+
+        case execplan::CalpontSystemCatalog::BIGINT:
+        case execplan::CalpontSystemCatalog::UBIGINT:
+        case execplan::CalpontSystemCatalog::DECIMAL:
+        case execplan::CalpontSystemCatalog::UDECIMAL:
+            // uint64_t values hash as the int64_t with the same bits
+            for (i = 0; i < rowCount; i++)
+            {
+                if (col.colWidth == datatypes::MAXDECIMALWIDTH)
+                    sketchOf(userData[groups[i]]).add(&col.getValues<int128_t>()[i], sizeof(int128_t));
+                else
+                    sketchOf(userData[groups[i]]).add(&col.getValues<int64_t>()[i], sizeof(int64_t));
+            }
+
+            break;
+
+        default:
+            for (i = 0; i < rowCount; i++)
+            {
+                const std::string& val = col.getValues<std::string>()[i];
+                sketchOf(userData[groups[i]]).add(val.data(), val.length());
+            }
+
+            break;
+    }
+
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::subEvaluate(mcsv1Context* context, const UserData* userDataIn)
+{
+    if (!userDataIn)
+    {
+        return mcsv1_UDAF::SUCCESS;
+    }
+
+    ApproxCountDistinctData* outData = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    const ApproxCountDistinctData* inData = static_cast<const ApproxCountDistinctData*>(userDataIn);
+
+    outData->fSketch.merge(inData->fSketch);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_count_distinct::evaluate(mcsv1Context* context, static_any::any& valOut)
+{
+    ApproxCountDistinctData* data = static_cast<ApproxCountDistinctData*>(context->getUserData());
+    valOut = (int64_t) data->fSketch.estimate();
+    return mcsv1_UDAF::SUCCESS;
+}
+
+void ApproxCountDistinctData::serialize(messageqcpp::ByteStream& bs) const
+{
+    const std::vector<uint32_t>& sparse = fSketch.sparse();
+    const std::vector<uint8_t>& registers = fSketch.registers();
+
+    bs << (uint32_t) sparse.size();
+
+    if (!sparse.empty())
+        bs.append((const uint8_t*) &sparse[0], sparse.size() * sizeof(uint32_t));
+
+    bs << (uint32_t) registers.size();
+
+    if (!registers.empty())
+        bs.append(&registers[0], registers.size());
+}
+
+void ApproxCountDistinctData::unserialize(messageqcpp::ByteStream& bs)
+{
+    std::vector<uint32_t> sparse;
+    std::vector<uint8_t> registers;
+    uint32_t count;
+
+    bs >> count;
+    sparse.resize(count);
+
+    if (count > 0)
+    {
+        memcpy(&sparse[0], bs.buf(), count * sizeof(uint32_t));
+        bs.advance(count * sizeof(uint32_t));
+    }
+
+    bs >> count;
+
+    if (count != 0 && count != HyperLogLog::RegisterCount)
+        throw std::runtime_error("ApproxCountDistinctData::unserialize with bad sketch size");
+
+    registers.resize(count);
+
+    if (count > 0)
+    {
+        memcpy(&registers[0], bs.buf(), count);
+        bs.advance(count);
+    }
+
+    fSketch.load(sparse, registers);
+}
+
@@ -0,0 +1,111 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/***********************************************************************
+*   $Id$
+*
+*   approx_count_distinct.h
+***********************************************************************/
+
+/**
+ * Columnstore interface for the approx_count_distinct function
+ *
+ *    CREATE AGGREGATE FUNCTION approx_count_distinct returns INTEGER soname 'libregr_mysql.so';
+ *
+ * approx_count_distinct(x) estimates COUNT(DISTINCT x) with a HyperLogLog
+ * sketch.  Unlike COUNT(DISTINCT) it doesn't keep the distinct values, each
+ * PM builds a sketch per group and the UM merges them.  The standard error is
+ * about 0.8%; NULLs are ignored.
+ */
+#ifndef HEADER_approx_count_distinct
+#define HEADER_approx_count_distinct
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mcsv1_udaf.h"
+#include "calpontsystemcatalog.h"
+#include "windowfunctioncolumn.h"
+#include "approxsketch.h"
+
+#if defined(_MSC_VER) && defined(xxxRGNODE_DLLEXPORT)
+#define EXPORT __declspec(dllexport)
+#else
+#define EXPORT
+#endif
+
+namespace mcsv1sdk
+{
+
+// Override UserData for data storage
+struct ApproxCountDistinctData : public UserData
+{
+    ApproxCountDistinctData() {};
+    virtual ~ApproxCountDistinctData() {};
+
+    virtual void serialize(messageqcpp::ByteStream& bs) const;
+    virtual void unserialize(messageqcpp::ByteStream& bs);
+
+    HyperLogLog fSketch;
+
+private:
+    // For now, copy construction is unwanted
+    ApproxCountDistinctData(UserData&);
+};
+
+class approx_count_distinct : public  mcsv1_UDAF
+{
+public:
+    // Defaults OK
+    approx_count_distinct() : mcsv1_UDAF() {};
+    virtual ~approx_count_distinct() {};
+
+    virtual ReturnCode init(mcsv1Context* context,
+                            ColumnDatum* colTypes);
+
+    virtual ReturnCode reset(mcsv1Context* context);
+
+    virtual ReturnCode nextValue(mcsv1Context* context, ColumnDatum* valsIn);
+
+    virtual ReturnCode nextValues(mcsv1Context* context, uint32_t rowCount, ColumnBatch* colsIn,
+                                  const uint32_t* groups, UserData** userData);
+
+    virtual ReturnCode subEvaluate(mcsv1Context* context, const UserData* valIn);
+
+    virtual ReturnCode evaluate(mcsv1Context* context, static_any::any& valOut);
+
+    virtual ReturnCode createUserData(UserData*& userData, int32_t& length)
+    {
+        userData = new ApproxCountDistinctData;
+        length = sizeof(ApproxCountDistinctData);
+        return mcsv1_UDAF::SUCCESS;
+    }
+
+private:
+    static HyperLogLog& sketchOf(UserData* userData)
+    {
+        return static_cast<ApproxCountDistinctData*>(userData)->fSketch;
+    }
+};
+
+};  // namespace
+
+#undef EXPORT
+
+#endif // HEADER_approx_count_distinct.h
+
@@ -0,0 +1,244 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+#include <sstream>
+#include <cstring>
+#include <typeinfo>
+#include "approx_percentile.h"
+#include "bytestream.h"
+#include "objectreader.h"
+
+using namespace mcsv1sdk;
+
+class Add_approx_percentile_ToUDAFMap
+{
+public:
+    Add_approx_percentile_ToUDAFMap()
+    {
+        UDAFMap::getMap()["approx_percentile"] = new approx_percentile();
+    }
+};
+
+static Add_approx_percentile_ToUDAFMap addToMap;
+
+mcsv1_UDAF::ReturnCode approx_percentile::init(mcsv1Context* context,
+        ColumnDatum* colTypes)
+{
+    if (context->getParameterCount() != 2)
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_percentile() with other than 2 arguments");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    if (!(datatypes::isNumeric(colTypes[0].dataType) && datatypes::isNumeric(colTypes[1].dataType)))
+    {
+        // The error message will be prepended with
+        // "The storage engine for the table doesn't support "
+        context->setErrorMessage("approx_percentile() with a non-numeric argument");
+        return mcsv1_UDAF::ERROR;
+    }
+
+    context->setResultType(execplan::CalpontSystemCatalog::DOUBLE);
+    context->setColWidth(8);
+    context->setScale(colTypes[0].scale + 4);
+    context->setPrecision(19);
+    context->setRunFlag(mcsv1sdk::UDAF_IGNORE_NULLS);
+    context->setRunFlag(mcsv1sdk::UDAF_BATCH);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::reset(mcsv1Context* context)
+{
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+    data->fDigest.clear();
+    data->fFraction = -1;
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::nextValue(mcsv1Context* context, ColumnDatum* valsIn)
+{
+    static_any::any& valIn = valsIn[0].columnData;
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+
+    if (valIn.empty() || valsIn[1].columnData.empty())
+    {
+        return mcsv1_UDAF::SUCCESS; // Ought not happen when UDAF_IGNORE_NULLS is on.
+    }
+
+    if (data->fFraction < 0)
+    {
+        double fraction = convertAnyTo<double>(valsIn[1].columnData);
+
+        if (fraction != 0 && valsIn[1].scale > 0)
+            fraction /= pow(10.0, (double)valsIn[1].scale);
+
+        if (!(fraction >= 0 && fraction <= 1))
+        {
+            context->setErrorMessage("approx_percentile() with a fraction outside of [0, 1]");
+            return mcsv1_UDAF::ERROR;
+        }
+
+        data->fFraction = fraction;
+    }
+
+    double val;
+
+    if (valsIn[0].dataType == execplan::CalpontSystemCatalog::LONGDOUBLE)
+        val = valIn.cast<long double>();
+    else
+        val = convertAnyTo<double>(valIn);
+
+    // For decimal types, we need to move the decimal point.
+    uint32_t scale = valsIn[0].scale;
+
+    if (val != 0 && scale > 0)
+    {
+        val /= pow(10.0, (double)scale);
+    }
+
+    data->fDigest.add(val);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+// The value of row i of a numeric column
+static double batchValue(const ColumnBatch& col, uint32_t i)
+{
+    switch (col.dataType)
+    {
+        case execplan::CalpontSystemCatalog::BIGINT:
+            return col.getValues<int64_t>()[i];
+
+        case execplan::CalpontSystemCatalog::UBIGINT:
+            return col.getValues<uint64_t>()[i];
+
+        case execplan::CalpontSystemCatalog::DECIMAL:
+        case execplan::CalpontSystemCatalog::UDECIMAL:
+            if (col.colWidth == datatypes::MAXDECIMALWIDTH)
+                return (double) col.getValues<int128_t>()[i];
+
+            return col.getValues<int64_t>()[i];
+
+        case execplan::CalpontSystemCatalog::FLOAT:
+            return col.getValues<float>()[i];
+
+        case execplan::CalpontSystemCatalog::LONGDOUBLE:
+            return col.getValues<long double>()[i];
+
+        default:
+            return col.getValues<double>()[i];
+    }
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::nextValues(mcsv1Context* context, uint32_t rowCount,
+        ColumnBatch* colsIn, const uint32_t* groups, UserData** userData)
+{
+    // For decimal types, we need to move the decimal point.
+    double divisor = pow(10.0, (double)colsIn[0].scale);
+    double fractionDivisor = pow(10.0, (double)colsIn[1].scale);
+
+    for (uint32_t i = 0; i < rowCount; i++)
+    {
+        ApproxPercentileData* data = static_cast<ApproxPercentileData*>(userData[groups[i]]);
+
+        if (data->fFraction < 0)
+        {
+            double fraction = batchValue(colsIn[1], i) / fractionDivisor;
+
+            if (!(fraction >= 0 && fraction <= 1))
+            {
+                context->setErrorMessage("approx_percentile() with a fraction outside of [0, 1]");
+                return mcsv1_UDAF::ERROR;
+            }
+
+            data->fFraction = fraction;
+        }
+
+        data->fDigest.add(batchValue(colsIn[0], i) / divisor);
+    }
+
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::subEvaluate(mcsv1Context* context, const UserData* userDataIn)
+{
+    if (!userDataIn)
+    {
+        return mcsv1_UDAF::SUCCESS;
+    }
+
+    ApproxPercentileData* outData = static_cast<ApproxPercentileData*>(context->getUserData());
+    const ApproxPercentileData* inData = static_cast<const ApproxPercentileData*>(userDataIn);
+
+    if (outData->fFraction < 0)
+        outData->fFraction = inData->fFraction;
+
+    outData->fDigest.merge(inData->fDigest);
+    return mcsv1_UDAF::SUCCESS;
+}
+
+mcsv1_UDAF::ReturnCode approx_percentile::evaluate(mcsv1Context* context, static_any::any& valOut)
+{
+    ApproxPercentileData* data = static_cast<ApproxPercentileData*>(context->getUserData());
+
+    if (!data->fDigest.empty() && data->fFraction >= 0)
+    {
+        valOut = data->fDigest.quantile(data->fFraction);
+    }
+
+    return mcsv1_UDAF::SUCCESS;
+}
+
+void ApproxPercentileData::serialize(messageqcpp::ByteStream& bs) const
+{
+    const std::vector<TDigest::Centroid>& centroids = fDigest.centroids();
+    const std::vector<TDigest::Centroid>& buffer = fDigest.buffer();
+
+    bs << fFraction;
+    bs << fDigest.min();
+    bs << fDigest.max();
+    bs << (uint32_t) (centroids.size() + buffer.size());
+
+    if (!centroids.empty())
+        bs.append((const uint8_t*) &centroids[0], centroids.size() * sizeof(TDigest::Centroid));
+
+    if (!buffer.empty())
+        bs.append((const uint8_t*) &buffer[0], buffer.size() * sizeof(TDigest::Centroid));
+}
+
+void ApproxPercentileData::unserialize(messageqcpp::ByteStream& bs)
+{
+    std::vector<TDigest::Centroid> centroids;
+    double min, max;
+    uint32_t count;
+
+    bs >> fFraction;
+    bs >> min;
+    bs >> max;
+    bs >> count;
+    centroids.resize(count);
+
+    if (count > 0)
+    {
+        memcpy(&centroids[0], bs.buf(), count * sizeof(TDigest::Centroid));
+        bs.advance(count * sizeof(TDigest::Centroid));
+    }
+
+    fDigest.load(min, max, centroids);
+}
+
@@ -0,0 +1,107 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/***********************************************************************
+*   $Id$
+*
+*   approx_percentile.h
+***********************************************************************/
+
+/**
+ * Columnstore interface for the approx_percentile function
+ *
+ *    CREATE AGGREGATE FUNCTION approx_percentile returns REAL soname 'libregr_mysql.so';
+ *
+ * approx_percentile(x, p) estimates the value below which a fraction p of the
+ * numeric x values fall, e.g. approx_percentile(latency, 0.95).  p must be a
+ * constant between 0 and 1.  The values are summarized by a t-digest built on
+ * each PM and merged on the UM, rather than sorted; the estimate is closest
+ * near the tails.  NULLs are ignored.
+ */
+#ifndef HEADER_approx_percentile
+#define HEADER_approx_percentile
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "mcsv1_udaf.h"
+#include "calpontsystemcatalog.h"
+#include "windowfunctioncolumn.h"
+#include "approxsketch.h"
+
+#if defined(_MSC_VER) && defined(xxxRGNODE_DLLEXPORT)
+#define EXPORT __declspec(dllexport)
+#else
+#define EXPORT
+#endif
+
+namespace mcsv1sdk
+{
+
+// Override UserData for data storage
+struct ApproxPercentileData : public UserData
+{
+    ApproxPercentileData() : fFraction(-1) {};
+    virtual ~ApproxPercentileData() {};
+
+    virtual void serialize(messageqcpp::ByteStream& bs) const;
+    virtual void unserialize(messageqcpp::ByteStream& bs);
+
+    TDigest fDigest;
+    double fFraction;   // p, negative until the first value is seen
+
+private:
+    // For now, copy construction is unwanted
+    ApproxPercentileData(UserData&);
+};
+
+class approx_percentile : public  mcsv1_UDAF
+{
+public:
+    // Defaults OK
+    approx_percentile() : mcsv1_UDAF() {};
+    virtual ~approx_percentile() {};
+
+    virtual ReturnCode init(mcsv1Context* context,
+                            ColumnDatum* colTypes);
+
+    virtual ReturnCode reset(mcsv1Context* context);
+
+    virtual ReturnCode nextValue(mcsv1Context* context, ColumnDatum* valsIn);
+
+    virtual ReturnCode nextValues(mcsv1Context* context, uint32_t rowCount, ColumnBatch* colsIn,
+                                  const uint32_t* groups, UserData** userData);
+
+    virtual ReturnCode subEvaluate(mcsv1Context* context, const UserData* valIn);
+
+    virtual ReturnCode evaluate(mcsv1Context* context, static_any::any& valOut);
+
+    virtual ReturnCode createUserData(UserData*& userData, int32_t& length)
+    {
+        userData = new ApproxPercentileData;
+        length = sizeof(ApproxPercentileData);
+        return mcsv1_UDAF::SUCCESS;
+    }
+};
+
+};  // namespace
+
+#undef EXPORT
+
+#endif // HEADER_approx_percentile.h
+
@@ -0,0 +1,246 @@
+#include <my_config.h>
+#include <cmath>
+#include <string.h>
+
+#include "idb_mysql.h"
+#include "approxsketch.h"
+
+using namespace mcsv1sdk;
+
+namespace
+{
+inline bool isNumeric(int type, const char* attr)
+{
+    if (type == INT_RESULT || type == REAL_RESULT || type == DECIMAL_RESULT)
+    {
+        return true;
+    }
+#if _MSC_VER
+    if (_strnicmp("NULL", attr, 4) == 0))
+#else
+    if (strncasecmp("NULL", attr, 4) == 0)
+#endif
+    {
+        return true;
+    }
+    return false;
+}
+
+inline double cvtArgToDouble(int t, const char* v)
+{
+    double d = 0.0;
+
+    switch (t)
+    {
+        case INT_RESULT:
+            d = (double)(*((long long*)v));
+            break;
+
+        case REAL_RESULT:
+            d = *((double*)v);
+            break;
+
+        case DECIMAL_RESULT:
+        case STRING_RESULT:
+            d = strtod(v, 0);
+            break;
+
+        case ROW_RESULT:
+            break;
+    }
+
+    return d;
+}
+
+struct approx_percentile_data
+{
+    TDigest digest;
+    double  fraction;
+};
+
+}
+
+extern "C"
+{
+
+//=======================================================================
+
+    /**
+     * approx_count_distinct
+     */
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+my_bool approx_count_distinct_init(UDF_INIT* initid, UDF_ARGS* args, char* message)
+{
+    if (args->arg_count != 1)
+    {
+        strcpy(message,"approx_count_distinct() requires one argument");
+        return 1;
+    }
+
+    initid->ptr = (char*)new HyperLogLog;
+    return 0;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_deinit(UDF_INIT* initid)
+{
+    delete (HyperLogLog*)initid->ptr;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_clear(UDF_INIT* initid, char* is_null __attribute__((unused)),
+                                 char* message __attribute__((unused)))
+{
+    ((HyperLogLog*)initid->ptr)->clear();
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_count_distinct_add(UDF_INIT* initid,
+                               UDF_ARGS* args,
+                               char* is_null,
+                               char* message __attribute__((unused)))
+{
+    // Test for NULL
+    if (args->args[0] == 0)
+    {
+        return;
+    }
+
+    HyperLogLog* sketch = (HyperLogLog*)initid->ptr;
+
+    switch (args->arg_type[0])
+    {
+        case INT_RESULT:
+            sketch->add(args->args[0], sizeof(long long));
+            break;
+
+        case REAL_RESULT:
+        {
+            double val = *((double*)args->args[0]);
+
+            if (val == 0)
+                val = 0;   // -0.0 == 0.0
+
+            sketch->add(&val, sizeof(val));
+            break;
+        }
+
+        default:
+            sketch->add(args->args[0], args->lengths[0]);
+            break;
+    }
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+long long approx_count_distinct(UDF_INIT* initid, UDF_ARGS* args __attribute__((unused)),
+                                char* is_null, char* error __attribute__((unused)))
+{
+    return ((HyperLogLog*)initid->ptr)->estimate();
+}
+
+//=======================================================================
+
+    /**
+     * approx_percentile
+     */
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+my_bool approx_percentile_init(UDF_INIT* initid, UDF_ARGS* args, char* message)
+{
+    struct approx_percentile_data* data;
+
+    if (args->arg_count != 2)
+    {
+        strcpy(message,"approx_percentile() requires two arguments");
+        return 1;
+    }
+
+    if (!(isNumeric(args->arg_type[0], args->attributes[0]) && isNumeric(args->arg_type[1], args->attributes[1])))
+    {
+        strcpy(message,"approx_percentile() with a non-numeric argument");
+        return 1;
+    }
+
+    data = new approx_percentile_data;
+    data->fraction = -1;
+    initid->maybe_null = 1;
+    initid->ptr = (char*)data;
+    return 0;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_deinit(UDF_INIT* initid)
+{
+    delete (struct approx_percentile_data*)initid->ptr;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_clear(UDF_INIT* initid, char* is_null __attribute__((unused)),
+                             char* message __attribute__((unused)))
+{
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+    data->digest.clear();
+    data->fraction = -1;
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+void approx_percentile_add(UDF_INIT* initid,
+                           UDF_ARGS* args,
+                           char* is_null,
+                           char* message __attribute__((unused)))
+{
+    // Test for NULL in x and p
+    if (args->args[0] == 0 || args->args[1] == 0)
+    {
+        return;
+    }
+
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+
+    if (data->fraction < 0)
+        data->fraction = cvtArgToDouble(args->arg_type[1], args->args[1]);
+
+    data->digest.add(cvtArgToDouble(args->arg_type[0], args->args[0]));
+}
+
+#ifdef _MSC_VER
+__declspec(dllexport)
+#endif
+double approx_percentile(UDF_INIT* initid, UDF_ARGS* args __attribute__((unused)),
+                         char* is_null, char* error)
+{
+    struct approx_percentile_data* data = (struct approx_percentile_data*)initid->ptr;
+
+    if (data->digest.empty())
+    {
+        *is_null = 1;
+        return 0;
+    }
+
+    if (!(data->fraction >= 0 && data->fraction <= 1))
+    {
+        *error = 1;
+        return 0;
+    }
+
+    return data->digest.quantile(data->fraction);
+}
+
+} // Extern "C"
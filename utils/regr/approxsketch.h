@@ -0,0 +1,401 @@
+/* Copyright (C) 2021 MariaDB Corporation
+
+   This program is free software; you can redistribute it and/or
+   modify it under the terms of the GNU General Public License
+   as published by the Free Software Foundation; version 2 of
+   the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02110-1301, USA. */
+
+/***********************************************************************
+*   $Id$
+*
+*   approxsketch.h
+***********************************************************************/
+
+/**
+ * Mergeable sketches behind approx_count_distinct() and approx_percentile().
+ *
+ * Both are small, fixed-bounded summaries that can be built independently
+ * on each PM and combined on the UM, which is what lets the UDAF framework
+ * run them as two-phase aggregates.  They're header-only so that the
+ * MariaDB side (approxmysql.cpp) computes the same answers.
+ */
+#ifndef HEADER_approxsketch
+#define HEADER_approxsketch
+
+#include <stdint.h>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "hasher.h"
+
+namespace mcsv1sdk
+{
+
+/** @brief A HyperLogLog distinct count estimator.
+ *
+ * 2^14 registers give a standard error of about 0.8%.  Until a sketch has
+ * seen a few thousand distinct values it keeps a sparse list of
+ * (register, rank) pairs instead, so that the groups of a GROUP BY with few
+ * values each don't cost 16KB apiece.
+ */
+class HyperLogLog
+{
+public:
+    static const uint32_t Precision = 14;
+    static const uint32_t RegisterCount = 1 << Precision;
+
+    void clear()
+    {
+        fSparse.clear();
+        fRegisters.clear();
+    }
+
+    void add(const void* data, uint64_t len)
+    {
+        addHash(fHasher((const char*) data, len));
+    }
+
+    void addHash(uint64_t hash)
+    {
+        uint32_t idx = hash >> (64 - Precision);
+        uint64_t rest = hash << Precision;
+        uint8_t rank = (rest == 0 ? 64 - Precision + 1 : __builtin_clzll(rest) + 1);
+
+        if (fRegisters.empty())
+        {
+            fSparse.push_back((idx << 8) | rank);
+
+            if (fSparse.size() >= SparseLimit)
+                compactSparse();
+        }
+        else if (fRegisters[idx] < rank)
+            fRegisters[idx] = rank;
+    }
+
+    void merge(const HyperLogLog& other)
+    {
+        if (fRegisters.empty() && other.fRegisters.empty())
+        {
+            fSparse.insert(fSparse.end(), other.fSparse.begin(), other.fSparse.end());
+
+            if (fSparse.size() >= SparseLimit)
+                compactSparse();
+
+            return;
+        }
+
+        toDense();
+
+        for (uint32_t i = 0; i < other.fSparse.size(); i++)
+            setMax(other.fSparse[i]);
+
+        for (uint32_t i = 0; i < other.fRegisters.size(); i++)
+            if (fRegisters[i] < other.fRegisters[i])
+                fRegisters[i] = other.fRegisters[i];
+    }
+
+    uint64_t estimate() const
+    {
+        std::vector<uint8_t> sparseRegs;
+        const std::vector<uint8_t>* regs = &fRegisters;
+        double sum = 0;
+        uint32_t zeros = 0;
+        const double m = RegisterCount;
+
+        if (fRegisters.empty())
+        {
+            sparseRegs.resize(RegisterCount, 0);
+
+            for (uint32_t i = 0; i < fSparse.size(); i++)
+                if (sparseRegs[fSparse[i] >> 8] < (fSparse[i] & 0xff))
+                    sparseRegs[fSparse[i] >> 8] = fSparse[i] & 0xff;
+
+            regs = &sparseRegs;
+        }
+
+        for (uint32_t i = 0; i < RegisterCount; i++)
+        {
+            sum += ldexp(1.0, -(int) (*regs)[i]);
+
+            if ((*regs)[i] == 0)
+                zeros++;
+        }
+
+        double est = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+        // small range correction, linear counting is the better estimate down there
+        if (est <= 2.5 * m && zeros > 0)
+            est = m * log(m / zeros);
+
+        return (uint64_t) (est + 0.5);
+    }
+
+    /* Accessors for serialization.  A sketch is either sparse or dense. */
+    const std::vector<uint32_t>& sparse() const
+    {
+        return fSparse;
+    }
+    const std::vector<uint8_t>& registers() const
+    {
+        return fRegisters;
+    }
+    void load(std::vector<uint32_t>& sparse, std::vector<uint8_t>& registers)
+    {
+        fSparse.swap(sparse);
+        fRegisters.swap(registers);
+    }
+
+private:
+    static const uint32_t SparseLimit = RegisterCount / 8;
+
+    void setMax(uint32_t entry)
+    {
+        if (fRegisters[entry >> 8] < (entry & 0xff))
+            fRegisters[entry >> 8] = entry & 0xff;
+    }
+
+    void toDense()
+    {
+        if (!fRegisters.empty())
+            return;
+
+        fRegisters.resize(RegisterCount, 0);
+
+        for (uint32_t i = 0; i < fSparse.size(); i++)
+            setMax(fSparse[i]);
+
+        std::vector<uint32_t>().swap(fSparse);
+    }
+
+    // keeps the highest rank per register, goes dense once that's still a long list
+    void compactSparse()
+    {
+        uint32_t out = 0;
+
+        std::sort(fSparse.begin(), fSparse.end());
+
+        for (uint32_t i = 0; i < fSparse.size(); i++)
+        {
+            if (i + 1 < fSparse.size() && (fSparse[i] >> 8) == (fSparse[i + 1] >> 8))
+                continue;
+
+            fSparse[out++] = fSparse[i];
+        }
+
+        fSparse.resize(out);
+
+        if (fSparse.size() >= SparseLimit / 2)
+            toDense();
+    }
+
+    std::vector<uint32_t> fSparse;
+    std::vector<uint8_t> fRegisters;
+    utils::Hasher128 fHasher;
+};
+
+/** @brief A merging t-digest quantile estimator.
+ *
+ * Values are buffered and periodically folded into about Compression
+ * centroids.  Centroid sizes follow the arcsine scale function, so the
+ * ones at the tails hold only a few values each and the middle of the
+ * distribution is summarized more coarsely.
+ */
+class TDigest
+{
+public:
+    static const uint32_t Compression = 100;
+
+    struct Centroid
+    {
+        double mean;
+        double weight;
+
+        bool operator<(const Centroid& c) const
+        {
+            return mean < c.mean;
+        }
+    };
+
+    TDigest()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        fCentroids.clear();
+        fBuffer.clear();
+        fMin = std::numeric_limits<double>::infinity();
+        fMax = -std::numeric_limits<double>::infinity();
+    }
+
+    bool empty() const
+    {
+        return fCentroids.empty() && fBuffer.empty();
+    }
+
+    void add(double val, double weight = 1)
+    {
+        Centroid c = {val, weight};
+
+        fBuffer.push_back(c);
+        fMin = std::min(fMin, val);
+        fMax = std::max(fMax, val);
+
+        if (fBuffer.size() >= BufferLimit)
+            compress();
+    }
+
+    void merge(const TDigest& other)
+    {
+        fBuffer.insert(fBuffer.end(), other.fCentroids.begin(), other.fCentroids.end());
+        fBuffer.insert(fBuffer.end(), other.fBuffer.begin(), other.fBuffer.end());
+        fMin = std::min(fMin, other.fMin);
+        fMax = std::max(fMax, other.fMax);
+
+        if (fBuffer.size() >= BufferLimit)
+            compress();
+    }
+
+    /** @brief Returns the estimated value at fraction q of the data, q in [0, 1] */
+    double quantile(double q)
+    {
+        double total = 0, target, cum, next;
+        uint32_t i;
+
+        compress();
+
+        if (fCentroids.empty())
+            return std::numeric_limits<double>::quiet_NaN();
+
+        if (fCentroids.size() == 1)
+            return fCentroids[0].mean;
+
+        for (i = 0; i < fCentroids.size(); i++)
+            total += fCentroids[i].weight;
+
+        // each centroid's mean sits at the middle of its weight, interpolate between those
+        target = q * total;
+        cum = fCentroids[0].weight / 2;
+
+        if (target < cum)
+            return interpolate(fMin, fCentroids[0].mean, target / cum);
+
+        for (i = 0; i < fCentroids.size() - 1; i++)
+        {
+            next = cum + (fCentroids[i].weight + fCentroids[i + 1].weight) / 2;
+
+            if (target < next)
+                return interpolate(fCentroids[i].mean, fCentroids[i + 1].mean,
+                                   (target - cum) / (next - cum));
+
+            cum = next;
+        }
+
+        return interpolate(fCentroids[i].mean, fMax, (target - cum) / (total - cum));
+    }
+
+    /** @brief Folds buffered values into the centroids. */
+    void compress()
+    {
+        double total = 0, soFar = 0, limit;
+        uint32_t i;
+
+        if (fBuffer.empty())
+            return;
+
+        fBuffer.insert(fBuffer.end(), fCentroids.begin(), fCentroids.end());
+        std::sort(fBuffer.begin(), fBuffer.end());
+        fCentroids.clear();
+
+        for (i = 0; i < fBuffer.size(); i++)
+            total += fBuffer[i].weight;
+
+        Centroid cur = fBuffer[0];
+        limit = total * quantileLimit(0);
+
+        for (i = 1; i < fBuffer.size(); i++)
+        {
+            if (soFar + cur.weight + fBuffer[i].weight <= limit)
+            {
+                cur.weight += fBuffer[i].weight;
+                cur.mean += (fBuffer[i].mean - cur.mean) * fBuffer[i].weight / cur.weight;
+            }
+            else
+            {
+                fCentroids.push_back(cur);
+                soFar += cur.weight;
+                limit = total * quantileLimit(soFar / total);
+                cur = fBuffer[i];
+            }
+        }
+
+        fCentroids.push_back(cur);
+        fBuffer.clear();
+    }
+
+    /* Accessors for serialization */
+    double min() const
+    {
+        return fMin;
+    }
+    double max() const
+    {
+        return fMax;
+    }
+    const std::vector<Centroid>& centroids() const
+    {
+        return fCentroids;
+    }
+    const std::vector<Centroid>& buffer() const
+    {
+        return fBuffer;
+    }
+    void load(double min, double max, std::vector<Centroid>& centroids)
+    {
+        clear();
+        fMin = min;
+        fMax = max;
+        fBuffer.swap(centroids);
+        compress();
+    }
+
+private:
+    static const uint32_t BufferLimit = 5 * Compression;
+
+    // A centroid that starts at quantile q may extend up to the returned quantile,
+    // one unit further along k(q) = Compression / (2 * pi) * asin(2 * q - 1)
+    static double quantileLimit(double q)
+    {
+        double k = asin(2 * q - 1) + 2 * M_PI / Compression;
+        return (sin(std::min(k, M_PI / 2)) + 1) / 2;
+    }
+
+    static double interpolate(double a, double b, double frac)
+    {
+        return a + (b - a) * frac;
+    }
+
+    std::vector<Centroid> fCentroids;
+    std::vector<Centroid> fBuffer;
+    double fMin;
+    double fMax;
+};
+
+};  // namespace
+
+#endif // HEADER_approxsketch.h
+
@@ -591,6 +591,253 @@ inline bool RowAggregation::isNull(const RowGroup* pRowGroup, const Row& row, in
 }
 
 
+//------------------------------------------------------------------------------
+// UDAFBatchColumn
+//------------------------------------------------------------------------------
+UDAFBatchColumn::UDAFBatchColumn() :
+    fColType(execplan::CalpontSystemCatalog::UNDEFINED), fColIn(0), fConst(NULL),
+    fStorage(INT), fHasNull(false)
+{
+}
+
+void UDAFBatchColumn::init(const Row& row, uint32_t colIn, execplan::ConstantColumn* cc)
+{
+    fColIn = colIn;
+    fConst = cc;
+
+    if (cc)
+    {
+        fColType = cc->resultType().colDataType;
+        fBatch.colWidth = cc->resultType().colWidth;
+        fBatch.scale = cc->resultType().scale;
+        fBatch.precision = cc->resultType().precision;
+    }
+    else
+    {
+        fColType = row.getColType(colIn);
+        fBatch.colWidth = row.getColumnWidth(colIn);
+        fBatch.scale = row.getScale(colIn);
+        fBatch.precision = row.getPrecision(colIn);
+    }
+
+    // the same types doUDAF() puts in a ColumnDatum
+    switch (fColType)
+    {
+        case execplan::CalpontSystemCatalog::TINYINT:
+        case execplan::CalpontSystemCatalog::SMALLINT:
+        case execplan::CalpontSystemCatalog::MEDINT:
+        case execplan::CalpontSystemCatalog::INT:
+        case execplan::CalpontSystemCatalog::BIGINT:
+        case execplan::CalpontSystemCatalog::TIME:
+            fBatch.dataType = execplan::CalpontSystemCatalog::BIGINT;
+            fStorage = INT;
+            break;
+
+        case execplan::CalpontSystemCatalog::DECIMAL:
+        case execplan::CalpontSystemCatalog::UDECIMAL:
+            fBatch.dataType = fColType;
+            fStorage = (fBatch.colWidth == datatypes::MAXDECIMALWIDTH ? INT128 : INT);
+            break;
+
+        case execplan::CalpontSystemCatalog::UTINYINT:
+        case execplan::CalpontSystemCatalog::USMALLINT:
+        case execplan::CalpontSystemCatalog::UMEDINT:
+        case execplan::CalpontSystemCatalog::UINT:
+        case execplan::CalpontSystemCatalog::UBIGINT:
+        case execplan::CalpontSystemCatalog::DATE:
+        case execplan::CalpontSystemCatalog::DATETIME:
+        case execplan::CalpontSystemCatalog::TIMESTAMP:
+            fBatch.dataType = execplan::CalpontSystemCatalog::UBIGINT;
+            fStorage = UINT;
+            break;
+
+        case execplan::CalpontSystemCatalog::DOUBLE:
+        case execplan::CalpontSystemCatalog::UDOUBLE:
+            fBatch.dataType = execplan::CalpontSystemCatalog::DOUBLE;
+            fStorage = DOUBLE;
+            break;
+
+        case execplan::CalpontSystemCatalog::FLOAT:
+        case execplan::CalpontSystemCatalog::UFLOAT:
+            fBatch.dataType = execplan::CalpontSystemCatalog::FLOAT;
+            fStorage = FLOAT;
+            break;
+
+        case execplan::CalpontSystemCatalog::LONGDOUBLE:
+            fBatch.dataType = execplan::CalpontSystemCatalog::LONGDOUBLE;
+            fStorage = LONGDOUBLE;
+            break;
+
+        case execplan::CalpontSystemCatalog::CHAR:
+        case execplan::CalpontSystemCatalog::VARCHAR:
+        case execplan::CalpontSystemCatalog::TEXT:
+        case execplan::CalpontSystemCatalog::VARBINARY:
+        case execplan::CalpontSystemCatalog::CLOB:
+        case execplan::CalpontSystemCatalog::BLOB:
+            fBatch.dataType = fColType;
+            fStorage = STRING;
+            break;
+
+        default:
+        {
+            std::ostringstream errmsg;
+            errmsg << "UDAFBatchColumn: No logic for data type: " << fColType;
+            throw logging::QueryDataExcept(errmsg.str(), logging::aggregateFuncErr);
+        }
+    }
+
+    clear();
+}
+
+void UDAFBatchColumn::append(Row& row)
+{
+    bool isNull = false;
+
+    fNulls.push_back(0);
+
+    switch (fStorage)
+    {
+        case INT:
+            if (!fConst)
+                fInts.push_back(row.getIntField(fColIn));
+            else if (fColType == execplan::CalpontSystemCatalog::TIME)
+                fInts.push_back(fConst->getTimeIntVal(row, isNull));
+            else if (fColType == execplan::CalpontSystemCatalog::DECIMAL ||
+                     fColType == execplan::CalpontSystemCatalog::UDECIMAL)
+                fInts.push_back(fConst->getDecimalVal(row, isNull).value);
+            else
+                fInts.push_back(fConst->getIntVal(row, isNull));
+
+            break;
+
+        case INT128:
+            if (fConst)
+                fInt128s.push_back(fConst->getDecimalVal(row, isNull).s128Value);
+            else
+                fInt128s.push_back(row.getTSInt128Field(fColIn).s128Value);
+
+            break;
+
+        case UINT:
+            if (!fConst)
+                fUints.push_back(row.getUintField(fColIn));
+            else if (fColType == execplan::CalpontSystemCatalog::DATE)
+                fUints.push_back(fConst->getDateIntVal(row, isNull));
+            else if (fColType == execplan::CalpontSystemCatalog::DATETIME)
+                fUints.push_back(fConst->getDatetimeIntVal(row, isNull));
+            else if (fColType == execplan::CalpontSystemCatalog::TIMESTAMP)
+                fUints.push_back(fConst->getTimestampIntVal(row, isNull));
+            else
+                fUints.push_back(fConst->getUintVal(row, isNull));
+
+            break;
+
+        case DOUBLE:
+            fDoubles.push_back(fConst ? fConst->getDoubleVal(row, isNull) : row.getDoubleField(fColIn));
+            break;
+
+        case FLOAT:
+            fFloats.push_back(fConst ? fConst->getFloatVal(row, isNull) : row.getFloatField(fColIn));
+            break;
+
+        case LONGDOUBLE:
+            fLongDoubles.push_back(fConst ? fConst->getLongDoubleVal(row, isNull) :
+                                   row.getLongDoubleField(fColIn));
+            break;
+
+        case STRING:
+            fStrings.push_back(fConst ? fConst->getStrVal(row, isNull) : row.getStringField(fColIn));
+            break;
+    }
+}
+
+void UDAFBatchColumn::appendNull()
+{
+    fNulls.push_back(1);
+    fHasNull = true;
+
+    switch (fStorage)
+    {
+        case INT:
+            fInts.push_back(0);
+            break;
+
+        case INT128:
+            fInt128s.push_back(0);
+            break;
+
+        case UINT:
+            fUints.push_back(0);
+            break;
+
+        case DOUBLE:
+            fDoubles.push_back(0);
+            break;
+
+        case FLOAT:
+            fFloats.push_back(0);
+            break;
+
+        case LONGDOUBLE:
+            fLongDoubles.push_back(0);
+            break;
+
+        case STRING:
+            fStrings.push_back(std::string());
+            break;
+    }
+}
+
+void UDAFBatchColumn::clear()
+{
+    fHasNull = false;
+    fNulls.clear();
+    fInts.clear();
+    fUints.clear();
+    fInt128s.clear();
+    fFloats.clear();
+    fDoubles.clear();
+    fLongDoubles.clear();
+    fStrings.clear();
+}
+
+mcsv1sdk::ColumnBatch* UDAFBatchColumn::batch()
+{
+    switch (fStorage)
+    {
+        case INT:
+            fBatch.values = fInts.data();
+            break;
+
+        case INT128:
+            fBatch.values = fInt128s.data();
+            break;
+
+        case UINT:
+            fBatch.values = fUints.data();
+            break;
+
+        case DOUBLE:
+            fBatch.values = fDoubles.data();
+            break;
+
+        case FLOAT:
+            fBatch.values = fFloats.data();
+            break;
+
+        case LONGDOUBLE:
+            fBatch.values = fLongDoubles.data();
+            break;
+
+        case STRING:
+            fBatch.values = fStrings.data();
+            break;
+    }
+
+    fBatch.nulls = (fHasNull ? fNulls.data() : NULL);
+    return &fBatch;
+}
+
 //------------------------------------------------------------------------------
 // Row Aggregation default constructor
 //------------------------------------------------------------------------------
@@ -598,7 +845,7 @@ RowAggregation::RowAggregation() :
     fAggMapPtr(NULL), fRowGroupOut(NULL),
     fTotalRowCount(0), fMaxTotalRowCount(AGG_ROWGROUP_SIZE),
     fSmallSideRGs(NULL), fLargeSideRG(NULL), fSmallSideCount(0),
-    fOrigFunctionCols(NULL)
+    fOrigFunctionCols(NULL), fBatchUDAF(false)
 {
 }
 
@@ -608,7 +855,7 @@ RowAggregation::RowAggregation(const vector<SP_ROWAGG_GRPBY_t>& rowAggGroupByCol
     fAggMapPtr(NULL), fRowGroupOut(NULL),
     fTotalRowCount(0), fMaxTotalRowCount(AGG_ROWGROUP_SIZE),
     fSmallSideRGs(NULL), fLargeSideRG(NULL), fSmallSideCount(0),
-    fOrigFunctionCols(NULL)
+    fOrigFunctionCols(NULL), fBatchUDAF(false)
 {
     fGroupByCols.assign(rowAggGroupByCols.begin(), rowAggGroupByCols.end());
     fFunctionCols.assign(rowAggFunctionCols.begin(), rowAggFunctionCols.end());
@@ -619,7 +866,7 @@ RowAggregation::RowAggregation(const RowAggregation& rhs):
     fAggMapPtr(NULL), fRowGroupOut(NULL),
     fTotalRowCount(0), fMaxTotalRowCount(AGG_ROWGROUP_SIZE),
     fSmallSideRGs(NULL), fLargeSideRG(NULL), fSmallSideCount(0),
-    fRGContext(rhs.fRGContext), fOrigFunctionCols(NULL)
+    fRGContext(rhs.fRGContext), fOrigFunctionCols(NULL), fBatchUDAF(false)
 {
     fGroupByCols.assign(rhs.fGroupByCols.begin(), rhs.fGroupByCols.end());
     fFunctionCols.assign(rhs.fFunctionCols.begin(), rhs.fFunctionCols.end());
@@ -668,12 +915,16 @@ void RowAggregation::addRowGroup(const RowGroup* pRows)
     Row rowIn;
     pRows->initRow(&rowIn);
     pRows->getRow(0, &rowIn);
+    bool batchUDAF = startUDAFBatches();
 
     for (uint64_t i = 0; i < pRows->getRowCount(); ++i)
     {
         aggregateRow(rowIn);
         rowIn.nextRow();
     }
+
+    if (batchUDAF)
+        flushUDAFBatches(pRows);
 }
 
 
@@ -683,12 +934,16 @@ void RowAggregation::addRowGroup(const RowGroup* pRows, vector<Row::Pointer>& in
     // if (countSpecial(pRows))
     Row rowIn;
     pRows->initRow(&rowIn);
+    bool batchUDAF = startUDAFBatches();
 
     for (uint32_t i = 0; i < inRows.size(); i++)
     {
         rowIn.setData(inRows[i]);
         aggregateRow(rowIn);
     }
+
+    if (batchUDAF)
+        flushUDAFBatches(pRows);
 }
 
 
@@ -2107,6 +2362,20 @@ void RowAggregation::doUDAF(const Row& rowIn,
         udafContextsCollPtr = rgContextColl;
     }
 
+    // queue the row for nextValues()
+    if (fBatchUDAF && rgContextColl == nullptr && fUDAFBatches[funcColsIdx].fActive)
+    {
+        fUDAFBatches[funcColsIdx].fRows.push_back(rowIn.getPointer());
+        fUDAFBatches[funcColsIdx].fRowData.push_back(fRow.getUserData(colAux).get());
+
+        // skip the columns of the other parameters
+        while (fFunctionCols.size() > funcColsIdx + 1
+                &&  fFunctionCols[funcColsIdx + 1]->fAggFunction == ROWAGG_MULTI_PARM)
+            ++funcColsIdx;
+
+        return;
+    }
+
     std::vector<mcsv1sdk::mcsv1Context>& udafContextsColl = *udafContextsCollPtr;
     uint32_t paramCount = udafContextsColl[funcColsIdx].getParameterCount();
     // doUDAF changes funcColsIdx to skip UDAF arguments so the real UDAF
@@ -2422,6 +2691,147 @@ void RowAggregation::doUDAF(const Row& rowIn,
     }
 }
 
+//------------------------------------------------------------------------------
+// UDAF that set UDAF_BATCH get their rows a RowGroup at a time.  While a
+// RowGroup is aggregated, doUDAF() queues each row with the userData of its
+// group, then flushUDAFBatches() hands the queue to nextValues().
+// return - true if there's such a UDAF
+//------------------------------------------------------------------------------
+bool RowAggregation::startUDAFBatches()
+{
+    fBatchUDAF = false;
+
+    for (uint64_t i = 0; i < fFunctionCols.size(); i++)
+    {
+        if (fFunctionCols[i]->fAggFunction != ROWAGG_UDAF)
+            continue;
+
+        RowUDAFFunctionCol* rowUDAF = dynamic_cast<RowUDAFFunctionCol*>(fFunctionCols[i].get());
+
+        if (rowUDAF && rowUDAF->fUDAFContext.getRunFlag(mcsv1sdk::UDAF_BATCH))
+        {
+            fUDAFBatches.resize(fFunctionCols.size());
+            fUDAFBatches[i].fActive = true;
+            fUDAFBatches[i].fRows.clear();
+            fUDAFBatches[i].fRowData.clear();
+            fBatchUDAF = true;
+        }
+    }
+
+    return fBatchUDAF;
+}
+
+void RowAggregation::flushUDAFBatches(const RowGroup* pRows)
+{
+    Row rowIn;
+    pRows->initRow(&rowIn);
+    fBatchUDAF = false;
+
+    for (uint64_t i = 0; i < fUDAFBatches.size(); i++)
+    {
+        UDAFBatch& batch = fUDAFBatches[i];
+
+        if (!batch.fActive || batch.fRows.empty())
+            continue;
+
+        mcsv1sdk::mcsv1Context& context = fRGContextColl[i];
+        uint32_t paramCount = context.getParameterCount();
+        bool ignoreNulls = context.getRunFlag(mcsv1sdk::UDAF_IGNORE_NULLS);
+        utils::VLArray<execplan::ConstantColumn*> constCols(paramCount);
+        utils::VLArray<bool> nulls(paramCount);
+        uint32_t k;
+
+        // the parameters after the first are in the ROWAGG_MULTI_PARM columns that follow
+        for (k = 0; k < paramCount; k++)
+            constCols[k] = dynamic_cast<execplan::ConstantColumn*>(fFunctionCols[i + k]->fpConstCol.get());
+
+        if (batch.fCols.empty())
+        {
+            batch.fCols.resize(paramCount);
+
+            for (k = 0; k < paramCount; k++)
+                batch.fCols[k].init(rowIn, fFunctionCols[i + k]->fInputColumnIndex, constCols[k]);
+        }
+
+        for (k = 0; k < paramCount; k++)
+            batch.fCols[k].clear();
+
+        batch.fGroups.clear();
+        batch.fGroupData.clear();
+        batch.fGroupIndex.clear();
+
+        for (uint32_t r = 0; r < batch.fRows.size(); r++)
+        {
+            bool skip = false;
+            rowIn.setData(batch.fRows[r]);
+
+            for (k = 0; k < paramCount; k++)
+            {
+                if (constCols[k])
+                    nulls[k] = (constCols[k]->type() == execplan::ConstantColumn::NULLDATA);
+                else
+                    nulls[k] = isNull(&fRowGroupIn, rowIn, fFunctionCols[i + k]->fInputColumnIndex);
+
+                if (nulls[k] && ignoreNulls)
+                    skip = true;
+            }
+
+            if (skip)
+                continue;
+
+            for (k = 0; k < paramCount; k++)
+            {
+                if (nulls[k])
+                    batch.fCols[k].appendNull();
+                else
+                    batch.fCols[k].append(rowIn);
+            }
+
+            // rows of the same group tend to come together
+            mcsv1sdk::UserData* userData = batch.fRowData[r];
+
+            if (batch.fGroupData.empty() || batch.fGroupData[batch.fGroups.back()] != userData)
+            {
+                std::pair<std::tr1::unordered_map<mcsv1sdk::UserData*, uint32_t>::iterator, bool> inserted =
+                    batch.fGroupIndex.insert(std::make_pair(userData, (uint32_t) batch.fGroupData.size()));
+
+                if (inserted.second)
+                    batch.fGroupData.push_back(userData);
+
+                batch.fGroups.push_back(inserted.first->second);
+            }
+            else
+                batch.fGroups.push_back(batch.fGroups.back());
+        }
+
+        batch.fRows.clear();
+        batch.fRowData.clear();
+
+        if (batch.fGroups.empty())
+            continue;
+
+        utils::VLArray<mcsv1sdk::ColumnBatch> colsIn(paramCount);
+
+        for (k = 0; k < paramCount; k++)
+            colsIn[k] = *batch.fCols[k].batch();
+
+        mcsv1sdk::mcsv1_UDAF::ReturnCode rc;
+        rc = context.getFunction()->nextValues(&context, batch.fGroups.size(), colsIn,
+                                               batch.fGroups.data(), batch.fGroupData.data());
+
+        if (rc != mcsv1sdk::mcsv1_UDAF::SUCCESS)
+        {
+            RowUDAFFunctionCol* rowUDAF = dynamic_cast<RowUDAFFunctionCol*>(fFunctionCols[i].get());
+            rowUDAF->bInterrupted = true;
+
+            if (rc == mcsv1sdk::mcsv1_UDAF::NOT_IMPLEMENTED)
+                context.setErrorMessage(context.getName() + " sets UDAF_BATCH but doesn't implement nextValues()");
+
+            throw logging::QueryDataExcept(context.getErrorMessage(), logging::aggregateFuncErr);
+        }
+    }
+}
+
 //------------------------------------------------------------------------------
 // Allocate a new data array for the output RowGroup
 // return - true if successfully allocated
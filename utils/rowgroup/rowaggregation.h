@@ -322,6 +322,48 @@ struct ConstantAggData
     {}
 };
 
+/** @brief Collects the values of one UDAF parameter for mcsv1_UDAF::nextValues().
+ *
+ * Values go from Rows (or a constant) straight into a typed array laid out as
+ * described for mcsv1sdk::ColumnBatch, so a batch costs no static_any boxing.
+ */
+class UDAFBatchColumn
+{
+public:
+    UDAFBatchColumn();
+
+    /** @brief Takes the values from column colIn of rows like row, or from cc if it's set */
+    void init(const Row& row, uint32_t colIn, execplan::ConstantColumn* cc);
+
+    void append(Row& row);
+    void appendNull();
+    void clear();
+
+    /** @brief Returns the batch, valid until the next append() or clear() */
+    mcsv1sdk::ColumnBatch* batch();
+
+private:
+    enum Storage
+    {
+        INT, UINT, INT128, FLOAT, DOUBLE, LONGDOUBLE, STRING
+    };
+
+    execplan::CalpontSystemCatalog::ColDataType fColType;
+    uint32_t fColIn;
+    execplan::ConstantColumn* fConst;
+    Storage fStorage;
+    mcsv1sdk::ColumnBatch fBatch;
+    bool fHasNull;
+    std::vector<uint8_t> fNulls;
+    std::vector<int64_t> fInts;
+    std::vector<uint64_t> fUints;
+    std::vector<int128_t> fInt128s;
+    std::vector<float> fFloats;
+    std::vector<double> fDoubles;
+    std::vector<long double> fLongDoubles;
+    std::vector<std::string> fStrings;
+};
+
 typedef boost::shared_ptr<RowAggGroupByCol>  SP_ROWAGG_GRPBY_t;
 typedef boost::shared_ptr<RowAggFunctionCol> SP_ROWAGG_FUNC_t;
 
@@ -523,6 +565,13 @@ public:
      */
     void setJoinRowGroups(std::vector<RowGroup>* pSmallSideRG, RowGroup* pLargeSideRG);
 
+    /** @brief Returns the number of groups (rows) aggregated since the last aggReset()
+     */
+    uint64_t getGroupCount() const
+    {
+        return fTotalRowCount;
+    }
+
     /** @brief Returns group by column vector
      *
      * This function is used to duplicate the RowAggregation object
@@ -649,6 +698,9 @@ protected:
     }
 
     virtual bool newRowGroup();
+
+    bool startUDAFBatches();
+    void flushUDAFBatches(const RowGroup* pRows);
     virtual void clearAggMap()
     {
         if (fAggMapPtr) fAggMapPtr->clear();
@@ -743,6 +795,23 @@ protected:
 
     // For UDAF along with with multiple distinct columns
     std::vector<SP_ROWAGG_FUNC_t>* fOrigFunctionCols;
+
+    // For UDAF that implement nextValues(), the rows of a RowGroup queued by
+    // doUDAF() along with the userData of their groups.  Indexed like fFunctionCols.
+    struct UDAFBatch
+    {
+        UDAFBatch() : fActive(false) {}
+
+        bool fActive;
+        std::vector<Row::Pointer> fRows;
+        std::vector<mcsv1sdk::UserData*> fRowData;
+        std::vector<UDAFBatchColumn> fCols;
+        std::vector<uint32_t> fGroups;
+        std::vector<mcsv1sdk::UserData*> fGroupData;
+        std::tr1::unordered_map<mcsv1sdk::UserData*, uint32_t> fGroupIndex;
+    };
+    std::vector<UDAFBatch> fUDAFBatches;
+    bool fBatchUDAF;
 };
 
 //------------------------------------------------------------------------------
@@ -806,6 +875,12 @@ public:
     {
         return fRm;
     }
+
+    // UM memory charged to the ResourceManager so far
+    uint64_t getMemUsage() const
+    {
+        return fTotalMemUsage;
+    }
     inline virtual RowAggregationUM* clone() const
     {
         return new RowAggregationUM (*this);
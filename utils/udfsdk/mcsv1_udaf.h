@@ -196,6 +196,7 @@ static uint64_t	UDAF_WINDOWFRAME_ALLOWED __attribute__ ((unused))  = 1 << 5; //
 static uint64_t	UDAF_MAYBE_NULL     __attribute__ ((unused))       = 1 << 6; // If UDA(n)F might return NULL.
 static uint64_t	UDAF_IGNORE_NULLS  __attribute__ ((unused))        = 1 << 7; // If UDA(n)F wants NULL rows suppressed.
 static uint64_t	UDAF_DISTINCT  __attribute__ ((unused))            = 1 << 8; // Force UDA(n)F to be distinct on first param.
+static uint64_t	UDAF_BATCH  __attribute__ ((unused))               = 1 << 9; // UDA(n)F implements nextValues().
 
 // Flags set by the framework to define the context of the call.
 // User code shouldn't use these directly
@@ -450,6 +451,37 @@ struct ColumnDatum
                     scale(0), precision(-1), charsetNumber(8) {};
 };
 
+// The values of one parameter for a batch of rows, as passed to nextValues().
+// values points to one element per row. Its type depends on dataType and is
+// the same type columnData would hold in a ColumnDatum:
+//   BIGINT (signed ints and TIME)              int64_t
+//   UBIGINT (unsigned ints, DATE and DATETIME) uint64_t
+//   DECIMAL, UDECIMAL                          int64_t, or int128_t if colWidth is 16
+//   FLOAT, DOUBLE, LONGDOUBLE                  float, double, long double
+//   char, varchar, text, varbinary and blob    std::string
+// The value of a NULL row is undefined.
+struct ColumnBatch
+{
+    execplan::CalpontSystemCatalog::ColDataType dataType;
+    uint32_t    colWidth;
+    uint32_t    scale;     // If dataType is a DECIMAL type
+    uint32_t    precision; // If dataType is a DECIMAL type
+    const void* values;
+    const uint8_t* nulls;  // nulls[i] is set if row i is NULL. NULL if no row is.
+    ColumnBatch() : dataType(execplan::CalpontSystemCatalog::UNDEFINED), colWidth(0),
+                    scale(0), precision(-1), values(NULL), nulls(NULL) {};
+
+    template<typename T>
+    const T* getValues() const
+    {
+        return static_cast<const T*>(values);
+    }
+    bool isNull(uint32_t row) const
+    {
+        return nulls && nulls[row];
+    }
+};
+
 // Override mcsv1_UDAF to build your User Defined Aggregate (UDAF) and/or
 // User Defined Analytic Function (UDAnF).
 // These will be singleton classes, so don't put any instance
@@ -528,6 +560,33 @@ public:
      */
     virtual ReturnCode nextValue(mcsv1Context* context, ColumnDatum* valsIn) = 0;
 
+    /**
+     * nextValues()
+     *
+     * Optional -- the batch form of nextValue(). If init() sets the
+     * UDAF_BATCH run flag, the framework hands over the rows of a
+     * whole RowGroup, or of a whole window frame, in one call instead
+     * of calling nextValue() for each of them. This saves a virtual
+     * call and the boxing of every value in a static_any, which for
+     * simple UDA(n)F is most of the cost.
+     *
+     * The rows may belong to different groups (GROUP BY).
+     * context->getUserData() isn't set, the userData of row i is
+     * userData[groups[i]].
+     *
+     * rowCount (in) - the number of rows in the batch.
+     *
+     * colsIn (in) - a vector of the parameters, each with the values
+     * of all the rows. With UDAF_IGNORE_NULLS, rows with a NULL
+     * parameter are left out of the batch.
+     *
+     * groups (in) - the index into userData of the group of each row.
+     *
+     * userData (in) - the userData of each group in the batch.
+     */
+    virtual ReturnCode nextValues(mcsv1Context* context, uint32_t rowCount, ColumnBatch* colsIn,
+                                  const uint32_t* groups, UserData** userData);
+
     /**
      * subEvaluate()
      *
@@ -1006,6 +1065,12 @@ inline mcsv1_UDAF::ReturnCode mcsv1_UDAF::dropValue(mcsv1Context* context, Colum
     return NOT_IMPLEMENTED;
 }
 
+inline mcsv1_UDAF::ReturnCode mcsv1_UDAF::nextValues(mcsv1Context* context, uint32_t rowCount,
+        ColumnBatch* colsIn, const uint32_t* groups, UserData** userData)
+{
+    return NOT_IMPLEMENTED;
+}
+
 inline mcsv1_UDAF::ReturnCode mcsv1_UDAF::createUserData(UserData*& userData, int32_t& length)
 {
     userData = new UserData(length);
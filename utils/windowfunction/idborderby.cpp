@@ -540,6 +540,220 @@ int TimeCompare::operator()(IdbCompare* l, Row::Pointer r1, Row::Pointer r2)
 }
 
 
+// Normalized keys.  Each column gets a byte that puts NULLs first or last,
+// then its value as an unsigned big endian number, inverted for DESC.
+int Compare::putKey(bool isNull, const uint8_t* value, uint32_t width, uint8_t* key, uint32_t len) const
+{
+    uint32_t i;
+
+    if (len == 0)
+        return 0;
+
+    key[0] = (isNull ? (fKeySpec.fNf > 0 ? 0 : 2) : 1);
+
+    for (i = 1; i <= width && i < len; i++)
+    {
+        uint8_t b = (isNull ? 0 : value[i - 1]);
+        key[i] = (fKeySpec.fAsc > 0 ? b : ~b);
+    }
+
+    return i;
+}
+
+int Compare::putUint(uint64_t v, bool isNull, uint32_t width, uint8_t* key, uint32_t len) const
+{
+    uint8_t value[8];
+
+    for (uint32_t i = 0; i < width; i++)
+        value[i] = v >> (8 * (width - 1 - i));
+
+    return putKey(isNull, value, width, key, len);
+}
+
+int Compare::putInt(int64_t v, bool isNull, uint32_t width, uint8_t* key, uint32_t len) const
+{
+    // flipping the sign bit orders two's complement numbers as unsigned ones
+    return putUint(static_cast<uint64_t>(v) ^ (1ULL << (8 * width - 1)), isNull, width, key, len);
+}
+
+int TinyIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int8_t v = l->row1().getIntField(fSpec.fIndex);
+    return putInt(v, v == static_cast<int8_t>(joblist::TINYINTNULL), 1, key, len);
+}
+
+int SmallIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int16_t v = l->row1().getIntField(fSpec.fIndex);
+    return putInt(v, v == static_cast<int16_t>(joblist::SMALLINTNULL), 2, key, len);
+}
+
+int IntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int32_t v = l->row1().getIntField(fSpec.fIndex);
+    return putInt(v, v == static_cast<int32_t>(joblist::INTNULL), 4, key, len);
+}
+
+int BigIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int64_t v = l->row1().getIntField(fSpec.fIndex);
+    return putInt(v, v == static_cast<int64_t>(joblist::BIGINTNULL), 8, key, len);
+}
+
+int WideDecimalCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int128_t v;
+    l->row1().getInt128Field(fSpec.fIndex, v);
+
+    uint128_t u = static_cast<uint128_t>(v) ^ (static_cast<uint128_t>(1) << 127);
+    uint8_t value[16];
+
+    for (uint32_t i = 0; i < 16; i++)
+        value[i] = u >> (8 * (15 - i));
+
+    return putKey(v == datatypes::Decimal128Null, value, 16, key, len);
+}
+
+int UTinyIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint8_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == static_cast<uint8_t>(joblist::UTINYINTNULL), 1, key, len);
+}
+
+int USmallIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint16_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == static_cast<uint16_t>(joblist::USMALLINTNULL), 2, key, len);
+}
+
+int UIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint32_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == static_cast<uint32_t>(joblist::UINTNULL), 4, key, len);
+}
+
+int UBigIntCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint64_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == joblist::UBIGINTNULL, 8, key, len);
+}
+
+int StringCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+
+    if (!cs)
+        cs = l->rowGroup()->getCharset(fSpec.fIndex);
+
+    // strnxfrm() only agrees with strnncoll() on single level collations
+    if (!(cs->state & MY_CS_BINSORT) && cs->levels_for_order != 1)
+        return -1;
+
+    if (len == 0)
+        return 0;
+
+    bool isNull = l->row1().isNullValue(fSpec.fIndex);
+    uint32_t n = 0;
+
+    putKey(isNull, NULL, 0, key, len);
+
+    if (!isNull)
+    {
+        uint32_t strLen = l->row1().getStringLength(fSpec.fIndex);
+        const uint8_t* str = l->row1().getStringPointer(fSpec.fIndex);
+
+        if (cs->state & MY_CS_BINSORT)
+        {
+            // like strncmp(), stop at a null
+            for (; n < strLen && n < len - 1 && str[n] != 0; n++)
+                key[1 + n] = str[n];
+        }
+        else
+            n = cs->strnxfrm(key + 1, len - 1, strLen, str, strLen, 0);
+    }
+
+    // a string takes the rest of the key, the padding sorts before any weight
+    memset(key + 1 + n, 0, len - 1 - n);
+
+    if (fKeySpec.fAsc < 0)
+        for (uint32_t i = 1; i < len; i++)
+            key[i] = ~key[i];
+
+    return len;
+}
+
+int DoubleCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint64_t u = l->row1().getUintField(fSpec.fIndex);
+    bool isNull = (u == joblist::DOUBLENULL);
+    double v = l->row1().getDoubleField(fSpec.fIndex);
+
+    // -0.0 == 0.0
+    if (v == 0)
+        v = 0;
+
+    memcpy(&u, &v, sizeof(u));
+    u = (u & (1ULL << 63) ? ~u : u | (1ULL << 63));
+    return putUint(u, isNull, 8, key, len);
+}
+
+int FloatCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int32_t iv = l->row1().getIntField(fSpec.fIndex);
+    bool isNull = (iv == static_cast<int32_t>(joblist::FLOATNULL));
+    float v = l->row1().getFloatField(fSpec.fIndex);
+    uint32_t u;
+
+    if (v == 0)
+        v = 0;
+
+    memcpy(&u, &v, sizeof(u));
+    u = (u & (1U << 31) ? ~u : u | (1U << 31));
+    return putUint(u, isNull, 4, key, len);
+}
+
+int DateCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint32_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == static_cast<uint32_t>(joblist::DATENULL), 4, key, len);
+}
+
+int DatetimeCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    uint64_t v = l->row1().getUintField(fSpec.fIndex);
+    return putUint(v, v == joblist::DATETIMENULL, 8, key, len);
+}
+
+int TimeCompare::encode(IdbCompare* l, Row::Pointer r, uint8_t* key, uint32_t len)
+{
+    l->row1().setData(r);
+    int64_t v = l->row1().getIntField(fSpec.fIndex);
+    uint64_t u;
+
+    // negative TIMEs come first, the one with the larger magnitude first,
+    // as in operator()
+    if (v < 0)
+        u = (1ULL << 63) - 1 - (v & ~(1ULL << 63));
+    else
+        u = v | (1ULL << 63);
+
+    return putUint(u, joblist::TIMENULL == (uint64_t) v, 8, key, len);
+}
+
+
 bool CompareRule::less(Row::Pointer r1, Row::Pointer r2)
 {
     for (vector<Compare*>::iterator i = fCompares.begin(); i != fCompares.end(); i++)
@@ -555,8 +769,32 @@ bool CompareRule::less(Row::Pointer r1, Row::Pointer r2)
     return false;
 }
 
+uint64_t CompareRule::abbreviate(Row::Pointer r) const
+{
+    uint8_t key[8] = {0};
+    uint32_t pos = 0;
+    uint64_t ret = 0;
+
+    for (vector<Compare*>::const_iterator i = fCompares.begin(); i != fCompares.end() && pos < 8; i++)
+    {
+        int n = (*i)->encode(fIdbCompare, r, key + pos, 8 - pos);
+
+        if (n < 0)
+            break;
+
+        pos += n;
+    }
+
+    for (uint32_t i = 0; i < 8; i++)
+        ret = (ret << 8) | key[i];
+
+    return ret;
+}
+
 void CompareRule::revertRules()
 {
+    fReverted = !fReverted;
+
     std::vector<Compare*>::iterator fCompareIter = fCompares.begin();
     for(; fCompareIter!=fCompares.end(); fCompareIter++)
     {
@@ -24,6 +24,7 @@
 #ifndef IDB_ORDER_BY_H
 #define IDB_ORDER_BY_H
 
+#include <algorithm>
 #include <queue>
 #include <utility>
 #include <vector>
@@ -92,7 +93,7 @@ struct IdbSortSpec
 class Compare
 {
 public:
-    Compare(const IdbSortSpec& spec) : fSpec(spec) {}
+    Compare(const IdbSortSpec& spec) : fSpec(spec), fKeySpec(spec) {}
     virtual ~Compare() {}
 
     virtual int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer) = 0;
@@ -102,8 +103,22 @@ public:
         fSpec.fNf = -fSpec.fNf;
     }
 
+    // Writes at most len bytes of the normalized key of the column.  memcmp() of
+    // two keys never disagrees with operator() under the spec the Compare was
+    // built with; revertSortSpec() doesn't change the keys.
+    // Returns the # of bytes written, -1 if the column has no normalized key.
+    virtual int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t)
+    {
+        return -1;
+    }
+
 protected:
+    int putKey(bool isNull, const uint8_t* value, uint32_t width, uint8_t* key, uint32_t len) const;
+    int putInt(int64_t v, bool isNull, uint32_t width, uint8_t* key, uint32_t len) const;
+    int putUint(uint64_t v, bool isNull, uint32_t width, uint8_t* key, uint32_t len) const;
+
     IdbSortSpec fSpec;
+    IdbSortSpec fKeySpec;
 };
 
 // Comparators for signed types
@@ -114,6 +129,7 @@ public:
     TinyIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -123,6 +139,7 @@ public:
     SmallIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -132,6 +149,7 @@ public:
     IntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -141,6 +159,7 @@ public:
     BigIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 class WideDecimalCompare : public Compare
@@ -150,6 +169,7 @@ public:
     WideDecimalCompare(const IdbSortSpec& spec, int offset) : Compare(spec), keyColumnOffset(offset) { }
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 // End of comparators for signed types
@@ -161,6 +181,7 @@ public:
     UTinyIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -170,6 +191,7 @@ public:
     USmallIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -179,6 +201,7 @@ public:
     UIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -188,6 +211,7 @@ public:
     UBigIntCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 // end of comparators for unsigned types
@@ -200,6 +224,7 @@ public:
     DoubleCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -218,6 +243,7 @@ public:
     FloatCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 // End of comparators for float types
@@ -229,6 +255,7 @@ public:
     DateCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -238,6 +265,7 @@ public:
     DatetimeCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 
@@ -247,6 +275,7 @@ public:
     TimeCompare(const IdbSortSpec& spec) : Compare(spec) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
 };
 
 // End of comparators for temporal types
@@ -259,6 +288,7 @@ public:
     StringCompare(const IdbSortSpec& spec) : Compare(spec), cs(NULL) {}
 
     int operator()(IdbCompare*, rowgroup::Row::Pointer, rowgroup::Row::Pointer);
+    int encode(IdbCompare*, rowgroup::Row::Pointer, uint8_t*, uint32_t);
     
     CHARSET_INFO* cs;
 };
@@ -268,16 +298,21 @@ public:
 class CompareRule
 {
 public:
-    CompareRule(IdbCompare* c = NULL) : fIdbCompare(c) {}
+    CompareRule(IdbCompare* c = NULL) : fIdbCompare(c), fReverted(false) {}
 
 
     bool less(rowgroup::Row::Pointer r1, rowgroup::Row::Pointer r2);
 
+    // The first 8 bytes of the normalized key of a row, as a big endian number.
+    // Keys are ordered the way the rule was before any revertRules().
+    uint64_t abbreviate(rowgroup::Row::Pointer) const;
+
     void compileRules(const std::vector<IdbSortSpec>&, const rowgroup::RowGroup&);
     void revertRules();
 
     std::vector<Compare*>           fCompares;
     IdbCompare*                     fIdbCompare;
+    bool                            fReverted;
 };
 
 
@@ -313,18 +348,87 @@ protected:
 class OrderByRow
 {
 public:
-    OrderByRow(const rowgroup::Row& r, CompareRule& c) : fData(r.getPointer()), fRule(&c) {}
+    OrderByRow(const rowgroup::Row& r, CompareRule& c) :
+        fData(r.getPointer()), fRule(&c), fKey(c.abbreviate(fData)) {}
 
+    // the abbreviated keys decide unless they are equal
     bool operator < (const OrderByRow& rhs) const
     {
+        if (fKey != rhs.fKey)
+            return (fRule->fReverted ? rhs.fKey < fKey : fKey < rhs.fKey);
+
         return fRule->less(fData, rhs.fData);
     }
 
     rowgroup::Row::Pointer          fData;
     CompareRule*                    fRule;
+    uint64_t                        fKey;
 };
 
 
+// A row position tagged with the abbreviated key of its row
+template<typename T>
+struct KeyedRow
+{
+    uint64_t fKey;
+    T        fPos;
+};
+
+// MSD radix sort of keyed rows on fKey, from the byte at shift down.  Rows
+// with equal keys are left for the caller to order by the full comparison.
+template<typename T>
+void radixSort(KeyedRow<T>* first, KeyedRow<T>* last, KeyedRow<T>* tmp, int shift = 56)
+{
+    const size_t smallSort = 64;
+    size_t n = last - first;
+    size_t count[256] = {0};
+    size_t offset[256];
+
+    if (n < 2 || shift < 0)
+        return;
+
+    if (n < smallSort)
+    {
+        for (KeyedRow<T>* i = first + 1; i < last; i++)
+        {
+            KeyedRow<T> v = *i;
+            KeyedRow<T>* j = i;
+
+            for (; j > first && v.fKey < (j - 1)->fKey; j--)
+                *j = *(j - 1);
+
+            *j = v;
+        }
+
+        return;
+    }
+
+    for (KeyedRow<T>* i = first; i < last; i++)
+        count[(i->fKey >> shift) & 0xff]++;
+
+    offset[0] = 0;
+
+    for (uint32_t b = 1; b < 256; b++)
+        offset[b] = offset[b - 1] + count[b - 1];
+
+    // all in one bucket, go straight to the next byte
+    if (count[(first->fKey >> shift) & 0xff] == n)
+    {
+        radixSort(first, last, tmp, shift - 8);
+        return;
+    }
+
+    for (KeyedRow<T>* i = first; i < last; i++)
+        tmp[offset[(i->fKey >> shift) & 0xff]++] = *i;
+
+    std::copy(tmp, tmp + n, first);
+
+    for (size_t b = 0, start = 0; b < 256; start += count[b], b++)
+        if (count[b] > 1)
+            radixSort(first + start, first + start + count[b], tmp, shift - 8);
+}
+
+
 class EqualCompData : public IdbCompare
 {
 public:
@@ -363,6 +467,47 @@ protected:
 };
 
 
+// Sorts n row positions by orderBy.  The positions are radix sorted on the
+// abbreviated keys of their rows, then each run of equal keys is put in order
+// by the full comparison.  getPointer(T&) gives the row of a position and
+// cancelled() stops the sort early.
+template<typename T, typename GetPointer, typename Cancelled>
+void sortByKey(typename std::vector<T>::iterator v, uint64_t n, OrderByData& orderBy,
+               GetPointer getPointer, Cancelled cancelled)
+{
+    std::vector<KeyedRow<T> > keyed(n), tmp(n);
+    uint64_t i, j;
+
+    for (i = 0; i < n; i++)
+    {
+        keyed[i].fPos = *(v + i);
+        keyed[i].fKey = orderBy.rule().abbreviate(getPointer(keyed[i].fPos));
+    }
+
+    if (cancelled())
+        return;
+
+    radixSort(&keyed[0], &keyed[0] + n, &tmp[0]);
+
+    for (i = 0; i < n && !cancelled(); i = j)
+    {
+        for (j = i + 1; j < n && keyed[j].fKey == keyed[i].fKey; j++)
+            ;
+
+        if (j - i > 1)
+            std::sort(keyed.begin() + i, keyed.begin() + j,
+                      [&](const KeyedRow<T>& a, const KeyedRow<T>& b)
+            {
+                T pa = a.fPos, pb = b.fPos;
+                return orderBy(getPointer(pa), getPointer(pb));
+            });
+    }
+
+    for (i = 0; i < n; i++)
+        *(v + i) = keyed[i].fPos;
+}
+
+
 // base classs for order by clause used in IDB
 class IdbOrderBy : public IdbCompare
 {
@@ -375,7 +520,7 @@ public:
     virtual uint64_t getKeyLength() const = 0;
     virtual const std::string toString() const = 0;
 
-    bool getData(rowgroup::RGData& data);
+    virtual bool getData(rowgroup::RGData& data);
 
     void distinct(bool b)
     {
@@ -393,6 +538,10 @@ public:
     {
         return fRule;
     }
+    uint64_t getMemUsage() const
+    {
+        return fMemSize;
+    }
 
     SortingPQ                           fOrderByQueue;
 protected:
@@ -778,6 +778,85 @@ void WF_udaf::SetUDAFValue(static_any::any& valOut, int64_t colOut,
     }
 }
 
+void WF_udaf::nextValues(int64_t b, int64_t e)
+{
+    uint32_t paramCount = getContext().getParameterCount();
+    utils::VLArray<bool> nulls(paramCount);
+    uint32_t rowCount = 0;
+    uint32_t k;
+
+    if (fBatchCols.empty())
+    {
+        fBatchCols.resize(paramCount);
+
+        for (k = 0; k < paramCount; k++)
+            fBatchCols[k].init(fRow, fFieldIndex[k + 1], static_cast<ConstantColumn*>(fConstantParms[k].get()));
+    }
+
+    for (k = 0; k < paramCount; k++)
+        fBatchCols[k].clear();
+
+    for (int64_t i = b; i <= e; i++)
+    {
+        if (i % 1000 == 0 && fStep->cancelled())
+            break;
+
+        fRow.setData(getPointer(fRowData->at(i)));
+        bool bSkipIt = false;
+
+        for (k = 0; k < paramCount; k++)
+        {
+            ConstantColumn* cc = static_cast<ConstantColumn*>(fConstantParms[k].get());
+            nulls[k] = ((!cc && fRow.isNullValue(fFieldIndex[k + 1]))
+                        ||  (cc && cc->type() == ConstantColumn::NULLDATA));
+
+            // Skip if any value is NULL and respect nulls is off.
+            if (nulls[k] && !bRespectNulls)
+                bSkipIt = true;
+        }
+
+        if (bSkipIt)
+            continue;
+
+        for (k = 0; k < paramCount; k++)
+        {
+            if (nulls[k])
+                fBatchCols[k].appendNull();
+            else
+                fBatchCols[k].append(fRow);
+        }
+
+        rowCount++;
+    }
+
+    if (rowCount == 0)
+        return;
+
+    utils::VLArray<mcsv1sdk::ColumnBatch> colsIn(paramCount);
+
+    for (k = 0; k < paramCount; k++)
+        colsIn[k] = *fBatchCols[k].batch();
+
+    // The whole frame is one group
+    std::vector<uint32_t> groups(rowCount, 0);
+    mcsv1sdk::UserData* userData = getContext().getUserData();
+    mcsv1sdk::mcsv1_UDAF::ReturnCode rc;
+
+    rc = getContext().getFunction()->nextValues(&getContext(), rowCount, colsIn, groups.data(), &userData);
+
+    if (rc != mcsv1sdk::mcsv1_UDAF::SUCCESS)
+    {
+        bInterrupted = true;
+
+        if (rc == mcsv1sdk::mcsv1_UDAF::NOT_IMPLEMENTED)
+            getContext().setErrorMessage(getContext().getName() + " sets UDAF_BATCH but doesn't implement nextValues()");
+
+        string errStr = IDBErrorInfo::instance()->errorMsg(ERR_WF_UDANF_ERROR, getContext().getErrorMessage());
+        cerr << errStr << endl;
+        throw IDBExcept(errStr, ERR_WF_UDANF_ERROR);
+    }
+}
+
 void WF_udaf::operator()(int64_t b, int64_t e, int64_t c)
 {
     mcsv1sdk::mcsv1_UDAF::ReturnCode rc;
@@ -830,7 +909,16 @@ void WF_udaf::operator()(int64_t b, int64_t e, int64_t c)
 
         bool bSkipIt = false;
         utils::VLArray<uint32_t> flags(getContext().getParameterCount());
-        for (int64_t i = b; i <= e; i++)
+        int64_t first = b;
+
+        // A UDAF_BATCH function gets the whole frame in one call
+        if (getContext().getRunFlag(mcsv1sdk::UDAF_BATCH) && !fDistinct)
+        {
+            nextValues(b, e);
+            first = e + 1;
+        }
+
+        for (int64_t i = first; i <= e; i++)
         {
             if (i % 1000 == 0 && fStep->cancelled())
                 break;
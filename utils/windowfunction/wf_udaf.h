@@ -28,6 +28,7 @@
 #endif
 #include "windowfunctiontype.h"
 #include "mcsv1_udaf.h"
+#include "rowaggregation.h"
 
 
 namespace windowfunction
@@ -90,6 +91,7 @@ public:
 
 protected:
     void SetUDAFValue(static_any::any& valOut, int64_t colOut, int64_t b, int64_t e, int64_t c);
+    void nextValues(int64_t b, int64_t e);
 
     mcsv1sdk::mcsv1Context fUDAFContext;  // The UDAF context
     bool bInterrupted;                    // Shared by all the threads
@@ -101,6 +103,7 @@ protected:
 	DistinctMap fDistinctMap;             
 
     static_any::any fValOut;              // The return value
+    std::vector<rowgroup::UDAFBatchColumn> fBatchCols;  // The frame, for UDAF_BATCH functions
 
 public:
     static boost::shared_ptr<WindowFunctionType> makeFunction(int id, const string& name,
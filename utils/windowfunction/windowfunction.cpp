@@ -239,35 +239,12 @@ const Row& WindowFunction::getRow() const
 
 void WindowFunction::sort(std::vector<RowPosition>::iterator v, uint64_t n)
 {
-    // recursive function termination condition.
     if (n < 2 || fStep->cancelled())
         return;
 
-    RowPosition                   p = *(v + n / 2); // pivot value
-    vector<RowPosition>::iterator l = v;            // low   address
-    vector<RowPosition>::iterator h = v + (n - 1);  // high  address
-
-    while (l <= h && !(fStep->cancelled()))
-    {
-        // Can use while here, but need check boundary and cancel status.
-        if (fOrderBy->operator()(getPointer(*l), getPointer(p)))
-        {
-            l++;
-        }
-        else if (fOrderBy->operator()(getPointer(p), getPointer(*h)))
-        {
-            h--;
-        }
-        else
-        {
-            RowPosition t = *l;    // temp value for swap
-            *l++ = *h;
-            *h-- = t;
-        }
-    }
-
-    sort(v, std::distance(v, h) + 1);
-    sort(l, std::distance(l, v) + n);
+    sortByKey<RowPosition>(v, n, *fOrderBy,
+                           [this](RowPosition & p) { return getPointer(p); },
+                           [this]() { return fStep->cancelled(); });
 }
 
 
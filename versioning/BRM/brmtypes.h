@@ -193,7 +193,7 @@ struct CPInfoMerge
     LBID_t  startLbid; // starting LBID for relevant extent
     int64_t max;       // max value to be merged with current max value
     int64_t min;       // min value to be merged with current min value
-    int32_t seqNum;    // sequence number (not currently used)
+    int32_t seqNum;    // sequence number (not currently used, see CP_MERGE_INVALIDATE)
     execplan::CalpontSystemCatalog::ColDataType type;
     int32_t colWidth;
     bool	newExtent; // is this to be treated as a new extent
@@ -210,6 +210,11 @@ struct CPInfoMerge
 };
 typedef std::vector<CPInfoMerge> CPInfoMergeList_t;
 
+// CPInfoMerge::seqNum value telling mergeExtentsMaxMin() to invalidate the
+// extent instead of merging min/max into it.  cpimport sends it for dictionary
+// columns, whose ranges are collation-ordered string prefixes built by queries.
+const int32_t CP_MERGE_INVALIDATE = -3;
+
 // Used for map where lbid is the key.  Data members have same meaning as
 // those in CPInfoMerge.
 struct CPMaxMinMerge
@@ -536,6 +541,7 @@ const uint8_t GET_ALL_TABLE_LOCKS = 74;
 const uint8_t RELEASE_ALL_TABLE_LOCKS = 75;
 const uint8_t GET_TABLE_LOCK_INFO = 76;
 const uint8_t OWNER_CHECK = 77;   // the msg from the controller to worker
+const uint8_t GET_TABLE_VERSIONS = 78;
 
 /* Autoincrement interface (WIP) */
 const uint8_t START_AI_SEQUENCE = 80;
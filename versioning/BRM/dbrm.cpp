@@ -4322,6 +4322,33 @@ bool DBRM::getTableLockInfo(uint64_t id, TableLockInfo* tli)
     return (bool) err;
 }
 
+void DBRM::getTableVersions(const vector<uint32_t>& tableOIDs, vector<uint64_t>* versions,
+                            bool* locked)
+{
+    ByteStream command, response;
+    uint8_t err;
+
+    command << GET_TABLE_VERSIONS;
+    serializeInlineVector<uint32_t>(command, tableOIDs);
+    err = send_recv(command, response);
+
+    if (err != ERR_OK)
+    {
+        log("DBRM: getTableVersions(): network error", logging::LOG_TYPE_CRITICAL);
+        throw runtime_error("DBRM: getTableVersions(): network error");
+    }
+
+    response >> err;
+
+    if (err != ERR_OK)
+        throw runtime_error("DBRM: getTableVersions() processing error");
+
+    response >> err;
+    *locked = (bool) err;
+    deserializeInlineVector<uint64_t>(response, *versions);
+    idbassert(response.length() == 0);
+}
+
 void DBRM::startAISequence(uint32_t OID, uint64_t firstNum, uint32_t colWidth,
                            execplan::CalpontSystemCatalog::ColDataType colDataType)
 {
@@ -816,6 +816,10 @@ public:
     EXPORT std::vector<TableLockInfo> getAllTableLocks();
     EXPORT void releaseAllTableLocks();
     EXPORT bool getTableLockInfo(uint64_t id, TableLockInfo* out);
+    /* Versions of the given tables, which change whenever one is locked or
+     * unlocked; *locked is set if one is locked now.  Throws on error. */
+    EXPORT void getTableVersions(const std::vector<uint32_t>& tableOIDs,
+                                 std::vector<uint64_t>* versions, bool* locked);
 
     /** Casual partitioning support **/
     EXPORT int markExtentInvalid(const LBID_t lbid,
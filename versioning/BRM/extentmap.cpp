@@ -33,6 +33,7 @@
 #include <cerrno>
 #include <sstream>
 #include <vector>
+#include <list>
 #include <limits>
 #include <boost/scoped_array.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -107,6 +108,97 @@ inline void incSeqNum(int32_t& seqNum)
         seqNum = 0;
 }
 
+// One OID's extents as of the cache's generation, out of service ones included,
+// sorted.  Their CP ranges are those of cpGeneration.
+struct CachedExtents
+{
+    CachedExtents() : oid(0), cpGeneration(0), outOfService(false) { }
+
+    int oid;
+    uint64_t cpGeneration;
+    vector<BRM::EMEntry> extents;
+    vector<int> emIndexes;      // where each of the extents is in the EM
+    bool outOfService;          // if any of them is
+};
+typedef boost::shared_ptr<const CachedExtents> ExtentsPtr;
+typedef list<ExtentsPtr> ExtentsLRU;
+
+// The extents of the OIDs this process read last, shared by all its ExtentMaps.
+struct ExtentCache
+{
+    ExtentCache() : generation(0), bytes(0) { }
+
+    boost::mutex mutex;
+    uint64_t generation;
+    uint64_t bytes;
+    ExtentsLRU lru;             // most recently used first
+    tr1::unordered_map<int, ExtentsLRU::iterator> oids;
+};
+
+ExtentCache extentCache;
+
+uint64_t extentCacheSize()
+{
+    static const uint64_t size = config::Config::uFromText(
+        config::Config::makeConfig()->getConfig("ExtentMap", "ClientCacheSize"));
+    return size;
+}
+
+uint64_t cachedBytes(const CachedExtents& c)
+{
+    return c.extents.size() * (sizeof(BRM::EMEntry) + sizeof(int));
+}
+
+struct EMIndexLess
+{
+    explicit EMIndexLess(const BRM::EMEntry* em) : fEM(em) { }
+
+    bool operator()(int a, int b) const
+    {
+        return fEM[a] < fEM[b];
+    }
+
+    const BRM::EMEntry* fEM;
+};
+
+// call with extentCache.mutex held
+void uncacheExtents(tr1::unordered_map<int, ExtentsLRU::iterator>::iterator it)
+{
+    extentCache.bytes -= cachedBytes(**it->second);
+    extentCache.lru.erase(it->second);
+    extentCache.oids.erase(it);
+}
+
+// call with extentCache.mutex held
+void cacheExtents(uint64_t generation, const ExtentsPtr& extents)
+{
+    uint64_t bytes = cachedBytes(*extents);
+
+    // another thread has already cached a later EM
+    if (bytes > extentCacheSize() || generation < extentCache.generation)
+        return;
+
+    if (generation > extentCache.generation)
+    {
+        extentCache.oids.clear();
+        extentCache.lru.clear();
+        extentCache.bytes = 0;
+        extentCache.generation = generation;
+    }
+
+    tr1::unordered_map<int, ExtentsLRU::iterator>::iterator it = extentCache.oids.find(extents->oid);
+
+    if (it != extentCache.oids.end())
+        uncacheExtents(it);
+
+    while (extentCache.bytes + bytes > extentCacheSize() && !extentCache.lru.empty())
+        uncacheExtents(extentCache.oids.find(extentCache.lru.back()->oid));
+
+    extentCache.lru.push_front(extents);
+    extentCache.oids[extents->oid] = extentCache.lru.begin();
+    extentCache.bytes += bytes;
+}
+
 }
 
 namespace BRM
@@ -290,6 +382,8 @@ ExtentMap::ExtentMap()
     r_only = false;
     flLocked = false;
     emLocked = false;
+    scanCPUndoRecords = 0;
+    emScanCPOnly = false;
     fPExtMapImpl = 0;
     fPFreeListImpl = 0;
 
@@ -658,6 +752,7 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
                     }
                     fExtentMap[i].partition.cprange.isValid = CP_VALID;
                     incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                    scanCPUndoRecords++;
                     extentsUpdated++;
 #ifdef BRM_DEBUG
 
@@ -727,7 +822,8 @@ void ExtentMap::setExtentsMaxMin(const CPMaxMinMap_t& cpMap, bool firstNode, boo
 // @note - The key passed in the map must the starting LBID in the extent.
 // Used by cpimport to update extentmap casual partition min/max.
 // NULL or empty values should not be passed in as min/max values.
-// seqNum in the input struct is not currently used.
+// seqNum in the input struct is not currently used, other than to carry
+// CP_MERGE_INVALIDATE, which invalidates the extent instead of merging.
 //
 // Note that DML calls markInvalid() to flag an extent as CP_UPDATING and incre-
 // ments the sequence number prior to any change, and then marks the extent as
@@ -823,7 +919,14 @@ void ExtentMap::mergeExtentsMaxMin(CPMaxMinMergeMap_t& cpMap, bool useLock)
 
                 bool isBinaryColumn = it->second.colWidth > 8;
 
-                switch (fExtentMap[i].partition.cprange.isValid)
+                // Dictionary column; the range is rebuilt by the next scan
+                if (it->second.seqNum == CP_MERGE_INVALIDATE)
+                {
+                    makeUndoRecord(&fExtentMap[i], sizeof(struct EMEntry));
+                    fExtentMap[i].partition.cprange.isValid = CP_INVALID;
+                    incSeqNum(fExtentMap[i].partition.cprange.sequenceNum);
+                }
+                else switch (fExtentMap[i].partition.cprange.isValid)
                 {
                     // Merge input min/max with current min/max
                     case CP_VALID:
@@ -1371,17 +1474,24 @@ void ExtentMap::loadVersion4or5(IDBDataFile* in, bool upgradeV4ToV5)
 
         std::cout<<emNumElements<<" extents successfully upgraded"<<std::endl;
     }
-    
+
     for (int i = 0; i < emNumElements; i++)
     {
-        reserveLBIDRange(fExtentMap[i].range.start, fExtentMap[i].range.size);
-
         //@bug 1911 - verify status value is valid
         if (fExtentMap[i].status < EXTENTSTATUSMIN ||
                 fExtentMap[i].status > EXTENTSTATUSMAX)
             fExtentMap[i].status = EXTENTAVAILABLE;
     }
 
+    // Rebuilding the free list searches it once per extent, which is what made
+    // loading a big EM take minutes.  The image's own free list is used instead
+    // unless it doesn't match the extents.
+    if (upgradeV4ToV5 || !loadFreeList(in, emNumElements, flNumElements))
+    {
+        for (int i = 0; i < emNumElements; i++)
+            reserveLBIDRange(fExtentMap[i].range.start, fExtentMap[i].range.size);
+    }
+
     fEMShminfo->currentSize = emNumElements * sizeof(EMEntry);
 
 #ifdef DUMP_EXTENT_MAP
@@ -1416,6 +1526,82 @@ void ExtentMap::loadVersion4or5(IDBDataFile* in, bool upgradeV4ToV5)
 #endif
 }
 
+/* Reads the free list that follows the EM entries in an image, and installs it
+   if it and the extents already loaded cover every LBID exactly once. */
+bool ExtentMap::loadFreeList(IDBDataFile* in, int emNumElements, int flNumElements)
+{
+    if (flNumElements <= 0)
+        return false;
+
+    vector<InlineLBIDRange> freeList(flNumElements);
+    char* readPos = (char*) &freeList[0];
+    size_t progress = 0, readSize = flNumElements * sizeof(InlineLBIDRange);
+    int err;
+
+    while (progress < readSize)
+    {
+        err = in->read(readPos + progress, readSize - progress);
+
+        if (err <= 0)
+        {
+            log("ExtentMap::loadFreeList(): the image's free list is truncated, rebuilding it",
+                logging::LOG_TYPE_WARNING);
+            return false;
+        }
+
+        progress += (uint) err;
+    }
+
+    vector<pair<LBID_t, LBID_t> > ranges;
+    int i, flEntries = 0;
+
+    ranges.reserve(emNumElements + flNumElements);
+
+    for (i = 0; i < emNumElements; i++)
+        if (fExtentMap[i].range.size != 0)
+            ranges.push_back(make_pair(fExtentMap[i].range.start,
+                                       fExtentMap[i].range.start + ((LBID_t) fExtentMap[i].range.size) * 1024));
+
+    for (i = 0; i < flNumElements; i++)
+        if (freeList[i].size != 0)
+        {
+            ranges.push_back(make_pair(freeList[i].start,
+                                       freeList[i].start + ((LBID_t) freeList[i].size) * 1024));
+            flEntries++;
+        }
+
+    sort(ranges.begin(), ranges.end());
+
+    LBID_t next = 0;
+
+    for (i = 0; i < (int) ranges.size(); i++)
+    {
+        if (ranges[i].first != next)
+            break;
+
+        next = ranges[i].second;
+    }
+
+    if (i < (int) ranges.size() || next != (1LL << 36))
+    {
+        log("ExtentMap::loadFreeList(): the image's free list doesn't match its extents, rebuilding it",
+            logging::LOG_TYPE_WARNING);
+        return false;
+    }
+
+    if (fFLShminfo->allocdSize < (int) (flEntries * sizeof(InlineLBIDRange)))
+        growFLShmseg(flEntries);
+
+    memset(fFreeList, 0, fFLShminfo->allocdSize);
+
+    for (i = 0, flEntries = 0; i < flNumElements; i++)
+        if (freeList[i].size != 0)
+            fFreeList[flEntries++] = freeList[i];
+
+    fFLShminfo->currentSize = flEntries * sizeof(InlineLBIDRange);
+    return true;
+}
+
 void ExtentMap::load(const string& filename, bool fixFL)
 {
 #ifdef BRM_INFO
@@ -1762,6 +1948,10 @@ void ExtentMap::releaseEMEntryTable(OPS op)
            declaring the EM unlocked here is OK.  Same with all similar assignments.
          */
         emLocked = false;
+        // scans filling in CP ranges leave the rest of the cached extents current
+        fMST.bumpGeneration(MasterSegmentTable::EMTable, emScanCPOnly);
+        scanCPUndoRecords = 0;
+        emScanCPOnly = false;
         fMST.releaseTable_write(MasterSegmentTable::EMTable);
     }
 }
@@ -1842,7 +2032,7 @@ void ExtentMap::growEMShmseg(size_t nrows)
 
 /* Must be called holding the FL lock
    Returns with the new shmseg mapped */
-void ExtentMap::growFLShmseg()
+void ExtentMap::growFLShmseg(size_t nrows)
 {
     size_t allocSize;
     key_t newshmkey;
@@ -1855,6 +2045,9 @@ void ExtentMap::growFLShmseg()
     newshmkey = chooseFLShmkey();
     ASSERT((allocSize == EM_FREELIST_INITIAL_SIZE && !fPFreeListImpl) || fPFreeListImpl);
 
+    //Use the larger of the calculated value or the specified value
+    allocSize = max(allocSize, nrows * sizeof(InlineLBIDRange));
+
     if (!fPFreeListImpl)
         fPFreeListImpl = FreeListImpl::makeFreeListImpl(newshmkey, allocSize, false);
     else
@@ -4765,6 +4958,13 @@ void ExtentMap::getExtents(int OID, vector<struct EMEntry>& entries,
         throw invalid_argument(oss.str());
     }
 
+    // the cached extents are sorted already
+    if (extentCacheSize() > 0)
+    {
+        getCachedExtents(OID, entries, incOutOfService);
+        return;
+    }
+
     grabEMEntryTable(READ);
     emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
     // Pre-expand entries to stop lots of small allocs
@@ -4792,6 +4992,94 @@ void ExtentMap::getExtents(int OID, vector<struct EMEntry>& entries,
         sort<vector<struct EMEntry>::iterator>(entries.begin(), entries.end());
 }
 
+//------------------------------------------------------------------------------
+// getExtents() through the process' extent cache.  Every change to the EM bumps
+// its generation in the MST, except for the CP ranges scans fill in, which bump
+// its CP generation instead.  While the generation is the one the OID's extents
+// were copied at they're returned without scanning the EM; if only the CP
+// generation moved, just their CP ranges are read again.
+//------------------------------------------------------------------------------
+void ExtentMap::getCachedExtents(int OID, vector<struct EMEntry>& entries, bool incOutOfService)
+{
+    uint64_t generation = fMST.getGeneration(MasterSegmentTable::EMTable);
+    uint64_t cpGeneration = fMST.getCPGeneration(MasterSegmentTable::EMTable);
+    ExtentsPtr extents;
+
+    {
+        boost::mutex::scoped_lock lk(extentCache.mutex);
+
+        if (extentCache.generation == generation)
+        {
+            tr1::unordered_map<int, ExtentsLRU::iterator>::iterator it = extentCache.oids.find(OID);
+
+            if (it != extentCache.oids.end())
+            {
+                extentCache.lru.splice(extentCache.lru.begin(), extentCache.lru, it->second);
+                extents = *it->second;
+            }
+        }
+    }
+
+    if (!extents || extents->cpGeneration != cpGeneration)
+    {
+        boost::shared_ptr<CachedExtents> newExtents(new CachedExtents());
+        int i, emEntries;
+
+        newExtents->oid = OID;
+        grabEMEntryTable(READ);
+
+        // can't change while we hold the read lock
+        if (extents && fMST.getGeneration(MasterSegmentTable::EMTable) == generation)
+        {
+            *newExtents = *extents;
+
+            for (i = 0; i < (int) newExtents->extents.size(); i++)
+                newExtents->extents[i].partition = fExtentMap[newExtents->emIndexes[i]].partition;
+        }
+        else
+        {
+            generation = fMST.getGeneration(MasterSegmentTable::EMTable);
+            emEntries = fEMShminfo->allocdSize / sizeof(struct EMEntry);
+
+            for (i = 0 ; i < emEntries; i++)
+                if ((fExtentMap[i].fileID == OID) &&
+                        (fExtentMap[i].range.size != 0))
+                    newExtents->emIndexes.push_back(i);
+
+            sort(newExtents->emIndexes.begin(), newExtents->emIndexes.end(), EMIndexLess(fExtentMap));
+            newExtents->extents.reserve(newExtents->emIndexes.size());
+
+            for (i = 0; i < (int) newExtents->emIndexes.size(); i++)
+            {
+                newExtents->extents.push_back(fExtentMap[newExtents->emIndexes[i]]);
+
+                if (newExtents->extents.back().status == EXTENTOUTOFSERVICE)
+                    newExtents->outOfService = true;
+            }
+        }
+
+        newExtents->cpGeneration = fMST.getCPGeneration(MasterSegmentTable::EMTable);
+        releaseEMEntryTable(READ);
+
+        extents = newExtents;
+        boost::mutex::scoped_lock lk(extentCache.mutex);
+        cacheExtents(generation, extents);
+    }
+
+    // the only copy, unless the out of service extents have to be left out
+    if (incOutOfService || !extents->outOfService)
+    {
+        entries = extents->extents;
+        return;
+    }
+
+    entries.reserve(extents->extents.size());
+
+    for (uint32_t i = 0; i < extents->extents.size(); i++)
+        if (extents->extents[i].status != EXTENTOUTOFSERVICE)
+            entries.push_back(extents->extents[i]);
+}
+
 void ExtentMap::getExtents_dbroot(int OID, vector<struct EMEntry>& entries, const uint16_t dbroot)
 {
 #ifdef BRM_INFO
@@ -5773,6 +6061,7 @@ void ExtentMap::undoChanges()
     if (fDebug) TRACER_WRITENOW("undoChanges");
 
 #endif
+    emScanCPOnly = (scanCPUndoRecords > 0 && scanCPUndoRecords == (int) undoRecords.size());
     Undoable::undoChanges();
     finishChanges();
 }
@@ -5784,6 +6073,7 @@ void ExtentMap::confirmChanges()
     if (fDebug) TRACER_WRITENOW("confirmChanges");
 
 #endif
+    emScanCPOnly = (scanCPUndoRecords > 0 && scanCPUndoRecords == (int) undoRecords.size());
     Undoable::confirmChanges();
     finishChanges();
 }
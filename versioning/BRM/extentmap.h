@@ -755,6 +755,10 @@ public:
      * @param sorted (in) indicates if output is to be sorted
      * @param notFoundErr (in) indicates if no extents is considered an err
      * @param incOutOfService (in) include/exclude out of service extents
+     *
+     * With ExtentMap/ClientCacheSize set, the OID's extents are kept sorted in
+     * the process and reused until the next change to the extent map; CP
+     * ranges filled in by scans only refresh those.
      */
     EXPORT void getExtents(int OID, std::vector<struct EMEntry>& entries,
                            bool sorted = true, bool notFoundErr = true,
@@ -945,6 +949,9 @@ private:
 
     int numUndoRecords;
     bool flLocked, emLocked;
+    // undo records made by scans filling in CP ranges, and if they're all there are
+    int scanCPUndoRecords;
+    bool emScanCPOnly;
     static boost::mutex mutex; // @bug5355 - made mutex static
     boost::mutex fConfigCacheMutex; // protect access to Config Cache
 
@@ -988,8 +995,9 @@ private:
     void releaseEMEntryTable(OPS op);
     void releaseFreeList(OPS op);
     void growEMShmseg(size_t nrows = 0);
-    void growFLShmseg();
+    void growFLShmseg(size_t nrows = 0);
     void finishChanges();
+    void getCachedExtents(int OID, std::vector<struct EMEntry>& entries, bool incOutOfService);
 
     EXPORT unsigned getFilesPerColumnPartition();
     unsigned getExtentsPerSegmentFile();
@@ -1009,6 +1017,7 @@ private:
      * extent map from v4 to v5.
      */
     void loadVersion4or5(idbdatafile::IDBDataFile* in, bool upgradeV4ToV5);
+    bool loadFreeList(idbdatafile::IDBDataFile* in, int emNumElements, int flNumElements);
 
     ExtentMapImpl* fPExtMapImpl;
     FreeListImpl* fPFreeListImpl;
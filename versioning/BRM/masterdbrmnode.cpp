@@ -569,6 +569,10 @@ void MasterDBRMNode::msgProcessor()
             case OWNER_CHECK:
                 doOwnerCheck(msg, p);
                 continue;
+
+            case GET_TABLE_VERSIONS:
+                doGetTableVersions(msg, p);
+                continue;
         }
 
         /* Process OIDManager calls */
@@ -2495,6 +2499,37 @@ void MasterDBRMNode::doGetTableLockInfo(ByteStream& msg, ThreadParams* p)
     }
 }
 
+void MasterDBRMNode::doGetTableVersions(ByteStream& msg, ThreadParams* p)
+{
+    uint8_t cmd;
+    ByteStream reply;
+    vector<uint32_t> tableOIDs;
+    vector<uint64_t> versions;
+    bool locked;
+
+    try
+    {
+        msg >> cmd;
+        deserializeInlineVector<uint32_t>(msg, tableOIDs);
+        idbassert(msg.length() == 0);
+        tableLockServer->getTableVersions(tableOIDs, &versions, &locked);
+        reply << (uint8_t) ERR_OK << (uint8_t) locked;
+        serializeInlineVector<uint64_t>(reply, versions);
+        p->sock->write(reply);
+    }
+    catch (exception&)
+    {
+        reply.restart();
+        reply << (uint8_t) ERR_FAILURE;
+
+        try
+        {
+            p->sock->write(reply);
+        }
+        catch (...) { }
+    }
+}
+
 void MasterDBRMNode::doOwnerCheck(ByteStream& msg, ThreadParams* p)
 {
     uint8_t cmd;
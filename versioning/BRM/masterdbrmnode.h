@@ -232,6 +232,7 @@ private:
     void doReleaseAllTableLocks(messageqcpp::ByteStream& msg, ThreadParams* p);
     void doGetTableLockInfo(messageqcpp::ByteStream& msg, ThreadParams* p);
     void doOwnerCheck(messageqcpp::ByteStream& msg, ThreadParams* p);
+    void doGetTableVersions(messageqcpp::ByteStream& msg, ThreadParams* p);
 
     /* Autoincrement interface */
     AutoincrementManager aiManager;
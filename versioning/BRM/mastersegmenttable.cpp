@@ -25,6 +25,7 @@
 #include <stdexcept>
 #include <sys/types.h>
 #include <cerrno>
+#include <ctime>
 using namespace std;
 
 #include <boost/thread.hpp>
@@ -37,6 +38,7 @@ namespace bi = boost::interprocess;
 #include "calpontsystemcatalog.h"
 #include "rwlock.h"
 using namespace rwlock;
+#include "atomicops.h"
 #define MASTERSEGMENTTABLE_DLLEXPORT
 #include "mastersegmenttable.h"
 #undef MASTERSEGMENTTABLE_DLLEXPORT
@@ -111,7 +113,9 @@ MasterSegmentTableImpl::MasterSegmentTableImpl(int key, int size)
 MSTEntry::MSTEntry() :
     tableShmkey(-1),
     allocdSize(0),
-    currentSize(0)
+    currentSize(0),
+    generation(0),
+    cpGeneration(0)
 {
 }
 
@@ -189,8 +193,11 @@ void MasterSegmentTable::makeMSTSegment()
 
 void MasterSegmentTable::initMSTData()
 {
-    void *dp = static_cast<void*>(&fShmDescriptors);
-    memset(dp, 0, MSTshmsize);
+    memset(fShmDescriptors, 0, MSTshmsize);
+
+    // a process that outlives the segment mustn't mistake a new table for the old one
+    for (int i = 0; i < nTables; i++)
+        fShmDescriptors[i].generation = static_cast<uint64_t>(time(NULL)) << 32;
 }
 
 MSTEntry* MasterSegmentTable::getTable_read(int num, bool block) const
@@ -265,4 +272,15 @@ void MasterSegmentTable::releaseTable_write(int num) const
     rwlock[num]->write_unlock();
 }
 
+void MasterSegmentTable::bumpGeneration(int num, bool cpOnly) const
+{
+    if (num < 0 || num >= nTables)
+        throw std::invalid_argument("ControllerSegmentTable::bumpGeneration()");
+
+    if (cpOnly)
+        atomicops::atomicInc(&fShmDescriptors[num].cpGeneration);
+    else
+        atomicops::atomicInc(&fShmDescriptors[num].generation);
+}
+
 }		//namespace
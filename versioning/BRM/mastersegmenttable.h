@@ -35,6 +35,7 @@
 #define _MASTERSEGMENTTABLE_H_
 
 #include <stdexcept>
+#include <stdint.h>
 #include <sys/types.h>
 #include <boost/thread.hpp>
 #include <boost/interprocess/shared_memory_object.hpp>
@@ -58,6 +59,8 @@ struct MSTEntry
     key_t tableShmkey;
     int allocdSize;
     int currentSize;
+    uint64_t generation;    // see MasterSegmentTable::getGeneration()
+    uint64_t cpGeneration;
     EXPORT MSTEntry();
 };
 
@@ -190,6 +193,27 @@ public:
         return fShmDescriptors[VSSSegment].tableShmkey;
     }
 
+    /** @brief This function gets the generation of the specified table without locking
+     *
+     * The writer of a table bumps its generation before it gives up the write lock,
+     * so a copy of the table's contents taken under the read lock is still current
+     * while the generation it was taken at is.  Used by ExtentMap to cache the
+     * extents of an OID in each process.
+     */
+    inline uint64_t getGeneration(int num) const
+    {
+        return *static_cast<volatile uint64_t*>(&fShmDescriptors[num].generation);
+    }
+
+    /** @brief Like getGeneration(), for changes to the EM's casual partitioning ranges only */
+    inline uint64_t getCPGeneration(int num) const
+    {
+        return *static_cast<volatile uint64_t*>(&fShmDescriptors[num].cpGeneration);
+    }
+
+    /** @brief Bumps the generation, or only the CP generation, of a table the caller has write locked */
+    EXPORT void bumpGeneration(int num, bool cpOnly = false) const;
+
 private:
     MasterSegmentTable(const MasterSegmentTable& mst);
     MasterSegmentTable& operator=(const MasterSegmentTable& mst);
@@ -143,6 +143,13 @@ void SessionManagerServer::reset()
     semValue = maxTxns;
     condvar.notify_all();
     activeTxns.clear();
+
+    if (!ddlTxns.empty())
+    {
+        ddlTxns.clear();
+        ++_sysCatVerID;
+    }
+
     mutex.unlock();
 }
 
@@ -288,8 +295,12 @@ const TxnID SessionManagerServer::newTxnID(const SID session, bool block, bool i
     ret.valid = true;
     activeTxns[session] = ret.id;
 
+    // again when it ends, the catalog read while it ran isn't the committed one
     if (isDDL)
+    {
         ++_sysCatVerID;
+        ddlTxns.insert(ret.id);
+    }
 
     saveSMTxnIDAndState();
 
@@ -320,6 +331,12 @@ void SessionManagerServer::finishTransaction(TxnID& txn)
             ++it;
     }
 
+    if (ddlTxns.erase(txn.id) > 0)
+    {
+        ++_sysCatVerID;
+        saveSMTxnIDAndState();
+    }
+
     if (found)
     {
         semValue++;
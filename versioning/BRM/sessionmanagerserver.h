@@ -28,6 +28,7 @@
 #define _SESSIONMANAGERSERVER_H
 
 #include <map>
+#include <set>
 
 #include <boost/shared_array.hpp>
 #include <boost/thread/mutex.hpp>
@@ -278,6 +279,7 @@ private:
     uint32_t systemState;
 
     std::map<SID, execplan::CalpontSystemCatalog::SCN> activeTxns;
+    std::set<execplan::CalpontSystemCatalog::SCN> ddlTxns;   // the active ones that change the syscat
     typedef std::map<SID, execplan::CalpontSystemCatalog::SCN>::iterator iterator;
 
     boost::mutex mutex;
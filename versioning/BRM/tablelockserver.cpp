@@ -21,6 +21,8 @@
  ****************************************************************************/
 
 #include <exception>
+#include <algorithm>
+#include <ctime>
 #include <boost/scoped_ptr.hpp>
 
 #include "configcpp.h"
@@ -40,6 +42,8 @@ namespace BRM
 
 TableLockServer::TableLockServer(SessionManagerServer* sm) : sms(sm)
 {
+    baseVersion = lastVersion = (uint64_t) time(NULL) << 24;
+
     boost::mutex::scoped_lock lk(mutex);
     config::Config* config = config::Config::makeConfig();
 
@@ -169,6 +173,7 @@ uint64_t TableLockServer::lock(TableLockInfo* tli)
         throw;
     }
 
+    bumpVersion(tli->tableOID);
     return tli->id;
 }
 
@@ -195,6 +200,7 @@ bool TableLockServer::unlock(uint64_t id)
             throw;
         }
 
+        bumpVersion(tli.tableOID);
         return true;
     }
 
@@ -296,6 +302,9 @@ void TableLockServer::releaseAllLocks()
         tmp.swap(locks);
         throw;
     }
+
+    for (lit_t it = tmp.begin(); it != tmp.end(); ++it)
+        bumpVersion(it->second.tableOID);
 }
 
 bool TableLockServer::getLockInfo(uint64_t id, TableLockInfo* out) const
@@ -317,5 +326,30 @@ bool TableLockServer::getLockInfo(uint64_t id, TableLockInfo* out) const
     return false;
 }
 
+// call with lock held
+void TableLockServer::bumpVersion(uint32_t tableOID)
+{
+    tableVersions[tableOID] = ++lastVersion;
 }
 
+void TableLockServer::getTableVersions(const vector<uint32_t>& tableOIDs,
+                                       vector<uint64_t>* versions, bool* locked) const
+{
+    map<uint32_t, uint64_t>::const_iterator vit;
+    constlit_t it;
+    boost::mutex::scoped_lock lk(mutex);
+
+    versions->resize(tableOIDs.size());
+    *locked = false;
+
+    for (uint32_t i = 0; i < tableOIDs.size(); i++)
+    {
+        vit = tableVersions.find(tableOIDs[i]);
+        (*versions)[i] = (vit == tableVersions.end() ? baseVersion : vit->second);
+    }
+
+    for (it = locks.begin(); it != locks.end() && !*locked; ++it)
+        *locked = (find(tableOIDs.begin(), tableOIDs.end(), it->second.tableOID) != tableOIDs.end());
+}
+
+}
@@ -52,9 +52,16 @@ public:
     EXPORT void releaseAllLocks();
     EXPORT bool getLockInfo(uint64_t id, TableLockInfo* out) const;
 
+    /* A table's version changes whenever a lock on it is granted or released,
+     * which every writer does around its changes.  *locked is set if any of the
+     * tables is locked right now, ie their contents may be changing. */
+    EXPORT void getTableVersions(const std::vector<uint32_t>& tableOIDs,
+                                 std::vector<uint64_t>* versions, bool* locked) const;
+
 private:
     void load();
     void save();
+    void bumpVersion(uint32_t tableOID);
 
     mutable boost::mutex mutex;
     std::map<uint64_t, TableLockInfo> locks;
@@ -62,6 +69,11 @@ private:
     typedef std::map<uint64_t, TableLockInfo>::const_iterator constlit_t;
     std::string filename;
     SessionManagerServer* sms;
+
+    // tables not locked since startup are at baseVersion; it differs per run
+    std::map<uint32_t, uint64_t> tableVersions;
+    uint64_t baseVersion;
+    uint64_t lastVersion;
 };
 
 }
@@ -281,7 +281,12 @@ void ColExtInf::getCPInfoForBRM( JobColumn column, BRMReporter& brmReporter )
             cpInfoMerge.bigMax = bigMaxVal;
             cpInfoMerge.bigMin = bigMinVal;
         }
-        cpInfoMerge.seqNum    = -1;     // Not used by mergeExtentsMaxMin
+        // Dictionary min/max are string prefixes that only queries maintain
+        if (column.colType == COL_TYPE_DICT)
+            cpInfoMerge.seqNum = BRM::CP_MERGE_INVALIDATE;
+        else
+            cpInfoMerge.seqNum = -1;    // Not used by mergeExtentsMaxMin
+
         cpInfoMerge.type      = column.dataType;
         cpInfoMerge.newExtent = iter->second.fNewExtent;
         cpInfoMerge.colWidth = column.width;
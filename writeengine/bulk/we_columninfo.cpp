@@ -180,20 +180,6 @@ ColumnInfo::ColumnInfo(Log*             logger,
             break;
         }
 
-        case WriteEngine::WR_CHAR:
-        {
-            if (column.colType == COL_TYPE_DICT)
-            {
-                fColExtInf = new ColExtInfBase( );
-            }
-            else
-            {
-                fColExtInf = new ColExtInf(column.mapOid, logger);
-            }
-
-            break;
-        }
-
         case WriteEngine::WR_SHORT:
         case WriteEngine::WR_BYTE:
         case WriteEngine::WR_LONGLONG:
@@ -205,6 +191,9 @@ ColumnInfo::ColumnInfo(Log*             logger,
         case WriteEngine::WR_UMEDINT:
         case WriteEngine::WR_UINT:
         case WriteEngine::WR_BINARY:
+        // Dictionary ranges are built by queries, so for those the extents
+        // we start loading into are only tracked to be invalidated at EOJ.
+        case WriteEngine::WR_CHAR:
         default:
         {
             fColExtInf = new ColExtInf(column.mapOid, logger);
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <cstdio>
 #include <ctime>
+#include <algorithm>
 //#define NDEBUG
 #include <cassert>
 using namespace std;
@@ -33,6 +34,7 @@ using namespace std;
 
 #include "logger.h"
 #include "cacheutils.h"
+#include "threadpool.h"
 
 #include "we_chunkmanager.h"
 
@@ -103,8 +105,20 @@ ChunkManager::ChunkManager() : fMaxActiveChunkNum(100), fLenCompressed(0), fIsBu
 {
     fUserPaddings = Config::getNumCompressedPadBlks() * BYTE_PER_BLOCK;
     fCompressor.numUserPaddingBytes(fUserPaddings);
+    fFlushThreads = Config::getFlushThreads();
     fMaxCompressedBufSize = COMPRESSED_CHUNK_SIZE + fUserPaddings;
     fBufCompressed = new char[fMaxCompressedBufSize];
+
+    // the flush threads besides the committing one stay up between flushes
+    if (fFlushThreads > 1)
+    {
+        fFlushPool.reset(new threadpool::ThreadPool(fFlushThreads - 1, fFlushThreads));
+        fFlushPool->setName("ChunkFlush");
+
+        for (unsigned int n = 0; n < fFlushThreads; n++)
+            fFlushBufs.push_back(new char[fMaxCompressedBufSize]);
+    }
+
     fSysLogger = new logging::Logger(SUBSYSTEM_ID_WE);
     logging::MsgMap msgMap;
     msgMap[logging::M0080] = logging::Message(logging::M0080);
@@ -122,6 +136,9 @@ ChunkManager::~ChunkManager()
     delete [] fBufCompressed;
     fBufCompressed = NULL;
 
+    for (unsigned int n = 0; n < fFlushBufs.size(); n++)
+        delete [] fFlushBufs[n];
+
     delete fSysLogger;
     fSysLogger = NULL;
 }
@@ -550,81 +567,46 @@ int ChunkManager::flushChunks(int rc, const std::map<FID, FID>& columOids)
     // shall fail the the statement if failed here
     WE_COMP_DBG(cout << "flushChunks." << endl;)
 
-    int k = fFilePtrMap.size();
-    std::map<FID, FID>::const_iterator it;
+    vector<CompFileData*> files;
+    map<IDBDataFile*, CompFileData*>::iterator i;
+    uint32_t k;
 
-    if ((rc == NO_ERROR) && fIsInsert)
+    if (rc == NO_ERROR)
     {
-        while (k-- > 0 && rc == NO_ERROR)
-        {
-            map<IDBDataFile*, CompFileData*>::iterator i = fFilePtrMap.begin();
-            // sort the chunk list first
-            CompFileData* fileData = i->second;
-            it = columOids.find (fileData->fFid);
-
-            if (it != columOids.end())
-            {
-                list<ChunkData*>& chunkList = fileData->fChunkList;
-                chunkList.sort(chunkDataPtrLessCompare);
-                list<ChunkData*>::iterator j = chunkList.begin();
-
-                while (j != chunkList.end())
-                {
-                    if ((rc = writeChunkToFile(fileData, *j)) != NO_ERROR)
-                        break;
-
-                    // write chunk to file removes the written chunk from the list
-                    j = chunkList.begin();
-                }
-
-                if (rc != NO_ERROR)
-                    break;
+        for (i = fFilePtrMap.begin(); i != fFilePtrMap.end(); ++i)
+            if (!fIsInsert || columOids.find(i->second->fFid) != columOids.end())
+                files.push_back(i->second);
+    }
 
-                // finally update the header
-                if ((rc = writeHeader(fileData, __LINE__)) != NO_ERROR)
-                    break;
+    // The chunks and then the header of each file are written.  With 1 flush
+    // thread each file is then synced, and its backups removed, before the
+    // next file is written.  With more, the files are synced together at the
+    // end and only then are the backups removed; a crash before that sync
+    // leaves the backups to recover from.
+    for (k = 0; k < files.size() && rc == NO_ERROR; k++)
+    {
+        if ((rc = writeChunks(files[k])) == NO_ERROR)
+            rc = writeHeader(files[k], __LINE__, fFlushThreads == 1);
 
-                //@Bug 4977 remove log file
-                removeBackups(fTransId);
+        if (rc == NO_ERROR && fFlushThreads == 1)
+        {
+            //@Bug 4977 remove log file
+            removeBackups(fTransId);
 
-                // closeFile invalidates the iterator
-                closeFile(fileData);
-            }
+            // closeFile invalidates files[k]
+            closeFile(files[k]);
         }
     }
-    else if (rc == NO_ERROR)
+
+    if (rc == NO_ERROR && fFlushThreads > 1)
     {
-        while (k-- > 0 && rc == NO_ERROR)
+        if ((rc = syncFiles(files)) == NO_ERROR)
         {
-            map<IDBDataFile*, CompFileData*>::iterator i = fFilePtrMap.begin();
-            // sort the chunk list first
-            CompFileData* fileData = i->second;
-
-            list<ChunkData*>& chunkList = fileData->fChunkList;
-            chunkList.sort(chunkDataPtrLessCompare);
-            list<ChunkData*>::iterator j = chunkList.begin();
-
-            while (j != chunkList.end())
-            {
-                if ((rc = writeChunkToFile(fileData, *j)) != NO_ERROR)
-                    break;
-
-                // write chunk to file removes the written chunk from the list
-                j = chunkList.begin();
-            }
-
-            if (rc != NO_ERROR)
-                break;
-
-            // finally update the header
-            if ((rc = writeHeader(fileData, __LINE__)) != NO_ERROR)
-                break;
-
             //@Bug 4977 remove log file
             removeBackups(fTransId);
 
-            // closeFile invalidates the iterator
-            closeFile(fileData);
+            for (k = 0; k < files.size(); k++)
+                closeFile(files[k]);
         }
     }
 
@@ -842,6 +824,144 @@ void ChunkManager::initializeDctnryChunk(char* buf, int size)
     }
 }
 
+//------------------------------------------------------------------------------
+// Compress and write all the chunks in fileData's list, in chunk order.  With
+// more than 1 flush thread the changed chunks are compressed a batch at a time
+// in parallel ahead of being written; the writes and chunk pointer updates
+// stay in order on this thread.
+//------------------------------------------------------------------------------
+int ChunkManager::writeChunks(CompFileData* fileData)
+{
+    int rc = NO_ERROR;
+    list<ChunkData*>& chunkList = fileData->fChunkList;
+
+    chunkList.sort(chunkDataPtrLessCompare);
+
+    while (!chunkList.empty() && rc == NO_ERROR)
+    {
+        ChunkData* chunkData = chunkList.front();
+
+        if (fFlushThreads > 1 && chunkData->fWriteToFile &&
+                fCompressedChunks.find(chunkData) == fCompressedChunks.end())
+            rc = compressChunks(chunkList);
+
+        // write chunk to file removes the written chunk from the list
+        if (rc == NO_ERROR)
+            rc = writeChunkToFile(fileData, chunkData);
+    }
+
+    fCompressedChunks.clear();
+    return rc;
+}
+
+//------------------------------------------------------------------------------
+// Compress the first fFlushThreads changed chunks in chunkList into
+// fFlushBufs, one per flush thread, and note them in fCompressedChunks.
+// fCompressor is stateless, so the threads share it.
+//------------------------------------------------------------------------------
+int ChunkManager::compressChunks(list<ChunkData*>& chunkList)
+{
+    vector<ChunkData*> batch;
+    list<ChunkData*>::iterator it;
+    uint32_t n;
+
+    for (it = chunkList.begin(); it != chunkList.end() && batch.size() < fFlushThreads; ++it)
+        if ((*it)->fWriteToFile)
+            batch.push_back(*it);
+
+    vector<CompressedChunk> compressed(batch.size());
+    vector<int> rcs(batch.size(), 0);
+    vector<uint64_t> jobs;
+
+#ifdef PROFILE
+    Stats::startParseEvent(WE_STATS_COMPRESS_DCT_COMPRESS);
+#endif
+
+    for (n = 0; n < batch.size(); n++)
+    {
+        compressed[n].fBuf = n;
+        compressed[n].fLen = fMaxCompressedBufSize;
+
+        ChunkData* chunkData = batch[n];
+        char* buf = fFlushBufs[n];
+        CompressedChunk* out = &compressed[n];
+        int* rc = &rcs[n];
+        boost::function0<void> compress = [this, chunkData, buf, out, rc]()
+        {
+            *rc = fCompressor.compressBlock((char*)chunkData->fBufUnCompressed,
+                                            chunkData->fLenUnCompressed,
+                                            (unsigned char*)buf,
+                                            out->fLen);
+        };
+
+        // the last one is done on this thread
+        if (n + 1 < batch.size())
+            jobs.push_back(fFlushPool->invoke(compress));
+        else
+            compress();
+    }
+
+    fFlushPool->join(jobs);
+
+#ifdef PROFILE
+    Stats::stopParseEvent(WE_STATS_COMPRESS_DCT_COMPRESS);
+#endif
+
+    for (n = 0; n < batch.size(); n++)
+    {
+        if (rcs[n] != 0)
+        {
+            logMessage(ERR_COMP_COMPRESS, logging::LOG_TYPE_ERROR, __LINE__);
+            return ERR_COMP_COMPRESS;
+        }
+
+        fCompressedChunks[batch[n]] = compressed[n];
+    }
+
+    return NO_ERROR;
+}
+
+//------------------------------------------------------------------------------
+// Sync the given files to disk, on the flush pool and this thread.
+//------------------------------------------------------------------------------
+int ChunkManager::syncFiles(const vector<CompFileData*>& files)
+{
+    vector<int> rcs(files.size(), 0);
+    vector<uint64_t> jobs;
+    uint32_t k;
+
+    for (k = 0; k < files.size(); k++)
+    {
+        IDBDataFile* pFile = files[k]->fFilePtr;
+        int* rc = &rcs[k];
+        boost::function0<void> sync = [pFile, rc]()
+        {
+            *rc = pFile->flush();
+        };
+
+        // the last one is done on this thread
+        if (k + 1 < files.size())
+            jobs.push_back(fFlushPool->invoke(sync));
+        else
+            sync();
+    }
+
+    fFlushPool->join(jobs);
+
+    for (k = 0; k < files.size(); k++)
+    {
+        if (rcs[k] != 0)
+        {
+            ostringstream oss;
+            oss << "Failed to flush " << files[k]->fFileName << " @line: " << __LINE__;
+            logMessage(oss.str(), logging::LOG_TYPE_ERROR);
+            return ERR_FILE_WRITE;
+        }
+    }
+
+    return NO_ERROR;
+}
+
 //------------------------------------------------------------------------------
 // Compress and write the requested chunk (id) for fileData, to disk.
 // id is: (fbo*BYTE_PER_BLOCK)/UNCOMPRESSED_CHUNK_SIZE
@@ -879,16 +999,28 @@ int ChunkManager::writeChunkToFile(CompFileData* fileData, ChunkData* chunkData)
 #ifdef PROFILE
         Stats::startParseEvent(WE_STATS_COMPRESS_DCT_COMPRESS);
 #endif
-        // compress the chunk before writing it to file
-        fLenCompressed = fMaxCompressedBufSize;
+        // compress the chunk before writing it to file, unless compressChunks()
+        // did; its buffer then becomes fBufCompressed, and the old one is reused
+        map<ChunkData*, CompressedChunk>::iterator cit = fCompressedChunks.find(chunkData);
 
-        if (fCompressor.compressBlock((char*)chunkData->fBufUnCompressed,
-                                      chunkData->fLenUnCompressed,
-                                      (unsigned char*)fBufCompressed,
-                                      fLenCompressed) != 0)
+        if (cit != fCompressedChunks.end())
         {
-            logMessage(ERR_COMP_COMPRESS, logging::LOG_TYPE_ERROR, __LINE__);
-            return ERR_COMP_COMPRESS;
+            fLenCompressed = cit->second.fLen;
+            std::swap(fBufCompressed, fFlushBufs[cit->second.fBuf]);
+            fCompressedChunks.erase(cit);
+        }
+        else
+        {
+            fLenCompressed = fMaxCompressedBufSize;
+
+            if (fCompressor.compressBlock((char*)chunkData->fBufUnCompressed,
+                                          chunkData->fLenUnCompressed,
+                                          (unsigned char*)fBufCompressed,
+                                          fLenCompressed) != 0)
+            {
+                logMessage(ERR_COMP_COMPRESS, logging::LOG_TYPE_ERROR, __LINE__);
+                return ERR_COMP_COMPRESS;
+            }
         }
 
         WE_COMP_DBG(cout << "Chunk compressed from " << chunkData->fLenUnCompressed << " to "
@@ -984,6 +1116,9 @@ int ChunkManager::writeChunkToFile(CompFileData* fileData, ChunkData* chunkData)
             << " filename:" << fileData->fFileName << ", chunkId:" << chunkData->fChunkId
             << " data size:" << fLenCompressed << "/available:" << spaceAvl << " -- shifting ";
 
+        // the shift writes and frees the file's chunks itself
+        fCompressedChunks.clear();
+
         if ((rc = reallocateChunks(fileData)) == NO_ERROR)
         {
             oss << "SUCCESS";
@@ -1243,8 +1378,10 @@ int ChunkManager::closeFile(CompFileData* fileData)
 // (ex __LINE__); this is used for logging error messages.  For DML usage,
 // backup for recovery is also performed.  This step is skipped for cpimport.bin
 // as bulk import performs its own backup and recovery operations.
+// The file is synced afterwards unless flush is false, flushChunks() syncs all
+// its files at once.
 //------------------------------------------------------------------------------
-int ChunkManager::writeHeader(CompFileData* fileData, int ln)
+int ChunkManager::writeHeader(CompFileData* fileData, int ln, bool flush)
 {
     int rc = NO_ERROR;
     int headerSize = fCompressor.getHdrSize(fileData->fFileHeader.fControlData);
@@ -1287,7 +1424,7 @@ int ChunkManager::writeHeader(CompFileData* fileData, int ln)
                 logMessage(oss.str(), logging::LOG_TYPE_ERROR);
             }
 
-            if ((rc == NO_ERROR) && (rc = writeHeader_(fileData, ptrSecSize)) == NO_ERROR)
+            if ((rc == NO_ERROR) && (rc = writeHeader_(fileData, ptrSecSize)) == NO_ERROR && flush)
             {
                 (fileData->fFilePtr)->flush();
             }
@@ -1299,7 +1436,7 @@ int ChunkManager::writeHeader(CompFileData* fileData, int ln)
     }
     else
     {
-        if ((rc = writeHeader_(fileData, ptrSecSize)) == NO_ERROR)
+        if ((rc = writeHeader_(fileData, ptrSecSize)) == NO_ERROR && flush)
         {
             (fileData->fFilePtr)->flush();
         }
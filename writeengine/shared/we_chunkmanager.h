@@ -27,7 +27,9 @@
 #include <map>
 #include <list>
 #include <string>
+#include <vector>
 #include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "we_type.h"
 #include "we_typeext.h"
@@ -58,6 +60,11 @@ namespace logging
 class Logger;
 }
 
+namespace threadpool
+{
+class ThreadPool;
+}
+
 namespace WriteEngine
 {
 
@@ -88,6 +95,13 @@ struct ChunkData
     }
 };
 
+// a chunk compressed ahead of being written, into fFlushBufs[fBuf]
+struct CompressedChunk
+{
+    unsigned int    fBuf;
+    unsigned int    fLen;
+};
+
 // compressed DB file header information
 struct CompFileHeader
 {
@@ -299,12 +313,21 @@ protected:
     int writeChunkToFile(CompFileData* fileData, int64_t id);
     int writeChunkToFile(CompFileData* fileData, ChunkData* chunkData);
 
+    // @brief Write all the chunks of a file, compressing them in parallel.
+    int writeChunks(CompFileData* fileData);
+
+    // @brief Compress the next batch of changed chunks on fFlushThreads threads.
+    int compressChunks(std::list<ChunkData*>& chunkList);
+
+    // @brief Sync the files on fFlushThreads threads, see flushChunks().
+    int syncFiles(const std::vector<CompFileData*>& files);
+
     // @brief Write the compressed data to file and log a recover entry.
     int writeCompressedChunk(CompFileData* fileData, int64_t offset, int64_t size);
     inline int writeCompressedChunk_(CompFileData* fileData, int64_t offset);
 
-    // @brief Write the file header to disk.
-    int writeHeader(CompFileData* fileData, int ln);
+    // @brief Write the file header to disk, and sync the file if flush is true.
+    int writeHeader(CompFileData* fileData, int ln, bool flush = true);
     inline int writeHeader_(CompFileData* fileData, int ptrSecSize);
 
     // @brief open a compressed DB file.
@@ -367,6 +390,10 @@ protected:
     bool                                        fIsHdfs;
     FileOp*                                     fFileOp;
     compress::IDBCompressInterface              fCompressor;
+    unsigned int                                fFlushThreads;
+    boost::scoped_ptr<threadpool::ThreadPool>   fFlushPool;
+    std::vector<char*>                          fFlushBufs;
+    std::map<ChunkData*, CompressedChunk>       fCompressedChunks;
     logging::Logger*                            fSysLogger;
     TxnID                                       fTransId;
     int                                         fLocalModuleId;
@@ -47,6 +47,7 @@ const unsigned DEFAULT_EXTENTS_PER_SEGMENT_FILE   =  2;
 const int      DEFAULT_BULK_PROCESS_PRIORITY      = -1;
 const unsigned DEFAULT_MAX_FILESYSTEM_DISK_USAGE  = 98; // allow 98% full
 const unsigned DEFAULT_COMPRESSED_PADDING_BLKS    =  1;
+const unsigned DEFAULT_FLUSH_THREADS              =  1;
 const int      DEFAULT_LOCAL_MODULE_ID            = 1;
 const bool     DEFAULT_PARENT_OAM                 = true;
 const char*    DEFAULT_LOCAL_MODULE_TYPE          = "pm";
@@ -73,6 +74,7 @@ string   Config::m_BulkRollbackDir;
 unsigned Config::m_MaxFileSystemDiskUsage  =
     DEFAULT_MAX_FILESYSTEM_DISK_USAGE;
 unsigned Config::m_NumCompressedPadBlks    = DEFAULT_COMPRESSED_PADDING_BLKS;
+unsigned Config::m_FlushThreads            = DEFAULT_FLUSH_THREADS;
 bool     Config::m_ParentOAMModuleFlag     = DEFAULT_PARENT_OAM;
 string   Config::m_LocalModuleType;
 int      Config::m_LocalModuleID           = DEFAULT_LOCAL_MODULE_ID;
@@ -214,6 +216,18 @@ void Config::checkReload( )
     if ( ncpb.length() != 0 )
         m_NumCompressedPadBlks = cf->uFromText(ncpb);
 
+    //--------------------------------------------------------------------------
+    // Number of threads compressing and syncing chunks at commit
+    //--------------------------------------------------------------------------
+    m_FlushThreads = DEFAULT_FLUSH_THREADS;
+    string flt = cf->getConfig("WriteEngine", "FlushThreads");
+
+    if ( flt.length() != 0 )
+        m_FlushThreads = cf->uFromText(flt);
+
+    if ( m_FlushThreads == 0 )
+        m_FlushThreads = DEFAULT_FLUSH_THREADS;
+
     IDBPolicy::configIDBPolicy();
 
     //--------------------------------------------------------------------------
@@ -556,6 +570,21 @@ unsigned Config::getNumCompressedPadBlks()
     return m_NumCompressedPadBlks;
 }
 
+/*******************************************************************************
+ * DESCRIPTION:
+ *    Get number of threads used to compress the changed chunks of compressed
+ *    columns, and to sync their files, when a statement is committed.
+ * PARAMETERS:
+ *    none
+ ******************************************************************************/
+unsigned Config::getFlushThreads()
+{
+    boost::mutex::scoped_lock lk(fCacheLock);
+    checkReload( );
+
+    return m_FlushThreads;
+}
+
 /*******************************************************************************
  * DESCRIPTION:
  *    Get Parent OAM Module flag; are we running on active parent OAM node.
@@ -131,6 +131,11 @@ public:
      */
     EXPORT static unsigned getNumCompressedPadBlks();
 
+    /**
+     * @brief Number of threads compressing and syncing chunks at commit.
+     */
+    EXPORT static unsigned getFlushThreads();
+
     /**
      * @brief Parent OAM Module flag (is this the parent OAM node, ex: pm1)
      */
@@ -188,6 +193,7 @@ private:
     static std::string  m_BulkRollbackDir;       // bulk rollback meta data dir
     static unsigned     m_MaxFileSystemDiskUsage;// max file system % disk usage
     static unsigned     m_NumCompressedPadBlks;  // num blks to pad comp chunks
+    static unsigned     m_FlushThreads;          // threads flushing comp chunks
     static bool         m_ParentOAMModuleFlag;   // are we running on parent PM
     static std::string  m_LocalModuleType;       // local node type (ex: "pm")
     static int          m_LocalModuleID;         // local node id   (ex: 1   )